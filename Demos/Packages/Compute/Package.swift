@@ -25,7 +25,11 @@ let package = Package(
             .product(name: "CoreGraphicsSupport", package: "SwiftGraphics"),
             .product(name: "RenderKit", package: "RenderKit"),
         ]),
-        .executableTarget(name: "ComputeTool", dependencies: ["Compute"], resources: [
+        // RenderKitShaders' public headers (HashRandom.h) are on the Metal compiler's search path through this dependency.
+        .executableTarget(name: "ComputeTool", dependencies: [
+            "Compute",
+            .product(name: "RenderKitShaders", package: "RenderKit"),
+        ], resources: [
             .process("BitonicSort.metal"),
             .process("GameOfLife.metal"),
             .process("RandomFill.metal"),
@@ -1,16 +1,12 @@
 #include <metal_stdlib>
 #include <simd/simd.h>
+#include "HashRandom.h"
 
 using namespace metal;
 
 float random(float2 p)
 {
-  // We need irrationals for pseudo randomness.
-  // Most (all?) known transcendental numbers will (generally) work.
-  const float2 r = float2(
-    23.1406926327792690,  // e^pi (Gelfond's constant)
-     2.6651441426902251); // 2^sqrt(2) (Gelfond–Schneider constant)
-  return fract(cos(fmod(123456789.0, 1e-7 + 256.0 * dot(p,r))));
+  return hashRandom::rand2dTo1d(p);
 }
 
 [[kernel]]
@@ -15,6 +15,8 @@ let package = Package(
         .library(name: "RenderKit", targets: ["RenderKit"]),
         .library(name: "RenderKitScratch", targets: ["RenderKitScratch"]),
         .library(name: "RenderKitShaders", targets: ["RenderKitShaders"]),
+        .library(name: "RenderKitCPU", targets: ["RenderKitCPU"]),
+        .library(name: "RenderKitShadersHost", targets: ["RenderKitShadersHost"]),
     ],
     dependencies: [
         .package(url: "https://github.com/schwa/Everything", branch: "jwight/downsizing"),
@@ -58,6 +60,30 @@ let package = Package(
                 //                .plugin(name: "MetalCompilerPlugin", package: "MetalCompilerPlugin")
             ]
         ),
+        .target(
+            name: "RenderKitCPU",
+            linkerSettings: [
+                .linkedLibrary("pthread", .when(platforms: [.linux])),
+            ]
+        ),
+        .target(
+            name: "RenderKitShadersHost",
+            dependencies: ["RenderKitCPU"],
+            exclude: [
+                "MetalShim/metal_stdlib",
+            ],
+            cxxSettings: [
+                .headerSearchPath("MetalShim"),
+            ]
+        ),
+        .target(
+            name: "RenderKitCPUBenchmarking",
+            dependencies: ["RenderKitCPU"]
+        ),
+        .executableTarget(
+            name: "RenderKitCPUBenchmarks",
+            dependencies: ["RenderKitCPU", "RenderKitCPUBenchmarking", "RenderKitShadersHost"]
+        ),
         .target(
             name: "RenderKitScratch",
             dependencies: [
@@ -68,5 +94,13 @@ let package = Package(
         .testTarget(
             name: "RenderKitTests",
             dependencies: ["RenderKit", "RenderKitScratch"]),
-    ]
+        .testTarget(
+            name: "RenderKitCPUTests",
+            dependencies: ["RenderKitCPU", "RenderKitCPUBenchmarking", "RenderKitShadersHost"],
+            swiftSettings: [
+                .interoperabilityMode(.Cxx),
+            ]
+        ),
+    ],
+    cxxLanguageStandard: .cxx20
 )
@@ -125,7 +125,9 @@ internal class MetalViewModel: NSObject, MTKViewDelegate {
             fatalError()
         }
         do {
-            try draw(device, view.configuration, view.drawableSize, currentDrawable, currentRenderPassDescriptor)
+            try signposter.withIntervalSignpost("MetalView.draw") {
+                try draw(device, view.configuration, view.drawableSize, currentDrawable, currentRenderPassDescriptor)
+            }
         }
         catch {
             set(error: error)
@@ -72,7 +72,9 @@ public extension RenderPass {
             fatalError()
         }
         try commandQueue.withCommandBuffer(waitAfterCommit: true) { commandBuffer in
-            try draw(device: device, size: size, renderPassDescriptor: configuration.currentRenderPassDescriptor!, commandBuffer: commandBuffer)
+            try signposter.withIntervalSignpost("OffscreenRenderPass.draw") {
+                try draw(device: device, size: size, renderPassDescriptor: configuration.currentRenderPassDescriptor!, commandBuffer: commandBuffer)
+            }
         }
         let cgImage = await configuration.targetTexture!.cgImage(colorSpace: CGColorSpace(name: CGColorSpace.extendedSRGB))
         return cgImage
@@ -32,7 +32,9 @@ public struct RendererView <T>: View where T: RenderPass {
             }
             try commandQueue.withCommandBuffer(drawable: currentDrawable, block: { commandBuffer in
                 commandBuffer.label = "RendererView-CommandBuffer"
-                try renderPass.draw(device: device, size: size, renderPassDescriptor: renderPassDescriptor, commandBuffer: commandBuffer)
+                try signposter.withIntervalSignpost("RenderPass.draw") {
+                    try renderPass.draw(device: device, size: size, renderPassDescriptor: renderPassDescriptor, commandBuffer: commandBuffer)
+                }
             })
         }
         .onAppear {
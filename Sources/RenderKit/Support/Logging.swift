@@ -1,3 +1,6 @@
 import os
 
 let logger: Logger? = Logger()
+
+// Intervals around render pass draws, shown in Instruments' Points of Interest track. Signposts cost next to nothing unless a tool is recording them.
+let signposter = OSSignposter(subsystem: "RenderKit", category: .pointsOfInterest)
@@ -250,7 +250,13 @@ public extension VertexDescriptor {
                     return nil
                 }
                 let format = MTLVertexFormat(mdlAttribute.format)
-                return Attribute(semantic: nil, format: format, offset: mdlAttribute.offset)
+                let semantic: Semantic? = switch mdlAttribute.name {
+                case MDLVertexAttributePosition: .position
+                case MDLVertexAttributeNormal: .normal
+                case MDLVertexAttributeTextureCoordinate: .textureCoordinate
+                default: nil
+                }
+                return Attribute(semantic: semantic, format: format, offset: mdlAttribute.offset)
             }
             return .init(label: nil, bufferIndex: bufferIndex, stride: mdlLayout.stride, stepFunction: .perVertex, stepRate: 1, attributes: attributes)
         }
@@ -260,14 +266,21 @@ public extension VertexDescriptor {
 
 public extension VertexDescriptor {
     /// Convenience method for creating packed descriptors with common attribute types/sizes...
-    static func packed(label: String? = nil, semantics: [Semantic]) -> VertexDescriptor {
+    /// With `quantized` the attributes are those of `QuantizedVertex` (QuantizedVertex.h): unorm16 positions within the mesh's bounds, octahedral snorm16 normals and half texture coordinates.
+    static func packed(label: String? = nil, semantics: [Semantic], quantized: Bool = false) -> VertexDescriptor {
         let attributes: [Attribute] = semantics.map { semantic in
             let format: MTLVertexFormat
-            switch semantic {
-            case .position, .normal:
+            switch (semantic, quantized) {
+            case (.position, false), (.normal, false):
                 format = .float3
-            case .textureCoordinate:
+            case (.textureCoordinate, false):
                 format = .float2
+            case (.position, true):
+                format = .ushort4Normalized
+            case (.normal, true):
+                format = .short2Normalized
+            case (.textureCoordinate, true):
+                format = .half2
             }
             return .init(semantic: semantic, format: format, offset: 0)
         }
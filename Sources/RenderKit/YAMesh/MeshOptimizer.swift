@@ -0,0 +1,456 @@
+import Foundation
+import Metal
+import simd
+
+/// Reorders indexed triangle lists to draw the same triangles for less work: for the post-transform vertex cache with Tipsify, then for less overdraw by sorting clusters of those triangles outside-in (both from Sander, Nehab & Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007), and finally renumbering vertices in the order they are first fetched. Every triangle keeps its vertices and winding.
+public enum MeshOptimizer {
+    /// Metal doesn't document the size of its post-transform cache; orders that suit a 16 entry FIFO do well across GPUs.
+    public static let defaultCacheSize = 16
+
+    /// The default for how much worse than Tipsify's order, as a cache miss ratio, a cluster may get so that it can be split for overdraw.
+    public static let defaultOverdrawThreshold: Float = 1.05
+
+    /// How a triangle list uses a FIFO post-transform vertex cache.
+    public struct CacheStatistics: Hashable, Sendable {
+        public var triangleCount: Int
+        /// Distinct vertices the triangles use.
+        public var vertexCount: Int
+        /// Cache misses: the vertex shader invocations the triangles cost.
+        public var transformedVertexCount: Int
+
+        public init(triangleCount: Int = 0, vertexCount: Int = 0, transformedVertexCount: Int = 0) {
+            self.triangleCount = triangleCount
+            self.vertexCount = vertexCount
+            self.transformedVertexCount = transformedVertexCount
+        }
+
+        /// Average cache miss ratio: transformed vertices per triangle, from 3 down to about 0.5 for large closed meshes.
+        public var acmr: Double {
+            triangleCount > 0 ? Double(transformedVertexCount) / Double(triangleCount) : 0
+        }
+
+        /// Average transform to vertex ratio: transformed vertices per distinct vertex, 1 at best.
+        public var atvr: Double {
+            vertexCount > 0 ? Double(transformedVertexCount) / Double(vertexCount) : 0
+        }
+    }
+
+    public struct Report: Hashable, Sendable {
+        public var before: CacheStatistics
+        public var after: CacheStatistics
+
+        public init(before: CacheStatistics, after: CacheStatistics) {
+            self.before = before
+            self.after = after
+        }
+    }
+
+    // MARK: Analysis
+
+    /// Simulates `indices`, a triangle list, drawn through a FIFO cache of `cacheSize` vertices.
+    public static func analyzeVertexCache(indices: [UInt32], vertexCount: Int, cacheSize: Int = defaultCacheSize) -> CacheStatistics {
+        analyzeVertexCache(draws: [indices], vertexCount: vertexCount, cacheSize: cacheSize)
+    }
+
+    /// As `analyzeVertexCache(indices:vertexCount:cacheSize:)` for several draws of one vertex buffer; the cache starts empty for each.
+    static func analyzeVertexCache(draws: [[UInt32]], vertexCount: Int, cacheSize: Int) -> CacheStatistics {
+        var statistics = CacheStatistics()
+        var used = [Bool](repeating: false, count: vertexCount)
+        for indices in draws {
+            var cache = FIFOCache(vertexCount: vertexCount, size: cacheSize)
+            statistics.triangleCount += indices.count / 3
+            for index in indices {
+                let vertex = Int(index)
+                if !used[vertex] {
+                    used[vertex] = true
+                    statistics.vertexCount += 1
+                }
+                if cache.insert(vertex) {
+                    statistics.transformedVertexCount += 1
+                }
+            }
+        }
+        return statistics
+    }
+
+    // MARK: Ordering
+
+    /// Tipsify: emits the triangles around one vertex at a time, moving next to the vertex just emitted that has been cached longest yet will still be cached once its own remaining triangles are emitted. Runs in time linear in the triangle count.
+    public static func optimizeVertexCache(indices: [UInt32], vertexCount: Int, cacheSize: Int = defaultCacheSize) -> [UInt32] {
+        precondition(indices.count.isMultiple(of: 3), "Indices must form a triangle list.")
+        let triangleCount = indices.count / 3
+
+        // The triangles using each vertex, as ranges of `adjacency`, and how many of those are still to be emitted.
+        var liveTriangles = [Int](repeating: 0, count: vertexCount)
+        for index in indices {
+            liveTriangles[Int(index)] += 1
+        }
+        var offsets = [Int](repeating: 0, count: vertexCount + 1)
+        for vertex in 0 ..< vertexCount {
+            offsets[vertex + 1] = offsets[vertex] + liveTriangles[vertex]
+        }
+        var adjacency = [Int](repeating: 0, count: offsets[vertexCount])
+        var fill = offsets
+        for (corner, index) in indices.enumerated() {
+            let vertex = Int(index)
+            adjacency[fill[vertex]] = corner / 3
+            fill[vertex] += 1
+        }
+
+        var cache = FIFOCache(vertexCount: vertexCount, size: cacheSize)
+        var emitted = [Bool](repeating: false, count: triangleCount)
+        var result: [UInt32] = []
+        result.reserveCapacity(indices.count)
+        // Recently emitted vertices, to fall back on when a fan leaves no candidate.
+        var deadEnds: [Int] = []
+        var candidates: [Int] = []
+        // Vertices before this in input order have no live triangles left or are on the dead-end stack.
+        var cursor = 0
+
+        func nextDeadEnd() -> Int? {
+            while let vertex = deadEnds.popLast() {
+                if liveTriangles[vertex] > 0 {
+                    return vertex
+                }
+            }
+            while cursor < vertexCount {
+                let vertex = cursor
+                cursor += 1
+                if liveTriangles[vertex] > 0 {
+                    return vertex
+                }
+            }
+            return nil
+        }
+
+        var fan = nextDeadEnd()
+        while let vertex = fan {
+            candidates.removeAll(keepingCapacity: true)
+            for triangle in adjacency[offsets[vertex] ..< offsets[vertex + 1]] where !emitted[triangle] {
+                emitted[triangle] = true
+                for index in indices[triangle * 3 ..< triangle * 3 + 3] {
+                    let other = Int(index)
+                    result.append(index)
+                    deadEnds.append(other)
+                    candidates.append(other)
+                    liveTriangles[other] -= 1
+                    _ = cache.insert(other)
+                }
+            }
+            var best: Int?
+            var bestPriority = -1
+            for candidate in candidates where liveTriangles[candidate] > 0 {
+                let age = cache.age(of: candidate)
+                let priority = age + 2 * liveTriangles[candidate] <= cacheSize ? age : 0
+                if priority > bestPriority {
+                    best = candidate
+                    bestPriority = priority
+                }
+            }
+            fan = best ?? nextDeadEnd()
+        }
+        return result
+    }
+
+    /// Splits a cache-ordered triangle list into clusters, wherever the order breaks off (a triangle that misses the cache three times) and then wherever the cluster so far has a cache miss ratio within `threshold` of its whole, and draws the clusters facing furthest away from the mesh's centre first. On mostly convex meshes those clusters occlude the ones behind them, so fewer fragments are shaded and discarded. `positions` is indexed by vertex.
+    public static func optimizeOverdraw(indices: [UInt32], positions: [SIMD3<Float>], threshold: Float = defaultOverdrawThreshold, cacheSize: Int = defaultCacheSize) -> [UInt32] {
+        precondition(indices.count.isMultiple(of: 3), "Indices must form a triangle list.")
+        let triangleCount = indices.count / 3
+        guard triangleCount > 0 else {
+            return indices
+        }
+        var cache = FIFOCache(vertexCount: positions.count, size: cacheSize)
+        func misses(_ triangle: Int) -> Int {
+            var count = 0
+            for index in indices[triangle * 3 ..< triangle * 3 + 3] {
+                if cache.insert(Int(index)) {
+                    count += 1
+                }
+            }
+            return count
+        }
+
+        // MARK: Clusters
+        var hardBoundaries: [Int] = []
+        for triangle in 0 ..< triangleCount {
+            if misses(triangle) == 3 || triangle == 0 {
+                hardBoundaries.append(triangle)
+            }
+        }
+        var clusters: [Range<Int>] = []
+        for (number, start) in hardBoundaries.enumerated() {
+            let end = number + 1 < hardBoundaries.count ? hardBoundaries[number + 1] : triangleCount
+            cache.flush()
+            let clusterMisses = (start ..< end).reduce(0) { $0 + misses($1) }
+            let target = threshold * Float(clusterMisses) / Float(end - start)
+            cache.flush()
+            var first = start
+            var runningMisses = 0
+            for triangle in start ..< end {
+                runningMisses += misses(triangle)
+                if Float(runningMisses) / Float(triangle + 1 - first) <= target, triangle + 1 < end {
+                    clusters.append(first ..< triangle + 1)
+                    first = triangle + 1
+                    runningMisses = 0
+                    cache.flush()
+                }
+            }
+            clusters.append(first ..< end)
+        }
+        guard clusters.count > 1 else {
+            return indices
+        }
+
+        // MARK: Sorting
+        var used = [Bool](repeating: false, count: positions.count)
+        var centre = SIMD3<Float>.zero
+        var usedCount = 0
+        for index in indices where !used[Int(index)] {
+            used[Int(index)] = true
+            centre += positions[Int(index)]
+            usedCount += 1
+        }
+        centre /= Float(usedCount)
+        // How far the cluster's area-weighted centroid lies in front of the centre, along the cluster's average normal.
+        let keys: [Float] = clusters.map { cluster in
+            var centroid = SIMD3<Float>.zero
+            var normal = SIMD3<Float>.zero
+            var area: Float = 0
+            for triangle in cluster {
+                let a = positions[Int(indices[triangle * 3])]
+                let b = positions[Int(indices[triangle * 3 + 1])]
+                let c = positions[Int(indices[triangle * 3 + 2])]
+                let crossProduct = cross(b - a, c - a)
+                let triangleArea = length(crossProduct)
+                centroid += (a + b + c) / 3 * triangleArea
+                normal += crossProduct
+                area += triangleArea
+            }
+            let normalLength = length(normal)
+            guard area > 0, normalLength > 0 else {
+                return 0
+            }
+            let key = dot(centroid / area - centre, normal / normalLength)
+            return key.isNaN ? 0 : key
+        }
+        let order = clusters.indices.sorted { keys[$0] != keys[$1] ? keys[$0] > keys[$1] : $0 < $1 }
+        var result: [UInt32] = []
+        result.reserveCapacity(indices.count)
+        for cluster in order {
+            result += indices[clusters[cluster].lowerBound * 3 ..< clusters[cluster].upperBound * 3]
+        }
+        return result
+    }
+
+    // MARK: Vertex fetch
+
+    /// New numbers for the vertices in the order `indices` first uses them, so vertex fetches walk forward through memory. Vertices no triangle uses map to nil and are dropped; `vertexCount` is how many remain.
+    public static func vertexFetchRemap(indices: [UInt32], vertexCount: Int) -> (remap: [Int?], vertexCount: Int) {
+        var remap = [Int?](repeating: nil, count: vertexCount)
+        var next = 0
+        for index in indices where remap[Int(index)] == nil {
+            remap[Int(index)] = next
+            next += 1
+        }
+        return (remap, next)
+    }
+
+    public static func remapIndices(_ indices: [UInt32], with remap: [Int?]) -> [UInt32] {
+        indices.map { UInt32(remap[Int($0)]!) }
+    }
+
+    public static func remapVertices<Vertex>(_ vertices: [Vertex], with remap: [Int?], vertexCount: Int) -> [Vertex] {
+        var sources = [Int](repeating: 0, count: vertexCount)
+        for (vertex, new) in remap.enumerated() {
+            if let new {
+                sources[new] = vertex
+            }
+        }
+        return sources.map { vertices[$0] }
+    }
+
+    // MARK: Pipeline
+
+    /// Runs every pass over one triangle list and its vertices: Tipsify, overdraw clustering, then vertex fetch order.
+    public static func optimize<Vertex>(indices: [UInt32], vertices: [Vertex], position: (Vertex) -> SIMD3<Float>, cacheSize: Int = defaultCacheSize, overdrawThreshold: Float = defaultOverdrawThreshold) -> (indices: [UInt32], vertices: [Vertex], report: Report) {
+        let before = analyzeVertexCache(indices: indices, vertexCount: vertices.count, cacheSize: cacheSize)
+        var optimized = optimizeVertexCache(indices: indices, vertexCount: vertices.count, cacheSize: cacheSize)
+        optimized = optimizeOverdraw(indices: optimized, positions: vertices.map(position), threshold: overdrawThreshold, cacheSize: cacheSize)
+        let (remap, vertexCount) = vertexFetchRemap(indices: optimized, vertexCount: vertices.count)
+        let remappedIndices = remapIndices(optimized, with: remap)
+        let after = analyzeVertexCache(indices: remappedIndices, vertexCount: vertexCount, cacheSize: cacheSize)
+        return (remappedIndices, remapVertices(vertices, with: remap, vertexCount: vertexCount), Report(before: before, after: after))
+    }
+}
+
+extension MeshOptimizer.CacheStatistics: CustomStringConvertible {
+    public var description: String {
+        String(format: "%d triangles, %d vertices, ACMR %.3f, ATVR %.3f", triangleCount, vertexCount, acmr, atvr)
+    }
+}
+
+extension MeshOptimizer.Report: CustomStringConvertible {
+    public var description: String {
+        String(format: "ACMR %.3f → %.3f, ATVR %.3f → %.3f", before.acmr, after.acmr, before.atvr, after.atvr)
+    }
+}
+
+// MARK: -
+
+/// A FIFO cache of vertices, kept as the time each vertex last entered it: a vertex is cached while fewer than `size` others have entered since.
+struct FIFOCache {
+    let size: Int
+    var time: Int
+    var timestamps: [Int]
+
+    init(vertexCount: Int, size: Int) {
+        self.size = size
+        time = size + 1
+        timestamps = .init(repeating: 0, count: vertexCount)
+    }
+
+    /// 1 for the vertex that entered last, more than `size` once evicted.
+    func age(of vertex: Int) -> Int {
+        time - timestamps[vertex]
+    }
+
+    /// Returns true on a miss, when the vertex enters the cache.
+    mutating func insert(_ vertex: Int) -> Bool {
+        guard age(of: vertex) > size else {
+            return false
+        }
+        timestamps[vertex] = time
+        time += 1
+        return true
+    }
+
+    mutating func flush() {
+        time += size + 1
+    }
+}
+
+// MARK: -
+
+public extension YAMesh {
+    /// The mesh with every submesh's triangles reordered by `MeshOptimizer` and one vertex buffer per per-vertex layout rewritten in fetch order, dropping unused vertices. Submeshes must be triangle lists in CPU-visible buffers. Overdraw ordering needs positions: the `.position` attribute, or the first float3 or float4 attribute without a semantic; meshes without one only get the cache and fetch passes.
+    func optimized(device: MTLDevice, cacheSize: Int = MeshOptimizer.defaultCacheSize, overdrawThreshold: Float = MeshOptimizer.defaultOverdrawThreshold) throws -> (mesh: YAMesh, report: MeshOptimizer.Report) {
+        let vertexCount = try vertexCapacity()
+        let draws = try submeshes.map { try $0.triangleIndices(vertexCount: vertexCount) }
+        let vertexPositions = positions(count: vertexCount)
+        let optimizedDraws = draws.map { indices in
+            let indices = MeshOptimizer.optimizeVertexCache(indices: indices, vertexCount: vertexCount, cacheSize: cacheSize)
+            guard let positions = vertexPositions else {
+                return indices
+            }
+            return MeshOptimizer.optimizeOverdraw(indices: indices, positions: positions, threshold: overdrawThreshold, cacheSize: cacheSize)
+        }
+        // One order across all submeshes, as they share the vertex buffers.
+        let (remap, remappedVertexCount) = MeshOptimizer.vertexFetchRemap(indices: Array(optimizedDraws.joined()), vertexCount: vertexCount)
+        let remappedDraws = optimizedDraws.map { MeshOptimizer.remapIndices($0, with: remap) }
+        var sources = [Int](repeating: 0, count: remappedVertexCount)
+        for (vertex, new) in remap.enumerated() {
+            if let new {
+                sources[new] = vertex
+            }
+        }
+
+        var mesh = self
+        mesh.vertexBufferViews = try zip(vertexDescriptor.layouts, vertexBufferViews).map { layout, view in
+            guard layout.stepFunction == .perVertex, layout.stride > 0 else {
+                return view
+            }
+            guard let buffer = device.makeBuffer(length: max(remappedVertexCount * layout.stride, 1), options: .storageModeShared) else {
+                throw RenderKitError.generic("Could not allocate an optimized vertex buffer.")
+            }
+            buffer.label = view.buffer.label
+            let source = UnsafeRawPointer(view.buffer.contents() + view.offset)
+            for (new, vertex) in sources.enumerated() {
+                (buffer.contents() + new * layout.stride).copyMemory(from: source + vertex * layout.stride, byteCount: layout.stride)
+            }
+            return BufferView(label: view.label, buffer: buffer, offset: 0)
+        }
+        mesh.submeshes = try zip(submeshes, remappedDraws).map { submesh, indices in
+            guard !indices.isEmpty else {
+                return submesh
+            }
+            let buffer: MTLBuffer?
+            switch submesh.indexType {
+            case .uint16:
+                buffer = device.makeBuffer(bytesOf: indices.map { UInt16($0) }, options: .storageModeShared)
+            default:
+                buffer = device.makeBuffer(bytesOf: indices, options: .storageModeShared)
+            }
+            guard let buffer else {
+                throw RenderKitError.generic("Could not allocate an optimized index buffer.")
+            }
+            buffer.label = submesh.indexBufferView.buffer.label
+            var submesh = submesh
+            submesh.indexBufferView = BufferView(label: submesh.indexBufferView.label, buffer: buffer, offset: 0)
+            return submesh
+        }
+        let before = MeshOptimizer.analyzeVertexCache(draws: draws, vertexCount: vertexCount, cacheSize: cacheSize)
+        let after = MeshOptimizer.analyzeVertexCache(draws: remappedDraws, vertexCount: remappedVertexCount, cacheSize: cacheSize)
+        return (mesh, MeshOptimizer.Report(before: before, after: after))
+    }
+
+    /// How the mesh's triangle lists use a FIFO post-transform vertex cache, with the cache emptied between submeshes.
+    func vertexCacheStatistics(cacheSize: Int = MeshOptimizer.defaultCacheSize) throws -> MeshOptimizer.CacheStatistics {
+        let vertexCount = try vertexCapacity()
+        let draws = try submeshes.map { try $0.triangleIndices(vertexCount: vertexCount) }
+        return MeshOptimizer.analyzeVertexCache(draws: draws, vertexCount: vertexCount, cacheSize: cacheSize)
+    }
+}
+
+extension YAMesh {
+    /// The vertices every per-vertex buffer has room for.
+    func vertexCapacity() throws -> Int {
+        guard vertexBufferViews.allSatisfy({ $0.buffer.storageMode != .private }) else {
+            throw RenderKitError.generic("Vertex buffers must be CPU visible.")
+        }
+        let capacities = zip(vertexDescriptor.layouts, vertexBufferViews).compactMap { layout, view in
+            layout.stepFunction == .perVertex && layout.stride > 0 ? (view.buffer.length - view.offset) / layout.stride : nil
+        }
+        return capacities.min() ?? 0
+    }
+
+    func positions(count: Int) -> [SIMD3<Float>]? {
+        let formats: [MTLVertexFormat] = [.float3, .float4]
+        let attributes = zip(vertexDescriptor.layouts, vertexBufferViews).flatMap { layout, view in
+            layout.attributes.map { attribute in (layout: layout, view: view, attribute: attribute) }
+        }
+        guard let match = attributes.first(where: { $0.attribute.semantic == .position }) ?? attributes.first(where: { $0.attribute.semantic == nil && formats.contains($0.attribute.format) }), match.layout.stepFunction == .perVertex, formats.contains(match.attribute.format) else {
+            return nil
+        }
+        let base = UnsafeRawPointer(match.view.buffer.contents() + match.view.offset + match.attribute.offset)
+        return (0 ..< count).map { vertex in
+            let pointer = base + vertex * match.layout.stride
+            return SIMD3<Float>(pointer.loadUnaligned(as: Float.self), pointer.loadUnaligned(fromByteOffset: 4, as: Float.self), pointer.loadUnaligned(fromByteOffset: 8, as: Float.self))
+        }
+    }
+}
+
+extension YAMesh.Submesh {
+    /// The index buffer widened to 32 bits, checked to be a triangle list within `vertexCount` vertices.
+    func triangleIndices(vertexCount: Int) throws -> [UInt32] {
+        guard primitiveType == .triangle, indexCount.isMultiple(of: 3) else {
+            throw RenderKitError.generic("Only triangle lists can be optimized.")
+        }
+        guard indexBufferView.buffer.storageMode != .private else {
+            throw RenderKitError.generic("Index buffers must be CPU visible.")
+        }
+        let pointer = UnsafeRawPointer(indexBufferView.buffer.contents() + indexBufferView.offset)
+        let indices: [UInt32]
+        switch indexType {
+        case .uint16:
+            indices = (0 ..< indexCount).map { UInt32(pointer.loadUnaligned(fromByteOffset: $0 * 2, as: UInt16.self)) }
+        case .uint32:
+            indices = (0 ..< indexCount).map { pointer.loadUnaligned(fromByteOffset: $0 * 4, as: UInt32.self) }
+        @unknown default:
+            throw RenderKitError.generic("Unknown index type.")
+        }
+        guard indices.allSatisfy({ Int($0) < vertexCount }) else {
+            throw RenderKitError.generic("Indices reach past the vertex buffers.")
+        }
+        return indices
+    }
+}
@@ -92,7 +92,15 @@ public extension YAMesh {
 }
 
 public extension YAMesh {
-    static func simpleMesh(label: String? = nil, indices: [UInt16], vertices: [SimpleVertex], primitiveType: MTLPrimitiveType = .triangle, device: MTLDevice) throws -> YAMesh {
+    /// With `optimize`, triangle lists are reordered by `MeshOptimizer` before upload.
+    static func simpleMesh(label: String? = nil, indices: [UInt16], vertices: [SimpleVertex], primitiveType: MTLPrimitiveType = .triangle, optimize: Bool = false, device: MTLDevice) throws -> YAMesh {
+        var indices = indices
+        var vertices = vertices
+        if optimize, primitiveType == .triangle {
+            let optimized = MeshOptimizer.optimize(indices: indices.map { UInt32($0) }, vertices: vertices, position: \.position)
+            indices = optimized.indices.map { UInt16($0) }
+            vertices = optimized.vertices
+        }
         guard let indexBuffer = device.makeBuffer(bytesOf: indices, options: .storageModeShared) else {
             fatalError()
         }
@@ -167,8 +175,10 @@ public extension YAMesh {
 }
 
 public extension Shape3D {
-    func toYAMesh(allocator: MDLMeshBufferAllocator?, device: MTLDevice) throws -> YAMesh {
+    /// With `optimize`, the mesh is passed through `YAMesh.optimized(device:)`.
+    func toYAMesh(allocator: MDLMeshBufferAllocator?, optimize: Bool = false, device: MTLDevice) throws -> YAMesh {
         let mdlMesh = self.toMDLMesh(allocator: allocator)
-        return try YAMesh(label: "\(type(of: self))", mdlMesh: mdlMesh, device: device)
+        let mesh = try YAMesh(label: "\(type(of: self))", mdlMesh: mdlMesh, device: device)
+        return optimize ? try mesh.optimized(device: device).mesh : mesh
     }
 }
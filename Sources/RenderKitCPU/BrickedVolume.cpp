@@ -0,0 +1,478 @@
+#include "BrickedVolume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "Parallel.h"
+
+namespace volume {
+
+struct BrickedVolume::Mapping {
+    void *address = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (address) {
+            munmap(address, size);
+        }
+    }
+};
+
+namespace {
+
+constexpr char magic[4] = { 'R', 'K', 'B', 'V' };
+constexpr uint32_t version = 1;
+constexpr size_t pageAlignment = 16384;
+constexpr size_t histogramSize = 65536;
+
+// The file starts with this header, followed by the 65536 entry histogram, the brick records and, from `dataOffset`, the bricks themselves every `brickStride` bytes. Everything is little endian.
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t size[3];
+    float spacing[3];
+    uint32_t brickSize;
+    uint16_t minValue;
+    uint16_t maxValue;
+    uint64_t recordOffset;
+    uint64_t dataOffset;
+    uint64_t brickStride;
+};
+
+static_assert(sizeof(FileHeader) == 64);
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Bricks per axis: enough to cover the size - 1 trilinear cells (at least one).
+uint32_t brickCountAlong(uint32_t size, uint32_t brickSize) {
+    return (std::max(size, 2u) - 1 + brickSize - 1) / brickSize;
+}
+
+size_t brickVoxels(uint32_t brickSize) {
+    return size_t(brickSize + 1) * (brickSize + 1) * (brickSize + 1);
+}
+
+struct Layout {
+    uint32_t brickGrid[3];
+    size_t brickCount;
+    size_t recordOffset;
+    size_t dataOffset;
+    size_t brickStride;
+    size_t fileSize;
+
+    Layout(const uint32_t *size, uint32_t brickSize) {
+        brickCount = 1;
+        for (int axis = 0; axis != 3; ++axis) {
+            brickGrid[axis] = brickCountAlong(size[axis], brickSize);
+            brickCount *= brickGrid[axis];
+        }
+        recordOffset = sizeof(FileHeader) + histogramSize * sizeof(uint64_t);
+        dataOffset = alignUp(recordOffset + brickCount * sizeof(BrickRecord), pageAlignment);
+        brickStride = alignUp(brickVoxels(brickSize) * sizeof(uint16_t), pageAlignment);
+        fileSize = dataOffset + brickCount * brickStride;
+    }
+};
+
+bool writeAll(int descriptor, const void *bytes, size_t count, size_t offset) {
+    const uint8_t *cursor = static_cast<const uint8_t *>(bytes);
+    while (count > 0) {
+        const ssize_t written = pwrite(descriptor, cursor, count, off_t(offset));
+        if (written <= 0) {
+            return false;
+        }
+        cursor += written;
+        count -= size_t(written);
+        offset += size_t(written);
+    }
+    return true;
+}
+
+}
+
+// MARK: BrickedVolume
+
+bool BrickedVolume::open(const std::string &path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        message = "cannot open " + path;
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+        ::close(descriptor);
+        message = "cannot read " + path;
+        return false;
+    }
+    auto newMapping = std::make_shared<Mapping>();
+    newMapping->size = size_t(status.st_size);
+    void *address = mmap(nullptr, newMapping->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (address == MAP_FAILED) {
+        message = "cannot map " + path;
+        return false;
+    }
+    newMapping->address = address;
+    // Bricks are read as rays reach them, not in file order.
+    madvise(address, newMapping->size, MADV_RANDOM);
+    mapping = std::move(newMapping);
+    return parse(static_cast<const uint8_t *>(mapping->address), mapping->size);
+}
+
+bool BrickedVolume::parse(const uint8_t *bytes, size_t size) {
+    message.clear();
+    counts = nullptr;
+    records = nullptr;
+    data = nullptr;
+    FileHeader header;
+    if (size < sizeof(header) || std::memcmp(bytes, magic, 4) != 0) {
+        message = "not a bricked volume";
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (header.version != version) {
+        message = "unsupported bricked volume version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.brickSize == 0 || header.brickSize > maximumBrickSize || std::count(header.size, header.size + 3, 0u) > 0 || !std::all_of(header.spacing, header.spacing + 3, [](float value) { return std::isfinite(value) && value > 0; })) {
+        message = "invalid volume or brick size";
+        return false;
+    }
+    // Checks the layout against the one the writer would have produced, which also bounds every offset by the file size.
+    double brickCount = 1;
+    for (int axis = 0; axis != 3; ++axis) {
+        brickCount *= brickCountAlong(header.size[axis], header.brickSize);
+    }
+    if (brickCount * pageAlignment > double(size)) {
+        message = "truncated or inconsistent bricked volume";
+        return false;
+    }
+    const Layout layout(header.size, header.brickSize);
+    if (layout.fileSize > size || header.recordOffset != layout.recordOffset || header.dataOffset != layout.dataOffset || header.brickStride != layout.brickStride) {
+        message = "truncated or inconsistent bricked volume";
+        return false;
+    }
+
+    std::copy_n(header.size, 3, dimensions);
+    std::copy_n(header.spacing, 3, voxelSpacing);
+    std::copy_n(layout.brickGrid, 3, brickGrid);
+    bricks = header.brickSize;
+    stride = layout.brickStride;
+    minimum = header.minValue;
+    maximum = header.maxValue;
+    counts = reinterpret_cast<const uint64_t *>(bytes + sizeof(FileHeader));
+    records = reinterpret_cast<const BrickRecord *>(bytes + layout.recordOffset);
+    data = bytes + layout.dataOffset;
+    return true;
+}
+
+// MARK: Writing
+
+bool writeBrickedVolume(const std::string &path, uint32_t width, uint32_t height, uint32_t depth, const float *spacing, uint32_t brickSize, const std::function<void(uint32_t z, uint16_t *slice)> &readSlice, std::string &error) {
+    if (width == 0 || height == 0 || depth == 0 || brickSize == 0 || brickSize > BrickedVolume::maximumBrickSize) {
+        error = "invalid volume or brick size";
+        return false;
+    }
+    const int descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0) {
+        error = "cannot create " + path;
+        return false;
+    }
+    const uint32_t size[3] = { width, height, depth };
+    const Layout layout(size, brickSize);
+    if (ftruncate(descriptor, off_t(layout.fileSize)) != 0) {
+        ::close(descriptor);
+        error = "cannot size " + path;
+        return false;
+    }
+
+    const size_t sliceSize = size_t(width) * height;
+    const size_t voxelCount = brickVoxels(brickSize);
+    const size_t layerBricks = size_t(layout.brickGrid[0]) * layout.brickGrid[1];
+    std::vector<uint16_t> slices(sliceSize * (brickSize + 1));
+    std::vector<uint64_t> histogram(histogramSize, 0);
+    std::vector<BrickRecord> layerRecords(layerBricks);
+    bool succeeded = true;
+
+    for (uint32_t brickZ = 0; brickZ != layout.brickGrid[2] && succeeded; ++brickZ) {
+        // Slices brickZ * brickSize ... + brickSize, repeating the last past the end. The first was the previous layer's last.
+        const uint32_t firstZ = brickZ * brickSize;
+        for (uint32_t local = 0; local <= brickSize; ++local) {
+            uint16_t *slice = slices.data() + local * sliceSize;
+            if (local == 0 && brickZ > 0) {
+                std::copy_n(slices.data() + brickSize * sliceSize, sliceSize, slice);
+            }
+            else if (firstZ + local >= depth) {
+                std::copy_n(slice - sliceSize, sliceSize, slice);
+            }
+            else {
+                readSlice(firstZ + local, slice);
+            }
+        }
+        // Each voxel counts once, in the layer that owns it.
+        const uint32_t ownedEnd = brickZ + 1 == layout.brickGrid[2] ? depth : firstZ + brickSize;
+        for (uint32_t z = firstZ; z < ownedEnd; ++z) {
+            const uint16_t *slice = slices.data() + (z - firstZ) * sliceSize;
+            for (size_t index = 0; index != sliceSize; ++index) {
+                ++histogram[slice[index]];
+            }
+        }
+
+        std::vector<uint8_t> failures(layerBricks, 0);
+        parallel::parallelFor(layerBricks, 16, [&](size_t begin, size_t end) {
+            std::vector<uint16_t> values(layout.brickStride / sizeof(uint16_t), 0);
+            for (size_t brick = begin; brick != end; ++brick) {
+                const uint32_t brickX = uint32_t(brick % layout.brickGrid[0]), brickY = uint32_t(brick / layout.brickGrid[0]);
+                const uint32_t origin[3] = { brickX * brickSize, brickY * brickSize, firstZ };
+                const uint32_t coordinates[3] = { brickX, brickY, brickZ };
+                // The brick's own voxels: up to the next brick, or to the edge for the last brick.
+                uint32_t owned[3];
+                for (int axis = 0; axis != 3; ++axis) {
+                    owned[axis] = coordinates[axis] + 1 == layout.brickGrid[axis] ? size[axis] - origin[axis] : brickSize;
+                }
+                uint16_t *output = values.data();
+                for (uint32_t z = 0; z <= brickSize; ++z) {
+                    const uint16_t *slice = slices.data() + z * sliceSize;
+                    for (uint32_t y = 0; y <= brickSize; ++y) {
+                        const uint16_t *row = slice + size_t(std::min(origin[1] + y, height - 1)) * width;
+                        for (uint32_t x = 0; x <= brickSize; ++x) {
+                            *output++ = row[std::min(origin[0] + x, width - 1)];
+                        }
+                    }
+                }
+                const auto [low, high] = std::minmax_element(values.data(), values.data() + voxelCount);
+                BrickRecord record = { .minimum = *low, .maximum = *high, .histogram = {} };
+                const uint32_t bins = std::size(record.histogram);
+                const uint32_t range = uint32_t(record.maximum - record.minimum) + 1;
+                for (uint32_t z = 0; z != owned[2]; ++z) {
+                    for (uint32_t y = 0; y != owned[1]; ++y) {
+                        const uint16_t *row = values.data() + (size_t(z) * (brickSize + 1) + y) * (brickSize + 1);
+                        for (uint32_t x = 0; x != owned[0]; ++x) {
+                            ++record.histogram[(uint32_t(row[x] - record.minimum) * bins) / range];
+                        }
+                    }
+                }
+                layerRecords[brick] = record;
+                const size_t offset = layout.dataOffset + (size_t(brickZ) * layerBricks + brick) * layout.brickStride;
+                failures[brick] = !writeAll(descriptor, values.data(), voxelCount * sizeof(uint16_t), offset);
+            }
+        });
+        succeeded = std::count(failures.begin(), failures.end(), 1) == 0 && writeAll(descriptor, layerRecords.data(), layerBricks * sizeof(BrickRecord), layout.recordOffset + size_t(brickZ) * layerBricks * sizeof(BrickRecord));
+    }
+
+    FileHeader header = {
+        .magic = { magic[0], magic[1], magic[2], magic[3] },
+        .version = version,
+        .size = { width, height, depth },
+        .spacing = { spacing[0], spacing[1], spacing[2] },
+        .brickSize = brickSize,
+        .minValue = uint16_t(std::find_if(histogram.begin(), histogram.end(), [](uint64_t count) { return count > 0; }) - histogram.begin()),
+        .maxValue = uint16_t(histogram.rend() - 1 - std::find_if(histogram.rbegin(), histogram.rend(), [](uint64_t count) { return count > 0; })),
+        .recordOffset = layout.recordOffset,
+        .dataOffset = layout.dataOffset,
+        .brickStride = layout.brickStride,
+    };
+    succeeded = succeeded && writeAll(descriptor, &header, sizeof(header), 0) && writeAll(descriptor, histogram.data(), histogramSize * sizeof(uint64_t), sizeof(header));
+    succeeded = ::close(descriptor) == 0 && succeeded;
+    if (!succeeded) {
+        error = "cannot write " + path;
+    }
+    return succeeded;
+}
+
+bool writeBrickedVolume(const std::string &path, const Volume &volume, uint32_t brickSize, std::string &error) {
+    const size_t sliceSize = size_t(volume.width) * volume.height;
+    return writeBrickedVolume(path, volume.width, volume.height, volume.depth, volume.spacing, brickSize, [&](uint32_t z, uint16_t *slice) {
+        std::copy_n(volume.values + z * sliceSize, sliceSize, slice);
+    }, error);
+}
+
+// MARK: BrickCache
+
+struct BrickCache::State {
+    BrickedVolume volume;
+    size_t budget;
+    std::mutex mutex;
+    // Most recently used first.
+    std::list<size_t> recent;
+    std::unordered_map<size_t, std::list<size_t>::iterator> resident;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // Applies `advice` to the whole pages inside a brick. Only mapped files have pages to advise on.
+    void advise(size_t brick, int advice) const {
+        if (!volume.mapping) {
+            return;
+        }
+        static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(volume.brickData(brick));
+        const uintptr_t first = alignUp(begin, pageSize), last = (begin + volume.brickStride()) / pageSize * pageSize;
+        if (first < last) {
+            madvise(reinterpret_cast<void *>(first), last - first, advice);
+        }
+    }
+
+    // Marks a brick most recently used, evicting others past the budget. Returns whether it was already resident. Call with `mutex` held.
+    bool touch(size_t brick) {
+        const auto found = resident.find(brick);
+        if (found != resident.end()) {
+            recent.splice(recent.begin(), recent, found->second);
+            return true;
+        }
+        recent.push_front(brick);
+        resident.emplace(brick, recent.begin());
+        while (recent.size() > 1 && recent.size() * volume.brickStride() > budget) {
+            const size_t evicted = recent.back();
+            recent.pop_back();
+            resident.erase(evicted);
+            advise(evicted, MADV_DONTNEED);
+            ++evictions;
+        }
+        return false;
+    }
+};
+
+BrickCache::BrickCache(const BrickedVolume &volume, size_t memoryBudget) : state(std::make_shared<State>()) {
+    state->volume = volume;
+    state->budget = memoryBudget;
+}
+
+const BrickedVolume &BrickCache::volume() const {
+    return state->volume;
+}
+
+const uint16_t *BrickCache::brick(size_t index) const {
+    std::lock_guard lock(state->mutex);
+    if (state->touch(index)) {
+        ++state->hits;
+    }
+    else {
+        ++state->misses;
+    }
+    return state->volume.brickData(index);
+}
+
+size_t BrickCache::prefetch(const float *position, const float *direction, const std::function<bool(size_t brick)> &wanted) const {
+    const BrickedVolume &volume = state->volume;
+    const uint32_t *size = volume.size(), *brickGrid = volume.brickDimensions();
+    const uint32_t brickSize = volume.brickSize();
+    // Brick centres in the volume box, as `Renderer` lays it out.
+    float physical[3], largest = 0;
+    for (int axis = 0; axis != 3; ++axis) {
+        physical[axis] = float(size[axis]) * volume.spacing()[axis];
+        largest = std::max(largest, physical[axis]);
+    }
+    float voxelSize[3], radius = 0;
+    for (int axis = 0; axis != 3; ++axis) {
+        voxelSize[axis] = physical[axis] / largest / float(size[axis]);
+        radius += std::pow(voxelSize[axis] * float(brickSize) / 2, 2.0f);
+    }
+    radius = std::sqrt(radius);
+    const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    if (!(length > 0)) {
+        return 0;
+    }
+
+    std::vector<std::pair<float, size_t>> candidates;
+    {
+        std::lock_guard lock(state->mutex);
+        for (size_t brick = 0; brick != volume.brickCount(); ++brick) {
+            if (state->resident.contains(brick) || (wanted && !wanted(brick))) {
+                continue;
+            }
+            const uint32_t coordinates[3] = { uint32_t(brick % brickGrid[0]), uint32_t(brick / brickGrid[0] % brickGrid[1]), uint32_t(brick / (size_t(brickGrid[0]) * brickGrid[1])) };
+            float distance = 0;
+            for (int axis = 0; axis != 3; ++axis) {
+                // Sample coordinate s, with voxel centres at integers, is s + 0.5 voxels into the box.
+                const float centre = (float(coordinates[axis] * brickSize) + float(brickSize) / 2 + 0.5f) * voxelSize[axis];
+                distance += (centre - position[axis]) * direction[axis] / length;
+            }
+            if (distance >= -radius) {
+                candidates.emplace_back(distance, brick);
+            }
+        }
+    }
+    const size_t limit = std::min(candidates.size(), state->budget / 2 / volume.brickStride());
+    std::partial_sort(candidates.begin(), candidates.begin() + ptrdiff_t(limit), candidates.end());
+
+    std::lock_guard lock(state->mutex);
+    for (size_t index = 0; index != limit; ++index) {
+        state->advise(candidates[index].second, MADV_WILLNEED);
+        state->touch(candidates[index].second);
+    }
+    return limit;
+}
+
+void BrickCache::extract(uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth, uint32_t step, uint16_t *output) const {
+    const BrickedVolume &volume = state->volume;
+    const uint32_t *size = volume.size(), *brickGrid = volume.brickDimensions();
+    const uint32_t brickSize = volume.brickSize(), stride = brickSize + 1;
+    step = std::max(step, 1u);
+    // The brick holding a voxel, and where in it.
+    auto locate = [&](uint32_t voxel, int axis, uint32_t &brick, uint32_t &local) {
+        voxel = std::min(voxel, size[axis] - 1);
+        brick = std::min(voxel / brickSize, brickGrid[axis] - 1);
+        local = voxel - brick * brickSize;
+    };
+    parallel::parallelFor(depth, 1, [&](size_t begin, size_t end) {
+        for (size_t dz = begin; dz != end; ++dz) {
+            uint32_t brickZ, localZ;
+            locate(z + uint32_t(dz) * step, 2, brickZ, localZ);
+            for (uint32_t dy = 0; dy != height; ++dy) {
+                uint32_t brickY, localY;
+                locate(y + dy * step, 1, brickY, localY);
+                uint16_t *row = output + (dz * height + dy) * width;
+                size_t current = SIZE_MAX;
+                const uint16_t *values = nullptr;
+                for (uint32_t dx = 0; dx != width; ++dx) {
+                    uint32_t brickX, localX;
+                    locate(x + dx * step, 0, brickX, localX);
+                    const size_t brick = (size_t(brickZ) * brickGrid[1] + brickY) * brickGrid[0] + brickX;
+                    if (brick != current) {
+                        current = brick;
+                        values = this->brick(brick);
+                    }
+                    row[dx] = values[(size_t(localZ) * stride + localY) * stride + localX];
+                }
+            }
+        }
+    });
+}
+
+size_t BrickCache::memoryBudget() const {
+    return state->budget;
+}
+
+size_t BrickCache::residentBytes() const {
+    std::lock_guard lock(state->mutex);
+    return state->recent.size() * state->volume.brickStride();
+}
+
+uint64_t BrickCache::hits() const {
+    std::lock_guard lock(state->mutex);
+    return state->hits;
+}
+
+uint64_t BrickCache::misses() const {
+    std::lock_guard lock(state->mutex);
+    return state->misses;
+}
+
+uint64_t BrickCache::evictions() const {
+    std::lock_guard lock(state->mutex);
+    return state->evictions;
+}
+
+}
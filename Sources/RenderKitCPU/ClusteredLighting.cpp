@@ -0,0 +1,220 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace lighting {
+
+namespace {
+
+struct Sphere {
+    float center[3];
+    float radius;
+};
+
+// The view space range covered by a band of tiles between two depths: the band's edges are planes through the eye, x = slope × depth.
+void bandExtent(float lowSlope, float highSlope, float nearDepth, float farDepth, float &low, float &high) {
+    low = std::min(lowSlope * nearDepth, lowSlope * farDepth);
+    high = std::max(highSlope * nearDepth, highSlope * farDepth);
+}
+
+float dot3(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+void normalize3(float *v) {
+    const float length = std::sqrt(dot3(v, v));
+    if (length > 0) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+}
+
+float influenceRadius(const Light &light, float threshold) {
+    const float brightest = std::max({ light.color[0], light.color[1], light.color[2] }) * light.power;
+    if (!(brightest > 0)) {
+        return 0;
+    }
+    return std::sqrt(brightest / std::max(threshold, 1e-12f));
+}
+
+// MARK: - Binning
+
+LightClusters::LightClusters(uint32_t tilesWide, uint32_t tilesHigh, uint32_t slices) {
+    clusterGrid = {
+        .tilesWide = std::max(tilesWide, 1u),
+        .tilesHigh = std::max(tilesHigh, 1u),
+        .slices = std::max(slices, 1u),
+        .viewportWidth = 1,
+        .viewportHeight = 1,
+        .nearZ = 0.1f,
+        .farZ = 100,
+    };
+    clusterRanges.assign(size_t(clusterGrid.tilesWide) * clusterGrid.tilesHigh * clusterGrid.slices, { 0, 0 });
+}
+
+void LightClusters::build(const Light *lights, size_t count, const Projection &projection, float viewportWidth, float viewportHeight, float nearZ, float farZ, float threshold) {
+    const trace::Zone zone("lighting.buildClusters");
+    clusterGrid.viewportWidth = viewportWidth;
+    clusterGrid.viewportHeight = viewportHeight;
+    clusterGrid.nearZ = std::max(nearZ, 1e-6f);
+    clusterGrid.farZ = std::max(farZ, clusterGrid.nearZ * 1.0001f);
+    const uint32_t tilesWide = clusterGrid.tilesWide, tilesHigh = clusterGrid.tilesHigh, slices = clusterGrid.slices;
+    const size_t tilesPerSlice = size_t(tilesWide) * tilesHigh;
+
+    std::vector<Sphere> spheres(count);
+    for (size_t index = 0; index != count; ++index) {
+        const Light &light = lights[index];
+        spheres[index] = { { light.position[0], light.position[1], light.position[2] }, influenceRadius(light, threshold) };
+    }
+
+    // Slopes of the tile edges: x = slope × depth in view space. Rows count down from the top of the screen.
+    const float tanY = std::tan(projection.fieldOfView / 2), tanX = tanY * projection.aspectRatio;
+    std::vector<float> columnSlopes(tilesWide + 1), rowSlopes(tilesHigh + 1);
+    for (uint32_t column = 0; column <= tilesWide; ++column) {
+        columnSlopes[column] = (2 * float(column) / float(tilesWide) - 1) * tanX;
+    }
+    for (uint32_t row = 0; row <= tilesHigh; ++row) {
+        rowSlopes[row] = (1 - 2 * float(row) / float(tilesHigh)) * tanY;
+    }
+
+    // Each slice bins into its own list, cluster by cluster with lights in ascending order; the lists are then concatenated in slice order.
+    std::vector<std::vector<uint32_t>> sliceIndices(slices);
+    std::vector<std::vector<uint32_t>> sliceCounts(slices);
+    parallel::parallelFor(slices, 1, [&](size_t begin, size_t end) {
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        std::vector<float> columnLow(tilesWide), columnHigh(tilesWide), rowLow(tilesHigh), rowHigh(tilesHigh);
+        std::vector<uint32_t> columns, rows;
+        for (size_t slice = begin; slice != end; ++slice) {
+            const float nearDepth = clusterGrid.nearZ * std::pow(clusterGrid.farZ / clusterGrid.nearZ, float(slice) / float(slices));
+            const float farDepth = clusterGrid.nearZ * std::pow(clusterGrid.farZ / clusterGrid.nearZ, float(slice + 1) / float(slices));
+            for (uint32_t column = 0; column != tilesWide; ++column) {
+                bandExtent(columnSlopes[column], columnSlopes[column + 1], nearDepth, farDepth, columnLow[column], columnHigh[column]);
+            }
+            for (uint32_t row = 0; row != tilesHigh; ++row) {
+                bandExtent(rowSlopes[row + 1], rowSlopes[row], nearDepth, farDepth, rowLow[row], rowHigh[row]);
+            }
+
+            pairs.clear();
+            for (uint32_t index = 0; index != count; ++index) {
+                const Sphere &sphere = spheres[index];
+                const float depth = -sphere.center[2];
+                if (sphere.radius <= 0 || depth + sphere.radius < nearDepth || depth - sphere.radius > farDepth) {
+                    continue;
+                }
+                columns.clear();
+                for (uint32_t column = 0; column != tilesWide; ++column) {
+                    if (sphere.center[0] + sphere.radius >= columnLow[column] && sphere.center[0] - sphere.radius <= columnHigh[column]) {
+                        columns.push_back(column);
+                    }
+                }
+                rows.clear();
+                for (uint32_t row = 0; row != tilesHigh && !columns.empty(); ++row) {
+                    if (sphere.center[1] + sphere.radius >= rowLow[row] && sphere.center[1] - sphere.radius <= rowHigh[row]) {
+                        rows.push_back(row);
+                    }
+                }
+                // Sphere against the cluster's bounding box.
+                const float dz = std::max({ nearDepth - depth, depth - farDepth, 0.0f });
+                const float radiusSquared = sphere.radius * sphere.radius;
+                for (const uint32_t row : rows) {
+                    const float dy = std::max({ rowLow[row] - sphere.center[1], sphere.center[1] - rowHigh[row], 0.0f });
+                    for (const uint32_t column : columns) {
+                        const float dx = std::max({ columnLow[column] - sphere.center[0], sphere.center[0] - columnHigh[column], 0.0f });
+                        if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+                            pairs.push_back({ row * tilesWide + column, index });
+                        }
+                    }
+                }
+            }
+
+            // Counting sort by cluster; stable, so lights stay in ascending order.
+            std::vector<uint32_t> &counts = sliceCounts[slice];
+            counts.assign(tilesPerSlice, 0);
+            for (const auto &pair : pairs) {
+                ++counts[pair.first];
+            }
+            std::vector<uint32_t> offsets(tilesPerSlice);
+            uint32_t total = 0;
+            for (size_t tile = 0; tile != tilesPerSlice; ++tile) {
+                offsets[tile] = total;
+                total += counts[tile];
+            }
+            std::vector<uint32_t> &list = sliceIndices[slice];
+            list.resize(pairs.size());
+            for (const auto &pair : pairs) {
+                list[offsets[pair.first]++] = pair.second;
+            }
+        }
+    });
+
+    clusterRanges.resize(tilesPerSlice * slices);
+    indices.clear();
+    uint32_t offset = 0;
+    for (uint32_t slice = 0; slice != slices; ++slice) {
+        for (size_t tile = 0; tile != tilesPerSlice; ++tile) {
+            clusterRanges[slice * tilesPerSlice + tile] = { offset, sliceCounts[slice][tile] };
+            offset += sliceCounts[slice][tile];
+        }
+        indices.insert(indices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+    }
+    // Every light every cluster lists: the light evaluations a fragment in each cluster pays for.
+    trace::count("lighting.clusterLights", int64_t(indices.size()));
+}
+
+uint32_t LightClusters::clusterIndex(float x, float y, float depth) const {
+    const uint32_t column = std::min(uint32_t(std::max(x / clusterGrid.viewportWidth * float(clusterGrid.tilesWide), 0.0f)), clusterGrid.tilesWide - 1);
+    const uint32_t row = std::min(uint32_t(std::max(y / clusterGrid.viewportHeight * float(clusterGrid.tilesHigh), 0.0f)), clusterGrid.tilesHigh - 1);
+    const float position = std::log(std::max(depth, clusterGrid.nearZ) / clusterGrid.nearZ) / std::log(clusterGrid.farZ / clusterGrid.nearZ);
+    const uint32_t slice = std::min(uint32_t(std::max(position * float(clusterGrid.slices), 0.0f)), clusterGrid.slices - 1);
+    return (slice * clusterGrid.tilesHigh + row) * clusterGrid.tilesWide + column;
+}
+
+// MARK: - Shading
+
+void calculateBlinnPhong(const float *position, const float *interpolatedNormal, const Light *lights, const uint32_t *lightIndices, size_t count, const float *ambientLightColor, const Material &material, int phongMode, float *rgb) {
+    float normal[3] = { interpolatedNormal[0], interpolatedNormal[1], interpolatedNormal[2] };
+    normalize3(normal);
+    float viewDirection[3] = { -position[0], -position[1], -position[2] };
+    normalize3(viewDirection);
+
+    float diffuse[3] = { 0, 0, 0 }, specular[3] = { 0, 0, 0 };
+    for (size_t index = 0; index != count; ++index) {
+        const Light &light = lights[lightIndices ? lightIndices[index] : index];
+        float lightDirection[3] = { light.position[0] - position[0], light.position[1] - position[1], light.position[2] - position[2] };
+        const float distanceSquared = dot3(lightDirection, lightDirection);
+        normalize3(lightDirection);
+
+        const float lambertian = std::max(dot3(lightDirection, normal), 0.0f);
+        float specularTerm = 0;
+        if (lambertian > 0) {
+            if (phongMode == 0) {
+                float halfDirection[3] = { lightDirection[0] + viewDirection[0], lightDirection[1] + viewDirection[1], lightDirection[2] + viewDirection[2] };
+                normalize3(halfDirection);
+                specularTerm = std::pow(std::max(dot3(halfDirection, normal), 0.0f), material.shininess);
+            }
+            else {
+                // reflect(-l, n) = -l + 2 (n · l) n
+                const float projection = 2 * dot3(normal, lightDirection);
+                const float reflection[3] = { normal[0] * projection - lightDirection[0], normal[1] * projection - lightDirection[1], normal[2] * projection - lightDirection[2] };
+                specularTerm = std::pow(std::max(dot3(reflection, viewDirection), 0.0f), material.shininess / 4);
+            }
+        }
+        for (int channel = 0; channel != 3; ++channel) {
+            const float radiance = light.color[channel] * light.power / distanceSquared;
+            diffuse[channel] += material.diffuse[channel] * lambertian * radiance;
+            specular[channel] += material.specular[channel] * specularTerm * radiance;
+        }
+    }
+    for (int channel = 0; channel != 3; ++channel) {
+        rgb[channel] = ambientLightColor[channel] * material.ambient[channel] + diffuse[channel] + specular[channel];
+    }
+}
+
+}
@@ -0,0 +1,290 @@
+#include "ColorConversion.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi" // The 32 byte vectors below never cross a translation unit boundary.
+#endif
+
+namespace color {
+
+float srgbToLinear(float value) {
+    const double c = value;
+    return float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+}
+
+float linearToSRGB(float value) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    if (value > 1) {
+        return 1;
+    }
+    const double c = value;
+    return float(value < 0.0031308f ? 12.92 * c : 1.055 * std::pow(c, 1 / 2.4) - 0.055);
+}
+
+namespace {
+
+// Eight lanes, as in SimplexNoise.cpp. GCC and Clang lower these to AVX registers inside `target("avx2")` functions and to pairs of 128 bit registers elsewhere.
+typedef float Float8 __attribute__((vector_size(32)));
+typedef int32_t Int8 __attribute__((vector_size(32)));
+
+[[gnu::always_inline]] inline Float8 select(Int8 mask, Float8 a, Float8 b) {
+    return (Float8)(((Int8)a & mask) | ((Int8)b & ~mask));
+}
+
+// MARK: Tables
+
+// The float curves are sampled at the start of every 1/1024th of an octave, `2^(23 - sampleBits)` float encodings apart, and interpolated linearly in between. Within an octave the encodings are evenly spaced in value, so interpolating on the low bits is interpolating on the value.
+constexpr uint32_t sampleBits = 10;
+constexpr uint32_t sampleShift = 23 - sampleBits;
+
+// Encoding below 2^-9 is the linear segment, so its table starts there; decoding's starts at 2^-5. Both end at 1.
+constexpr uint32_t encodeFirst = (127 - 9) << 23;
+constexpr uint32_t decodeFirst = (127 - 5) << 23;
+constexpr uint32_t oneBits = 127 << 23;
+
+// Below these the curves are linear. Both are the reference's comparisons, decoding's rounded to the float below.
+constexpr float encodeKnee = 0.0031308f;
+constexpr float decodeKnee = 0.04045f;
+
+struct Tables {
+    float decode8[256];
+    // Sampled curves, each with an extra sample at 1.
+    std::vector<float> encode;
+    std::vector<float> decode;
+
+    Tables() {
+        for (unsigned code = 0; code != 256; ++code) {
+            decode8[code] = srgbToLinear(float(code) / 255.0f);
+        }
+        // Only the power curves are sampled, continued below the knees: the table is only read above them, and interpolating across the knee would bend the curve in that sample's span.
+        encode.resize(((oneBits - encodeFirst) >> sampleShift) + 1);
+        for (size_t index = 0; index != encode.size(); ++index) {
+            const double c = std::bit_cast<float>(encodeFirst + uint32_t(index << sampleShift));
+            encode[index] = float(1.055 * std::pow(c, 1 / 2.4) - 0.055);
+        }
+        decode.resize(((oneBits - decodeFirst) >> sampleShift) + 1);
+        for (size_t index = 0; index != decode.size(); ++index) {
+            const double c = std::bit_cast<float>(decodeFirst + uint32_t(index << sampleShift));
+            decode[index] = float(std::pow((c + 0.055) / 1.055, 2.4));
+        }
+    }
+};
+
+const Tables &tables() {
+    static const Tables shared;
+    return shared;
+}
+
+// 256 KB, so only built once 16 bit images are decoded.
+const float *decode16Table() {
+    static const std::vector<float> shared = [] {
+        std::vector<float> table(65536);
+        for (size_t code = 0; code != table.size(); ++code) {
+            table[code] = srgbToLinear(float(code) / 65535.0f);
+        }
+        return table;
+    }();
+    return shared.data();
+}
+
+// The sampled curve starting at `first` at x, for lanes in `inside`; other lanes read sample 0.
+[[gnu::always_inline]] inline Float8 interpolate(const float *table, uint32_t first, Float8 x, Int8 inside) {
+    const Int8 offset = ((Int8)x - int32_t(first)) & inside;
+    const Int8 index = offset >> sampleShift;
+    const Float8 fraction = __builtin_convertvector(offset & ((1 << sampleShift) - 1), Float8) * (1.0f / float(1 << sampleShift));
+    Float8 a, b;
+    for (int lane = 0; lane != 8; ++lane) {
+        a[lane] = table[index[lane]];
+        b[lane] = table[index[lane] + 1];
+    }
+    return a + (b - a) * fraction;
+}
+
+// MARK: Curves
+
+[[gnu::always_inline]] inline Float8 decodeLanes(const Tables &tables, Float8 x) {
+    const Int8 linear = x <= decodeKnee;
+    const Int8 sampled = ~linear & (x < 1.0f);
+    Float8 result = select(linear, x / 12.92f, interpolate(tables.decode.data(), decodeFirst, x, sampled));
+    // 1 and above (HDR values) and NaN take the reference path.
+    const Int8 other = ~(linear | sampled);
+    bool any = false;
+    for (int lane = 0; lane != 8; ++lane) {
+        any |= other[lane] != 0;
+    }
+    if (any) {
+        for (int lane = 0; lane != 8; ++lane) {
+            if (other[lane]) {
+                result[lane] = srgbToLinear(x[lane]);
+            }
+        }
+    }
+    return result;
+}
+
+[[gnu::always_inline]] inline Float8 encodeLanes(const Tables &tables, Float8 x) {
+    const Int8 linear = x < encodeKnee;
+    const Int8 sampled = (x >= encodeKnee) & (x < 1.0f);
+    const Float8 zero = {}, one = zero + 1.0f;
+    // What's left is 1 and above, which clamp to 1, and NaN, which becomes 0.
+    const Float8 other = select(x >= 1.0f, one, zero);
+    return select(linear, x * 12.92f, select(sampled, interpolate(tables.encode.data(), encodeFirst, x, sampled), other));
+}
+
+// Rounds [0, 1] (clamping anything else, NaN to 0) to 0 … `maximum`.
+[[gnu::always_inline]] inline Int8 quantize(Float8 x, float maximum) {
+    const Float8 zero = {};
+    x = select(x > 0.0f, x, zero);
+    x = select(x < 1.0f, x, zero + 1.0f);
+    return __builtin_convertvector(x * maximum + 0.5f, Int8);
+}
+
+// MARK: Batches
+
+// Which of the eight values from `first` on are alpha.
+[[gnu::always_inline]] inline Int8 alphaLanes(Layout layout, size_t first, size_t alphaStart) {
+    const Int8 lanes = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    switch (layout) {
+    case Layout::color:
+        break;
+    case Layout::interleavedRGBA:
+        return ((lanes + int32_t(first & 3)) & 3) == 3;
+    case Layout::planarRGBA:
+        return lanes >= int32_t(std::clamp<ptrdiff_t>(ptrdiff_t(alphaStart) - ptrdiff_t(first), 0, 8));
+    }
+    return Int8 {};
+}
+
+template <typename In, typename Out> struct Batch {
+    const In *input;
+    Out *output;
+    Layout layout;
+    // The index of the first alpha value of a planar batch.
+    size_t alphaStart;
+    const Tables *tables;
+    // decode16Table() for 16 bit decoding.
+    const float *codeTable;
+};
+
+// Converts eight values. Integers are decoded by lookup; floats go through the sampled curves.
+template <bool Encode, typename In, typename Out> [[gnu::always_inline]] inline void convertLanes(const Batch<In, Out> &batch, const In *input, Out *output, Int8 alpha) {
+    if constexpr (std::is_integral_v<In>) {
+        const float scale = float((1u << (8 * sizeof(In))) - 1);
+        const float *table = sizeof(In) == 1 ? batch.tables->decode8 : batch.codeTable;
+        Float8 codes, decoded;
+        for (int lane = 0; lane != 8; ++lane) {
+            codes[lane] = float(input[lane]);
+            decoded[lane] = table[input[lane]];
+        }
+        const Float8 result = select(alpha, codes / scale, decoded);
+        std::memcpy(output, &result, sizeof(Float8));
+    }
+    else {
+        Float8 x;
+        std::memcpy(&x, input, sizeof(Float8));
+        const Float8 curve = Encode ? encodeLanes(*batch.tables, x) : decodeLanes(*batch.tables, x);
+        if constexpr (std::is_integral_v<Out>) {
+            const float scale = float((1u << (8 * sizeof(Out))) - 1);
+            const Int8 codes = quantize(select(alpha, x, curve), scale);
+            for (int lane = 0; lane != 8; ++lane) {
+                output[lane] = Out(codes[lane]);
+            }
+        }
+        else {
+            const Float8 result = select(alpha, x, curve);
+            std::memcpy(output, &result, sizeof(Float8));
+        }
+    }
+}
+
+template <bool Encode, typename In, typename Out> [[gnu::always_inline]] inline void runBatch(const Batch<In, Out> &batch, size_t begin, size_t end) {
+    size_t index = begin;
+    for (; index + 8 <= end; index += 8) {
+        convertLanes<Encode>(batch, batch.input + index, batch.output + index, alphaLanes(batch.layout, index, batch.alphaStart));
+    }
+    if (index != end) {
+        // The tail goes through the same lanes, padded with zeros.
+        In input[8] = {};
+        Out output[8];
+        std::memcpy(input, batch.input + index, (end - index) * sizeof(In));
+        convertLanes<Encode>(batch, input, output, alphaLanes(batch.layout, index, batch.alphaStart));
+        std::memcpy(batch.output + index, output, (end - index) * sizeof(Out));
+    }
+}
+
+template <bool Encode, typename In, typename Out> void runBatchGeneric(const Batch<In, Out> &batch, size_t begin, size_t end) {
+    runBatch<Encode>(batch, begin, end);
+}
+
+#if defined(__x86_64__)
+template <bool Encode, typename In, typename Out> __attribute__((target("avx2"))) void runBatchAVX2(const Batch<In, Out> &batch, size_t begin, size_t end) {
+    runBatch<Encode>(batch, begin, end);
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+template <bool Encode, typename In, typename Out> void run(const In *input, Out *output, size_t count, Layout layout) {
+    const Batch<In, Out> batch {
+        .input = input,
+        .output = output,
+        .layout = layout,
+        .alphaStart = count - count / 4,
+        .tables = &tables(),
+        .codeTable = std::is_same_v<In, uint16_t> ? decode16Table() : nullptr,
+    };
+    parallel::parallelFor(count, 16384, [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+        if (hasAVX2) {
+            runBatchAVX2<Encode>(batch, begin, end);
+            return;
+        }
+#endif
+        runBatchGeneric<Encode>(batch, begin, end);
+    });
+}
+
+}
+
+void srgbToLinear(const uint8_t *input, float *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.srgbToLinear");
+    run<false>(input, output, count, layout);
+}
+
+void srgbToLinear(const uint16_t *input, float *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.srgbToLinear");
+    run<false>(input, output, count, layout);
+}
+
+void srgbToLinear(const float *input, float *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.srgbToLinear");
+    run<false>(input, output, count, layout);
+}
+
+void linearToSRGB(const float *input, uint8_t *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.linearToSRGB");
+    run<true>(input, output, count, layout);
+}
+
+void linearToSRGB(const float *input, uint16_t *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.linearToSRGB");
+    run<true>(input, output, count, layout);
+}
+
+void linearToSRGB(const float *input, float *output, size_t count, Layout layout) {
+    const trace::Zone zone("color.linearToSRGB");
+    run<true>(input, output, count, layout);
+}
+
+}
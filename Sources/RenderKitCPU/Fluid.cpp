@@ -0,0 +1,328 @@
+#include "Fluid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <numbers>
+
+#include "Parallel.h"
+
+namespace fluid {
+
+namespace {
+
+// Buckets per parallel chunk. About as many particles, since the table has roughly one bucket per particle.
+constexpr size_t bucketGrain = 1 << 12;
+constexpr size_t particleGrain = 1 << 14;
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Cell {
+    int32_t x, y, z;
+
+    bool operator==(const Cell &) const = default;
+};
+
+// The uniform grid over `Parameters::boundsMin` ... `boundsMax`, with cell (x, y, z) hashed to bucket `(x + y * rowStride + z * sliceStride) mod bucketCount`. Consecutive cells of a row land in consecutive buckets, and the table is more than twice the largest offset between two cells of a 3x3x3 neighbourhood, so no two neighbouring cells share a bucket.
+struct Grid {
+    float origin[3];
+    float inverseCellSize;
+    int32_t size[3];
+    uint64_t rowStride;
+    uint64_t sliceStride;
+
+    explicit Grid(const Parameters &parameters) {
+        inverseCellSize = 1 / parameters.smoothingRadius;
+        for (int axis = 0; axis != 3; ++axis) {
+            origin[axis] = parameters.boundsMin[axis];
+            size[axis] = std::max(1, int32_t(std::ceil((parameters.boundsMax[axis] - parameters.boundsMin[axis]) * inverseCellSize)));
+        }
+        rowStride = uint64_t(size[0]);
+        sliceStride = rowStride * uint64_t(size[1]);
+    }
+
+    size_t bucketCount(size_t particleCount) const {
+        return std::max({ std::bit_ceil(particleCount), std::bit_ceil(2 * (sliceStride + rowStride + 1) + 1), size_t(1024) });
+    }
+
+    Cell cellOf(float x, float y, float z) const {
+        auto coordinate = [&](float value, int axis) {
+            return std::clamp(int32_t(std::floor((value - origin[axis]) * inverseCellSize)), 0, size[axis] - 1);
+        };
+        return { coordinate(x, 0), coordinate(y, 1), coordinate(z, 2) };
+    }
+
+    uint32_t bucketOf(int32_t x, int32_t y, int32_t z, uint32_t mask) const {
+        return uint32_t(uint64_t(x) + uint64_t(y) * rowStride + uint64_t(z) * sliceStride) & mask;
+    }
+};
+
+struct Range {
+    uint32_t begin, end;
+};
+
+// The particles in the 27 cells around a cell, as up to nine row ranges (eighteen if rows wrap around the end of the table).
+struct Neighbourhood {
+    Cell cell = { -1, -1, -1 };
+    Range ranges[18];
+    int count = 0;
+
+    void update(Cell next, const Grid &grid, const uint32_t *bucketStarts, uint32_t mask) {
+        if (next == cell) {
+            return;
+        }
+        cell = next;
+        count = 0;
+        const int32_t firstX = std::max(cell.x - 1, 0), lastX = std::min(cell.x + 1, grid.size[0] - 1);
+        for (int32_t z = std::max(cell.z - 1, 0); z <= std::min(cell.z + 1, grid.size[2] - 1); ++z) {
+            for (int32_t y = std::max(cell.y - 1, 0); y <= std::min(cell.y + 1, grid.size[1] - 1); ++y) {
+                const uint32_t first = grid.bucketOf(firstX, y, z, mask);
+                const uint32_t last = first + uint32_t(lastX - firstX);
+                if (last <= mask) {
+                    ranges[count++] = { bucketStarts[first], bucketStarts[last + 1] };
+                }
+                else {
+                    ranges[count++] = { bucketStarts[first], bucketStarts[mask + 1] };
+                    ranges[count++] = { bucketStarts[0], bucketStarts[(last & mask) + 1] };
+                }
+            }
+        }
+    }
+};
+
+struct Kernels {
+    float radius;
+    float radiusSquared;
+    float poly6;
+    float spikyGradient;
+    float viscosityLaplacian;
+
+    explicit Kernels(float h) : radius(h), radiusSquared(h * h) {
+        const float pi = std::numbers::pi_v<float>;
+        poly6 = 315 / (64 * pi * std::pow(h, 9.0f));
+        spikyGradient = -45 / (pi * std::pow(h, 6.0f));
+        viscosityLaplacian = 45 / (pi * std::pow(h, 6.0f));
+    }
+};
+
+}
+
+Solver::Solver(const Parameters &parameters) : settings(parameters) {
+}
+
+void Solver::setParticles(const particles::Particle *input, size_t count) {
+    for (int axis = 0; axis != 3; ++axis) {
+        positions[axis].resize(count);
+        oldPositions[axis].resize(count);
+        accelerations[axis].resize(count);
+    }
+    ages.resize(count);
+    densities.assign(count, settings.restDensity);
+    pressures.assign(count, 0);
+    ids.resize(count);
+    parallel::parallelFor(count, particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            for (int axis = 0; axis != 3; ++axis) {
+                positions[axis][index] = input[index].position[axis];
+                oldPositions[axis][index] = input[index].oldPosition[axis];
+                accelerations[axis][index] = input[index].acceleration[axis];
+            }
+            ages[index] = input[index].age;
+            ids[index] = uint32_t(index);
+        }
+    });
+    bucketStarts.assign(Grid(settings).bucketCount(count) + 1, 0);
+}
+
+void Solver::exportParticles(particles::Particle *output) const {
+    parallel::parallelFor(count(), particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            particles::Particle &particle = output[ids[index]];
+            particle = {};
+            for (int axis = 0; axis != 3; ++axis) {
+                particle.position[axis] = positions[axis][index];
+                particle.oldPosition[axis] = oldPositions[axis][index];
+                particle.acceleration[axis] = accelerations[axis][index];
+            }
+            particle.age = ages[index];
+            particle.lifetime = INFINITY;
+        }
+    });
+}
+
+void Solver::exportDensities(float *output) const {
+    for (size_t index = 0; index != count(); ++index) {
+        output[ids[index]] = densities[index];
+    }
+}
+
+Timings Solver::step(const particles::Environment &environment) {
+    Timings timings;
+    const size_t particleCount = count();
+    if (particleCount == 0) {
+        return timings;
+    }
+    const size_t tableSize = bucketCount();
+    const uint32_t mask = uint32_t(tableSize - 1);
+    const Kernels kernels(settings.smoothingRadius);
+    const Grid grid(settings);
+    auto cellOf = [&](size_t index) {
+        return grid.cellOf(positions[0][index], positions[1][index], positions[2][index]);
+    };
+
+    // MARK: Grid
+
+    // Counting sort by bucket: count with atomic increments, scan, scatter through atomic cursors, then put each bucket back in the previous step's order so the result does not depend on thread timing.
+    Clock::time_point start = Clock::now();
+    buckets.resize(particleCount);
+    order.resize(particleCount);
+    std::fill(bucketStarts.begin(), bucketStarts.end(), 0);
+    parallel::parallelFor(particleCount, particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const Cell cell = cellOf(index);
+            buckets[index] = grid.bucketOf(cell.x, cell.y, cell.z, mask);
+            std::atomic_ref<uint32_t>(bucketStarts[buckets[index] + 1]).fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    for (size_t bucket = 0; bucket != tableSize; ++bucket) {
+        bucketStarts[bucket + 1] += bucketStarts[bucket];
+    }
+    // Each bucket's cursor starts at its first slot.
+    std::vector<uint32_t> &cursors = scratchIds;
+    cursors.assign(bucketStarts.begin(), bucketStarts.end() - 1);
+    parallel::parallelFor(particleCount, particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            order[std::atomic_ref<uint32_t>(cursors[buckets[index]]).fetch_add(1, std::memory_order_relaxed)] = uint32_t(index);
+        }
+    });
+    parallel::parallelFor(tableSize, bucketGrain, [&](size_t begin, size_t end) {
+        for (size_t bucket = begin; bucket != end; ++bucket) {
+            std::sort(order.begin() + bucketStarts[bucket], order.begin() + bucketStarts[bucket + 1]);
+        }
+    });
+    scratch.resize(particleCount);
+    auto permute = [&](std::vector<float> &values) {
+        parallel::parallelFor(particleCount, particleGrain, [&](size_t begin, size_t end) {
+            for (size_t index = begin; index != end; ++index) {
+                scratch[index] = values[order[index]];
+            }
+        });
+        values.swap(scratch);
+    };
+    for (int axis = 0; axis != 3; ++axis) {
+        permute(positions[axis]);
+        permute(oldPositions[axis]);
+    }
+    permute(ages);
+    scratchIds.resize(particleCount);
+    parallel::parallelFor(particleCount, particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            scratchIds[index] = ids[order[index]];
+        }
+    });
+    ids.swap(scratchIds);
+    timings.grid = secondsSince(start);
+
+    // Runs `body(index, neighbourhood)` for the particles of every bucket, a chunk of buckets per task. Unless a distant cell shares its bucket, the particles of one cell are contiguous, so the neighbourhood is only recomputed when the cell changes.
+    auto forEachParticle = [&](auto &&body) {
+        parallel::parallelFor(tableSize, bucketGrain, [&](size_t begin, size_t end) {
+            Neighbourhood neighbourhood;
+            for (size_t index = bucketStarts[begin]; index != bucketStarts[end]; ++index) {
+                neighbourhood.update(cellOf(index), grid, bucketStarts.data(), mask);
+                body(index, neighbourhood);
+            }
+        });
+    };
+    const float *x = positions[0].data(), *y = positions[1].data(), *z = positions[2].data();
+
+    // MARK: Density
+
+    start = Clock::now();
+    forEachParticle([&](size_t index, const Neighbourhood &neighbourhood) {
+        const float px = x[index], py = y[index], pz = z[index];
+        float sum = 0;
+        for (int slot = 0; slot != neighbourhood.count; ++slot) {
+            for (uint32_t other = neighbourhood.ranges[slot].begin; other != neighbourhood.ranges[slot].end; ++other) {
+                const float dx = x[other] - px, dy = y[other] - py, dz = z[other] - pz;
+                const float difference = kernels.radiusSquared - (dx * dx + dy * dy + dz * dz);
+                sum += difference > 0 ? difference * difference * difference : 0;
+            }
+        }
+        densities[index] = settings.particleMass * kernels.poly6 * sum;
+        // Clamped so that sparse particles do not attract each other and clump.
+        pressures[index] = std::max(0.0f, settings.stiffness * (densities[index] - settings.restDensity));
+    });
+    timings.density = secondsSince(start);
+
+    // MARK: Forces
+
+    start = Clock::now();
+    const float timestep = environment.timestep;
+    const float inverseTimestep = 1 / timestep;
+    const float *ox = oldPositions[0].data(), *oy = oldPositions[1].data(), *oz = oldPositions[2].data();
+    forEachParticle([&](size_t index, const Neighbourhood &neighbourhood) {
+        const float px = x[index], py = y[index], pz = z[index];
+        const float vx = px - ox[index], vy = py - oy[index], vz = pz - oz[index];
+        const float pressure = pressures[index];
+        float pressureForce[3] = { 0, 0, 0 }, viscosityForce[3] = { 0, 0, 0 };
+        for (int slot = 0; slot != neighbourhood.count; ++slot) {
+            for (uint32_t other = neighbourhood.ranges[slot].begin; other != neighbourhood.ranges[slot].end; ++other) {
+                const float dx = px - x[other], dy = py - y[other], dz = pz - z[other];
+                const float distanceSquared = dx * dx + dy * dy + dz * dz;
+                if (distanceSquared >= kernels.radiusSquared || other == index) {
+                    continue;
+                }
+                const float distance = std::sqrt(distanceSquared);
+                const float falloff = kernels.radius - distance;
+                const float inverseDensity = 1 / densities[other];
+                // -m (p_i + p_j) / (2 rho_j) * grad W_spiky, with grad W pointing along (x_i - x_j) / r.
+                const float pressureScale = distance > 0 ? -0.5f * (pressure + pressures[other]) * inverseDensity * kernels.spikyGradient * falloff * falloff / distance : 0;
+                pressureForce[0] += pressureScale * dx;
+                pressureForce[1] += pressureScale * dy;
+                pressureForce[2] += pressureScale * dz;
+                // (v_j - v_i) / rho_j * laplacian W_viscosity, with velocities still scaled by the timestep.
+                const float viscosityScale = inverseDensity * falloff;
+                viscosityForce[0] += viscosityScale * ((x[other] - ox[other]) - vx);
+                viscosityForce[1] += viscosityScale * ((y[other] - oy[other]) - vy);
+                viscosityForce[2] += viscosityScale * ((z[other] - oz[other]) - vz);
+            }
+        }
+        const float inverseDensity = 1 / densities[index];
+        const float pressureScale = settings.particleMass * inverseDensity;
+        const float viscosityScale = settings.viscosity * settings.particleMass * kernels.viscosityLaplacian * inverseTimestep * inverseDensity;
+        for (int axis = 0; axis != 3; ++axis) {
+            accelerations[axis][index] = environment.gravity[axis] + pressureScale * pressureForce[axis] + viscosityScale * viscosityForce[axis];
+        }
+    });
+    timings.forces = secondsSince(start);
+
+    // MARK: Integrate
+
+    start = Clock::now();
+    parallel::parallelFor(particleCount, particleGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            for (int axis = 0; axis != 3; ++axis) {
+                float &position = positions[axis][index], &oldPosition = oldPositions[axis][index];
+                const float next = position + ((position - oldPosition) + accelerations[axis][index] * timestep * timestep);
+                const float velocity = next - position;
+                oldPosition = position;
+                position = next;
+                if (next < settings.boundsMin[axis] || next > settings.boundsMax[axis]) {
+                    position = std::clamp(next, settings.boundsMin[axis], settings.boundsMax[axis]);
+                    oldPosition = position + settings.restitution * velocity;
+                }
+            }
+            ages[index] += timestep;
+        }
+    });
+    timings.integrate = secondsSince(start);
+    return timings;
+}
+
+}
@@ -0,0 +1,262 @@
+#include "GameOfLife.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "LifeKernels.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace gameOfLife {
+
+// MARK: Rule
+
+std::optional<Rule> Rule::parse(std::string_view string) {
+    // Digits following a 'B' or 'S' go to that set. Without letters, the first group is survival and the second birth.
+    Rule rule = { .birth = 0, .survival = 0 };
+    uint16_t *target = nullptr;
+    bool sawLetter = false, sawSlash = false, sawDigit = false, sawBirth = false, sawSurvival = false;
+    for (char c : string) {
+        if (c == 'B' || c == 'b' || c == 'S' || c == 's') {
+            const bool birth = c == 'B' || c == 'b';
+            target = birth ? &rule.birth : &rule.survival;
+            sawBirth = sawBirth || birth;
+            sawSurvival = sawSurvival || !birth;
+            sawLetter = true;
+        }
+        else if (c == '/') {
+            if (sawSlash) {
+                return std::nullopt;
+            }
+            sawSlash = true;
+            target = sawLetter ? nullptr : &rule.birth;
+        }
+        else if (c >= '0' && c <= '8') {
+            if (!target) {
+                if (sawLetter || sawSlash) {
+                    return std::nullopt;
+                }
+                target = &rule.survival;
+            }
+            *target |= 1 << (c - '0');
+            sawDigit = true;
+        }
+        else if (c != ' ') {
+            return std::nullopt;
+        }
+    }
+    // An empty rule has to name both sets ("B/S"), so that "B", "S" or "/" alone are not taken for one.
+    if ((!sawLetter && !sawSlash) || (!sawDigit && !(sawBirth && sawSurvival))) {
+        return std::nullopt;
+    }
+    return rule;
+}
+
+std::string Rule::toString() const {
+    std::string result = "B";
+    for (unsigned count = 0; count <= 8; ++count) {
+        if ((birth >> count) & 1) {
+            result += char('0' + count);
+        }
+    }
+    result += "/S";
+    for (unsigned count = 0; count <= 8; ++count) {
+        if ((survival >> count) & 1) {
+            result += char('0' + count);
+        }
+    }
+    return result;
+}
+
+// MARK: Board
+
+Board::Board(uint32_t width, uint32_t height)
+    : columns(width), rows(height), stride((width + 63) / 64), words(size_t(stride) * height, 0) {
+}
+
+Board Board::fromCells(const uint8_t *cells, uint32_t width, uint32_t height, size_t bytesPerRow) {
+    Board board(width, height);
+    bytesPerRow = bytesPerRow ? bytesPerRow : width;
+    for (uint32_t y = 0; y != height; ++y) {
+        const uint8_t *source = cells + y * bytesPerRow;
+        uint64_t *destination = board.row(y);
+        for (uint32_t x = 0; x != width; ++x) {
+            destination[x / 64] |= uint64_t(source[x] != 0) << (x % 64);
+        }
+    }
+    return board;
+}
+
+void Board::toCells(uint8_t *cells, size_t bytesPerRow) const {
+    bytesPerRow = bytesPerRow ? bytesPerRow : columns;
+    for (uint32_t y = 0; y != rows; ++y) {
+        uint8_t *destination = cells + y * bytesPerRow;
+        const uint64_t *source = row(y);
+        for (uint32_t x = 0; x != columns; ++x) {
+            destination[x] = (source[x / 64] >> (x % 64)) & 1;
+        }
+    }
+}
+
+size_t Board::population() const {
+    size_t count = 0;
+    for (auto word : words) {
+        count += std::popcount(word);
+    }
+    return count;
+}
+
+// MARK: -
+
+namespace {
+
+// The three rows around the one being computed. Rows outside a non-wrapping board point at a row of zeros.
+struct Neighbourhood {
+    const uint64_t *up;
+    const uint64_t *center;
+    const uint64_t *down;
+};
+
+struct RowGeometry {
+    uint32_t words;
+    uint32_t width;
+    uint64_t lastWordMask;
+    bool wrap;
+    Rule rule;
+};
+
+// West neighbours of word `i`: bit k holds cell (64i + k - 1).
+inline uint64_t westWord(const uint64_t *row, uint32_t i, const RowGeometry &geometry) {
+    uint64_t carry;
+    if (i > 0) {
+        carry = row[i - 1] >> 63;
+    }
+    else {
+        carry = geometry.wrap ? (row[(geometry.width - 1) / 64] >> ((geometry.width - 1) % 64)) & 1 : 0;
+    }
+    return (row[i] << 1) | carry;
+}
+
+// East neighbours of word `i`: bit k holds cell (64i + k + 1).
+inline uint64_t eastWord(const uint64_t *row, uint32_t i, const RowGeometry &geometry) {
+    uint64_t carry;
+    if (i + 1 < geometry.words) {
+        carry = row[i + 1] << 63;
+    }
+    else {
+        carry = geometry.wrap ? (row[0] & 1) << ((geometry.width - 1) % 64) : 0;
+    }
+    return (row[i] >> 1) | carry;
+}
+
+template <bool Conway> inline uint64_t stepWord(const Neighbourhood &rows, uint32_t i, const RowGeometry &geometry) {
+    return nextState<Conway, uint64_t>(
+        westWord(rows.up, i, geometry), rows.up[i], eastWord(rows.up, i, geometry),
+        westWord(rows.center, i, geometry), eastWord(rows.center, i, geometry),
+        westWord(rows.down, i, geometry), rows.down[i], eastWord(rows.down, i, geometry),
+        rows.center[i], geometry.rule);
+}
+
+template <bool Conway> [[gnu::always_inline]] inline void stepRow(const Neighbourhood &rows, uint64_t *output, const RowGeometry &geometry) {
+    // Interior words don't need any edge handling, so they go four at a time.
+    uint32_t i = 1;
+    for (; i + 4 < geometry.words; i += 4) {
+        const Wide up = loadWide(rows.up + i), center = loadWide(rows.center + i), down = loadWide(rows.down + i);
+        const Wide upWest = (up << 1) | (loadWide(rows.up + i - 1) >> 63);
+        const Wide upEast = (up >> 1) | (loadWide(rows.up + i + 1) << 63);
+        const Wide centerWest = (center << 1) | (loadWide(rows.center + i - 1) >> 63);
+        const Wide centerEast = (center >> 1) | (loadWide(rows.center + i + 1) << 63);
+        const Wide downWest = (down << 1) | (loadWide(rows.down + i - 1) >> 63);
+        const Wide downEast = (down >> 1) | (loadWide(rows.down + i + 1) << 63);
+        const Wide next = nextState<Conway, Wide>(upWest, up, upEast, centerWest, centerEast, downWest, down, downEast, center, geometry.rule);
+        std::memcpy(output + i, &next, sizeof(next));
+    }
+    output[0] = stepWord<Conway>(rows, 0, geometry);
+    for (i = std::max(i, 1u); i < geometry.words; ++i) {
+        output[i] = stepWord<Conway>(rows, i, geometry);
+    }
+    output[geometry.words - 1] &= geometry.lastWordMask;
+}
+
+template <bool Conway> [[gnu::always_inline]] inline void stepBand(const Board &input, Board &output, const uint64_t *zeros, const RowGeometry &geometry, uint32_t firstRow, uint32_t endRow) {
+    const uint32_t height = input.height();
+    for (uint32_t y = firstRow; y != endRow; ++y) {
+        Neighbourhood rows;
+        rows.center = input.row(y);
+        if (geometry.wrap) {
+            rows.up = input.row(y == 0 ? height - 1 : y - 1);
+            rows.down = input.row(y + 1 == height ? 0 : y + 1);
+        }
+        else {
+            rows.up = y == 0 ? zeros : input.row(y - 1);
+            rows.down = y + 1 == height ? zeros : input.row(y + 1);
+        }
+        stepRow<Conway>(rows, output.row(y), geometry);
+    }
+}
+
+void stepRows(const Board &input, Board &output, const uint64_t *zeros, const RowGeometry &geometry, uint32_t firstRow, uint32_t endRow) {
+    if (geometry.rule.isConway()) {
+        stepBand<true>(input, output, zeros, geometry, firstRow, endRow);
+    }
+    else {
+        stepBand<false>(input, output, zeros, geometry, firstRow, endRow);
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void stepRowsAVX2(const Board &input, Board &output, const uint64_t *zeros, const RowGeometry &geometry, uint32_t firstRow, uint32_t endRow) {
+    if (geometry.rule.isConway()) {
+        stepBand<true>(input, output, zeros, geometry, firstRow, endRow);
+    }
+    else {
+        stepBand<false>(input, output, zeros, geometry, firstRow, endRow);
+    }
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+}
+
+void step(const Board &input, Board &output, bool wrap, const Rule &rule) {
+    const trace::Zone zone("gameOfLife.step");
+    trace::count("gameOfLife.cells", int64_t(input.width()) * input.height());
+    if (output.width() != input.width() || output.height() != input.height()) {
+        output = Board(input.width(), input.height());
+    }
+    if (input.width() == 0 || input.height() == 0) {
+        return;
+    }
+    const uint32_t tailBits = input.width() % 64;
+    const RowGeometry geometry = {
+        .words = input.wordsPerRow(),
+        .width = input.width(),
+        .lastWordMask = tailBits ? (uint64_t(1) << tailBits) - 1 : ~uint64_t(0),
+        .wrap = wrap,
+        .rule = rule,
+    };
+    const std::vector<uint64_t> zeros(geometry.words, 0);
+    const size_t band = std::max<size_t>(1, input.height() / (parallel::threadCount() * 4));
+    parallel::parallelFor(input.height(), band, [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+        if (hasAVX2) {
+            stepRowsAVX2(input, output, zeros.data(), geometry, uint32_t(begin), uint32_t(end));
+            return;
+        }
+#endif
+        stepRows(input, output, zeros.data(), geometry, uint32_t(begin), uint32_t(end));
+    });
+}
+
+void run(Board &board, unsigned generations, bool wrap, const Rule &rule) {
+    Board scratch(board.width(), board.height());
+    for (unsigned generation = 0; generation != generations; ++generation) {
+        step(board, scratch, wrap, rule);
+        std::swap(board, scratch);
+    }
+}
+
+}
@@ -0,0 +1,922 @@
+#include "GraphToy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi" // The 32 byte vectors below never cross a translation unit boundary.
+#endif
+
+namespace graphtoy {
+
+namespace {
+
+// Eight lanes, as in SimplexNoise.cpp. GCC and Clang lower these to AVX registers inside `target("avx2")` functions and to pairs of 128 bit registers elsewhere.
+typedef float Float8 __attribute__((vector_size(32)));
+typedef int32_t Int8 __attribute__((vector_size(32)));
+typedef uint32_t Bits8 __attribute__((vector_size(32)));
+
+// MARK: Lane helpers
+
+// Every function is written once for `float` and `Float8`, so a compiled expression gives the same results one point at a time as in batches.
+
+template <typename T> [[gnu::always_inline]] inline T splat(float value) {
+    return T {} + value;
+}
+
+template <> [[gnu::always_inline]] inline float splat(float value) {
+    return value;
+}
+
+[[gnu::always_inline]] inline float where(bool mask, float a, float b) {
+    return mask ? a : b;
+}
+
+[[gnu::always_inline]] inline Float8 where(Int8 mask, Float8 a, Float8 b) {
+    return (Float8)(((Int8)a & mask) | ((Int8)b & ~mask));
+}
+
+// Applies a scalar function lane by lane, for the transcendentals, which have no vector forms here.
+template <typename F> [[gnu::always_inline]] inline float lanewise(float x, F f) {
+    return f(x);
+}
+
+template <typename F> [[gnu::always_inline]] inline Float8 lanewise(Float8 x, F f) {
+    Float8 result;
+    for (int lane = 0; lane != 8; ++lane) {
+        result[lane] = f(x[lane]);
+    }
+    return result;
+}
+
+template <typename F> [[gnu::always_inline]] inline float lanewise(float x, float y, F f) {
+    return f(x, y);
+}
+
+template <typename F> [[gnu::always_inline]] inline Float8 lanewise(Float8 x, Float8 y, F f) {
+    Float8 result;
+    for (int lane = 0; lane != 8; ++lane) {
+        result[lane] = f(x[lane], y[lane]);
+    }
+    return result;
+}
+
+[[gnu::always_inline]] inline float absOf(float x) {
+    return std::fabs(x);
+}
+
+[[gnu::always_inline]] inline Float8 absOf(Float8 x) {
+    return (Float8)((Int8)x & 0x7fffffff);
+}
+
+[[gnu::always_inline]] inline float truncOf(float x) {
+    return std::trunc(x);
+}
+
+[[gnu::always_inline]] inline Float8 truncOf(Float8 x) {
+    // Floats of 2^23 and more are integers already, and would not survive the round trip through int. The round trip also loses the sign of zero; put it back, as std::trunc(-0.5) is -0.
+    const Float8 truncated = (Float8)((Int8)__builtin_convertvector(__builtin_convertvector(x, Int8), Float8) | ((Int8)x & int32_t(0x80000000)));
+    return where(absOf(x) < 8388608.0f, truncated, x);
+}
+
+[[gnu::always_inline]] inline float floorOf(float x) {
+    return std::floor(x);
+}
+
+[[gnu::always_inline]] inline Float8 floorOf(Float8 x) {
+    // Truncate, then step down where that rounded up (negative non-integers).
+    const Float8 truncated = truncOf(x);
+    return where(truncated > x, truncated - 1.0f, truncated);
+}
+
+template <typename T> [[gnu::always_inline]] inline T ceilOf(T x) {
+    return -floorOf(-x);
+}
+
+template <typename T> [[gnu::always_inline]] inline T minOf(T a, T b) {
+    return where(a < b, a, b);
+}
+
+template <typename T> [[gnu::always_inline]] inline T maxOf(T a, T b) {
+    return where(a > b, a, b);
+}
+
+template <typename T> [[gnu::always_inline]] inline T clampOf(T x, T a, T b) {
+    return where(x < a, a, where(x > b, b, x));
+}
+
+// MARK: Cell hashes
+
+// The cell of x as the wrapping 32 bit integer the hash works on.
+[[gnu::always_inline]] inline uint32_t cellOf(float x) {
+    return uint32_t(int32_t(std::floor(x)));
+}
+
+[[gnu::always_inline]] inline Bits8 cellOf(Float8 x) {
+    return (Bits8)__builtin_convertvector(floorOf(x), Int8);
+}
+
+// graphtoy's `cellnoise` hash of an integer cell, in [0, 1].
+template <typename Bits> [[gnu::always_inline]] inline auto hashCell(Bits n) {
+    n = (n << 13) ^ n;
+    const Bits m = n;
+    n = n * 15731u;
+    n = n * m;
+    n = n + 789221u;
+    n = n * m;
+    n = n + 1376312589u;
+    n = (n >> 14) & 65535u;
+    if constexpr (std::is_same_v<Bits, uint32_t>) {
+        return float(n) / 65535.0f;
+    }
+    else {
+        return __builtin_convertvector((Int8)n, Float8) / 65535.0f;
+    }
+}
+
+template <typename T> [[gnu::always_inline]] inline T cellnoiseOf(T x) {
+    return hashCell(cellOf(x));
+}
+
+template <typename T> [[gnu::always_inline]] inline T voronoiOf(T x) {
+    const auto i = cellOf(x);
+    const T f = x - floorOf(x);
+    const T d0 = absOf(f - (-1.0f + hashCell(i - 1u)));
+    const T d1 = absOf(f - hashCell(i));
+    const T d2 = absOf(f - (1.0f + hashCell(i + 1u)));
+    T r = d0;
+    r = where(d1 < r, d1, r);
+    r = where(d2 < r, d2, r);
+    return r;
+}
+
+template <typename T> [[gnu::always_inline]] inline T noiseOf(T x) {
+    const auto i = cellOf(x);
+    const T f = x - floorOf(x);
+    const T w = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+    const T a = (2.0f * hashCell(i) - 1.0f) * f;
+    const T b = (2.0f * hashCell(i + 1u) - 1.0f) * (f - 1.0f);
+    return 2.0f * (a + (b - a) * w);
+}
+
+// MARK: Functions
+
+constexpr float pi = 3.14159265358979323846f;
+
+// Calls `visitor.operator()<arity>(f)` with a generic lambda `f` computing `function` of `float`s or `Float8`s. Everything that evaluates a function goes through here, so scalar and batch results agree.
+template <typename Visitor> [[gnu::always_inline]] inline void visit(Function function, Visitor &&visitor) {
+    switch (function) {
+    case Function::negate:
+        return visitor.template operator()<1>([](auto x) { return -x; });
+    case Function::add:
+        return visitor.template operator()<2>([](auto a, auto b) { return a + b; });
+    case Function::subtract:
+        return visitor.template operator()<2>([](auto a, auto b) { return a - b; });
+    case Function::multiply:
+        return visitor.template operator()<2>([](auto a, auto b) { return a * b; });
+    case Function::divide:
+        return visitor.template operator()<2>([](auto a, auto b) { return a / b; });
+    case Function::remainder:
+        return visitor.template operator()<2>([](auto a, auto b) { return lanewise(a, b, [](float x, float y) { return std::fmod(x, y); }); });
+    case Function::abs:
+        return visitor.template operator()<1>([](auto x) { return absOf(x); });
+    case Function::sign:
+        // Math.sign: zeros and NaN come back unchanged.
+        return visitor.template operator()<1>([](auto x) {
+            using T = decltype(x);
+            return where(x > 0.0f, splat<T>(1.0f), where(x < 0.0f, splat<T>(-1.0f), x));
+        });
+    case Function::floor:
+        return visitor.template operator()<1>([](auto x) { return floorOf(x); });
+    case Function::ceil:
+        return visitor.template operator()<1>([](auto x) { return ceilOf(x); });
+    case Function::round:
+        return visitor.template operator()<1>([](auto x) {
+            using T = decltype(x);
+            const T floored = floorOf(x);
+            return floored + where(x - floored >= 0.5f, splat<T>(1.0f), splat<T>(0.0f));
+        });
+    case Function::trunc:
+        return visitor.template operator()<1>([](auto x) { return truncOf(x); });
+    case Function::sqrt:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::sqrt(v); }); });
+    case Function::cbrt:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::cbrt(v); }); });
+    case Function::exp:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::exp(v); }); });
+    case Function::log:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::log(v); }); });
+    case Function::log2:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::log2(v); }); });
+    case Function::log10:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::log10(v); }); });
+    case Function::sin:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::sin(v); }); });
+    case Function::cos:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::cos(v); }); });
+    case Function::tan:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::tan(v); }); });
+    case Function::asin:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::asin(v); }); });
+    case Function::acos:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::acos(v); }); });
+    case Function::atan:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::atan(v); }); });
+    case Function::sinh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::sinh(v); }); });
+    case Function::cosh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::cosh(v); }); });
+    case Function::tanh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::tanh(v); }); });
+    case Function::asinh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::asinh(v); }); });
+    case Function::acosh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::acosh(v); }); });
+    case Function::atanh:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::atanh(v); }); });
+    case Function::saturate:
+        return visitor.template operator()<1>([](auto x) {
+            using T = decltype(x);
+            return clampOf(x, splat<T>(0.0f), splat<T>(1.0f));
+        });
+    case Function::ssign:
+        return visitor.template operator()<1>([](auto x) {
+            using T = decltype(x);
+            return where(x >= 0.0f, splat<T>(1.0f), splat<T>(-1.0f));
+        });
+    case Function::radians:
+        return visitor.template operator()<1>([](auto x) { return x * pi / 180.0f; });
+    case Function::degrees:
+        return visitor.template operator()<1>([](auto x) { return x * 180.0f / pi; });
+    case Function::inversesqrt:
+        return visitor.template operator()<1>([](auto x) { return 1.0f / lanewise(x, [](float v) { return std::sqrt(v); }); });
+    case Function::rcbrt:
+        return visitor.template operator()<1>([](auto x) { return 1.0f / lanewise(x, [](float v) { return std::cbrt(v); }); });
+    case Function::rcp:
+        return visitor.template operator()<1>([](auto x) { return 1.0f / x; });
+    case Function::frac:
+        return visitor.template operator()<1>([](auto x) { return x - floorOf(x); });
+    case Function::exp2:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::pow(2.0f, v); }); });
+    case Function::exp10:
+        return visitor.template operator()<1>([](auto x) { return lanewise(x, [](float v) { return std::pow(10.0f, v); }); });
+    case Function::cellnoise:
+        return visitor.template operator()<1>([](auto x) { return cellnoiseOf(x); });
+    case Function::voronoi:
+        return visitor.template operator()<1>([](auto x) { return voronoiOf(x); });
+    case Function::noise:
+        return visitor.template operator()<1>([](auto x) { return noiseOf(x); });
+    case Function::pow:
+        return visitor.template operator()<2>([](auto a, auto b) { return lanewise(a, b, [](float x, float y) { return std::pow(x, y); }); });
+    case Function::atan2:
+        return visitor.template operator()<2>([](auto a, auto b) { return lanewise(a, b, [](float y, float x) { return std::atan2(y, x); }); });
+    case Function::min:
+        return visitor.template operator()<2>([](auto a, auto b) { return minOf(a, b); });
+    case Function::max:
+        return visitor.template operator()<2>([](auto a, auto b) { return maxOf(a, b); });
+    case Function::step:
+        return visitor.template operator()<2>([](auto a, auto x) {
+            using T = decltype(x);
+            return where(x < a, splat<T>(0.0f), splat<T>(1.0f));
+        });
+    case Function::mod:
+        return visitor.template operator()<2>([](auto x, auto y) { return x - y * floorOf(x / y); });
+    case Function::over:
+        return visitor.template operator()<2>([](auto x, auto y) { return 1.0f - (1.0f - x) * (1.0f - y); });
+    case Function::sqr:
+        return visitor.template operator()<2>([](auto a, auto x) {
+            using T = decltype(x);
+            return where(lanewise(x, [](float v) { return std::sin(v); }) > a, splat<T>(1.0f), splat<T>(-1.0f));
+        });
+    case Function::tri:
+        return visitor.template operator()<2>([](auto a, auto x) {
+            using T = decltype(x);
+            T phase = lanewise(x / (2.0f * pi), [](float v) { return std::fmod(v, 1.0f); });
+            phase = where(phase > 0.0f, phase, phase + 1.0f);
+            phase = where(phase < a, phase / a, 1.0f - (phase - a) / (1.0f - a));
+            return -1.0f + 2.0f * phase;
+        });
+    case Function::clamp:
+        return visitor.template operator()<3>([](auto x, auto a, auto b) { return clampOf(x, a, b); });
+    case Function::smoothstep:
+        return visitor.template operator()<3>([](auto a, auto b, auto x) {
+            using T = decltype(x);
+            const T y = clampOf((x - a) / (b - a), splat<T>(0.0f), splat<T>(1.0f));
+            return y * y * (3.0f - 2.0f * y);
+        });
+    case Function::mix:
+        return visitor.template operator()<3>([](auto a, auto b, auto x) { return a + (b - a) * x; });
+    case Function::fma:
+        return visitor.template operator()<3>([](auto x, auto y, auto z) { return x * y + z; });
+    case Function::remap:
+        return visitor.template operator()<5>([](auto a, auto b, auto x, auto c, auto d) { return where(x < a, c, where(x > b, d, c + (d - c) * ((x - a) / (b - a)))); });
+    }
+}
+
+template <typename T, typename F, size_t... Index> [[gnu::always_inline]] inline T apply(const F &f, const T *arguments, std::index_sequence<Index...>) {
+    return f(arguments[Index]...);
+}
+
+// `output[i] = f(inputs[0][i], …)` over [begin, end), eight lanes at a time. The tail goes through the same lanes padded with zeros.
+template <unsigned Arity, typename F> [[gnu::always_inline]] inline void runLanes(const F &f, const float *const *inputs, float *output, size_t begin, size_t end) {
+    size_t index = begin;
+    for (; index + 8 <= end; index += 8) {
+        Float8 arguments[Arity];
+        for (unsigned argument = 0; argument != Arity; ++argument) {
+            std::memcpy(&arguments[argument], inputs[argument] + index, sizeof(Float8));
+        }
+        const Float8 result = apply(f, arguments, std::make_index_sequence<Arity>());
+        std::memcpy(output + index, &result, sizeof(Float8));
+    }
+    if (index != end) {
+        Float8 arguments[Arity] = {};
+        for (unsigned argument = 0; argument != Arity; ++argument) {
+            std::memcpy(&arguments[argument], inputs[argument] + index, (end - index) * sizeof(float));
+        }
+        const Float8 result = apply(f, arguments, std::make_index_sequence<Arity>());
+        std::memcpy(output + index, &result, (end - index) * sizeof(float));
+    }
+}
+
+// MARK: Batches
+
+[[gnu::always_inline]] inline void evaluateRange(Function function, const float *const *arguments, float *output, size_t begin, size_t end) {
+    // Forced inline like everything it calls, so the AVX2 callers compile all of it for AVX2: lambdas don't inherit their enclosing function's target.
+    visit(function, [&]<unsigned Arity>(const auto &f) __attribute__((always_inline)) {
+        runLanes<Arity>(f, arguments, output, begin, end);
+    });
+}
+
+void evaluateRangeGeneric(Function function, const float *const *arguments, float *output, size_t begin, size_t end) {
+    evaluateRange(function, arguments, output, begin, end);
+}
+
+// Registers of a compiled expression hold this many lanes each, so a few dozen registers stay in the L1 cache.
+constexpr size_t blockSize = 256;
+
+// Runs `program` over the first `lanes` (a multiple of eight) lanes of every `blockSize` float register in `registers`.
+[[gnu::always_inline]] inline void runProgram(const std::vector<Expression::Instruction> &program, float *registers, size_t lanes) {
+    for (const Expression::Instruction &instruction : program) {
+        visit(instruction.function, [&]<unsigned Arity>(const auto &f) __attribute__((always_inline)) {
+            const float *inputs[Arity];
+            for (unsigned argument = 0; argument != Arity; ++argument) {
+                inputs[argument] = registers + instruction.inputs[argument] * blockSize;
+            }
+            runLanes<Arity>(f, inputs, registers + instruction.output * blockSize, 0, lanes);
+        });
+    }
+}
+
+void runProgramGeneric(const std::vector<Expression::Instruction> &program, float *registers, size_t lanes) {
+    runProgram(program, registers, lanes);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void evaluateRangeAVX2(Function function, const float *const *arguments, float *output, size_t begin, size_t end) {
+    evaluateRange(function, arguments, output, begin, end);
+}
+
+__attribute__((target("avx2"))) void runProgramAVX2(const std::vector<Expression::Instruction> &program, float *registers, size_t lanes) {
+    runProgram(program, registers, lanes);
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+// MARK: Names
+
+struct NamedFunction {
+    const char *name;
+    Function function;
+};
+
+constexpr NamedFunction namedFunctions[] = {
+    { "abs", Function::abs },
+    { "sign", Function::sign },
+    { "floor", Function::floor },
+    { "ceil", Function::ceil },
+    { "round", Function::round },
+    { "trunc", Function::trunc },
+    { "sqrt", Function::sqrt },
+    { "cbrt", Function::cbrt },
+    { "exp", Function::exp },
+    { "log", Function::log },
+    { "log2", Function::log2 },
+    { "log10", Function::log10 },
+    { "sin", Function::sin },
+    { "cos", Function::cos },
+    { "tan", Function::tan },
+    { "asin", Function::asin },
+    { "acos", Function::acos },
+    { "atan", Function::atan },
+    { "sinh", Function::sinh },
+    { "cosh", Function::cosh },
+    { "tanh", Function::tanh },
+    { "asinh", Function::asinh },
+    { "acosh", Function::acosh },
+    { "atanh", Function::atanh },
+    { "saturate", Function::saturate },
+    { "ssign", Function::ssign },
+    { "radians", Function::radians },
+    { "degrees", Function::degrees },
+    { "inversesqrt", Function::inversesqrt },
+    { "rsqrt", Function::inversesqrt },
+    { "rcbrt", Function::rcbrt },
+    { "rcp", Function::rcp },
+    { "frac", Function::frac },
+    { "fract", Function::frac },
+    { "exp2", Function::exp2 },
+    { "exp10", Function::exp10 },
+    { "cellnoise", Function::cellnoise },
+    { "voronoi", Function::voronoi },
+    { "noise", Function::noise },
+    { "pow", Function::pow },
+    { "atan2", Function::atan2 },
+    { "min", Function::min },
+    { "max", Function::max },
+    { "step", Function::step },
+    { "mod", Function::mod },
+    { "over", Function::over },
+    { "sqr", Function::sqr },
+    { "tri", Function::tri },
+    { "clamp", Function::clamp },
+    { "smoothstep", Function::smoothstep },
+    { "mix", Function::mix },
+    { "lerp", Function::mix },
+    { "fma", Function::fma },
+    { "remap", Function::remap },
+};
+
+// MARK: Parsing
+
+// A parsed expression tree, stored flat. Constant subtrees are folded as they are parsed, so calls always have a non-constant argument.
+struct Node {
+    enum class Kind {
+        constant,
+        variable,
+        call,
+    };
+
+    Kind kind;
+    float value = 0;
+    uint16_t variable = 0;
+    Function function = Function::add;
+    uint32_t arguments[5] = {};
+};
+
+class Parser {
+public:
+    explicit Parser(std::string_view source) : source(source) {
+    }
+
+    // Parses the whole source. Returns the root node, or nothing with a message in `error`.
+    std::optional<uint32_t> parse(std::string &error) {
+        const std::optional<uint32_t> root = expression(0);
+        skipSpace();
+        if (root && position != source.size()) {
+            fail("unexpected `" + std::string(1, source[position]) + "`");
+        }
+        if (!failure.empty()) {
+            error = failure;
+            return std::nullopt;
+        }
+        return root;
+    }
+
+    std::vector<Node> nodes;
+
+private:
+    // Deep enough for anything written by hand, shallow enough not to exhaust the stack.
+    static constexpr unsigned maximumDepth = 200;
+
+    std::optional<uint32_t> fail(const std::string &message) {
+        if (failure.empty()) {
+            failure = message + " at column " + std::to_string(position + 1);
+        }
+        return std::nullopt;
+    }
+
+    void skipSpace() {
+        while (position < source.size() && (source[position] == ' ' || source[position] == '\t' || source[position] == '\n' || source[position] == '\r')) {
+            ++position;
+        }
+    }
+
+    bool consume(char character) {
+        skipSpace();
+        if (position < source.size() && source[position] == character) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t constant(float value) {
+        nodes.push_back({ .kind = Node::Kind::constant, .value = value });
+        return uint32_t(nodes.size() - 1);
+    }
+
+    uint32_t call(Function function, const uint32_t *arguments) {
+        const unsigned count = arity(function);
+        bool constantArguments = true;
+        float values[5] = {};
+        for (unsigned index = 0; index != count; ++index) {
+            constantArguments &= nodes[arguments[index]].kind == Node::Kind::constant;
+            values[index] = nodes[arguments[index]].value;
+        }
+        if (constantArguments) {
+            return constant(evaluate(function, values));
+        }
+        Node node { .kind = Node::Kind::call, .function = function };
+        std::copy_n(arguments, count, node.arguments);
+        nodes.push_back(node);
+        return uint32_t(nodes.size() - 1);
+    }
+
+    // expression := term (('+' | '-') term)*
+    std::optional<uint32_t> expression(unsigned depth) {
+        std::optional<uint32_t> left = term(depth);
+        while (left) {
+            Function function;
+            if (consume('+')) {
+                function = Function::add;
+            }
+            else if (consume('-')) {
+                function = Function::subtract;
+            }
+            else {
+                break;
+            }
+            const std::optional<uint32_t> right = term(depth);
+            if (!right) {
+                return std::nullopt;
+            }
+            const uint32_t arguments[2] = { *left, *right };
+            left = call(function, arguments);
+        }
+        return left;
+    }
+
+    // term := unary (('*' | '/' | '%') unary)*
+    std::optional<uint32_t> term(unsigned depth) {
+        std::optional<uint32_t> left = unary(depth);
+        while (left) {
+            Function function;
+            if (consume('*')) {
+                function = Function::multiply;
+            }
+            else if (consume('/')) {
+                function = Function::divide;
+            }
+            else if (consume('%')) {
+                function = Function::remainder;
+            }
+            else {
+                break;
+            }
+            const std::optional<uint32_t> right = unary(depth);
+            if (!right) {
+                return std::nullopt;
+            }
+            const uint32_t arguments[2] = { *left, *right };
+            left = call(function, arguments);
+        }
+        return left;
+    }
+
+    // unary := ('-' | '+') unary | primary
+    std::optional<uint32_t> unary(unsigned depth) {
+        if (depth > maximumDepth) {
+            return fail("expression nested too deeply");
+        }
+        if (consume('-')) {
+            const std::optional<uint32_t> operand = unary(depth + 1);
+            if (!operand) {
+                return std::nullopt;
+            }
+            return call(Function::negate, &*operand);
+        }
+        if (consume('+')) {
+            return unary(depth + 1);
+        }
+        return primary(depth);
+    }
+
+    // primary := number | name | name '(' arguments ')' | '(' expression ')'
+    std::optional<uint32_t> primary(unsigned depth) {
+        skipSpace();
+        if (position == source.size()) {
+            return fail("unexpected end of expression");
+        }
+        const char character = source[position];
+        if (consume('(')) {
+            const std::optional<uint32_t> inner = expression(depth + 1);
+            if (inner && !consume(')')) {
+                return fail("expected `)`");
+            }
+            return inner;
+        }
+        if ((character >= '0' && character <= '9') || character == '.') {
+            return number();
+        }
+        if (!isNameStart(character)) {
+            return fail("unexpected `" + std::string(1, character) + "`");
+        }
+        const size_t start = position;
+        while (position < source.size() && (isNameStart(source[position]) || (source[position] >= '0' && source[position] <= '9'))) {
+            ++position;
+        }
+        const std::string_view name = source.substr(start, position - start);
+        skipSpace();
+        if (position == source.size() || source[position] != '(') {
+            if (name == "x" || name == "t") {
+                nodes.push_back({ .kind = Node::Kind::variable, .variable = name == "x" ? Expression::xRegister : Expression::tRegister });
+                return uint32_t(nodes.size() - 1);
+            }
+            if (name == "PI") {
+                return constant(pi);
+            }
+            if (name == "E") {
+                return constant(2.71828182845904523536f);
+            }
+            position = start;
+            return fail("unknown name `" + std::string(name) + "`");
+        }
+        const std::optional<Function> function = functionNamed(name);
+        if (!function) {
+            position = start;
+            return fail("unknown function `" + std::string(name) + "`");
+        }
+        ++position;
+        uint32_t arguments[5];
+        unsigned count = 0;
+        if (!consume(')')) {
+            do {
+                const std::optional<uint32_t> argument = expression(depth + 1);
+                if (!argument) {
+                    return std::nullopt;
+                }
+                if (count == arity(*function)) {
+                    return fail("`" + std::string(name) + "` takes " + std::to_string(arity(*function)) + " argument" + (arity(*function) == 1 ? "" : "s"));
+                }
+                arguments[count++] = *argument;
+            } while (consume(','));
+            if (!consume(')')) {
+                return fail("expected `)` or `,`");
+            }
+        }
+        if (count != arity(*function)) {
+            return fail("`" + std::string(name) + "` takes " + std::to_string(arity(*function)) + " argument" + (arity(*function) == 1 ? "" : "s"));
+        }
+        return call(*function, arguments);
+    }
+
+    std::optional<uint32_t> number() {
+        // JavaScript numbers: digits, an optional fraction, an optional exponent.
+        const size_t start = position;
+        const auto digits = [&] {
+            const size_t first = position;
+            while (position < source.size() && source[position] >= '0' && source[position] <= '9') {
+                ++position;
+            }
+            return position - first;
+        };
+        size_t count = digits();
+        if (position < source.size() && source[position] == '.') {
+            ++position;
+            count += digits();
+        }
+        if (count == 0) {
+            position = start;
+            return fail("malformed number");
+        }
+        if (position < source.size() && (source[position] == 'e' || source[position] == 'E')) {
+            const size_t mark = position++;
+            if (position < source.size() && (source[position] == '+' || source[position] == '-')) {
+                ++position;
+            }
+            if (digits() == 0) {
+                position = mark;
+            }
+        }
+        // Parsed as a double and then rounded, as graphtoy's literals are doubles.
+        const std::string text(source.substr(start, position - start));
+        return constant(float(std::strtod(text.c_str(), nullptr)));
+    }
+
+    static bool isNameStart(char character) {
+        return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || character == '_';
+    }
+
+    std::string_view source;
+    size_t position = 0;
+    std::string failure;
+};
+
+}
+
+// MARK: - Functions
+
+unsigned arity(Function function) {
+    unsigned result = 0;
+    visit(function, [&]<unsigned Arity>(const auto &) {
+        result = Arity;
+    });
+    return result;
+}
+
+std::optional<Function> functionNamed(std::string_view name) {
+    for (const NamedFunction &named : namedFunctions) {
+        if (name == named.name) {
+            return named.function;
+        }
+    }
+    return std::nullopt;
+}
+
+float evaluate(Function function, const float *arguments) {
+    float result = 0;
+    visit(function, [&]<unsigned Arity>(const auto &f) {
+        result = apply(f, arguments, std::make_index_sequence<Arity>());
+    });
+    return result;
+}
+
+void evaluate(Function function, const float *const *arguments, float *output, size_t count) {
+    const trace::Zone zone("graphtoy.evaluate");
+    parallel::parallelFor(count, 8192, [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+        if (hasAVX2) {
+            evaluateRangeAVX2(function, arguments, output, begin, end);
+            return;
+        }
+#endif
+        evaluateRangeGeneric(function, arguments, output, begin, end);
+    });
+}
+
+float cellnoise(float x) {
+    return cellnoiseOf(x);
+}
+
+float voronoi(float x) {
+    return voronoiOf(x);
+}
+
+float noise(float x) {
+    return noiseOf(x);
+}
+
+// MARK: - Expressions
+
+bool Expression::compile(std::string_view source) {
+    Parser parser(source);
+    const std::optional<uint32_t> root = parser.parse(message);
+    if (!root) {
+        return false;
+    }
+    const std::vector<Node> &nodes = parser.nodes;
+
+    // Nodes are created children first, so index order is already a valid evaluation order; only nodes reachable from the root are emitted, so constants folded into others get no register.
+    std::vector<bool> reachable(nodes.size(), false);
+    reachable[*root] = true;
+    for (size_t index = nodes.size(); index-- > 0;) {
+        if (reachable[index] && nodes[index].kind == Node::Kind::call) {
+            for (unsigned argument = 0; argument != arity(nodes[index].function); ++argument) {
+                reachable[nodes[index].arguments[argument]] = true;
+            }
+        }
+    }
+    // Constants first, one register per distinct value, then temporaries as the tree is walked. A temporary is freed as soon as the call that reads it has been emitted, and the call may write its result over it.
+    std::vector<float> constants;
+    std::map<uint32_t, uint16_t> constantRegisters;
+    std::vector<uint16_t> nodeRegisters(nodes.size(), 0);
+    for (size_t index = 0; index != nodes.size(); ++index) {
+        if (!reachable[index] || nodes[index].kind != Node::Kind::constant) {
+            continue;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &nodes[index].value, sizeof bits);
+        if (2 + constants.size() >= std::numeric_limits<uint16_t>::max() && !constantRegisters.contains(bits)) {
+            message = "expression too large";
+            return false;
+        }
+        auto [found, inserted] = constantRegisters.try_emplace(bits, uint16_t(2 + constants.size()));
+        if (inserted) {
+            constants.push_back(nodes[index].value);
+        }
+        nodeRegisters[index] = found->second;
+    }
+    const uint16_t firstTemporary = uint16_t(2 + constants.size());
+    std::vector<Instruction> instructions;
+    std::vector<uint16_t> freeTemporaries;
+    uint16_t registerCount = firstTemporary;
+    // How many calls still have to read each node's register.
+    std::vector<uint32_t> readers(nodes.size(), 0);
+    for (size_t index = 0; index != nodes.size(); ++index) {
+        if (reachable[index] && nodes[index].kind == Node::Kind::call) {
+            for (unsigned argument = 0; argument != arity(nodes[index].function); ++argument) {
+                ++readers[nodes[index].arguments[argument]];
+            }
+        }
+    }
+    for (size_t index = 0; index != nodes.size(); ++index) {
+        const Node &node = nodes[index];
+        if (!reachable[index]) {
+            continue;
+        }
+        if (node.kind == Node::Kind::variable) {
+            nodeRegisters[index] = node.variable;
+            continue;
+        }
+        if (node.kind != Node::Kind::call) {
+            continue;
+        }
+        Instruction instruction { .function = node.function, .output = 0, .inputs = {} };
+        const unsigned count = arity(node.function);
+        for (unsigned argument = 0; argument != count; ++argument) {
+            const uint32_t child = node.arguments[argument];
+            instruction.inputs[argument] = nodeRegisters[child];
+            if (--readers[child] == 0 && nodeRegisters[child] >= firstTemporary) {
+                freeTemporaries.push_back(nodeRegisters[child]);
+            }
+        }
+        if (!freeTemporaries.empty()) {
+            instruction.output = freeTemporaries.back();
+            freeTemporaries.pop_back();
+        }
+        else {
+            if (registerCount == std::numeric_limits<uint16_t>::max()) {
+                message = "expression too large";
+                return false;
+            }
+            instruction.output = registerCount++;
+        }
+        nodeRegisters[index] = instruction.output;
+        instructions.push_back(instruction);
+    }
+
+    program = std::move(instructions);
+    constantValues = std::move(constants);
+    registers = registerCount;
+    result = nodeRegisters[*root];
+    message.clear();
+    return true;
+}
+
+float Expression::evaluate(float x, float t) const {
+    std::vector<float> values(registers, 0);
+    values[xRegister] = x;
+    values[tRegister] = t;
+    std::copy(constantValues.begin(), constantValues.end(), values.begin() + 2);
+    for (const Instruction &instruction : program) {
+        visit(instruction.function, [&]<unsigned Arity>(const auto &f) {
+            float arguments[Arity];
+            for (unsigned argument = 0; argument != Arity; ++argument) {
+                arguments[argument] = values[instruction.inputs[argument]];
+            }
+            values[instruction.output] = apply(f, arguments, std::make_index_sequence<Arity>());
+        });
+    }
+    return values[result];
+}
+
+void Expression::evaluate(const float *x, float *output, size_t count, float t) const {
+    const trace::Zone zone("graphtoy.Expression.evaluate");
+    trace::count("graphtoy.samples", int64_t(count));
+    parallel::parallelFor(count, blockSize * 16, [&](size_t begin, size_t end) {
+        std::vector<float> values(size_t(registers) * blockSize, 0);
+        std::fill_n(values.begin() + tRegister * blockSize, blockSize, t);
+        for (size_t index = 0; index != constantValues.size(); ++index) {
+            std::fill_n(values.begin() + (2 + index) * blockSize, blockSize, constantValues[index]);
+        }
+        for (size_t first = begin; first < end; first += blockSize) {
+            const size_t lanes = std::min(blockSize, end - first);
+            std::copy_n(x + first, lanes, values.begin() + xRegister * blockSize);
+            // Pad the last block to whole lanes with zeros.
+            const size_t paddedLanes = (lanes + 7) & ~size_t(7);
+            std::fill(values.begin() + xRegister * blockSize + lanes, values.begin() + xRegister * blockSize + paddedLanes, 0.0f);
+#if defined(__x86_64__)
+            if (hasAVX2) {
+                runProgramAVX2(program, values.data(), paddedLanes);
+            }
+            else {
+                runProgramGeneric(program, values.data(), paddedLanes);
+            }
+#else
+            runProgramGeneric(program, values.data(), paddedLanes);
+#endif
+            std::copy_n(values.begin() + result * blockSize, lanes, output + first);
+        }
+    });
+}
+
+}
@@ -0,0 +1,318 @@
+#include "SparseLife.h"
+
+namespace gameOfLife {
+
+HashLife::HashLife(const Rule &rule, size_t nodeBudget)
+    : currentRule(rule), nodeBudget(nodeBudget) {
+    currentRule.birth &= ~1;
+    for (unsigned block = 0; block != 1 << 16; ++block) {
+        uint8_t next = 0;
+        for (int y = 1; y != 3; ++y) {
+            for (int x = 1; x != 3; ++x) {
+                unsigned count = 0;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        count += (dx || dy) && (block >> ((y + dy) * 4 + x + dx)) & 1;
+                    }
+                }
+                next |= currentRule.next(count, (block >> (y * 4 + x)) & 1) << ((y - 1) * 2 + x - 1);
+            }
+        }
+        centreTable[block] = next;
+    }
+    nodes.push_back({ .nw = 0, .ne = 0, .sw = 0, .se = 0, .level = 0, .population = 0 });
+    nodes.push_back({ .nw = 0, .ne = 0, .sw = 0, .se = 0, .level = 0, .population = 1 });
+    emptyNodes.push_back(0);
+    root = empty(3);
+}
+
+size_t HashLife::ChildrenHash::operator()(const Children &children) const {
+    uint64_t hash = children.nw;
+    hash = hash * 0x9e3779b97f4a7c15 + children.ne;
+    hash = hash * 0x9e3779b97f4a7c15 + children.sw;
+    hash = hash * 0x9e3779b97f4a7c15 + children.se;
+    return size_t(hash ^ (hash >> 29));
+}
+
+// MARK: Nodes
+
+HashLife::NodeID HashLife::join(NodeID nw, NodeID ne, NodeID sw, NodeID se) {
+    const Children children = { nw, ne, sw, se };
+    auto found = canonical.find(children);
+    if (found != canonical.end()) {
+        return found->second;
+    }
+    const NodeID id = NodeID(nodes.size());
+    nodes.push_back({
+        .nw = nw, .ne = ne, .sw = sw, .se = se,
+        .level = nodes[nw].level + 1,
+        .population = nodes[nw].population + nodes[ne].population + nodes[sw].population + nodes[se].population,
+    });
+    canonical.emplace(children, id);
+    return id;
+}
+
+HashLife::NodeID HashLife::empty(uint32_t level) {
+    while (emptyNodes.size() <= level) {
+        const NodeID below = emptyNodes.back();
+        emptyNodes.push_back(join(below, below, below, below));
+    }
+    return emptyNodes[level];
+}
+
+HashLife::NodeID HashLife::centre(NodeID node) {
+    const Node n = nodes[node];
+    return join(nodes[n.nw].se, nodes[n.ne].sw, nodes[n.sw].ne, nodes[n.se].nw);
+}
+
+// The centre half of `node` after 2^log2Generations generations, for log2Generations <= level - 2.
+HashLife::NodeID HashLife::advance(NodeID node, uint32_t log2Generations) {
+    const Node n = nodes[node];
+    if (n.population == 0) {
+        return empty(n.level - 1);
+    }
+    const bool full = log2Generations == n.level - 2;
+    if (full && n.result != none) {
+        return n.result;
+    }
+    const uint64_t partialKey = uint64_t(node) << 8 | log2Generations;
+    if (!full) {
+        auto found = partialSteps.find(partialKey);
+        if (found != partialSteps.end()) {
+            return found->second;
+        }
+    }
+
+    NodeID result;
+    if (n.level == 2) {
+        const NodeID quadrants[4] = { n.nw, n.ne, n.sw, n.se };
+        unsigned block = 0;
+        for (int quadrant = 0; quadrant != 4; ++quadrant) {
+            const Node &q = nodes[quadrants[quadrant]];
+            const NodeID cells[4] = { q.nw, q.ne, q.sw, q.se };
+            for (int cell = 0; cell != 4; ++cell) {
+                block |= cells[cell] << ((quadrant / 2 * 2 + cell / 2) * 4 + quadrant % 2 * 2 + cell % 2);
+            }
+        }
+        const uint8_t next = centreTable[block];
+        result = join(next & 1, (next >> 1) & 1, (next >> 2) & 1, (next >> 3) & 1);
+    }
+    else {
+        // Nine overlapping sub-squares, each either advanced by half the full step or just cropped to its centre, then four more steps over their combinations.
+        const Node nw = nodes[n.nw], ne = nodes[n.ne], sw = nodes[n.sw], se = nodes[n.se];
+        NodeID parts[9] = {
+            n.nw, join(nw.ne, ne.nw, nw.se, ne.sw), n.ne,
+            join(nw.sw, nw.se, sw.nw, sw.ne), join(nw.se, ne.sw, sw.ne, se.nw), join(ne.sw, ne.se, se.nw, se.ne),
+            n.sw, join(sw.ne, se.nw, sw.se, se.sw), n.se,
+        };
+        for (auto &part : parts) {
+            part = full ? advance(part, n.level - 3) : centre(part);
+        }
+        const uint32_t remaining = full ? n.level - 3 : log2Generations;
+        const NodeID a = advance(join(parts[0], parts[1], parts[3], parts[4]), remaining);
+        const NodeID b = advance(join(parts[1], parts[2], parts[4], parts[5]), remaining);
+        const NodeID c = advance(join(parts[3], parts[4], parts[6], parts[7]), remaining);
+        const NodeID d = advance(join(parts[4], parts[5], parts[7], parts[8]), remaining);
+        result = join(a, b, c, d);
+    }
+
+    if (full) {
+        nodes[node].result = result;
+    }
+    else {
+        partialSteps.emplace(partialKey, result);
+    }
+    return result;
+}
+
+// Doubles the universe, keeping the existing cells in the centre.
+void HashLife::expand() {
+    const Node n = nodes[root];
+    const NodeID border = empty(n.level - 1);
+    root = join(join(border, border, border, n.nw), join(border, border, n.ne, border), join(border, n.sw, border, border), join(n.se, border, border, border));
+}
+
+// True if every live cell lies in the centre quarter of the root.
+bool HashLife::isPadded() const {
+    const Node &n = nodes[root];
+    return nodes[n.nw].population == nodes[nodes[n.nw].se].population
+        && nodes[n.ne].population == nodes[nodes[n.ne].sw].population
+        && nodes[n.sw].population == nodes[nodes[n.sw].ne].population
+        && nodes[n.se].population == nodes[nodes[n.se].nw].population;
+}
+
+HashLife::NodeID HashLife::setCell(NodeID node, int64_t x, int64_t y, bool alive) {
+    const Node n = nodes[node];
+    if (n.level == 0) {
+        return alive ? 1 : 0;
+    }
+    const int64_t half = int64_t(1) << (n.level - 1);
+    if (y < half) {
+        return x < half ? join(setCell(n.nw, x, y, alive), n.ne, n.sw, n.se) : join(n.nw, setCell(n.ne, x - half, y, alive), n.sw, n.se);
+    }
+    return x < half ? join(n.nw, n.ne, setCell(n.sw, x, y - half, alive), n.se) : join(n.nw, n.ne, n.sw, setCell(n.se, x - half, y - half, alive));
+}
+
+// The node of `level` whose top left cell is at (x, y) in board coordinates.
+HashLife::NodeID HashLife::build(const Board &board, uint32_t level, int64_t x, int64_t y) {
+    const int64_t size = int64_t(1) << level;
+    if (x >= board.width() || y >= board.height() || x + size <= 0 || y + size <= 0) {
+        return empty(level);
+    }
+    if (level == 0) {
+        return board.get(uint32_t(x), uint32_t(y)) ? 1 : 0;
+    }
+    const int64_t half = size / 2;
+    const NodeID nw = build(board, level - 1, x, y);
+    const NodeID ne = build(board, level - 1, x + half, y);
+    const NodeID sw = build(board, level - 1, x, y + half);
+    const NodeID se = build(board, level - 1, x + half, y + half);
+    return join(nw, ne, sw, se);
+}
+
+HashLife::NodeID HashLife::unite(NodeID a, NodeID b) {
+    if (a == b || nodes[b].population == 0) {
+        return a;
+    }
+    if (nodes[a].population == 0) {
+        return b;
+    }
+    if (nodes[a].level == 0) {
+        return 1;
+    }
+    const Node first = nodes[a], second = nodes[b];
+    const NodeID nw = unite(first.nw, second.nw);
+    const NodeID ne = unite(first.ne, second.ne);
+    const NodeID sw = unite(first.sw, second.sw);
+    const NodeID se = unite(first.se, second.se);
+    return join(nw, ne, sw, se);
+}
+
+HashLife::NodeID HashLife::copy(const std::vector<Node> &source, NodeID node, std::unordered_map<NodeID, NodeID> &copied) {
+    if (node < 2) {
+        return node;
+    }
+    auto found = copied.find(node);
+    if (found != copied.end()) {
+        return found->second;
+    }
+    const Node &n = source[node];
+    const NodeID nw = copy(source, n.nw, copied);
+    const NodeID ne = copy(source, n.ne, copied);
+    const NodeID sw = copy(source, n.sw, copied);
+    const NodeID se = copy(source, n.se, copied);
+    const NodeID result = join(nw, ne, sw, se);
+    copied.emplace(node, result);
+    return result;
+}
+
+void HashLife::collectGarbage() {
+    const std::vector<Node> old = std::move(nodes);
+    nodes.assign(old.begin(), old.begin() + 2);
+    canonical.clear();
+    partialSteps.clear();
+    emptyNodes.assign(1, 0);
+    std::unordered_map<NodeID, NodeID> copied;
+    root = copy(old, root, copied);
+}
+
+void HashLife::collectCells(NodeID node, int64_t x, int64_t y, std::vector<Cell> &result) const {
+    const Node &n = nodes[node];
+    if (n.population == 0) {
+        return;
+    }
+    if (n.level == 0) {
+        result.push_back({ x, y });
+        return;
+    }
+    const int64_t half = int64_t(1) << (n.level - 1);
+    collectCells(n.nw, x, y, result);
+    collectCells(n.ne, x + half, y, result);
+    collectCells(n.sw, x, y + half, result);
+    collectCells(n.se, x + half, y + half, result);
+}
+
+// MARK: Cells
+
+bool HashLife::get(int64_t x, int64_t y) const {
+    const int64_t r = radius();
+    if (x < -r || y < -r || x >= r || y >= r) {
+        return false;
+    }
+    NodeID node = root;
+    x += r;
+    y += r;
+    while (nodes[node].level > 0 && nodes[node].population) {
+        const Node &n = nodes[node];
+        const int64_t half = int64_t(1) << (n.level - 1);
+        const bool east = x >= half, south = y >= half;
+        node = south ? (east ? n.se : n.sw) : (east ? n.ne : n.nw);
+        x -= east ? half : 0;
+        y -= south ? half : 0;
+    }
+    return node == 1;
+}
+
+void HashLife::set(int64_t x, int64_t y, bool alive) {
+    while (x < -radius() || y < -radius() || x >= radius() || y >= radius()) {
+        expand();
+    }
+    root = setCell(root, x + radius(), y + radius(), alive);
+}
+
+void HashLife::insert(const Board &board, int64_t x, int64_t y) {
+    const int64_t right = x + board.width(), bottom = y + board.height();
+    while (x < -radius() || y < -radius() || right > radius() || bottom > radius()) {
+        expand();
+    }
+    const NodeID cells = build(board, nodes[root].level, -radius() - x, -radius() - y);
+    root = unite(root, cells);
+}
+
+Board HashLife::extract(int64_t x, int64_t y, uint32_t width, uint32_t height) const {
+    Board board(width, height);
+    for (const Cell &cell : cells()) {
+        if (cell.x >= x && cell.y >= y && cell.x - x < width && cell.y - y < height) {
+            board.set(uint32_t(cell.x - x), uint32_t(cell.y - y), true);
+        }
+    }
+    return board;
+}
+
+std::vector<Cell> HashLife::cells() const {
+    std::vector<Cell> result;
+    collectCells(root, -radius(), -radius(), result);
+    return result;
+}
+
+uint64_t HashLife::population() const {
+    return nodes[root].population;
+}
+
+// MARK: Stepping
+
+void HashLife::step(unsigned log2Generations) {
+    // The step returns the centre half of the root. Cells spread at most one per generation, so once everything lies in the centre quarter one more doubling leaves room for 2^(level - 3) generations of growth.
+    while (nodes[root].level < log2Generations + 3 || !isPadded()) {
+        expand();
+    }
+    expand();
+    if (nodes.size() > nodeBudget) {
+        collectGarbage();
+    }
+    root = advance(root, log2Generations);
+    while (nodes[root].level < 3) {
+        expand();
+    }
+    generationCount += uint64_t(1) << log2Generations;
+}
+
+void HashLife::run(uint64_t generations) {
+    for (unsigned bit = 0; generations >> bit; ++bit) {
+        if ((generations >> bit) & 1) {
+            step(bit);
+        }
+    }
+}
+
+}
@@ -0,0 +1,335 @@
+#include "KTXFile.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace textures {
+
+struct KTXFile::Mapping {
+    void *address = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (address) {
+            munmap(address, size);
+        }
+    }
+};
+
+namespace {
+
+constexpr uint8_t identifier1[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr uint8_t identifier2[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr uint32_t maximumLevels = 32;
+
+uint32_t read32(const uint8_t *bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, 4);
+    return value;
+}
+
+uint64_t read64(const uint8_t *bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, 8);
+    return value;
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Block sizes of the compressed `glInternalFormat`s KTX 1 files commonly hold.
+bool compressedFormat(uint32_t internalFormat, BlockFormat &block) {
+    // ASTC in the order of GL_COMPRESSED_RGBA_ASTC_4x4_KHR ... 12x12 (0x93B0) and their sRGB forms (0x93D0).
+    static constexpr uint8_t astc[14][2] = { { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 }, { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 } };
+    for (const uint32_t base : { 0x93B0u, 0x93D0u }) {
+        if (internalFormat >= base && internalFormat < base + 14) {
+            block = { astc[internalFormat - base][0], astc[internalFormat - base][1], 1, 16 };
+            return true;
+        }
+    }
+    switch (internalFormat) {
+    case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    case 0x83F1: // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+    case 0x8C4C: // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    case 0x8C4D: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+    case 0x8D64: // GL_ETC1_RGB8_OES
+    case 0x9274: // GL_COMPRESSED_RGB8_ETC2
+    case 0x9275: // GL_COMPRESSED_SRGB8_ETC2
+    case 0x9276: // GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+    case 0x9277: // GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2
+    case 0x9270: // GL_COMPRESSED_R11_EAC
+    case 0x9271: // GL_COMPRESSED_SIGNED_R11_EAC
+        block = { 4, 4, 1, 8 };
+        return true;
+    case 0x83F2: // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+    case 0x83F3: // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    case 0x8C4E: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+    case 0x8C4F: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+    case 0x8E8C: // GL_COMPRESSED_RGBA_BPTC_UNORM
+    case 0x8E8D: // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+    case 0x8E8E: // GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+    case 0x8E8F: // GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+    case 0x9272: // GL_COMPRESSED_RG11_EAC
+    case 0x9273: // GL_COMPRESSED_SIGNED_RG11_EAC
+    case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+    case 0x9279: // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+        block = { 4, 4, 1, 16 };
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Components of an uncompressed `glFormat`, or 0 if unknown.
+uint32_t componentCount(uint32_t format) {
+    switch (format) {
+    case 0x1903: // GL_RED
+    case 0x1906: // GL_ALPHA
+    case 0x1909: // GL_LUMINANCE
+    case 0x8D94: // GL_RED_INTEGER
+    case 0x1902: // GL_DEPTH_COMPONENT
+        return 1;
+    case 0x8227: // GL_RG
+    case 0x8228: // GL_RG_INTEGER
+    case 0x190A: // GL_LUMINANCE_ALPHA
+        return 2;
+    case 0x1907: // GL_RGB
+    case 0x80E0: // GL_BGR
+    case 0x8D98: // GL_RGB_INTEGER
+        return 3;
+    case 0x1908: // GL_RGBA
+    case 0x80E1: // GL_BGRA
+    case 0x8D99: // GL_RGBA_INTEGER
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Packed `glType`s hold a whole texel in `glTypeSize` bytes.
+bool packedType(uint32_t type) {
+    switch (type) {
+    case 0x8033: // GL_UNSIGNED_SHORT_4_4_4_4
+    case 0x8034: // GL_UNSIGNED_SHORT_5_5_5_1
+    case 0x8363: // GL_UNSIGNED_SHORT_5_6_5
+    case 0x8365: // GL_UNSIGNED_SHORT_4_4_4_4_REV
+    case 0x8366: // GL_UNSIGNED_SHORT_1_5_5_5_REV
+    case 0x8367: // GL_UNSIGNED_INT_8_8_8_8_REV
+    case 0x8368: // GL_UNSIGNED_INT_2_10_10_10_REV
+    case 0x8C3B: // GL_UNSIGNED_INT_10F_11F_11F_REV
+    case 0x8C3E: // GL_UNSIGNED_INT_5_9_9_9_REV
+    case 0x84FA: // GL_UNSIGNED_INT_24_8
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+bool KTXFile::open(const std::string &path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        message = "cannot open " + path;
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+        ::close(descriptor);
+        message = "cannot read " + path;
+        return false;
+    }
+    auto newMapping = std::make_shared<Mapping>();
+    newMapping->size = size_t(status.st_size);
+    void *address = mmap(nullptr, newMapping->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (address == MAP_FAILED) {
+        message = "cannot map " + path;
+        return false;
+    }
+    newMapping->address = address;
+    // Regions are read where the view is, not in file order.
+    madvise(address, newMapping->size, MADV_RANDOM);
+    mapping = std::move(newMapping);
+    return parse(static_cast<const uint8_t *>(mapping->address), mapping->size);
+}
+
+bool KTXFile::parse(const uint8_t *bytes, size_t byteCount) {
+    message.clear();
+    fileVersion = 0;
+    std::fill_n(levelData, maximumLevels, nullptr);
+    std::fill_n(faceStride, maximumLevels, 0);
+    if (byteCount >= 12 && std::memcmp(bytes, identifier1, 12) == 0) {
+        return parseVersion1(bytes, byteCount);
+    }
+    if (byteCount >= 12 && std::memcmp(bytes, identifier2, 12) == 0) {
+        return parseVersion2(bytes, byteCount);
+    }
+    message = "not a KTX file";
+    return false;
+}
+
+bool KTXFile::parseVersion1(const uint8_t *bytes, size_t byteCount) {
+    if (byteCount < 64) {
+        message = "truncated KTX header";
+        return false;
+    }
+    if (read32(bytes + 12) != 0x04030201) {
+        message = "big endian KTX files are not supported";
+        return false;
+    }
+    const uint32_t type = read32(bytes + 16), typeSize = read32(bytes + 20), glFormat = read32(bytes + 24);
+    pixelFormat = read32(bytes + 28);
+    size[0] = read32(bytes + 36);
+    size[1] = std::max(read32(bytes + 40), 1u);
+    size[2] = std::max(read32(bytes + 44), 1u);
+    const uint32_t arrayElements = read32(bytes + 48);
+    layers = std::max(arrayElements, 1u);
+    faces = read32(bytes + 52);
+    levels = std::max(read32(bytes + 56), 1u);
+    const uint32_t keyValueBytes = read32(bytes + 60);
+
+    if (type == 0) {
+        if (!compressedFormat(pixelFormat, block)) {
+            message = "unknown compressed KTX format " + std::to_string(pixelFormat);
+            return false;
+        }
+        padRows = false;
+    }
+    else {
+        const uint32_t texelBytes = packedType(type) ? typeSize : typeSize * componentCount(glFormat);
+        if (texelBytes == 0 || texelBytes > 64) {
+            message = "unknown KTX pixel format";
+            return false;
+        }
+        block = { 1, 1, 1, texelBytes };
+        padRows = true;
+    }
+    if (size[0] == 0 || (faces != 1 && faces != 6) || levels > maximumLevels || size_t(keyValueBytes) > byteCount - 64) {
+        message = "invalid KTX header";
+        return false;
+    }
+
+    // Each level is its image size followed by the images; non-array cube maps give the size of one face and pad each face.
+    const bool cubeFaces = faces == 6 && arrayElements == 0;
+    size_t offset = 64 + size_t(keyValueBytes);
+    for (uint32_t level = 0; level != levels; ++level) {
+        // Rounding the previous level up to 4 bytes can step past the end of the file.
+        if (offset > byteCount || byteCount - offset < 4) {
+            message = "truncated KTX level";
+            return false;
+        }
+        const size_t imageSize = read32(bytes + offset);
+        offset += 4;
+        const size_t depthAtLevel = std::max(size[2] >> level, 1u);
+        const double needed = double(imageBytes(level)) * double(depthAtLevel) * (cubeFaces ? 1 : double(layers) * faces);
+        const size_t levelBytes = cubeFaces ? alignUp(imageSize, 4) * faces : imageSize;
+        if (double(imageSize) < needed || levelBytes > byteCount - offset) {
+            message = "truncated KTX level";
+            return false;
+        }
+        levelData[level] = bytes + offset;
+        faceStride[level] = cubeFaces ? alignUp(imageSize, 4) : 0;
+        offset = alignUp(offset + levelBytes, 4);
+    }
+    fileVersion = 1;
+    return true;
+}
+
+bool KTXFile::parseVersion2(const uint8_t *bytes, size_t byteCount) {
+    if (byteCount < 80) {
+        message = "truncated KTX header";
+        return false;
+    }
+    pixelFormat = read32(bytes + 12);
+    size[0] = read32(bytes + 20);
+    size[1] = std::max(read32(bytes + 24), 1u);
+    size[2] = std::max(read32(bytes + 28), 1u);
+    layers = std::max(read32(bytes + 32), 1u);
+    faces = read32(bytes + 36);
+    levels = std::max(read32(bytes + 40), 1u);
+    const uint32_t supercompression = read32(bytes + 44);
+    const uint32_t descriptorOffset = read32(bytes + 48), descriptorBytes = read32(bytes + 52);
+    if (supercompression != 0) {
+        message = "supercompressed KTX 2 files are not supported";
+        return false;
+    }
+    if (size[0] == 0 || (faces != 1 && faces != 6) || levels > maximumLevels || 80 + size_t(levels) * 24 > byteCount) {
+        message = "invalid KTX header";
+        return false;
+    }
+
+    // The block size comes from the basic data format descriptor: its texel block dimensions (minus one) and the bytes in plane 0.
+    if (descriptorBytes < 4 + 24 || descriptorOffset > byteCount || descriptorBytes > byteCount - descriptorOffset) {
+        message = "missing KTX data format descriptor";
+        return false;
+    }
+    const uint8_t *descriptor = bytes + descriptorOffset + 4;
+    block = { uint32_t(descriptor[12]) + 1, uint32_t(descriptor[13]) + 1, uint32_t(descriptor[14]) + 1, descriptor[16] };
+    if (block.bytes == 0) {
+        message = "unsupported KTX data format descriptor";
+        return false;
+    }
+    padRows = false;
+
+    for (uint32_t level = 0; level != levels; ++level) {
+        const uint8_t *entry = bytes + 80 + size_t(level) * 24;
+        const uint64_t offset = read64(entry), length = read64(entry + 8);
+        const size_t depthAtLevel = std::max(size[2] >> level, 1u);
+        const double needed = double(imageBytes(level)) * double(depthAtLevel) * layers * faces;
+        if (offset > byteCount || length > byteCount - offset || double(length) < needed) {
+            message = "truncated KTX level";
+            return false;
+        }
+        levelData[level] = bytes + offset;
+    }
+    fileVersion = 2;
+    return true;
+}
+
+size_t KTXFile::bytesPerRow(uint32_t level) const {
+    const size_t bytes = size_t(blocksWide(level)) * block.bytes;
+    return padRows ? alignUp(bytes, 4) : bytes;
+}
+
+const uint8_t *KTXFile::image(uint32_t level, uint32_t layer, uint32_t face) const {
+    if (fileVersion == 0 || level >= levels || layer >= layers || face >= faces) {
+        return nullptr;
+    }
+    if (faceStride[level] != 0) {
+        return levelData[level] + face * faceStride[level];
+    }
+    const size_t depthAtLevel = std::max(size[2] >> level, 1u);
+    return levelData[level] + (size_t(layer) * faces + face) * depthAtLevel * imageBytes(level);
+}
+
+bool KTXFile::copyBlocks(uint32_t level, uint32_t layer, uint32_t face, int32_t blockX, int32_t blockY, uint32_t blocksAcross, uint32_t blocksDown, uint8_t *output, size_t outputBytesPerRow) const {
+    const uint8_t *source = image(level, layer, face);
+    if (!source) {
+        return false;
+    }
+    const int32_t lastX = int32_t(blocksWide(level)) - 1, lastY = int32_t(blocksHigh(level)) - 1;
+    const size_t rowBytes = bytesPerRow(level);
+    for (uint32_t row = 0; row != blocksDown; ++row) {
+        const uint8_t *sourceRow = source + size_t(std::clamp(blockY + int32_t(row), 0, lastY)) * rowBytes;
+        uint8_t *outputRow = output + row * outputBytesPerRow;
+        // The interior is one copy; edge blocks repeat.
+        const int32_t first = std::clamp(blockX, 0, lastX + 1), last = std::clamp(blockX + int32_t(blocksAcross), 0, lastX + 1);
+        for (int32_t x = blockX; x < first; ++x) {
+            std::memcpy(outputRow + size_t(x - blockX) * block.bytes, sourceRow, block.bytes);
+        }
+        if (first < last) {
+            std::memcpy(outputRow + size_t(first - blockX) * block.bytes, sourceRow + size_t(first) * block.bytes, size_t(last - first) * block.bytes);
+        }
+        for (int32_t x = std::max(last, blockX); x < blockX + int32_t(blocksAcross); ++x) {
+            std::memcpy(outputRow + size_t(x - blockX) * block.bytes, sourceRow + size_t(lastX) * block.bytes, block.bytes);
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "GameOfLife.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi" // The 32 byte vectors below never cross a translation unit boundary.
+#endif
+
+// Bit-sliced neighbour counting shared by the dense and sparse Life engines. Each bit of a word (or lane of a `Wide`) is an independent cell.
+
+namespace gameOfLife {
+
+template <typename T> struct SumCarry {
+    T sum;
+    T carry;
+};
+
+template <typename T> [[gnu::always_inline]] inline SumCarry<T> halfAdd(T a, T b) {
+    return { a ^ b, a & b };
+}
+
+template <typename T> [[gnu::always_inline]] inline SumCarry<T> fullAdd(T a, T b, T c) {
+    const T t = a ^ b;
+    return { t ^ c, (a & b) | (t & c) };
+}
+
+// Bit-sliced equivalent of `rules(count, alive)`: the eight neighbour masks are summed into a 4 bit count per lane. `Conway` selects the hardwired B3/S23 expression, otherwise each count the rule mentions is matched separately.
+template <bool Conway, typename T> [[gnu::always_inline]] inline T nextState(T n0, T n1, T n2, T n3, T n4, T n5, T n6, T n7, T alive, const Rule &rule) {
+    const auto a = fullAdd(n0, n1, n2);
+    const auto b = fullAdd(n3, n4, n5);
+    const auto c = halfAdd(n6, n7);
+    const auto ones = fullAdd(a.sum, b.sum, c.sum);
+    const auto t = fullAdd(a.carry, b.carry, c.carry);
+    const auto twos = halfAdd(t.sum, ones.carry);
+    if constexpr (Conway) {
+        const T foursOrEights = t.carry | twos.carry;
+        // count == 3, or count == 2 and alive.
+        return twos.sum & ~foursOrEights & (ones.sum | alive);
+    }
+    else {
+        const T bits[4] = { ones.sum, twos.sum, t.carry ^ twos.carry, t.carry & twos.carry };
+        T result = alive & 0;
+        for (unsigned count = 0; count <= 8; ++count) {
+            const bool born = (rule.birth >> count) & 1, survives = (rule.survival >> count) & 1;
+            if (!born && !survives) {
+                continue;
+            }
+            T matches = ~result | result;
+            for (unsigned bit = 0; bit != 4; ++bit) {
+                matches &= (count >> bit) & 1 ? bits[bit] : ~bits[bit];
+            }
+            result |= born && survives ? matches : born ? matches & ~alive : matches & alive;
+        }
+        return result;
+    }
+}
+
+// Four words per lane group. GCC and Clang lower this to AVX2 registers inside `target("avx2")` functions and to pairs of 128 bit registers elsewhere.
+typedef uint64_t Wide __attribute__((vector_size(32)));
+
+[[gnu::always_inline]] inline Wide loadWide(const uint64_t *source) {
+    Wide value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+}
@@ -0,0 +1,561 @@
+#include "MarchingCubes.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "MarchingCubesTables.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace marchingCubes {
+
+namespace {
+
+enum Axis : uint8_t {
+    AxisX = 0,
+    AxisY = 1,
+    AxisZ = 2,
+};
+
+// Lattice offsets of the eight GRIDCELL corners.
+constexpr uint8_t cornerOffsets[8][3] = {
+    { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+    { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
+};
+
+// The two corners joined by each of the 12 cube edges, in the order `Polygonise()` interpolates them.
+constexpr uint8_t edgeCorners[12][2] = {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+    { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+};
+
+// Every cube edge is a lattice edge owned by the corner it starts from (its lowest corner) and running along +x, +y or +z.
+struct LatticeEdge {
+    uint8_t corner;
+    Axis axis;
+};
+
+constexpr LatticeEdge latticeEdges[12] = {
+    { 0, AxisX }, { 1, AxisY }, { 3, AxisX }, { 0, AxisY },
+    { 4, AxisX }, { 5, AxisY }, { 7, AxisX }, { 4, AxisY },
+    { 0, AxisZ }, { 1, AxisZ }, { 2, AxisZ }, { 3, AxisZ },
+};
+
+// Vertex ids that belong to the following slab are tagged and resolved once every slab's vertex count is known.
+constexpr uint32_t foreignVertex = 0x80000000;
+
+// Matches `VertexInterp()`.
+float interpolationFactor(float isolevel, float valp1, float valp2) {
+    if (std::abs(isolevel - valp1) < 0.00001f) {
+        return 0;
+    }
+    if (std::abs(isolevel - valp2) < 0.00001f) {
+        return 1;
+    }
+    if (std::abs(valp1 - valp2) < 0.00001f) {
+        return 0;
+    }
+    return (isolevel - valp1) / (valp2 - valp1);
+}
+
+PackedFloat3 latticePosition(const ScalarGrid &grid, float x, float y, float z) {
+    return {
+        grid.origin.x + x * grid.spacing.x,
+        grid.origin.y + y * grid.spacing.y,
+        grid.origin.z + z * grid.spacing.z,
+    };
+}
+
+PackedFloat3 gradient(const ScalarGrid &grid, uint32_t x, uint32_t y, uint32_t z) {
+    const uint32_t x0 = x > 0 ? x - 1 : x, x1 = std::min(x + 1, grid.width - 1);
+    const uint32_t y0 = y > 0 ? y - 1 : y, y1 = std::min(y + 1, grid.height - 1);
+    const uint32_t z0 = z > 0 ? z - 1 : z, z1 = std::min(z + 1, grid.depth - 1);
+    return {
+        (grid.value(x1, y, z) - grid.value(x0, y, z)) / (float(x1 - x0) * grid.spacing.x),
+        (grid.value(x, y1, z) - grid.value(x, y0, z)) / (float(y1 - y0) * grid.spacing.y),
+        (grid.value(x, y, z1) - grid.value(x, y, z0)) / (float(z1 - z0) * grid.spacing.z),
+    };
+}
+
+Vertex makeVertex(const ScalarGrid &grid, float isolevel, uint32_t x, uint32_t y, uint32_t z, Axis axis) {
+    const uint32_t x2 = x + (axis == AxisX), y2 = y + (axis == AxisY), z2 = z + (axis == AxisZ);
+    const float mu = interpolationFactor(isolevel, grid.value(x, y, z), grid.value(x2, y2, z2));
+    const auto g1 = gradient(grid, x, y, z);
+    const auto g2 = gradient(grid, x2, y2, z2);
+    PackedFloat3 normal = { g1.x + mu * (g2.x - g1.x), g1.y + mu * (g2.y - g1.y), g1.z + mu * (g2.z - g1.z) };
+    // Bourke's tables wind triangles counter-clockwise around the direction of decreasing values.
+    const float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+    if (length > 0) {
+        normal = { -normal.x / length, -normal.y / length, -normal.z / length };
+    }
+    return {
+        .position = latticePosition(grid, float(x) + (axis == AxisX ? mu : 0), float(y) + (axis == AxisY ? mu : 0), float(z) + (axis == AxisZ ? mu : 0)),
+        .normal = normal,
+    };
+}
+
+// Edge crossing ids for one z layer of lattice points, indexed by ((y * width) + x) * 3 + axis. Only entries for crossing edges are meaningful.
+using LayerIds = std::vector<uint32_t>;
+
+// Assigns consecutive ids (starting at `nextId`, or-ed with `tag`) to every edge crossing owned by the points of layer `z`. Crossing vertices are appended to `vertices` if it is non-null. Returns the next unused id.
+uint32_t numberLayer(const ScalarGrid &grid, float isolevel, uint32_t z, LayerIds &ids, uint32_t nextId, uint32_t tag, std::vector<Vertex> *vertices) {
+    const bool hasZ = z + 1 < grid.depth;
+    for (uint32_t y = 0; y != grid.height; ++y) {
+        const bool hasY = y + 1 < grid.height;
+        const float *row = grid.values + (size_t(z) * grid.height + y) * grid.width;
+        const float *rowY = row + grid.width;
+        const float *rowZ = row + size_t(grid.width) * grid.height;
+        uint32_t *rowIds = ids.data() + size_t(y) * grid.width * 3;
+        for (uint32_t x = 0; x != grid.width; ++x) {
+            const bool inside = row[x] < isolevel;
+            if (x + 1 < grid.width && inside != (row[x + 1] < isolevel)) {
+                rowIds[x * 3 + AxisX] = nextId++ | tag;
+                if (vertices) {
+                    vertices->push_back(makeVertex(grid, isolevel, x, y, z, AxisX));
+                }
+            }
+            if (hasY && inside != (rowY[x] < isolevel)) {
+                rowIds[x * 3 + AxisY] = nextId++ | tag;
+                if (vertices) {
+                    vertices->push_back(makeVertex(grid, isolevel, x, y, z, AxisY));
+                }
+            }
+            if (hasZ && inside != (rowZ[x] < isolevel)) {
+                rowIds[x * 3 + AxisZ] = nextId++ | tag;
+                if (vertices) {
+                    vertices->push_back(makeVertex(grid, isolevel, x, y, z, AxisZ));
+                }
+            }
+        }
+    }
+    return nextId;
+}
+
+// Emits the triangles of every cell between point layers z and z + 1.
+void emitCells(const ScalarGrid &grid, float isolevel, uint32_t z, const LayerIds &lower, const LayerIds &upper, std::vector<uint32_t> &indices) {
+    const size_t layerSize = size_t(grid.width) * grid.height;
+    for (uint32_t y = 0; y + 1 < grid.height; ++y) {
+        const float *row0 = grid.values + z * layerSize + size_t(y) * grid.width;
+        const float *row1 = row0 + grid.width;
+        const float *row2 = row0 + layerSize;
+        const float *row3 = row2 + grid.width;
+        for (uint32_t x = 0; x + 1 < grid.width; ++x) {
+            int cubeindex = 0;
+            if (row0[x] < isolevel) cubeindex |= 1;
+            if (row0[x + 1] < isolevel) cubeindex |= 2;
+            if (row1[x + 1] < isolevel) cubeindex |= 4;
+            if (row1[x] < isolevel) cubeindex |= 8;
+            if (row2[x] < isolevel) cubeindex |= 16;
+            if (row2[x + 1] < isolevel) cubeindex |= 32;
+            if (row3[x + 1] < isolevel) cubeindex |= 64;
+            if (row3[x] < isolevel) cubeindex |= 128;
+            if (edgeTable[cubeindex] == 0) {
+                continue;
+            }
+            for (int i = 0; triTable[cubeindex][i] != -1; ++i) {
+                const auto edge = latticeEdges[triTable[cubeindex][i]];
+                const auto offset = cornerOffsets[edge.corner];
+                const LayerIds &layer = offset[2] ? upper : lower;
+                indices.push_back(layer[((size_t(y) + offset[1]) * grid.width + x + offset[0]) * 3 + edge.axis]);
+            }
+        }
+    }
+}
+
+struct Slab {
+    uint32_t firstLayer;
+    uint32_t endLayer;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// A slab owns the edges of the point layers [firstLayer, endLayer) and the cells between them and the next layer. Edges of the next slab's first layer are numbered exactly as that slab will number them, but tagged as foreign.
+void extractSlab(const ScalarGrid &grid, float isolevel, Slab &slab) {
+    LayerIds lower(size_t(grid.width) * grid.height * 3);
+    LayerIds upper(lower.size());
+    uint32_t nextId = numberLayer(grid, isolevel, slab.firstLayer, lower, 0, 0, &slab.vertices);
+    for (uint32_t z = slab.firstLayer; z != slab.endLayer && z + 1 < grid.depth; ++z) {
+        if (z + 1 < slab.endLayer) {
+            nextId = numberLayer(grid, isolevel, z + 1, upper, nextId, 0, &slab.vertices);
+        }
+        else {
+            numberLayer(grid, isolevel, z + 1, upper, 0, foreignVertex, nullptr);
+        }
+        emitCells(grid, isolevel, z, lower, upper, slab.indices);
+        std::swap(lower, upper);
+    }
+}
+
+uint64_t edgeKey(const ScalarGrid &grid, uint32_t x, uint32_t y, uint32_t z, Axis axis) {
+    return ((uint64_t(z) * grid.height + y) * grid.width + x) * 3 + axis;
+}
+
+PackedFloat3 cornerPosition(const ScalarGrid &grid, uint32_t x, uint32_t y, uint32_t z, int corner) {
+    return latticePosition(grid, float(x + cornerOffsets[corner][0]), float(y + cornerOffsets[corner][1]), float(z + cornerOffsets[corner][2]));
+}
+
+}
+
+// MARK: -
+
+IndexedMesh extractIsosurface(const ScalarGrid &grid, float isolevel) {
+    const trace::Zone zone("marchingCubes.extractIsosurface");
+    IndexedMesh mesh;
+    if (grid.width < 2 || grid.height < 2 || grid.depth < 2) {
+        return mesh;
+    }
+
+    // A few slabs per thread keeps the cores busy when the surface is unevenly distributed.
+    const uint32_t slabCount = std::min(grid.depth, parallel::threadCount() * 4);
+    std::vector<Slab> slabs(slabCount);
+    for (uint32_t index = 0; index != slabCount; ++index) {
+        slabs[index].firstLayer = uint32_t(uint64_t(grid.depth) * index / slabCount);
+        slabs[index].endLayer = uint32_t(uint64_t(grid.depth) * (index + 1) / slabCount);
+    }
+    parallel::parallelFor(slabCount, 1, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const trace::Zone slabZone("marchingCubes.extractSlab");
+            extractSlab(grid, isolevel, slabs[index]);
+        }
+    });
+
+    std::vector<size_t> vertexBases(slabCount + 1, 0);
+    std::vector<size_t> indexBases(slabCount + 1, 0);
+    for (uint32_t index = 0; index != slabCount; ++index) {
+        vertexBases[index + 1] = vertexBases[index] + slabs[index].vertices.size();
+        indexBases[index + 1] = indexBases[index] + slabs[index].indices.size();
+    }
+    mesh.vertices.resize(vertexBases[slabCount]);
+    mesh.indices.resize(indexBases[slabCount]);
+    parallel::parallelFor(slabCount, 1, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const auto &slab = slabs[index];
+            std::copy(slab.vertices.begin(), slab.vertices.end(), mesh.vertices.begin() + vertexBases[index]);
+            const auto base = uint32_t(vertexBases[index]);
+            const auto nextBase = uint32_t(vertexBases[index + 1]);
+            auto output = mesh.indices.begin() + indexBases[index];
+            for (auto id : slab.indices) {
+                *output++ = (id & foreignVertex) ? nextBase + (id & ~foreignVertex) : base + id;
+            }
+        }
+    });
+    trace::count("marchingCubes.cellsClassified", int64_t(grid.width - 1) * (grid.height - 1) * (grid.depth - 1));
+    trace::count("marchingCubes.trianglesEmitted", int64_t(mesh.indices.size() / 3));
+    return mesh;
+}
+
+std::vector<Triangle> extractTriangleSoup(const ScalarGrid &grid, float isolevel) {
+    std::vector<Triangle> triangles;
+    for (uint32_t z = 0; z + 1 < grid.depth; ++z) {
+        for (uint32_t y = 0; y + 1 < grid.height; ++y) {
+            for (uint32_t x = 0; x + 1 < grid.width; ++x) {
+                float val[8];
+                int cubeindex = 0;
+                for (int corner = 0; corner != 8; ++corner) {
+                    val[corner] = grid.value(x + cornerOffsets[corner][0], y + cornerOffsets[corner][1], z + cornerOffsets[corner][2]);
+                    if (val[corner] < isolevel) {
+                        cubeindex |= 1 << corner;
+                    }
+                }
+                if (edgeTable[cubeindex] == 0) {
+                    continue;
+                }
+                PackedFloat3 vertlist[12];
+                for (int edge = 0; edge != 12; ++edge) {
+                    if (edgeTable[cubeindex] & (1 << edge)) {
+                        const int c1 = edgeCorners[edge][0], c2 = edgeCorners[edge][1];
+                        const auto p1 = cornerPosition(grid, x, y, z, c1);
+                        const auto p2 = cornerPosition(grid, x, y, z, c2);
+                        const float mu = interpolationFactor(isolevel, val[c1], val[c2]);
+                        vertlist[edge] = { p1.x + mu * (p2.x - p1.x), p1.y + mu * (p2.y - p1.y), p1.z + mu * (p2.z - p1.z) };
+                    }
+                }
+                for (int i = 0; triTable[cubeindex][i] != -1; i += 3) {
+                    triangles.push_back({ { vertlist[triTable[cubeindex][i]], vertlist[triTable[cubeindex][i + 1]], vertlist[triTable[cubeindex][i + 2]] } });
+                }
+            }
+        }
+    }
+    return triangles;
+}
+
+// MARK: -
+
+BrickedIsosurface::BrickedIsosurface(const ScalarGrid &grid, float isolevel, uint32_t brickSize)
+    : grid(grid), currentIsolevel(isolevel), brickSize(std::max(brickSize, 1u)) {
+    const bool empty = grid.width < 2 || grid.height < 2 || grid.depth < 2;
+    brickDimensions[0] = empty ? 0 : (grid.width - 2) / this->brickSize + 1;
+    brickDimensions[1] = empty ? 0 : (grid.height - 2) / this->brickSize + 1;
+    brickDimensions[2] = empty ? 0 : (grid.depth - 2) / this->brickSize + 1;
+    bricks.resize(size_t(brickDimensions[0]) * brickDimensions[1] * brickDimensions[2]);
+    parallel::parallelFor(bricks.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            updateRange(index);
+        }
+    });
+    rebuildHierarchy();
+    setIsolevel(isolevel);
+}
+
+void BrickedIsosurface::setIsolevel(float isolevel) {
+    currentIsolevel = isolevel;
+    std::vector<size_t> dirty;
+    if (!hierarchy.empty()) {
+        collectStraddlingBricks(hierarchy.size() - 1, 0, 0, 0, dirty);
+    }
+    // Bricks that used to have geometry need clearing even if they no longer straddle.
+    for (size_t index = 0; index != bricks.size(); ++index) {
+        if (bricks[index].active) {
+            dirty.push_back(index);
+        }
+    }
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    extractBricks(dirty);
+}
+
+void BrickedIsosurface::invalidate(uint32_t minX, uint32_t minY, uint32_t minZ, uint32_t maxX, uint32_t maxY, uint32_t maxZ) {
+    if (bricks.empty()) {
+        return;
+    }
+    // Vertex normals use central differences, so cells up to two samples below and one above an edited sample can change.
+    const uint32_t minimum[3] = { minX, minY, minZ };
+    const uint32_t maximum[3] = { maxX, maxY, maxZ };
+    const uint32_t cells[3] = { grid.width - 1, grid.height - 1, grid.depth - 1 };
+    uint32_t firstBrick[3], lastBrick[3];
+    for (int axis = 0; axis != 3; ++axis) {
+        const uint32_t firstCell = minimum[axis] > 2 ? minimum[axis] - 2 : 0;
+        const uint32_t lastCell = std::min(maximum[axis] + 1, cells[axis] - 1);
+        firstBrick[axis] = std::min(firstCell / brickSize, brickDimensions[axis] - 1);
+        lastBrick[axis] = std::min(lastCell / brickSize, brickDimensions[axis] - 1);
+    }
+    std::vector<size_t> dirty;
+    for (uint32_t bz = firstBrick[2]; bz <= lastBrick[2]; ++bz) {
+        for (uint32_t by = firstBrick[1]; by <= lastBrick[1]; ++by) {
+            for (uint32_t bx = firstBrick[0]; bx <= lastBrick[0]; ++bx) {
+                dirty.push_back(brickIndex(bx, by, bz));
+            }
+        }
+    }
+    for (auto index : dirty) {
+        updateRange(index);
+    }
+    rebuildHierarchy();
+    extractBricks(dirty);
+}
+
+const IndexedMesh &BrickedIsosurface::mesh() {
+    if (!needsAssembly) {
+        return assembledMesh;
+    }
+    std::vector<size_t> vertexBases(bricks.size() + 1, 0);
+    std::vector<size_t> indexBases(bricks.size() + 1, 0);
+    for (size_t index = 0; index != bricks.size(); ++index) {
+        vertexBases[index + 1] = vertexBases[index] + bricks[index].vertices.size();
+        indexBases[index + 1] = indexBases[index] + bricks[index].indices.size();
+    }
+    assembledMesh.vertices.resize(vertexBases.back());
+    assembledMesh.indices.resize(indexBases.back());
+    parallel::parallelFor(bricks.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const auto &brick = bricks[index];
+            std::copy(brick.vertices.begin(), brick.vertices.end(), assembledMesh.vertices.begin() + vertexBases[index]);
+            auto output = assembledMesh.indices.begin() + indexBases[index];
+            for (auto id : brick.indices) {
+                if (!(id & foreignVertex)) {
+                    *output++ = uint32_t(vertexBases[index] + id);
+                    continue;
+                }
+                // Resolve the edge through the brick that owns its lattice point.
+                const uint64_t key = brick.foreignKeys[id & ~foreignVertex];
+                const uint64_t point = key / 3;
+                const auto x = uint32_t(point % grid.width);
+                const auto y = uint32_t(point / grid.width % grid.height);
+                const auto z = uint32_t(point / (uint64_t(grid.width) * grid.height));
+                const size_t owner = brickIndex(std::min(x / brickSize, brickDimensions[0] - 1), std::min(y / brickSize, brickDimensions[1] - 1), std::min(z / brickSize, brickDimensions[2] - 1));
+                const auto &keys = bricks[owner].edgeKeys;
+                const auto found = std::lower_bound(keys.begin(), keys.end(), key);
+                assert(found != keys.end() && *found == key);
+                *output++ = uint32_t(vertexBases[owner] + (found - keys.begin()));
+            }
+        }
+    });
+    needsAssembly = false;
+    return assembledMesh;
+}
+
+size_t BrickedIsosurface::activeBrickCount() const {
+    return size_t(std::count_if(bricks.begin(), bricks.end(), [](const Brick &brick) { return brick.active; }));
+}
+
+void BrickedIsosurface::updateRange(size_t index) {
+    const auto bx = uint32_t(index % brickDimensions[0]);
+    const auto by = uint32_t(index / brickDimensions[0] % brickDimensions[1]);
+    const auto bz = uint32_t(index / (size_t(brickDimensions[0]) * brickDimensions[1]));
+    // The corners of a brick's cells span one sample more than its cells.
+    const uint32_t x0 = bx * brickSize, x1 = std::min(x0 + brickSize, grid.width - 1);
+    const uint32_t y0 = by * brickSize, y1 = std::min(y0 + brickSize, grid.height - 1);
+    const uint32_t z0 = bz * brickSize, z1 = std::min(z0 + brickSize, grid.depth - 1);
+    float minValue = grid.value(x0, y0, z0);
+    float maxValue = minValue;
+    for (uint32_t z = z0; z <= z1; ++z) {
+        for (uint32_t y = y0; y <= y1; ++y) {
+            const float *row = grid.values + (size_t(z) * grid.height + y) * grid.width;
+            for (uint32_t x = x0; x <= x1; ++x) {
+                minValue = std::min(minValue, row[x]);
+                maxValue = std::max(maxValue, row[x]);
+            }
+        }
+    }
+    bricks[index].minValue = minValue;
+    bricks[index].maxValue = maxValue;
+}
+
+void BrickedIsosurface::rebuildHierarchy() {
+    hierarchy.clear();
+    hierarchyDimensions.clear();
+    if (bricks.empty()) {
+        return;
+    }
+    std::vector<Range> level(bricks.size());
+    for (size_t index = 0; index != bricks.size(); ++index) {
+        level[index] = { bricks[index].minValue, bricks[index].maxValue };
+    }
+    uint32_t dimensions[3] = { brickDimensions[0], brickDimensions[1], brickDimensions[2] };
+    hierarchy.push_back(std::move(level));
+    hierarchyDimensions.insert(hierarchyDimensions.end(), dimensions, dimensions + 3);
+    while (dimensions[0] > 1 || dimensions[1] > 1 || dimensions[2] > 1) {
+        const uint32_t parentDimensions[3] = { (dimensions[0] + 1) / 2, (dimensions[1] + 1) / 2, (dimensions[2] + 1) / 2 };
+        const auto &children = hierarchy.back();
+        std::vector<Range> parents(size_t(parentDimensions[0]) * parentDimensions[1] * parentDimensions[2], { INFINITY, -INFINITY });
+        for (uint32_t z = 0; z != dimensions[2]; ++z) {
+            for (uint32_t y = 0; y != dimensions[1]; ++y) {
+                for (uint32_t x = 0; x != dimensions[0]; ++x) {
+                    const auto &child = children[(size_t(z) * dimensions[1] + y) * dimensions[0] + x];
+                    auto &parent = parents[(size_t(z / 2) * parentDimensions[1] + y / 2) * parentDimensions[0] + x / 2];
+                    parent.minValue = std::min(parent.minValue, child.minValue);
+                    parent.maxValue = std::max(parent.maxValue, child.maxValue);
+                }
+            }
+        }
+        std::copy(parentDimensions, parentDimensions + 3, dimensions);
+        hierarchy.push_back(std::move(parents));
+        hierarchyDimensions.insert(hierarchyDimensions.end(), dimensions, dimensions + 3);
+    }
+}
+
+void BrickedIsosurface::collectStraddlingBricks(size_t level, uint32_t x, uint32_t y, uint32_t z, std::vector<size_t> &result) const {
+    const uint32_t *dimensions = &hierarchyDimensions[level * 3];
+    const auto &range = hierarchy[level][(size_t(z) * dimensions[1] + y) * dimensions[0] + x];
+    if (!(range.minValue < currentIsolevel && range.maxValue >= currentIsolevel)) {
+        return;
+    }
+    if (level == 0) {
+        result.push_back(brickIndex(x, y, z));
+        return;
+    }
+    const uint32_t *childDimensions = &hierarchyDimensions[(level - 1) * 3];
+    for (uint32_t cz = z * 2; cz != std::min(z * 2 + 2, childDimensions[2]); ++cz) {
+        for (uint32_t cy = y * 2; cy != std::min(y * 2 + 2, childDimensions[1]); ++cy) {
+            for (uint32_t cx = x * 2; cx != std::min(x * 2 + 2, childDimensions[0]); ++cx) {
+                collectStraddlingBricks(level - 1, cx, cy, cz, result);
+            }
+        }
+    }
+}
+
+void BrickedIsosurface::extractBricks(const std::vector<size_t> &indices) {
+    const trace::Zone zone("marchingCubes.extractBricks");
+    trace::count("marchingCubes.bricksExtracted", int64_t(indices.size()));
+    parallel::parallelFor(indices.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            extractBrick(indices[index]);
+        }
+    });
+    needsAssembly = true;
+}
+
+// A brick owns the edges of the lattice points in [first cell, last cell] (the last brick along an axis also owns the final sample) and emits the triangles of its own cells. Edges on its upper faces belong to the neighbouring bricks and are recorded by key.
+void BrickedIsosurface::extractBrick(size_t index) {
+    auto &brick = bricks[index];
+    brick.vertices.clear();
+    brick.edgeKeys.clear();
+    brick.indices.clear();
+    brick.foreignKeys.clear();
+    brick.active = brick.minValue < currentIsolevel && brick.maxValue >= currentIsolevel;
+    if (!brick.active) {
+        return;
+    }
+    const float isolevel = currentIsolevel;
+    const uint32_t brickCoordinates[3] = {
+        uint32_t(index % brickDimensions[0]),
+        uint32_t(index / brickDimensions[0] % brickDimensions[1]),
+        uint32_t(index / (size_t(brickDimensions[0]) * brickDimensions[1])),
+    };
+    const uint32_t samples[3] = { grid.width, grid.height, grid.depth };
+    uint32_t first[3], endCell[3], endPoint[3], box[3];
+    for (int axis = 0; axis != 3; ++axis) {
+        first[axis] = brickCoordinates[axis] * brickSize;
+        endCell[axis] = std::min(first[axis] + brickSize, samples[axis] - 1);
+        endPoint[axis] = brickCoordinates[axis] + 1 == brickDimensions[axis] ? samples[axis] : endCell[axis];
+        box[axis] = endCell[axis] - first[axis] + 1;
+    }
+
+    thread_local std::vector<uint32_t> ids;
+    ids.resize(size_t(box[0]) * box[1] * box[2] * 3);
+    auto localIndex = [&](uint32_t x, uint32_t y, uint32_t z, Axis axis) {
+        return ((size_t(z - first[2]) * box[1] + (y - first[1])) * box[0] + (x - first[0])) * 3 + axis;
+    };
+
+    for (uint32_t z = first[2]; z != endPoint[2]; ++z) {
+        for (uint32_t y = first[1]; y != endPoint[1]; ++y) {
+            for (uint32_t x = first[0]; x != endPoint[0]; ++x) {
+                const bool inside = grid.value(x, y, z) < isolevel;
+                const bool crossings[3] = {
+                    x + 1 < grid.width && inside != (grid.value(x + 1, y, z) < isolevel),
+                    y + 1 < grid.height && inside != (grid.value(x, y + 1, z) < isolevel),
+                    z + 1 < grid.depth && inside != (grid.value(x, y, z + 1) < isolevel),
+                };
+                for (auto axis : { AxisX, AxisY, AxisZ }) {
+                    if (crossings[axis]) {
+                        ids[localIndex(x, y, z, axis)] = uint32_t(brick.vertices.size());
+                        brick.vertices.push_back(makeVertex(grid, isolevel, x, y, z, axis));
+                        brick.edgeKeys.push_back(edgeKey(grid, x, y, z, axis));
+                    }
+                }
+            }
+        }
+    }
+
+    for (uint32_t z = first[2]; z != endCell[2]; ++z) {
+        for (uint32_t y = first[1]; y != endCell[1]; ++y) {
+            for (uint32_t x = first[0]; x != endCell[0]; ++x) {
+                int cubeindex = 0;
+                for (int corner = 0; corner != 8; ++corner) {
+                    if (grid.value(x + cornerOffsets[corner][0], y + cornerOffsets[corner][1], z + cornerOffsets[corner][2]) < isolevel) {
+                        cubeindex |= 1 << corner;
+                    }
+                }
+                if (edgeTable[cubeindex] == 0) {
+                    continue;
+                }
+                for (int i = 0; triTable[cubeindex][i] != -1; ++i) {
+                    const auto edge = latticeEdges[triTable[cubeindex][i]];
+                    const auto offset = cornerOffsets[edge.corner];
+                    const uint32_t px = x + offset[0], py = y + offset[1], pz = z + offset[2];
+                    if (px < endPoint[0] && py < endPoint[1] && pz < endPoint[2]) {
+                        brick.indices.push_back(ids[localIndex(px, py, pz, edge.axis)]);
+                    }
+                    else {
+                        brick.indices.push_back(foreignVertex | uint32_t(brick.foreignKeys.size()));
+                        brick.foreignKeys.push_back(edgeKey(grid, px, py, pz, edge.axis));
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,378 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace meshCodec {
+
+namespace {
+
+// "RKMC", the stream kind, the format version and two reserved bytes, then the count and stride.
+constexpr uint8_t magic[4] = { 'R', 'K', 'M', 'C' };
+constexpr uint8_t formatVersion = 1;
+constexpr size_t headerSize = 16;
+
+// Items per chunk. Every chunk starts its deltas afresh, which costs a few bytes, so that chunks decode in parallel.
+constexpr size_t indexChunkSize = 16384;
+constexpr size_t vertexChunkSize = 1024;
+
+// Vertex deltas per bit packed group, and the bytes a group takes at each of the four widths.
+constexpr size_t groupSize = 16;
+constexpr size_t groupBytes[4] = { 0, 4, 8, 16 };
+
+// MARK: Bytes
+
+void append32(std::vector<uint8_t> &output, uint32_t value) {
+    for (int shift = 0; shift != 32; shift += 8) {
+        output.push_back(uint8_t(value >> shift));
+    }
+}
+
+uint32_t load32(const uint8_t *bytes) {
+    return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+void appendVarint(std::vector<uint8_t> &output, uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    output.push_back(uint8_t(value));
+}
+
+[[gnu::always_inline]] inline bool readVarint(const uint8_t *&bytes, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (bytes == end) {
+            return false;
+        }
+        const uint8_t byte = *bytes++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// MARK: Streams
+
+size_t chunkSize(Stream stream) {
+    return stream == Stream::indices ? indexChunkSize : vertexChunkSize;
+}
+
+size_t chunkCount(Stream stream, size_t count) {
+    return (count + chunkSize(stream) - 1) / chunkSize(stream);
+}
+
+// The header, then a table of where each chunk starts followed by where the last one ends, as offsets from the start of the stream, then the chunks. `encode(chunk, output)` encodes one chunk; chunks are encoded in parallel.
+template <typename Encode> std::vector<uint8_t> encodeStream(Stream stream, size_t count, size_t stride, const Encode &encode) {
+    std::vector<uint8_t> output(magic, magic + 4);
+    output.push_back(uint8_t(stream));
+    output.push_back(formatVersion);
+    output.push_back(0);
+    output.push_back(0);
+    append32(output, uint32_t(count));
+    append32(output, uint32_t(stride));
+
+    const size_t chunks = chunkCount(stream, count);
+    std::vector<std::vector<uint8_t>> encoded(chunks);
+    parallel::parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk != end; ++chunk) {
+            encode(chunk, encoded[chunk]);
+        }
+    });
+    size_t offset = headerSize + (chunks + 1) * 4;
+    for (const auto &chunk : encoded) {
+        append32(output, uint32_t(offset));
+        offset += chunk.size();
+    }
+    append32(output, uint32_t(offset));
+    output.reserve(offset);
+    for (const auto &chunk : encoded) {
+        output.insert(output.end(), chunk.begin(), chunk.end());
+    }
+    return output;
+}
+
+// Checks `data` is a `stream` of `count` items of `stride` bytes whose chunk table stays within it and runs forwards, and decodes its chunks in parallel with `decode(chunk, bytes, end)`.
+template <typename Decode> bool decodeStream(const uint8_t *data, size_t size, Stream stream, size_t count, size_t stride, size_t grain, const Decode &decode) {
+    const auto header = readHeader(data, size);
+    if (!header || header->stream != stream || header->count != count || header->stride != stride) {
+        return false;
+    }
+    const size_t chunks = chunkCount(stream, count);
+    const size_t dataStart = headerSize + (chunks + 1) * 4;
+    if (size < dataStart) {
+        return false;
+    }
+    const uint8_t *table = data + headerSize;
+    size_t previous = dataStart;
+    for (size_t chunk = 0; chunk <= chunks; ++chunk) {
+        const size_t offset = load32(table + chunk * 4);
+        if (offset < previous || offset > size) {
+            return false;
+        }
+        previous = offset;
+    }
+    std::atomic<bool> valid = true;
+    parallel::parallelFor(chunks, grain, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk != end; ++chunk) {
+            if (!decode(chunk, data + load32(table + chunk * 4), data + load32(table + (chunk + 1) * 4))) {
+                valid.store(false, std::memory_order_relaxed);
+            }
+        }
+    });
+    return valid.load();
+}
+
+// MARK: Indices
+
+// A chunk is the next unused vertex at its start, then a code per index: 0 for that next vertex, otherwise 1 + the zigzagged distance from the index to the vertex before it (negative for indices past it).
+template <typename Index> void encodeIndexChunk(const Index *indices, size_t count, uint64_t next, std::vector<uint8_t> &output) {
+    output.reserve(count * 2);
+    appendVarint(output, next);
+    for (size_t position = 0; position != count; ++position) {
+        const uint64_t index = indices[position];
+        if (index == next) {
+            output.push_back(0);
+            ++next;
+            continue;
+        }
+        const int64_t distance = int64_t(next) - 1 - int64_t(index);
+        appendVarint(output, ((uint64_t(distance) << 1) ^ uint64_t(distance >> 63)) + 1);
+        next = std::max(next, index + 1);
+    }
+}
+
+template <typename Index> std::vector<uint8_t> encodeIndexStream(const Index *indices, size_t count) {
+    const trace::Zone zone("meshCodec.encodeIndices");
+    // The next unused vertex at the start of each chunk.
+    std::vector<uint64_t> nexts(chunkCount(Stream::indices, count));
+    uint64_t next = 0;
+    for (size_t position = 0; position != count; ++position) {
+        if (position % indexChunkSize == 0) {
+            nexts[position / indexChunkSize] = next;
+        }
+        next = std::max(next, uint64_t(indices[position]) + 1);
+    }
+    return encodeStream(Stream::indices, count, 4, [&](size_t chunk, std::vector<uint8_t> &output) {
+        const size_t first = chunk * indexChunkSize;
+        encodeIndexChunk(indices + first, std::min(indexChunkSize, count - first), nexts[chunk], output);
+    });
+}
+
+template <typename Index> bool decodeIndexChunk(const uint8_t *bytes, const uint8_t *end, Index *indices, size_t count) {
+    constexpr uint64_t largest = Index(~Index(0));
+    uint64_t next;
+    if (!readVarint(bytes, end, next) || next > largest + 1) {
+        return false;
+    }
+    for (size_t position = 0; position != count; ++position) {
+        if (bytes == end) {
+            return false;
+        }
+        uint64_t index;
+        if (*bytes == 0) {
+            ++bytes;
+            index = next;
+        }
+        else {
+            uint64_t code;
+            if (*bytes < 0x80) {
+                code = *bytes++;
+            }
+            else if (!readVarint(bytes, end, code)) {
+                return false;
+            }
+            // Valid distances are within ±2^32.
+            const uint64_t zigzag = code - 1;
+            if (zigzag >> 34) {
+                return false;
+            }
+            const int64_t distance = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+            const int64_t value = int64_t(next) - 1 - distance;
+            if (value < 0 || uint64_t(value) > largest) {
+                return false;
+            }
+            index = uint64_t(value);
+        }
+        if (index > largest) {
+            return false;
+        }
+        indices[position] = Index(index);
+        next = std::max(next, index + 1);
+    }
+    return bytes == end;
+}
+
+template <typename Index> bool decodeIndexStream(const uint8_t *data, size_t size, Index *indices, size_t count) {
+    const trace::Zone zone("meshCodec.decodeIndices");
+    return decodeStream(data, size, Stream::indices, count, 4, 1, [&](size_t chunk, const uint8_t *bytes, const uint8_t *end) {
+        const size_t first = chunk * indexChunkSize;
+        return decodeIndexChunk(bytes, end, indices + first, std::min(indexChunkSize, count - first));
+    });
+}
+
+// MARK: Vertices
+
+[[gnu::always_inline]] inline uint8_t zigzag(uint8_t delta) {
+    return uint8_t((delta << 1) ^ uint8_t(int8_t(delta) >> 7));
+}
+
+// Eight zigzagged bytes at once.
+[[gnu::always_inline]] inline uint64_t unzigzag(uint64_t values) {
+    return ((values >> 1) & 0x7f7f7f7f7f7f7f7f) ^ ((values & 0x0101010101010101) * 0xff);
+}
+
+// A chunk is a column per byte of the vertex: two bits per group of 16 vertices giving the group's width (0, 2, 4 or 8 bits), then the groups' zigzagged deltas at those widths. At 2 and 4 bits, delta i of a group goes in byte i % 4 or i % 8 of it, at bit 2 * (i / 4) or 4 * (i / 8), so that a group unpacks with a few shifts and masks of whole words. The last group is padded with zero deltas.
+void encodeVertexChunk(const uint8_t *vertices, size_t count, size_t stride, std::vector<uint8_t> &output) {
+    const size_t groups = (count + groupSize - 1) / groupSize;
+    uint8_t deltas[vertexChunkSize] = {};
+    for (size_t byte = 0; byte != stride; ++byte) {
+        uint8_t previous = 0;
+        for (size_t vertex = 0; vertex != count; ++vertex) {
+            const uint8_t value = vertices[vertex * stride + byte];
+            deltas[vertex] = zigzag(uint8_t(value - previous));
+            previous = value;
+        }
+        const size_t widths = output.size();
+        output.resize(widths + (groups + 3) / 4);
+        for (size_t group = 0; group != groups; ++group) {
+            const uint8_t *values = deltas + group * groupSize;
+            uint8_t bits = 0;
+            for (size_t index = 0; index != groupSize; ++index) {
+                bits |= values[index];
+            }
+            const unsigned mode = bits == 0 ? 0 : bits < 4 ? 1 : bits < 16 ? 2 : 3;
+            output[widths + group / 4] |= uint8_t(mode << (group % 4 * 2));
+            switch (mode) {
+            case 1:
+                for (size_t index = 0; index != 4; ++index) {
+                    output.push_back(uint8_t(values[index] | values[index + 4] << 2 | values[index + 8] << 4 | values[index + 12] << 6));
+                }
+                break;
+            case 2:
+                for (size_t index = 0; index != 8; ++index) {
+                    output.push_back(uint8_t(values[index] | values[index + 8] << 4));
+                }
+                break;
+            case 3:
+                output.insert(output.end(), values, values + groupSize);
+                break;
+            }
+        }
+    }
+}
+
+bool decodeVertexChunk(const uint8_t *bytes, const uint8_t *end, uint8_t *vertices, size_t count, size_t stride) {
+    const size_t groups = (count + groupSize - 1) / groupSize;
+    const size_t widthBytes = (groups + 3) / 4;
+    uint64_t deltaWords[vertexChunkSize / 8];
+    auto *deltas = reinterpret_cast<uint8_t *>(deltaWords);
+    for (size_t byte = 0; byte != stride; ++byte) {
+        if (size_t(end - bytes) < widthBytes) {
+            return false;
+        }
+        const uint8_t *widths = bytes;
+        bytes += widthBytes;
+        size_t dataBytes = 0;
+        for (size_t group = 0; group != groups; ++group) {
+            dataBytes += groupBytes[(widths[group / 4] >> (group % 4 * 2)) & 3];
+        }
+        if (size_t(end - bytes) < dataBytes) {
+            return false;
+        }
+        // The streams are little endian, as are the hosts.
+        for (size_t group = 0; group != groups; ++group) {
+            uint64_t *values = deltaWords + group * 2;
+            switch ((widths[group / 4] >> (group % 4 * 2)) & 3) {
+            case 0:
+                values[0] = values[1] = 0;
+                break;
+            case 1: {
+                uint32_t packed;
+                std::memcpy(&packed, bytes, 4);
+                bytes += 4;
+                const uint64_t low = packed | uint64_t(packed >> 2) << 32, high = uint64_t(packed >> 4) | uint64_t(packed >> 6) << 32;
+                values[0] = unzigzag(low & 0x0303030303030303);
+                values[1] = unzigzag(high & 0x0303030303030303);
+                break;
+            }
+            case 2: {
+                uint64_t packed;
+                std::memcpy(&packed, bytes, 8);
+                bytes += 8;
+                values[0] = unzigzag(packed & 0x0f0f0f0f0f0f0f0f);
+                values[1] = unzigzag((packed >> 4) & 0x0f0f0f0f0f0f0f0f);
+                break;
+            }
+            case 3:
+                std::memcpy(values, bytes, 16);
+                bytes += 16;
+                values[0] = unzigzag(values[0]);
+                values[1] = unzigzag(values[1]);
+                break;
+            }
+        }
+        uint8_t previous = 0;
+        for (size_t vertex = 0; vertex != count; ++vertex) {
+            previous += deltas[vertex];
+            vertices[vertex * stride + byte] = previous;
+        }
+    }
+    return bytes == end;
+}
+
+}
+
+std::optional<Header> readHeader(const uint8_t *data, size_t size) {
+    if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0 || data[4] > uint8_t(Stream::vertices) || data[5] != formatVersion) {
+        return std::nullopt;
+    }
+    return Header {
+        .stream = Stream(data[4]),
+        .count = load32(data + 8),
+        .stride = load32(data + 12),
+    };
+}
+
+std::vector<uint8_t> encodeIndices(const uint32_t *indices, size_t count) {
+    return encodeIndexStream(indices, count);
+}
+
+std::vector<uint8_t> encodeIndices(const uint16_t *indices, size_t count) {
+    return encodeIndexStream(indices, count);
+}
+
+bool decodeIndices(const uint8_t *data, size_t size, uint32_t *indices, size_t count) {
+    return decodeIndexStream(data, size, indices, count);
+}
+
+bool decodeIndices(const uint8_t *data, size_t size, uint16_t *indices, size_t count) {
+    return decodeIndexStream(data, size, indices, count);
+}
+
+std::vector<uint8_t> encodeVertices(const void *vertices, size_t count, size_t stride) {
+    const trace::Zone zone("meshCodec.encodeVertices");
+    const auto *bytes = static_cast<const uint8_t *>(vertices);
+    return encodeStream(Stream::vertices, count, stride, [&](size_t chunk, std::vector<uint8_t> &output) {
+        const size_t first = chunk * vertexChunkSize;
+        encodeVertexChunk(bytes + first * stride, std::min(vertexChunkSize, count - first), stride, output);
+    });
+}
+
+bool decodeVertices(const uint8_t *data, size_t size, void *vertices, size_t count, size_t stride) {
+    const trace::Zone zone("meshCodec.decodeVertices");
+    auto *bytes = static_cast<uint8_t *>(vertices);
+    return decodeStream(data, size, Stream::vertices, count, stride, 4, [&](size_t chunk, const uint8_t *chunkBytes, const uint8_t *end) {
+        const size_t first = chunk * vertexChunkSize;
+        return decodeVertexChunk(chunkBytes, end, bytes + first * stride, std::min(vertexChunkSize, count - first), stride);
+    });
+}
+
+}
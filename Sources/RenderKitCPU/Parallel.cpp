@@ -0,0 +1,152 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+namespace {
+
+thread_local bool insideParallelFor = false;
+
+class Pool {
+public:
+    explicit Pool(unsigned count) {
+        for (unsigned index = 1; index < count; ++index) {
+            threads.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    unsigned size() const {
+        return unsigned(threads.size()) + 1;
+    }
+
+    void run(size_t chunkCount, const std::function<void(size_t)> &chunk) {
+        std::lock_guard<std::mutex> submit(submitMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &chunk;
+            jobChunkCount = chunkCount;
+            nextChunk = 0;
+            pending = threads.size();
+            ++generation;
+        }
+        wake.notify_all();
+        drain(chunk, chunkCount);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        job = nullptr;
+    }
+
+private:
+    void drain(const std::function<void(size_t)> &chunk, size_t chunkCount) {
+        insideParallelFor = true;
+        for (size_t index = nextChunk.fetch_add(1); index < chunkCount; index = nextChunk.fetch_add(1)) {
+            chunk(index);
+        }
+        insideParallelFor = false;
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            const std::function<void(size_t)> *chunk;
+            size_t chunkCount;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                chunk = job;
+                chunkCount = jobChunkCount;
+            }
+            drain(*chunk, chunkCount);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobChunkCount = 0;
+    std::atomic<size_t> nextChunk = 0;
+    size_t pending = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+std::mutex poolMutex;
+std::unique_ptr<Pool> sharedPool;
+
+unsigned defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+Pool &pool() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!sharedPool) {
+        sharedPool = std::make_unique<Pool>(defaultThreadCount());
+    }
+    return *sharedPool;
+}
+
+}
+
+unsigned threadCount() {
+    return pool().size();
+}
+
+void setThreadCount(unsigned count) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    sharedPool.reset();
+    sharedPool = std::make_unique<Pool>(count == 0 ? defaultThreadCount() : count);
+}
+
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunkCount = (count + grain - 1) / grain;
+    if (chunkCount == 1 || insideParallelFor) {
+        body(0, count);
+        return;
+    }
+    auto &workers = pool();
+    if (workers.size() == 1) {
+        body(0, count);
+        return;
+    }
+    workers.run(chunkCount, [&](size_t chunk) {
+        const size_t begin = chunk * grain;
+        body(begin, std::min(begin + grain, count));
+    });
+}
+
+}
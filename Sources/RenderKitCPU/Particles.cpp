@@ -0,0 +1,232 @@
+#include "Particles.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Parallel.h"
+#include "Random.h"
+#include "Trace.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi" // The 32 byte vectors below never cross a translation unit boundary.
+#endif
+
+namespace particles {
+
+namespace {
+
+typedef float Float8 __attribute__((vector_size(32)));
+typedef int32_t Int8 __attribute__((vector_size(32)));
+
+// Particles per parallel chunk.
+constexpr size_t blockSize = 1 << 14;
+
+[[gnu::always_inline]] inline Float8 select(Int8 mask, Float8 a, Float8 b) {
+    return (Float8)(((Int8)a & mask) | ((Int8)b & ~mask));
+}
+
+[[gnu::always_inline]] inline Float8 load(const float *source) {
+    Float8 value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+[[gnu::always_inline]] inline void store(float *destination, Float8 value) {
+    std::memcpy(destination, &value, sizeof(value));
+}
+
+struct Arrays {
+    float *positions[3];
+    float *oldPositions[3];
+    float *accelerations[3];
+    float *ages;
+    const float *lifetimes;
+    int32_t *alive;
+};
+
+// `particleUpdate` minus the respawn, for the eight particles at `index`: dead lanes are left untouched. Returns the lanes that died this step.
+[[gnu::always_inline]] inline unsigned stepLanes(const Arrays &arrays, const Environment &environment, size_t index) {
+    Int8 alive;
+    std::memcpy(&alive, arrays.alive + index, sizeof(alive));
+    if ((alive[0] | alive[1] | alive[2] | alive[3] | alive[4] | alive[5] | alive[6] | alive[7]) == 0) {
+        return 0;
+    }
+    const float timestep = environment.timestep;
+    const float dragScale = 0.5f * environment.drag;
+    Float8 positions[3];
+    for (int axis = 0; axis != 3; ++axis) {
+        const Float8 position = load(arrays.positions[axis] + index);
+        const Float8 oldPosition = load(arrays.oldPositions[axis] + index);
+        const Float8 acceleration = load(arrays.accelerations[axis] + index);
+        // particle.position += particle.position - particle.oldPosition + particle.acceleration * timestep * timestep
+        const Float8 next = position + ((position - oldPosition) + acceleration * timestep * timestep);
+        // apply_forces(particle.position - particle.oldPosition, drag, mass)
+        const Float8 velocity = next - position;
+        const Float8 speed = (Float8)((Int8)velocity & 0x7fffffff);
+        const Float8 dragForce = dragScale * (velocity * speed);
+        const Float8 force = environment.gravity[axis] - dragForce / environment.mass;
+        store(arrays.positions[axis] + index, select(alive, next, position));
+        store(arrays.oldPositions[axis] + index, select(alive, position, oldPosition));
+        store(arrays.accelerations[axis] + index, select(alive, force, acceleration));
+        positions[axis] = select(alive, next, position);
+    }
+    const Float8 age = load(arrays.ages + index);
+    const Float8 nextAge = select(alive, age + timestep, age);
+    store(arrays.ages + index, nextAge);
+
+    // The kernel's death test, as it will run at the start of the next dispatch.
+    const Int8 dead = alive & ((nextAge >= load(arrays.lifetimes + index)) | (positions[1] < 0.0f));
+    unsigned mask = 0;
+    for (int lane = 0; lane != 8; ++lane) {
+        mask |= unsigned(dead[lane] & 1) << lane;
+    }
+    if (mask) {
+        alive &= ~dead;
+        std::memcpy(arrays.alive + index, &alive, sizeof(alive));
+    }
+    return mask;
+}
+
+[[gnu::always_inline]] inline void stepBlock(const Arrays &arrays, const Environment &environment, size_t begin, size_t end, std::vector<uint32_t> &died) {
+    for (size_t index = begin; index != end; index += 8) {
+        for (unsigned mask = stepLanes(arrays, environment, index); mask != 0; mask &= mask - 1) {
+            died.push_back(uint32_t(index + __builtin_ctz(mask)));
+        }
+    }
+}
+
+void stepBlockGeneric(const Arrays &arrays, const Environment &environment, size_t begin, size_t end, std::vector<uint32_t> &died) {
+    stepBlock(arrays, environment, begin, end, died);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void stepBlockAVX2(const Arrays &arrays, const Environment &environment, size_t begin, size_t end, std::vector<uint32_t> &died) {
+    stepBlock(arrays, environment, begin, end, died);
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+}
+
+System::System(size_t capacity) : count(capacity), paddedCount((capacity + 7) & ~size_t(7)) {
+    for (int axis = 0; axis != 3; ++axis) {
+        positions[axis].assign(paddedCount, 0);
+        oldPositions[axis].assign(paddedCount, 0);
+        accelerations[axis].assign(paddedCount, 0);
+    }
+    ages.assign(paddedCount, 0);
+    lifetimes.assign(paddedCount, 0);
+    alive.assign(paddedCount, 0);
+    // Reversed, so emitting takes the low indices first.
+    freeList.resize(count);
+    for (size_t index = 0; index != count; ++index) {
+        freeList[index] = uint32_t(count - 1 - index);
+    }
+}
+
+size_t System::emit(size_t requested, const Emitter &emitter) {
+    const trace::Zone zone("particles.emit");
+    const size_t emitted = std::min(requested, freeList.size());
+    const uint32_t *slots = freeList.data() + freeList.size() - emitted;
+    const uint32_t spawnSeed = emitter.seed ^ hashRandom::pcg(uint32_t(steps) ^ hashRandom::pcg(uint32_t(steps >> 32)));
+    parallel::parallelFor(emitted, blockSize, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const uint32_t slot = slots[index];
+            // rand1dTo3d(gid), but hashed from the integer index so every slot in a large system gets its own value.
+            const hashRandom::uint3 random = hashRandom::pcg3d(slot, spawnSeed, 0x9E3779B9u);
+            const float randomLanes[3] = { hashRandom::unitFloat(random.x), hashRandom::unitFloat(random.y), hashRandom::unitFloat(random.z) };
+            for (int axis = 0; axis != 3; ++axis) {
+                positions[axis][slot] = emitter.origin[axis];
+                oldPositions[axis][slot] = emitter.origin[axis];
+                accelerations[axis][slot] = (randomLanes[axis] + emitter.accelerationOffset[axis]) * emitter.accelerationScale[axis];
+            }
+            ages[slot] = 0;
+            lifetimes[slot] = emitter.lifetime;
+            alive[slot] = -1;
+        }
+    });
+    freeList.resize(freeList.size() - emitted);
+    return emitted;
+}
+
+void System::step(const Environment &environment) {
+    const trace::Zone zone("particles.step");
+    trace::count("particles.stepped", int64_t(liveCount()));
+    const Arrays arrays = {
+        .positions = { positions[0].data(), positions[1].data(), positions[2].data() },
+        .oldPositions = { oldPositions[0].data(), oldPositions[1].data(), oldPositions[2].data() },
+        .accelerations = { accelerations[0].data(), accelerations[1].data(), accelerations[2].data() },
+        .ages = ages.data(),
+        .lifetimes = lifetimes.data(),
+        .alive = alive.data(),
+    };
+    const size_t blockCount = (paddedCount + blockSize - 1) / blockSize;
+    std::vector<std::vector<uint32_t>> died(blockCount);
+    parallel::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block != end; ++block) {
+            const size_t first = block * blockSize, last = std::min(paddedCount, first + blockSize);
+#if defined(__x86_64__)
+            if (hasAVX2) {
+                stepBlockAVX2(arrays, environment, first, last, died[block]);
+                continue;
+            }
+#endif
+            stepBlockGeneric(arrays, environment, first, last, died[block]);
+        }
+    });
+    for (const auto &block : died) {
+        freeList.insert(freeList.end(), block.begin(), block.end());
+    }
+    ++steps;
+}
+
+void System::step(const Environment &environment, const Emitter &respawn) {
+    trace::count("particles.respawned", int64_t(emit(freeList.size(), respawn)));
+    step(environment);
+}
+
+Particle System::particle(size_t index) const {
+    Particle particle = {};
+    for (int axis = 0; axis != 3; ++axis) {
+        particle.position[axis] = positions[axis][index];
+        particle.oldPosition[axis] = oldPositions[axis][index];
+        particle.acceleration[axis] = accelerations[axis][index];
+    }
+    particle.age = ages[index];
+    particle.lifetime = lifetimes[index];
+    return particle;
+}
+
+void System::exportParticles(Particle *output) const {
+    parallel::parallelFor(count, blockSize, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            output[index] = particle(index);
+        }
+    });
+}
+
+void System::importParticles(const Particle *input) {
+    parallel::parallelFor(count, blockSize, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const Particle &particle = input[index];
+            for (int axis = 0; axis != 3; ++axis) {
+                positions[axis][index] = particle.position[axis];
+                oldPositions[axis][index] = particle.oldPosition[axis];
+                accelerations[axis][index] = particle.acceleration[axis];
+            }
+            ages[index] = particle.age;
+            lifetimes[index] = particle.lifetime;
+            alive[index] = particle.age >= particle.lifetime || particle.position[1] < 0 ? 0 : -1;
+        }
+    });
+    freeList.clear();
+    for (size_t index = count; index-- != 0;) {
+        if (!alive[index]) {
+            freeList.push_back(uint32_t(index));
+        }
+    }
+}
+
+}
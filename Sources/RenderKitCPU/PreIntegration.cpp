@@ -0,0 +1,88 @@
+#include "PreIntegration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Half.h"
+#include "Parallel.h"
+
+namespace volume {
+
+PreIntegratedTable::PreIntegratedTable(const TransferFunction &transferFunction, const FragmentUniforms &uniforms, float segmentLength) : dimension(uint32_t(transferFunction.size())), length(std::max(segmentLength, 0.0f)) {
+    referenceSlices = std::max(float(uniforms.instanceCount), 1.0f);
+    sliceAlpha = std::max(uniforms.alpha, 0.0f) / referenceSlices;
+    entries.resize(size_t(dimension) * dimension * 4);
+    integrate(transferFunction, 0, dimension, 0, dimension);
+}
+
+void PreIntegratedTable::update(const TransferFunction &transferFunction, size_t first, size_t count) {
+    if (count == 0 || first >= dimension) {
+        return;
+    }
+    // Linear filtering reaches one texel either side of a value, so segments within a texel of the edit change too.
+    const uint32_t low = uint32_t(first > 0 ? first - 1 : 0);
+    const uint32_t high = uint32_t(std::min(first + count, size_t(dimension) - 1));
+    // Rows entirely inside the edit change completely; below it only segments reaching up to `low`, above it only those reaching down to `high`.
+    if (low > 0) {
+        integrate(transferFunction, 0, low, low, dimension);
+    }
+    integrate(transferFunction, low, high + 1, 0, dimension);
+    if (high + 1 < dimension) {
+        integrate(transferFunction, high + 1, dimension, 0, high + 1);
+    }
+}
+
+void PreIntegratedTable::integrate(const TransferFunction &transferFunction, uint32_t firstRow, uint32_t lastRow, uint32_t firstColumn, uint32_t lastColumn) {
+    parallel::parallelFor(lastRow - firstRow, 4, [&](size_t begin, size_t end) {
+        for (uint32_t back = firstRow + uint32_t(begin); back != firstRow + uint32_t(end); ++back) {
+            for (uint32_t front = firstColumn; front != lastColumn; ++front) {
+                // A sub-step per texel crossed, each at its midpoint.
+                const uint32_t steps = uint32_t(std::abs(int32_t(back) - int32_t(front))) + 1;
+                const float frontValue = (float(front) + 0.5f) / float(dimension), backValue = (float(back) + 0.5f) / float(dimension);
+                const float exponent = length / float(steps) * referenceSlices;
+                float color[4] = { 0, 0, 0, 0 };
+                for (uint32_t step = 0; step != steps && color[3] < 1; ++step) {
+                    float sample[4];
+                    transferFunction.sample(frontValue + (backValue - frontValue) * (float(step) + 0.5f) / float(steps), sample);
+                    const float opacity = std::min(sample[3] * sliceAlpha, 1.0f);
+                    if (opacity <= 0) {
+                        continue;
+                    }
+                    const float alpha = 1 - std::exp2(std::log2(1 - opacity) * exponent);
+                    const float weight = (1 - color[3]) * alpha;
+                    color[0] += weight * sample[0];
+                    color[1] += weight * sample[1];
+                    color[2] += weight * sample[2];
+                    color[3] += weight;
+                }
+                std::copy_n(color, 4, entries.data() + (size_t(back) * dimension + front) * 4);
+            }
+        }
+    });
+}
+
+void PreIntegratedTable::sample(float front, float back, float *rgba) const {
+    auto cell = [&](float value, uint32_t &index, float &fraction) {
+        const float coordinate = std::clamp(value * float(dimension) - 0.5f, 0.0f, float(dimension - 1));
+        index = std::min(uint32_t(coordinate), dimension > 1 ? dimension - 2 : 0);
+        fraction = coordinate - float(index);
+    };
+    uint32_t column, row;
+    float x, y;
+    cell(front, column, x);
+    cell(back, row, y);
+    const size_t stepX = dimension > 1 ? 4 : 0, stepY = dimension > 1 ? size_t(dimension) * 4 : 0;
+    const float *corner = entries.data() + (size_t(row) * dimension + column) * 4;
+    for (int channel = 0; channel != 4; ++channel) {
+        const float *values = corner + channel;
+        const float top = values[0] + (values[stepX] - values[0]) * x;
+        const float bottom = values[stepY] + (values[stepY + stepX] - values[stepY]) * x;
+        rgba[channel] = top + (bottom - top) * y;
+    }
+}
+
+void PreIntegratedTable::exportHalf(uint16_t *output) const {
+    std::transform(entries.begin(), entries.end(), output, half::fromFloat);
+}
+
+}
@@ -0,0 +1,460 @@
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace raster {
+
+namespace {
+
+// Vertex positions snap to 1/16 pixel; edge functions are then exact in 64 bit integers.
+constexpr int subpixelBits = 4;
+constexpr float subpixelScale = 1 << subpixelBits;
+constexpr int64_t halfPixel = 1 << (subpixelBits - 1);
+// Triangles are clipped to this many viewport widths either side, which bounds the fixed point coordinates.
+constexpr float guardBand = 4;
+// Pixels whose edge functions are evaluated together.
+constexpr int lanes = 8;
+// One edge function at eight pixels. GCC and Clang lower these to pairs of AVX registers inside `target("avx2")` functions, and to SSE2 (which has no 64 bit compare) elsewhere.
+typedef int64_t Int64x8 __attribute__((vector_size(lanes * sizeof(int64_t))));
+// Perspective correct varyings: the view space position for flat shading, the texture coordinate for unlit.
+constexpr int maximumVaryings = 3;
+constexpr size_t trianglesPerChunk = 1024;
+
+struct ClipVertex {
+    float position[4];
+    float varyings[maximumVaryings];
+};
+
+struct Triangle {
+    // E(x, y) = a x + b y + c at the centre of pixel (x, y); a pixel is covered where every E reaches its threshold (0 on top and left edges, 1 otherwise).
+    int64_t a[3];
+    int64_t b[3];
+    int64_t c[3];
+    int64_t threshold[3];
+    float inverseArea;
+    int32_t minX;
+    int32_t minY;
+    int32_t maxX;
+    int32_t maxY;
+    // Per vertex: depth, 1 / w and varyings / w.
+    float z[3];
+    float inverseW[3];
+    float varyings[3][maximumVaryings];
+    float flatNormal[3];
+    uint32_t instance;
+};
+
+// A run of triangles set up together, and the tiles each one overlaps; tiles rasterize chunks in order so draw order is kept.
+struct Chunk {
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;
+};
+
+void multiply(const float matrix[4][4], const float *vector, float *result) {
+    for (int row = 0; row != 4; ++row) {
+        result[row] = matrix[0][row] * vector[0] + matrix[1][row] * vector[1] + matrix[2][row] * vector[2] + matrix[3][row] * vector[3];
+    }
+}
+
+// Sutherland-Hodgman against one plane, given each vertex's signed distance to it.
+int clipPolygon(const ClipVertex *input, int count, ClipVertex *output, float (*distance)(const ClipVertex &)) {
+    int outputCount = 0;
+    for (int index = 0; index != count; ++index) {
+        const ClipVertex &current = input[index], &next = input[(index + 1) % count];
+        const float currentDistance = distance(current), nextDistance = distance(next);
+        if (currentDistance >= 0) {
+            output[outputCount++] = current;
+        }
+        if ((currentDistance >= 0) != (nextDistance >= 0)) {
+            const float t = currentDistance / (currentDistance - nextDistance);
+            ClipVertex &vertex = output[outputCount++];
+            for (int component = 0; component != 4; ++component) {
+                vertex.position[component] = current.position[component] + (next.position[component] - current.position[component]) * t;
+            }
+            for (int component = 0; component != maximumVaryings; ++component) {
+                vertex.varyings[component] = current.varyings[component] + (next.varyings[component] - current.varyings[component]) * t;
+            }
+        }
+    }
+    return outputCount;
+}
+
+// Metal's clip volume, 0 ≤ z ≤ w, with the guard band in x and y.
+float (*const clipPlanes[])(const ClipVertex &) = {
+    [](const ClipVertex &vertex) { return vertex.position[3] - 1e-6f; },
+    [](const ClipVertex &vertex) { return vertex.position[2]; },
+    [](const ClipVertex &vertex) { return vertex.position[3] - vertex.position[2]; },
+    [](const ClipVertex &vertex) { return guardBand * vertex.position[3] - vertex.position[0]; },
+    [](const ClipVertex &vertex) { return guardBand * vertex.position[3] + vertex.position[0]; },
+    [](const ClipVertex &vertex) { return guardBand * vertex.position[3] - vertex.position[1]; },
+    [](const ClipVertex &vertex) { return guardBand * vertex.position[3] + vertex.position[1]; },
+};
+
+void sampleTexture(const Texture &texture, float u, float v, float *rgba) {
+    const float x = std::clamp(u * float(texture.width) - 0.5f, 0.0f, float(texture.width - 1));
+    const float y = std::clamp(v * float(texture.height) - 0.5f, 0.0f, float(texture.height - 1));
+    const uint32_t x0 = uint32_t(x), y0 = uint32_t(y);
+    const uint32_t x1 = std::min(x0 + 1, texture.width - 1), y1 = std::min(y0 + 1, texture.height - 1);
+    const float fx = x - float(x0), fy = y - float(y0);
+    for (int channel = 0; channel != 4; ++channel) {
+        auto texel = [&](uint32_t column, uint32_t row) {
+            return float(texture.rgba8[(size_t(row) * texture.width + column) * 4 + channel]) / 255;
+        };
+        const float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fx;
+        const float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fx;
+        rgba[channel] = top + (bottom - top) * fy;
+    }
+}
+
+// What a tile needs to rasterize and shade its share of a draw.
+struct TileJob {
+    const Chunk *chunks;
+    size_t chunkCount;
+    bool flat;
+    uint32_t tile;
+    uint32_t tilesWide;
+    uint32_t targetWidth;
+    uint32_t targetHeight;
+    float *colorBuffer;
+    float *depthBuffer;
+    const LightUniforms *light;
+    const FlatMaterial *flatMaterials;
+    const UnlitMaterial *unlitMaterials;
+    const Texture *textures;
+    size_t textureCount;
+};
+
+// Rasterizes and shades every triangle binned to one tile, chunk by chunk in draw order. Returns the fragments that passed the depth test.
+[[gnu::always_inline]] inline uint64_t rasterizeTile(const TileJob &job, size_t tileIndex) {
+    const Int64x8 laneOffsets = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    const int32_t tileMinX = int32_t(tileIndex % job.tilesWide * job.tile), tileMinY = int32_t(tileIndex / job.tilesWide * job.tile);
+    const int32_t tileMaxX = std::min(tileMinX + int32_t(job.tile), int32_t(job.targetWidth)) - 1, tileMaxY = std::min(tileMinY + int32_t(job.tile), int32_t(job.targetHeight)) - 1;
+    uint64_t fragments = 0;
+    for (size_t chunkIndex = 0; chunkIndex != job.chunkCount; ++chunkIndex) {
+        const Chunk &chunk = job.chunks[chunkIndex];
+        for (const uint32_t triangleIndex : chunk.bins[tileIndex]) {
+            const Triangle &triangle = chunk.triangles[triangleIndex];
+            const int32_t minX = std::max(triangle.minX, tileMinX), maxX = std::min(triangle.maxX, tileMaxX);
+            const int32_t minY = std::max(triangle.minY, tileMinY), maxY = std::min(triangle.maxY, tileMaxY);
+            // Each edge function across the eight lanes, relative to the first.
+            Int64x8 laneSteps[3];
+            for (int edge = 0; edge != 3; ++edge) {
+                laneSteps[edge] = triangle.a[edge] * laneOffsets;
+            }
+            for (int32_t y = minY; y <= maxY; ++y) {
+                Int64x8 edges[3];
+                for (int edge = 0; edge != 3; ++edge) {
+                    edges[edge] = triangle.a[edge] * minX + triangle.b[edge] * y + triangle.c[edge] + laneSteps[edge];
+                }
+                for (int32_t x = minX; x <= maxX; x += lanes) {
+                    if (x != minX) {
+                        for (int edge = 0; edge != 3; ++edge) {
+                            edges[edge] += triangle.a[edge] * lanes;
+                        }
+                    }
+                    const Int64x8 covered = (edges[0] >= triangle.threshold[0]) & (edges[1] >= triangle.threshold[1]) & (edges[2] >= triangle.threshold[2]) & (laneOffsets + x <= maxX);
+                    bool any = false;
+                    for (int lane = 0; lane != lanes; ++lane) {
+                        any |= covered[lane] != 0;
+                    }
+                    if (!any) {
+                        continue;
+                    }
+                    for (int lane = 0; lane != lanes; ++lane) {
+                        if (!covered[lane]) {
+                            continue;
+                        }
+                        const float weights[3] = { float(edges[0][lane]) * triangle.inverseArea, float(edges[1][lane]) * triangle.inverseArea, float(edges[2][lane]) * triangle.inverseArea };
+                        const float z = weights[0] * triangle.z[0] + weights[1] * triangle.z[1] + weights[2] * triangle.z[2];
+                        const size_t pixel = size_t(y) * job.targetWidth + size_t(x + lane);
+                        if (!(z < job.depthBuffer[pixel])) {
+                            continue;
+                        }
+                        job.depthBuffer[pixel] = z;
+                        ++fragments;
+
+                        const float w = 1 / (weights[0] * triangle.inverseW[0] + weights[1] * triangle.inverseW[1] + weights[2] * triangle.inverseW[2]);
+                        float varyings[maximumVaryings];
+                        for (int component = 0; component != maximumVaryings; ++component) {
+                            varyings[component] = (weights[0] * triangle.varyings[0][component] + weights[1] * triangle.varyings[1][component] + weights[2] * triangle.varyings[2][component]) * w;
+                        }
+                        float *color = job.colorBuffer + pixel * 4;
+                        if (job.flat) {
+                            // As flatShaderFragmentShader, which does not normalize the light direction.
+                            const LightUniforms &light = *job.light;
+                            const FlatMaterial &material = job.flatMaterials[triangle.instance];
+                            const float direction[3] = { light.lightPosition[0] - varyings[0], light.lightPosition[1] - varyings[1], light.lightPosition[2] - varyings[2] };
+                            const float distanceSquared = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+                            const float lambertian = std::max(direction[0] * triangle.flatNormal[0] + direction[1] * triangle.flatNormal[1] + direction[2] * triangle.flatNormal[2], 0.0f);
+                            for (int channel = 0; channel != 3; ++channel) {
+                                color[channel] = material.diffuseColor[channel] * lambertian * light.lightColor[channel] * light.lightPower / distanceSquared + light.ambientLightColor[channel] * material.ambientColor[channel];
+                            }
+                            color[3] = 1;
+                        }
+                        else {
+                            const UnlitMaterial &material = job.unlitMaterials[triangle.instance];
+                            if (material.textureIndex >= 0 && size_t(material.textureIndex) < job.textureCount) {
+                                sampleTexture(job.textures[material.textureIndex], varyings[0], varyings[1], color);
+                            }
+                            else {
+                                std::copy_n(material.color, 4, color);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return fragments;
+}
+
+uint64_t rasterizeTileGeneric(const TileJob &job, size_t tileIndex) {
+    return rasterizeTile(job, tileIndex);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+uint64_t rasterizeTileAVX2(const TileJob &job, size_t tileIndex) {
+    return rasterizeTile(job, tileIndex);
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+}
+
+// MARK: - Target
+
+Rasterizer::Rasterizer(uint32_t width, uint32_t height, uint32_t tileSize) : targetWidth(std::max(width, 1u)), targetHeight(std::max(height, 1u)), tile(std::max(tileSize, 8u)) {
+    tilesWide = (targetWidth + tile - 1) / tile;
+    tilesHigh = (targetHeight + tile - 1) / tile;
+    colorBuffer.assign(size_t(targetWidth) * targetHeight * 4, 0);
+    depthBuffer.assign(size_t(targetWidth) * targetHeight, 1);
+}
+
+void Rasterizer::clear(const float *rgba, float depth) {
+    parallel::parallelFor(targetHeight, 64, [&](size_t begin, size_t end) {
+        for (size_t pixel = begin * targetWidth; pixel != end * targetWidth; ++pixel) {
+            std::copy_n(rgba, 4, colorBuffer.data() + pixel * 4);
+            depthBuffer[pixel] = depth;
+        }
+    });
+}
+
+void Rasterizer::toRGBA8(uint8_t *output) const {
+    std::transform(colorBuffer.begin(), colorBuffer.end(), output, [](float value) {
+        return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255 + 0.5f);
+    });
+}
+
+DrawStatistics Rasterizer::drawFlat(const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const LightUniforms &light, const FlatMaterial *materials) {
+    return draw(Shading::flat, mesh, instanceCount, camera, transforms, &light, materials, nullptr, nullptr, 0);
+}
+
+DrawStatistics Rasterizer::drawUnlit(const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const UnlitMaterial *materials, const Texture *textures, size_t textureCount) {
+    return draw(Shading::unlit, mesh, instanceCount, camera, transforms, nullptr, nullptr, materials, textures, textureCount);
+}
+
+// MARK: - Drawing
+
+DrawStatistics Rasterizer::draw(Shading shading, const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const LightUniforms *light, const FlatMaterial *flatMaterials, const UnlitMaterial *unlitMaterials, const Texture *textures, size_t textureCount) {
+    const trace::Zone zone(shading == Shading::flat ? "raster.drawFlat" : "raster.drawUnlit");
+    DrawStatistics statistics;
+    const size_t trianglesPerInstance = (mesh.indices ? mesh.indexCount : mesh.vertexCount) / 3;
+    const size_t triangleCount = trianglesPerInstance * instanceCount;
+    if (triangleCount == 0) {
+        return statistics;
+    }
+
+    // The vertex shader, once per vertex of every instance.
+    std::vector<ClipVertex> clipVertices(mesh.vertexCount * instanceCount);
+    std::vector<float> normals(mesh.vertexCount * instanceCount * 3);
+    parallel::parallelFor(clipVertices.size(), 4096, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const ModelTransforms &model = transforms[index / mesh.vertexCount];
+            const Vertex &vertex = mesh.vertices[index % mesh.vertexCount];
+            const float position[4] = { vertex.position[0], vertex.position[1], vertex.position[2], 1 };
+            float modelVertex[4];
+            multiply(model.modelViewMatrix, position, modelVertex);
+            ClipVertex &output = clipVertices[index];
+            multiply(camera.projectionMatrix, modelVertex, output.position);
+            if (shading == Shading::flat) {
+                for (int component = 0; component != 3; ++component) {
+                    output.varyings[component] = modelVertex[component] / modelVertex[3];
+                    normals[index * 3 + component] = model.modelNormalMatrix[0][component] * vertex.normal[0] + model.modelNormalMatrix[1][component] * vertex.normal[1] + model.modelNormalMatrix[2][component] * vertex.normal[2];
+                }
+            }
+            else {
+                output.varyings[0] = vertex.textureCoordinate[0];
+                output.varyings[1] = vertex.textureCoordinate[1];
+                output.varyings[2] = 0;
+            }
+        }
+    });
+
+    // Clip, set up and bin triangles in chunks.
+    const float width = float(targetWidth), height = float(targetHeight);
+    std::vector<Chunk> chunks((triangleCount + trianglesPerChunk - 1) / trianglesPerChunk);
+    parallel::parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t chunkIndex = begin; chunkIndex != end; ++chunkIndex) {
+            Chunk &chunk = chunks[chunkIndex];
+            chunk.bins.resize(size_t(tilesWide) * tilesHigh);
+            const size_t last = std::min(triangleCount, (chunkIndex + 1) * trianglesPerChunk);
+            for (size_t triangleIndex = chunkIndex * trianglesPerChunk; triangleIndex != last; ++triangleIndex) {
+                const uint32_t instance = uint32_t(triangleIndex / trianglesPerInstance);
+                const size_t first = (triangleIndex % trianglesPerInstance) * 3;
+                size_t vertexIndices[3];
+                for (int corner = 0; corner != 3; ++corner) {
+                    const size_t vertex = mesh.indices ? mesh.indices[first + corner] : first + corner;
+                    vertexIndices[corner] = size_t(instance) * mesh.vertexCount + std::min(vertex, mesh.vertexCount - 1);
+                }
+
+                ClipVertex polygon[2][3 + std::size(clipPlanes)];
+                int count = 3;
+                for (int corner = 0; corner != 3; ++corner) {
+                    polygon[0][corner] = clipVertices[vertexIndices[corner]];
+                }
+                int current = 0;
+                for (auto plane : clipPlanes) {
+                    count = clipPolygon(polygon[current], count, polygon[1 - current], plane);
+                    current = 1 - current;
+                    if (count < 3) {
+                        break;
+                    }
+                }
+                if (count < 3) {
+                    continue;
+                }
+
+                // The flat normal is the first (provoking) vertex's.
+                float flatNormal[3] = { 0, 0, 0 };
+                if (shading == Shading::flat) {
+                    const float *normal = normals.data() + vertexIndices[0] * 3;
+                    const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    for (int component = 0; component != 3; ++component) {
+                        flatNormal[component] = length > 0 ? normal[component] / length : 0;
+                    }
+                }
+
+                // Project the clipped polygon and fan it into triangles.
+                int64_t fixedX[std::size(polygon[0])], fixedY[std::size(polygon[0])];
+                float depth[std::size(polygon[0])], inverseW[std::size(polygon[0])];
+                for (int index = 0; index != count; ++index) {
+                    const float *position = polygon[current][index].position;
+                    inverseW[index] = 1 / position[3];
+                    fixedX[index] = std::llround((position[0] * inverseW[index] * 0.5f + 0.5f) * width * subpixelScale);
+                    fixedY[index] = std::llround((0.5f - position[1] * inverseW[index] * 0.5f) * height * subpixelScale);
+                    depth[index] = std::clamp(position[2] * inverseW[index], 0.0f, 1.0f);
+                }
+                for (int fan = 1; fan + 1 < count; ++fan) {
+                    int corners[3] = { 0, fan, fan + 1 };
+                    int64_t area = (fixedX[corners[1]] - fixedX[corners[0]]) * (fixedY[corners[2]] - fixedY[corners[0]]) - (fixedY[corners[1]] - fixedY[corners[0]]) * (fixedX[corners[2]] - fixedX[corners[0]]);
+                    if (area == 0) {
+                        continue;
+                    }
+                    // No culling: wind every triangle the same way.
+                    if (area < 0) {
+                        std::swap(corners[1], corners[2]);
+                        area = -area;
+                    }
+
+                    Triangle triangle;
+                    int64_t minX = INT64_MAX, minY = INT64_MAX, maxX = INT64_MIN, maxY = INT64_MIN;
+                    for (int corner = 0; corner != 3; ++corner) {
+                        const int from = corners[(corner + 1) % 3], to = corners[(corner + 2) % 3];
+                        const int64_t dx = fixedX[to] - fixedX[from], dy = fixedY[to] - fixedY[from];
+                        triangle.a[corner] = -dy * int64_t(subpixelScale);
+                        triangle.b[corner] = dx * int64_t(subpixelScale);
+                        triangle.c[corner] = dx * (halfPixel - fixedY[from]) - dy * (halfPixel - fixedX[from]);
+                        triangle.threshold[corner] = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+
+                        const int vertex = corners[corner];
+                        minX = std::min(minX, fixedX[vertex]);
+                        maxX = std::max(maxX, fixedX[vertex]);
+                        minY = std::min(minY, fixedY[vertex]);
+                        maxY = std::max(maxY, fixedY[vertex]);
+                        triangle.z[corner] = depth[vertex];
+                        triangle.inverseW[corner] = inverseW[vertex];
+                        for (int component = 0; component != maximumVaryings; ++component) {
+                            triangle.varyings[corner][component] = polygon[current][vertex].varyings[component] * inverseW[vertex];
+                        }
+                    }
+                    // Pixels whose centres lie within the bounds.
+                    auto firstPixel = [](int64_t value) {
+                        return int64_t(std::ceil(double(value - halfPixel) / subpixelScale));
+                    };
+                    auto lastPixel = [](int64_t value) {
+                        return int64_t(std::floor(double(value - halfPixel) / subpixelScale));
+                    };
+                    triangle.minX = int32_t(std::max<int64_t>(firstPixel(minX), 0));
+                    triangle.minY = int32_t(std::max<int64_t>(firstPixel(minY), 0));
+                    triangle.maxX = int32_t(std::min<int64_t>(lastPixel(maxX), targetWidth - 1));
+                    triangle.maxY = int32_t(std::min<int64_t>(lastPixel(maxY), targetHeight - 1));
+                    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+                        continue;
+                    }
+                    triangle.inverseArea = 1 / float(area);
+                    std::copy_n(flatNormal, 3, triangle.flatNormal);
+                    triangle.instance = instance;
+
+                    const uint32_t localIndex = uint32_t(chunk.triangles.size());
+                    chunk.triangles.push_back(triangle);
+                    for (uint32_t tileY = uint32_t(triangle.minY) / tile; tileY <= uint32_t(triangle.maxY) / tile; ++tileY) {
+                        for (uint32_t tileX = uint32_t(triangle.minX) / tile; tileX <= uint32_t(triangle.maxX) / tile; ++tileX) {
+                            chunk.bins[tileY * tilesWide + tileX].push_back(localIndex);
+                        }
+                    }
+                }
+            }
+        }
+    });
+    for (const Chunk &chunk : chunks) {
+        statistics.triangles += chunk.triangles.size();
+    }
+
+    // Rasterize and shade tile by tile.
+    const TileJob job = {
+        .chunks = chunks.data(),
+        .chunkCount = chunks.size(),
+        .flat = shading == Shading::flat,
+        .tile = tile,
+        .tilesWide = tilesWide,
+        .targetWidth = targetWidth,
+        .targetHeight = targetHeight,
+        .colorBuffer = colorBuffer.data(),
+        .depthBuffer = depthBuffer.data(),
+        .light = light,
+        .flatMaterials = flatMaterials,
+        .unlitMaterials = unlitMaterials,
+        .textures = textures,
+        .textureCount = textureCount,
+    };
+    std::vector<uint64_t> tileFragments(size_t(tilesWide) * tilesHigh, 0);
+    parallel::parallelFor(tileFragments.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t tileIndex = begin; tileIndex != end; ++tileIndex) {
+#if defined(__x86_64__)
+            if (hasAVX2) {
+                tileFragments[tileIndex] = rasterizeTileAVX2(job, tileIndex);
+                continue;
+            }
+#endif
+            tileFragments[tileIndex] = rasterizeTileGeneric(job, tileIndex);
+        }
+    });
+    for (const uint64_t fragments : tileFragments) {
+        statistics.fragments += fragments;
+    }
+    trace::count("raster.triangles", int64_t(statistics.triangles));
+    trace::count("raster.fragments", int64_t(statistics.fragments));
+    if (shading == Shading::flat) {
+        // One point light per shaded fragment.
+        trace::count("raster.lightsEvaluated", int64_t(statistics.fragments));
+    }
+    return statistics;
+}
+
+}
@@ -0,0 +1,477 @@
+#include "SimplexNoise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "Parallel.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi" // The 32 byte vectors below never cross a translation unit boundary.
+#endif
+
+namespace noise {
+
+namespace {
+
+// Eight lanes. GCC and Clang lower these to AVX registers inside `target("avx2")` functions and to pairs of 128 bit registers elsewhere.
+typedef float Float8 __attribute__((vector_size(32)));
+typedef int32_t Int8 __attribute__((vector_size(32)));
+
+// MARK: Lane helpers
+
+// The noise functions below are written once for `float` and `Float8`, so scalar and batch results are bit identical.
+
+template <typename T> [[gnu::always_inline]] inline T splat(float value) {
+    return T {} + value;
+}
+
+template <> [[gnu::always_inline]] inline float splat(float value) {
+    return value;
+}
+
+[[gnu::always_inline]] inline Float8 select(Int8 mask, Float8 a, Float8 b) {
+    return (Float8)(((Int8)a & mask) | ((Int8)b & ~mask));
+}
+
+[[gnu::always_inline]] inline float floorOf(float x) {
+    return std::floor(x);
+}
+
+[[gnu::always_inline]] inline Float8 floorOf(Float8 x) {
+    // Truncate, then step down where that rounded up (negative non-integers).
+    const Float8 truncated = __builtin_convertvector(__builtin_convertvector(x, Int8), Float8);
+    return truncated + __builtin_convertvector(truncated > x, Float8);
+}
+
+template <typename T> [[gnu::always_inline]] inline T fractOf(T x) {
+    return x - floorOf(x);
+}
+
+[[gnu::always_inline]] inline float absOf(float x) {
+    return std::fabs(x);
+}
+
+[[gnu::always_inline]] inline Float8 absOf(Float8 x) {
+    return (Float8)((Int8)x & 0x7fffffff);
+}
+
+[[gnu::always_inline]] inline float maxOf(float a, float b) {
+    return a > b ? a : b;
+}
+
+[[gnu::always_inline]] inline Float8 maxOf(Float8 a, Float8 b) {
+    return select(a > b, a, b);
+}
+
+[[gnu::always_inline]] inline float minOf(float a, float b) {
+    return a < b ? a : b;
+}
+
+[[gnu::always_inline]] inline Float8 minOf(Float8 a, Float8 b) {
+    return select(a < b, a, b);
+}
+
+// a > b ? ifGreater : otherwise
+[[gnu::always_inline]] inline float whereGreater(float a, float b, float ifGreater, float otherwise) {
+    return a > b ? ifGreater : otherwise;
+}
+
+[[gnu::always_inline]] inline Float8 whereGreater(Float8 a, Float8 b, Float8 ifGreater, Float8 otherwise) {
+    return select(a > b, ifGreater, otherwise);
+}
+
+// GLSL `step(edge, x)`.
+[[gnu::always_inline]] inline float stepOf(float edge, float x) {
+    return x < edge ? 0.0f : 1.0f;
+}
+
+[[gnu::always_inline]] inline Float8 stepOf(Float8 edge, Float8 x) {
+    return select(x < edge, Float8 {}, Float8 {} + 1.0f);
+}
+
+template <typename T> [[gnu::always_inline]] inline T clamp01(T x) {
+    return minOf(maxOf(x, splat<T>(0.0f)), splat<T>(1.0f));
+}
+
+template <typename T> [[gnu::always_inline]] inline T mod289(T x) {
+    return x - floorOf(x * (1.0f / 289.0f)) * 289.0f;
+}
+
+template <typename T> [[gnu::always_inline]] inline T permute(T x) {
+    return mod289(((x * 34.0f) + 10.0f) * x);
+}
+
+template <typename T> [[gnu::always_inline]] inline T taylorInvSqrt(T r) {
+    return 1.79284291400159f - 0.85373472095314f * r;
+}
+
+// MARK: Noise
+
+template <typename T> [[gnu::always_inline]] inline T simplex2(T vx, T vy) {
+    const float Cx = 0.211324865405187f; // (3.0-sqrt(3.0))/6.0
+    const float Cy = 0.366025403784439f; // 0.5*(sqrt(3.0)-1.0)
+    const float Cz = -0.577350269189626f; // -1.0 + 2.0 * C.x
+    const float Cw = 0.024390243902439f; // 1.0 / 41.0
+
+    // First corner
+    const T s = vx * Cy + vy * Cy;
+    T ix = floorOf(vx + s), iy = floorOf(vy + s);
+    const T t = ix * Cx + iy * Cx;
+    const T x0x = vx - ix + t, x0y = vy - iy + t;
+
+    // Other corners
+    const T i1x = whereGreater(x0x, x0y, splat<T>(1.0f), splat<T>(0.0f));
+    const T i1y = whereGreater(x0x, x0y, splat<T>(0.0f), splat<T>(1.0f));
+    const T x12x = x0x + Cx - i1x, x12y = x0y + Cx - i1y;
+    const T x12z = x0x + Cz, x12w = x0y + Cz;
+
+    // Permutations
+    ix = mod289(ix);
+    iy = mod289(iy);
+    const T p[3] = {
+        permute(permute(iy + 0.0f) + ix + 0.0f),
+        permute(permute(iy + i1y) + ix + i1x),
+        permute(permute(iy + 1.0f) + ix + 1.0f),
+    };
+    const T offsets[3][2] = { { x0x, x0y }, { x12x, x12y }, { x12z, x12w } };
+
+    // Gradients: 41 points uniformly over a line, mapped onto a diamond.
+    T result = splat<T>(0.0f);
+    for (int corner = 0; corner != 3; ++corner) {
+        const T dx = offsets[corner][0], dy = offsets[corner][1];
+        T m = maxOf(0.5f - (dx * dx + dy * dy), splat<T>(0.0f));
+        m = m * m;
+        m = m * m;
+        const T x = 2.0f * fractOf(p[corner] * Cw) - 1.0f;
+        const T h = absOf(x) - 0.5f;
+        const T ox = floorOf(x + 0.5f);
+        const T a0 = x - ox;
+        // Normalise gradients implicitly by scaling m
+        m *= taylorInvSqrt(a0 * a0 + h * h);
+        result += m * (a0 * dx + h * dy);
+    }
+    return 130.0f * result;
+}
+
+template <typename T> [[gnu::always_inline]] inline T simplex3(T vx, T vy, T vz) {
+    const float Cx = 1.0f / 6.0f, Cy = 1.0f / 3.0f;
+
+    // First corner
+    const T s = vx * Cy + vy * Cy + vz * Cy;
+    T i[3] = { floorOf(vx + s), floorOf(vy + s), floorOf(vz + s) };
+    const T t = i[0] * Cx + i[1] * Cx + i[2] * Cx;
+    const T x0[3] = { vx - i[0] + t, vy - i[1] + t, vz - i[2] + t };
+
+    // Other corners
+    const T g[3] = { stepOf(x0[1], x0[0]), stepOf(x0[2], x0[1]), stepOf(x0[0], x0[2]) };
+    const T l[3] = { 1.0f - g[0], 1.0f - g[1], 1.0f - g[2] };
+    const T i1[3] = { minOf(g[0], l[2]), minOf(g[1], l[0]), minOf(g[2], l[1]) };
+    const T i2[3] = { maxOf(g[0], l[2]), maxOf(g[1], l[0]), maxOf(g[2], l[1]) };
+    T x[4][3];
+    for (int axis = 0; axis != 3; ++axis) {
+        x[0][axis] = x0[axis];
+        x[1][axis] = x0[axis] - i1[axis] + Cx;
+        x[2][axis] = x0[axis] - i2[axis] + Cy;
+        x[3][axis] = x0[axis] - 0.5f;
+    }
+
+    // Permutations
+    for (auto &value : i) {
+        value = mod289(value);
+    }
+    const T corners[3][4] = {
+        { splat<T>(0.0f), i1[0], i2[0], splat<T>(1.0f) },
+        { splat<T>(0.0f), i1[1], i2[1], splat<T>(1.0f) },
+        { splat<T>(0.0f), i1[2], i2[2], splat<T>(1.0f) },
+    };
+
+    // Gradients: 7x7 points over a square, mapped onto an octahedron.
+    const float n_ = 0.142857142857f; // 1.0/7.0
+    const float nsx = n_ * 2.0f - 0.0f, nsy = n_ * 0.5f - 1.0f, nsz = n_ * 1.0f - 0.0f;
+    T result = splat<T>(0.0f);
+    for (int corner = 0; corner != 4; ++corner) {
+        const T p = permute(permute(permute(i[2] + corners[2][corner]) + i[1] + corners[1][corner]) + i[0] + corners[0][corner]);
+        const T j = p - 49.0f * floorOf(p * nsz * nsz); // mod(p,7*7)
+        const T gx_ = floorOf(j * nsz);
+        const T gy_ = floorOf(j - 7.0f * gx_); // mod(j,N)
+        const T bx = gx_ * nsx + nsy;
+        const T by = gy_ * nsx + nsy;
+        const T h = 1.0f - absOf(bx) - absOf(by);
+        const T sh = -stepOf(h, splat<T>(0.0f));
+        const T gradient[3] = { bx + (floorOf(bx) * 2.0f + 1.0f) * sh, by + (floorOf(by) * 2.0f + 1.0f) * sh, h };
+        const T norm = taylorInvSqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+        const T *offset = x[corner];
+        T m = maxOf(0.5f - (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]), splat<T>(0.0f));
+        m = m * m;
+        result += m * m * ((gradient[0] * norm) * offset[0] + (gradient[1] * norm) * offset[1] + (gradient[2] * norm) * offset[2]);
+    }
+    return 105.0f * result;
+}
+
+template <typename T> [[gnu::always_inline]] inline T simplex4(T vx, T vy, T vz, T vw) {
+    const float F4 = 0.309016994374947451f; // (sqrt(5) - 1)/4
+    const float Cx = 0.138196601125011f; // (5 - sqrt(5))/20  G4
+    const float Cy = 0.276393202250021f; // 2 * G4
+    const float Cz = 0.414589803375032f; // 3 * G4
+    const float Cw = -0.447213595499958f; // -1 + 4 * G4
+
+    // First corner
+    const T s = vx * F4 + vy * F4 + vz * F4 + vw * F4;
+    T i[4] = { floorOf(vx + s), floorOf(vy + s), floorOf(vz + s), floorOf(vw + s) };
+    const T t = i[0] * Cx + i[1] * Cx + i[2] * Cx + i[3] * Cx;
+    const T x0[4] = { vx - i[0] + t, vy - i[1] + t, vz - i[2] + t, vw - i[3] + t };
+
+    // Other corners: rank sorting originally contributed by Bill Licea-Kane, AMD (formerly ATI)
+    const T isX[3] = { stepOf(x0[1], x0[0]), stepOf(x0[2], x0[0]), stepOf(x0[3], x0[0]) };
+    const T isYZ[3] = { stepOf(x0[2], x0[1]), stepOf(x0[3], x0[1]), stepOf(x0[3], x0[2]) };
+    T i0[4] = { isX[0] + isX[1] + isX[2], 1.0f - isX[0], 1.0f - isX[1], 1.0f - isX[2] };
+    i0[1] += isYZ[0] + isYZ[1];
+    i0[2] += 1.0f - isYZ[0];
+    i0[3] += 1.0f - isYZ[1];
+    i0[2] += isYZ[2];
+    i0[3] += 1.0f - isYZ[2];
+    // i0 now contains the unique values 0,1,2,3 in each channel
+    T steps[3][4];
+    for (int axis = 0; axis != 4; ++axis) {
+        steps[2][axis] = clamp01(i0[axis]);
+        steps[1][axis] = clamp01(i0[axis] - 1.0f);
+        steps[0][axis] = clamp01(i0[axis] - 2.0f);
+    }
+    T x[5][4];
+    for (int axis = 0; axis != 4; ++axis) {
+        x[0][axis] = x0[axis];
+        x[1][axis] = x0[axis] - steps[0][axis] + Cx;
+        x[2][axis] = x0[axis] - steps[1][axis] + Cy;
+        x[3][axis] = x0[axis] - steps[2][axis] + Cz;
+        x[4][axis] = x0[axis] + Cw;
+    }
+
+    // Permutations
+    for (auto &value : i) {
+        value = mod289(value);
+    }
+    T j[5];
+    j[0] = permute(permute(permute(permute(i[3]) + i[2]) + i[1]) + i[0]);
+    for (int corner = 1; corner != 5; ++corner) {
+        T offset[4];
+        for (int axis = 0; axis != 4; ++axis) {
+            offset[axis] = corner == 4 ? splat<T>(1.0f) : steps[corner - 1][axis];
+        }
+        j[corner] = permute(permute(permute(permute(i[3] + offset[3]) + i[2] + offset[2]) + i[1] + offset[1]) + i[0] + offset[0]);
+    }
+
+    // Gradients: 7x7x6 points over a cube, mapped onto a 4-cross polytope
+    const float ip[3] = { 1.0f / 294.0f, 1.0f / 49.0f, 1.0f / 7.0f };
+    T result = splat<T>(0.0f);
+    for (int corner = 0; corner != 5; ++corner) {
+        T gradient[4];
+        for (int axis = 0; axis != 3; ++axis) {
+            gradient[axis] = floorOf(fractOf(j[corner] * ip[axis]) * 7.0f) * ip[2] - 1.0f;
+        }
+        gradient[3] = 1.5f - (absOf(gradient[0]) * 1.0f + absOf(gradient[1]) * 1.0f + absOf(gradient[2]) * 1.0f);
+        const T negativeW = whereGreater(splat<T>(0.0f), gradient[3], splat<T>(1.0f), splat<T>(0.0f));
+        for (int axis = 0; axis != 3; ++axis) {
+            const T negative = whereGreater(splat<T>(0.0f), gradient[axis], splat<T>(1.0f), splat<T>(0.0f));
+            gradient[axis] = gradient[axis] + (negative * 2.0f - 1.0f) * negativeW;
+        }
+        const T norm = taylorInvSqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2] + gradient[3] * gradient[3]);
+        const T *offset = x[corner];
+        T m = maxOf(0.6f - (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] + offset[3] * offset[3]), splat<T>(0.0f));
+        m = m * m;
+        result += m * m * ((gradient[0] * norm) * offset[0] + (gradient[1] * norm) * offset[1] + (gradient[2] * norm) * offset[2] + (gradient[3] * norm) * offset[3]);
+    }
+    return 49.0f * result;
+}
+
+template <unsigned Dimensions, typename T> [[gnu::always_inline]] inline T simplexAt(const T *p) {
+    if constexpr (Dimensions == 2) {
+        return simplex2(p[0], p[1]);
+    }
+    else if constexpr (Dimensions == 3) {
+        return simplex3(p[0], p[1], p[2]);
+    }
+    else {
+        return simplex4(p[0], p[1], p[2], p[3]);
+    }
+}
+
+// Added to octave n's coordinates n times.
+constexpr float octaveShift[4] = { 17.31f, -41.57f, 29.83f, -7.19f };
+
+template <unsigned Dimensions, typename T> [[gnu::always_inline]] inline T fractalAt(const Fractal &fractal, const T *p) {
+    T sum = splat<T>(0.0f);
+    float amplitude = 1, total = 0, frequency = fractal.frequency;
+    for (unsigned octave = 0; octave != fractal.octaves; ++octave) {
+        T q[Dimensions];
+        for (unsigned axis = 0; axis != Dimensions; ++axis) {
+            q[axis] = (p[axis] + fractal.offset[axis]) * frequency + octaveShift[axis] * float(octave);
+        }
+        T value = simplexAt<Dimensions>(q);
+        if (fractal.mode == FractalMode::ridged) {
+            value = 1.0f - absOf(value);
+            value = value * value;
+        }
+        sum += value * amplitude;
+        total += amplitude;
+        amplitude *= fractal.gain;
+        frequency *= fractal.lacunarity;
+    }
+    return total > 0 ? sum * (1.0f / total) : sum;
+}
+
+// MARK: Batches
+
+struct Batch {
+    const float *coordinates[4];
+    float *output;
+    const Fractal *fractal; // nullptr for plain noise
+};
+
+template <unsigned Dimensions, typename T> [[gnu::always_inline]] inline T evaluate(const Batch &batch, const T *p) {
+    return batch.fractal ? fractalAt<Dimensions>(*batch.fractal, p) : simplexAt<Dimensions>(p);
+}
+
+template <unsigned Dimensions> [[gnu::always_inline]] inline void runBatch(const Batch &batch, size_t begin, size_t end) {
+    size_t index = begin;
+    for (; index + 8 <= end; index += 8) {
+        Float8 p[Dimensions];
+        for (unsigned axis = 0; axis != Dimensions; ++axis) {
+            std::memcpy(&p[axis], batch.coordinates[axis] + index, sizeof(Float8));
+        }
+        const Float8 result = evaluate<Dimensions>(batch, p);
+        std::memcpy(batch.output + index, &result, sizeof(Float8));
+    }
+    if (index != end) {
+        // The tail goes through the same lanes, padded with zeros.
+        Float8 p[Dimensions] = {};
+        for (unsigned axis = 0; axis != Dimensions; ++axis) {
+            std::memcpy(&p[axis], batch.coordinates[axis] + index, (end - index) * sizeof(float));
+        }
+        const Float8 result = evaluate<Dimensions>(batch, p);
+        std::memcpy(batch.output + index, &result, (end - index) * sizeof(float));
+    }
+}
+
+template <unsigned Dimensions> void runBatchGeneric(const Batch &batch, size_t begin, size_t end) {
+    runBatch<Dimensions>(batch, begin, end);
+}
+
+#if defined(__x86_64__)
+template <unsigned Dimensions> __attribute__((target("avx2"))) void runBatchAVX2(const Batch &batch, size_t begin, size_t end) {
+    runBatch<Dimensions>(batch, begin, end);
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+template <unsigned Dimensions> void run(const Batch &batch, size_t count) {
+    const size_t grain = batch.fractal ? 1024 : 8192;
+    parallel::parallelFor(count, grain, [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+        if (hasAVX2) {
+            runBatchAVX2<Dimensions>(batch, begin, end);
+            return;
+        }
+#endif
+        runBatchGeneric<Dimensions>(batch, begin, end);
+    });
+}
+
+// MARK: Heightfields
+
+struct Heightfield {
+    const Fractal *fractal;
+    float *output;
+    uint32_t width;
+    float originX;
+    float originY;
+    float spacing;
+    size_t rowStride;
+};
+
+[[gnu::always_inline]] inline void heightfieldRows(const Heightfield &field, size_t firstRow, size_t endRow) {
+    const Float8 lanes = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    for (size_t row = firstRow; row != endRow; ++row) {
+        float *output = field.output + row * field.rowStride;
+        const Float8 y = splat<Float8>(field.originY + float(row) * field.spacing);
+        for (uint32_t column = 0; column < field.width; column += 8) {
+            const Float8 p[2] = { field.originX + (lanes + float(column)) * field.spacing, y };
+            const Float8 result = fractalAt<2>(*field.fractal, p);
+            std::memcpy(output + column, &result, std::min<size_t>(8, field.width - column) * sizeof(float));
+        }
+    }
+}
+
+void heightfieldRowsGeneric(const Heightfield &field, size_t firstRow, size_t endRow) {
+    heightfieldRows(field, firstRow, endRow);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void heightfieldRowsAVX2(const Heightfield &field, size_t firstRow, size_t endRow) {
+    heightfieldRows(field, firstRow, endRow);
+}
+#endif
+
+}
+
+float simplex(float x, float y) {
+    return simplex2(x, y);
+}
+
+float simplex(float x, float y, float z) {
+    return simplex3(x, y, z);
+}
+
+float simplex(float x, float y, float z, float w) {
+    return simplex4(x, y, z, w);
+}
+
+void simplex2D(const float *x, const float *y, float *output, size_t count) {
+    run<2>({ .coordinates = { x, y }, .output = output, .fractal = nullptr }, count);
+}
+
+void simplex3D(const float *x, const float *y, const float *z, float *output, size_t count) {
+    run<3>({ .coordinates = { x, y, z }, .output = output, .fractal = nullptr }, count);
+}
+
+void simplex4D(const float *x, const float *y, const float *z, const float *w, float *output, size_t count) {
+    run<4>({ .coordinates = { x, y, z, w }, .output = output, .fractal = nullptr }, count);
+}
+
+void fractal2D(const Fractal &fractal, const float *x, const float *y, float *output, size_t count) {
+    run<2>({ .coordinates = { x, y }, .output = output, .fractal = &fractal }, count);
+}
+
+void fractal3D(const Fractal &fractal, const float *x, const float *y, const float *z, float *output, size_t count) {
+    run<3>({ .coordinates = { x, y, z }, .output = output, .fractal = &fractal }, count);
+}
+
+void fractal4D(const Fractal &fractal, const float *x, const float *y, const float *z, const float *w, float *output, size_t count) {
+    run<4>({ .coordinates = { x, y, z, w }, .output = output, .fractal = &fractal }, count);
+}
+
+void heightfield(const Fractal &fractal, float *output, uint32_t width, uint32_t height, float originX, float originY, float spacing, size_t rowStride) {
+    const Heightfield field = {
+        .fractal = &fractal,
+        .output = output,
+        .width = width,
+        .originX = originX,
+        .originY = originY,
+        .spacing = spacing,
+        .rowStride = rowStride ? rowStride : width,
+    };
+    parallel::parallelFor(height, 1, [&](size_t begin, size_t end) {
+#if defined(__x86_64__)
+        if (hasAVX2) {
+            heightfieldRowsAVX2(field, begin, end);
+            return;
+        }
+#endif
+        heightfieldRowsGeneric(field, begin, end);
+    });
+}
+
+}
@@ -0,0 +1,278 @@
+#include "Sorting.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace sorting {
+
+namespace {
+
+// Radix passes read and write float keys as their bit patterns, and scratch storage holds 32 bit keys in 64 bit words.
+typedef uint32_t __attribute__((may_alias)) Bits32;
+typedef uint64_t __attribute__((may_alias)) Bits64;
+
+// Maps keys to unsigned integers with the same order.
+template <typename Key> struct KeyBits;
+
+template <> struct KeyBits<uint32_t> {
+    typedef Bits32 Type;
+
+    static Type encode(uint32_t key) {
+        return key;
+    }
+
+    static uint32_t decode(Type bits) {
+        return bits;
+    }
+};
+
+template <> struct KeyBits<uint64_t> {
+    typedef Bits64 Type;
+
+    static Type encode(uint64_t key) {
+        return key;
+    }
+
+    static uint64_t decode(Type bits) {
+        return bits;
+    }
+};
+
+// Negative floats have all their bits flipped (larger magnitudes become smaller), positive ones just the sign bit.
+template <> struct KeyBits<float> {
+    typedef Bits32 Type;
+
+    static Type encode(float key) {
+        const uint32_t bits = std::bit_cast<uint32_t>(key);
+        return bits ^ (-(bits >> 31) | 0x80000000);
+    }
+
+    static float decode(Type bits) {
+        return std::bit_cast<float>(uint32_t(bits ^ (((bits >> 31) - 1) | 0x80000000)));
+    }
+};
+
+// MARK: Bitonic
+
+template <typename Key> void compareAndSwapPass(Key *keys, uint32_t *payloads, size_t numEntries, size_t groupWidth, size_t groupHeight, uint32_t stepIndex) {
+    // One iteration per `thread_position_in_grid.x` that can land inside the array.
+    const size_t threadCount = std::bit_ceil(numEntries) / 2;
+    parallel::parallelFor(threadCount, size_t(1) << 16, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const size_t hIndex = index & (groupWidth - 1);
+            const size_t indexLeft = hIndex + (groupHeight + 1) * (index / groupWidth);
+            const size_t stepSize = stepIndex == 0 ? groupHeight - 2 * hIndex : (groupHeight + 1) / 2;
+            const size_t indexRight = indexLeft + stepSize;
+            if (indexRight >= numEntries) {
+                continue;
+            }
+            if (KeyBits<Key>::encode(keys[indexLeft]) > KeyBits<Key>::encode(keys[indexRight])) {
+                std::swap(keys[indexLeft], keys[indexRight]);
+                if (payloads) {
+                    std::swap(payloads[indexLeft], payloads[indexRight]);
+                }
+            }
+        }
+    });
+}
+
+template <typename Key> void bitonicNetwork(Key *keys, uint32_t *payloads, size_t count) {
+    const trace::Zone zone("sorting.bitonicSort");
+    trace::count("sorting.keys", int64_t(count));
+    if (count < 2) {
+        return;
+    }
+    const unsigned stageCount = std::countr_zero(std::bit_ceil(count));
+    for (unsigned stageIndex = 0; stageIndex != stageCount; ++stageIndex) {
+        for (unsigned stepIndex = 0; stepIndex <= stageIndex; ++stepIndex) {
+            const size_t groupWidth = size_t(1) << (stageIndex - stepIndex);
+            compareAndSwapPass(keys, payloads, count, groupWidth, 2 * groupWidth - 1, stepIndex);
+        }
+    }
+}
+
+// MARK: Radix
+
+constexpr size_t radixBlockSize = 1 << 16;
+
+typedef std::array<size_t, 256> Histogram;
+
+template <typename Key> void lsdRadixSort(Key *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    typedef typename KeyBits<Key>::Type Bits;
+    constexpr unsigned digitCount = sizeof(Bits);
+    const trace::Zone zone("sorting.radixSort");
+    trace::count("sorting.keys", int64_t(count));
+    if (count < 2) {
+        return;
+    }
+    Scratch temporary;
+    Scratch &storage = scratch ? *scratch : temporary;
+    storage.keys.resize((count * sizeof(Bits) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    if (payloads) {
+        storage.payloads.resize(count);
+    }
+
+    const size_t blockCount = std::clamp<size_t>(count / radixBlockSize, 1, parallel::threadCount());
+    const size_t blockSize = (count + blockCount - 1) / blockCount;
+    auto forEachBlock = [&](auto &&body) {
+        parallel::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block != end; ++block) {
+                body(block, block * blockSize, std::min(count, (block + 1) * blockSize));
+            }
+        });
+    };
+
+    // Encode in place and histogram every digit in one read; the totals tell which digits are shared by all keys.
+    Bits *keyBits = reinterpret_cast<Bits *>(keys);
+    std::vector<Histogram> histograms(blockCount * digitCount);
+    forEachBlock([&](size_t block, size_t begin, size_t end) {
+        Histogram *counts = histograms.data() + block * digitCount;
+        std::fill(counts, counts + digitCount, Histogram {});
+        for (size_t i = begin; i != end; ++i) {
+            const Bits bits = KeyBits<Key>::encode(keys[i]);
+            if constexpr (std::is_same_v<Key, float>) {
+                keyBits[i] = bits;
+            }
+            for (unsigned digit = 0; digit != digitCount; ++digit) {
+                ++counts[digit][(bits >> (digit * 8)) & 0xff];
+            }
+        }
+    });
+
+    Bits *source = keyBits, *destination = reinterpret_cast<Bits *>(storage.keys.data());
+    uint32_t *payloadSource = payloads, *payloadDestination = payloads ? storage.payloads.data() : nullptr;
+    bool countsMatchSource = true;
+    std::vector<Histogram> offsets(blockCount);
+    for (unsigned digit = 0; digit != digitCount; ++digit) {
+        const unsigned shift = digit * 8;
+        const auto &firstBlock = histograms[digit];
+        bool trivial = false;
+        for (size_t bucket = 0; bucket != 256 && !trivial; ++bucket) {
+            size_t total = firstBlock[bucket];
+            for (size_t block = 1; block != blockCount; ++block) {
+                total += histograms[block * digitCount + digit][bucket];
+            }
+            trivial = total == count;
+        }
+        if (trivial) {
+            continue;
+        }
+        if (!countsMatchSource) {
+            forEachBlock([&](size_t block, size_t begin, size_t end) {
+                Histogram &counts = histograms[block * digitCount + digit];
+                counts = {};
+                for (size_t i = begin; i != end; ++i) {
+                    ++counts[(source[i] >> shift) & 0xff];
+                }
+            });
+        }
+        countsMatchSource = false;
+
+        // Bucket major, then block, so each block's keys land after the same bucket's keys from earlier blocks.
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket != 256; ++bucket) {
+            for (size_t block = 0; block != blockCount; ++block) {
+                offsets[block][bucket] = offset;
+                offset += histograms[block * digitCount + digit][bucket];
+            }
+        }
+        forEachBlock([&](size_t block, size_t begin, size_t end) {
+            Histogram &next = offsets[block];
+            if (payloadSource) {
+                for (size_t i = begin; i != end; ++i) {
+                    const Bits bits = source[i];
+                    const size_t position = next[(bits >> shift) & 0xff]++;
+                    destination[position] = bits;
+                    payloadDestination[position] = payloadSource[i];
+                }
+            }
+            else {
+                for (size_t i = begin; i != end; ++i) {
+                    const Bits bits = source[i];
+                    destination[next[(bits >> shift) & 0xff]++] = bits;
+                }
+            }
+        });
+        std::swap(source, destination);
+        std::swap(payloadSource, payloadDestination);
+    }
+
+    // An odd number of passes leaves the result in scratch.
+    if (source != keyBits || std::is_same_v<Key, float>) {
+        forEachBlock([&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i != end; ++i) {
+                keys[i] = KeyBits<Key>::decode(source[i]);
+            }
+            if (payloadSource != payloads) {
+                std::memcpy(payloads + begin, payloadSource + begin, (end - begin) * sizeof(uint32_t));
+            }
+        });
+    }
+}
+
+template <typename Key> void sortWithFallback(Key *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    if (count <= bitonicThreshold) {
+        bitonicNetwork(keys, payloads, count);
+    }
+    else {
+        lsdRadixSort(keys, payloads, count, scratch);
+    }
+}
+
+}
+
+void sort(uint32_t *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    sortWithFallback<uint32_t>(keys, payloads, count, scratch);
+}
+
+void sort(uint64_t *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    sortWithFallback<uint64_t>(keys, payloads, count, scratch);
+}
+
+void sort(float *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    sortWithFallback<float>(keys, payloads, count, scratch);
+}
+
+void radixSort(uint32_t *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    lsdRadixSort<uint32_t>(keys, payloads, count, scratch);
+}
+
+void radixSort(uint64_t *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    lsdRadixSort<uint64_t>(keys, payloads, count, scratch);
+}
+
+void radixSort(float *keys, uint32_t *payloads, size_t count, Scratch *scratch) {
+    lsdRadixSort<float>(keys, payloads, count, scratch);
+}
+
+void bitonicSort(uint32_t *keys, uint32_t *payloads, size_t count) {
+    bitonicNetwork<uint32_t>(keys, payloads, count);
+}
+
+void bitonicSort(uint64_t *keys, uint32_t *payloads, size_t count) {
+    bitonicNetwork<uint64_t>(keys, payloads, count);
+}
+
+void bitonicSort(float *keys, uint32_t *payloads, size_t count) {
+    bitonicNetwork<float>(keys, payloads, count);
+}
+
+void bitonicPass(uint32_t *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex) {
+    compareAndSwapPass<uint32_t>(keys, payloads, numEntries, groupWidth, groupHeight, stepIndex);
+}
+
+void bitonicPass(uint64_t *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex) {
+    compareAndSwapPass<uint64_t>(keys, payloads, numEntries, groupWidth, groupHeight, stepIndex);
+}
+
+void bitonicPass(float *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex) {
+    compareAndSwapPass<float>(keys, payloads, numEntries, groupWidth, groupHeight, stepIndex);
+}
+
+}
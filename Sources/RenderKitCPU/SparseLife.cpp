@@ -0,0 +1,261 @@
+#include "SparseLife.h"
+
+#include <bit>
+#include <cstring>
+
+#include "LifeKernels.h"
+#include "Parallel.h"
+
+namespace gameOfLife {
+
+namespace {
+
+constexpr int tileRows = 64;
+
+const uint64_t emptyRows[tileRows] = {};
+
+// `neighbours` holds the rows of the 3 × 3 block of tiles around the one being stepped, north west first, with missing tiles pointing at `emptyRows`.
+template <bool Conway> [[gnu::always_inline]] inline void stepTile(const uint64_t *const neighbours[9], uint64_t *output, const Rule &rule) {
+    // One row of padding above and below; west/east hold each row shifted so bit k is the cell to the left/right of bit k.
+    uint64_t west[tileRows + 2], centre[tileRows + 2], east[tileRows + 2];
+    auto pad = [&](int index, const uint64_t *const *tiles, int row) {
+        const uint64_t word = tiles[1][row];
+        centre[index] = word;
+        west[index] = (word << 1) | (tiles[0][row] >> 63);
+        east[index] = (word >> 1) | (tiles[2][row] << 63);
+    };
+    pad(0, neighbours, tileRows - 1);
+    for (int row = 0; row != tileRows; ++row) {
+        pad(row + 1, neighbours + 3, row);
+    }
+    pad(tileRows + 1, neighbours + 6, 0);
+    // Rows are independent here, so four of them go through the adders at once.
+    for (int row = 0; row != tileRows; row += 4) {
+        const Wide next = nextState<Conway, Wide>(
+            loadWide(west + row), loadWide(centre + row), loadWide(east + row),
+            loadWide(west + row + 1), loadWide(east + row + 1),
+            loadWide(west + row + 2), loadWide(centre + row + 2), loadWide(east + row + 2),
+            loadWide(centre + row + 1), rule);
+        std::memcpy(output + row, &next, sizeof(next));
+    }
+}
+
+void stepTile(const uint64_t *const neighbours[9], uint64_t *output, const Rule &rule) {
+    if (rule.isConway()) {
+        stepTile<true>(neighbours, output, rule);
+    }
+    else {
+        stepTile<false>(neighbours, output, rule);
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+void stepTileAVX2(const uint64_t *const neighbours[9], uint64_t *output, const Rule &rule) {
+    if (rule.isConway()) {
+        stepTile<true>(neighbours, output, rule);
+    }
+    else {
+        stepTile<false>(neighbours, output, rule);
+    }
+}
+
+const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+}
+
+SparseLife::SparseLife(const Rule &rule)
+    : currentRule(rule) {
+    currentRule.birth &= ~1;
+}
+
+SparseLife::Tile *SparseLife::findTile(int64_t tileX, int64_t tileY) const {
+    auto found = tiles.find(key(tileX, tileY));
+    return found == tiles.end() ? nullptr : const_cast<Tile *>(&found->second);
+}
+
+SparseLife::Tile &SparseLife::tile(int64_t tileX, int64_t tileY) {
+    auto [found, inserted] = tiles.try_emplace(key(tileX, tileY));
+    if (inserted) {
+        found->second.x = int32_t(tileX);
+        found->second.y = int32_t(tileY);
+    }
+    return found->second;
+}
+
+void SparseLife::activate(Tile &tile) {
+    if (!tile.active) {
+        tile.active = true;
+        activeTiles.push_back(&tile);
+    }
+}
+
+bool SparseLife::get(int64_t x, int64_t y) const {
+    const Tile *found = findTile(x >> tileShift, y >> tileShift);
+    return found && (found->rows[generationCount & 1][y & (tileSize - 1)] >> (x & (tileSize - 1))) & 1;
+}
+
+void SparseLife::set(int64_t x, int64_t y, bool alive) {
+    Tile &target = tile(x >> tileShift, y >> tileShift);
+    uint64_t &word = target.rows[generationCount & 1][y & (tileSize - 1)];
+    const uint64_t bit = uint64_t(1) << (x & (tileSize - 1));
+    word = alive ? word | bit : word & ~bit;
+    // The previous generation no longer leads to this one, so the tile can't be skipped as repeating until it has been stepped twice.
+    target.edited = true;
+    activate(target);
+}
+
+void SparseLife::insert(const Board &board, int64_t x, int64_t y) {
+    for (uint32_t row = 0; row != board.height(); ++row) {
+        const uint64_t *words = board.row(row);
+        for (uint32_t i = 0; i != board.wordsPerRow(); ++i) {
+            for (uint64_t word = words[i]; word; word &= word - 1) {
+                set(x + i * 64 + std::countr_zero(word), y + row, true);
+            }
+        }
+    }
+}
+
+Board SparseLife::extract(int64_t x, int64_t y, uint32_t width, uint32_t height) const {
+    Board board(width, height);
+    for (uint32_t row = 0; row != height; ++row) {
+        const int64_t cellY = y + row;
+        const Tile *cached = nullptr;
+        int64_t cachedTileX = 0;
+        for (uint32_t column = 0; column < width; ++column) {
+            const int64_t cellX = x + column, tileX = cellX >> tileShift;
+            if (!cached || tileX != cachedTileX) {
+                cached = findTile(tileX, cellY >> tileShift);
+                cachedTileX = tileX;
+                if (!cached) {
+                    // Skip to the next tile.
+                    column += uint32_t(((tileX + 1) << tileShift) - cellX - 1);
+                    continue;
+                }
+            }
+            if ((cached->rows[generationCount & 1][cellY & (tileSize - 1)] >> (cellX & (tileSize - 1))) & 1) {
+                board.set(column, row, true);
+            }
+        }
+    }
+    return board;
+}
+
+std::vector<Cell> SparseLife::cells() const {
+    std::vector<Cell> result;
+    for (const auto &[key, tile] : tiles) {
+        for (int row = 0; row != tileRows; ++row) {
+            for (uint64_t word = tile.rows[generationCount & 1][row]; word; word &= word - 1) {
+                result.push_back({ int64_t(tile.x) * tileSize + std::countr_zero(word), int64_t(tile.y) * tileSize + row });
+            }
+        }
+    }
+    return result;
+}
+
+size_t SparseLife::population() const {
+    size_t count = 0;
+    for (const auto &[key, tile] : tiles) {
+        for (auto word : tile.rows[generationCount & 1]) {
+            count += std::popcount(word);
+        }
+    }
+    return count;
+}
+
+void SparseLife::step() {
+    const uint64_t current = generationCount & 1, next = current ^ 1;
+
+    // Cells on the edge of a changed tile can give birth in a neighbouring tile that doesn't exist yet.
+    const size_t changedCount = activeTiles.size();
+    for (size_t i = 0; i != changedCount; ++i) {
+        const Tile &changed = *activeTiles[i];
+        uint64_t westColumn = 0, eastColumn = 0;
+        for (auto word : changed.rows[current]) {
+            westColumn |= word & 1;
+            eastColumn |= word >> 63;
+        }
+        const uint64_t north = changed.rows[current][0], south = changed.rows[current][tileRows - 1];
+        const bool edges[9] = {
+            bool(north & 1), north != 0, bool(north >> 63),
+            westColumn != 0, false, eastColumn != 0,
+            bool(south & 1), south != 0, bool(south >> 63),
+        };
+        for (int neighbour = 0; neighbour != 9; ++neighbour) {
+            if (edges[neighbour]) {
+                tile(int64_t(changed.x) + neighbour % 3 - 1, int64_t(changed.y) + neighbour / 3 - 1);
+            }
+        }
+    }
+
+    // A tile can only differ from two generations ago if something in its neighbourhood did, so every other tile's next generation is already in its other buffer.
+    struct Candidate {
+        Tile *tile;
+        const uint64_t *neighbours[9];
+    };
+    const uint64_t stamp = generationCount + 1;
+    std::vector<Candidate> candidates;
+    for (Tile *changed : activeTiles) {
+        for (int neighbour = 0; neighbour != 9; ++neighbour) {
+            Tile *candidate = findTile(int64_t(changed->x) + neighbour % 3 - 1, int64_t(changed->y) + neighbour / 3 - 1);
+            if (!candidate || candidate->visited == stamp) {
+                continue;
+            }
+            candidate->visited = stamp;
+            Candidate entry = { .tile = candidate, .neighbours = {} };
+            for (int around = 0; around != 9; ++around) {
+                const Tile *found = around == 4 ? candidate : findTile(int64_t(candidate->x) + around % 3 - 1, int64_t(candidate->y) + around / 3 - 1);
+                entry.neighbours[around] = found ? found->rows[current] : emptyRows;
+            }
+            candidates.push_back(entry);
+        }
+    }
+
+    parallel::parallelFor(candidates.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i != end; ++i) {
+            Tile &target = *candidates[i].tile;
+#if defined(__x86_64__)
+            if (hasAVX2) {
+                stepTileAVX2(candidates[i].neighbours, target.next, currentRule);
+            }
+            else
+#endif
+            {
+                stepTile(candidates[i].neighbours, target.next, currentRule);
+            }
+            target.changed = std::memcmp(target.next, target.rows[next], sizeof(target.next)) != 0;
+            if (target.changed) {
+                std::memcpy(target.rows[next], target.next, sizeof(target.next));
+            }
+        }
+    });
+
+    for (Tile *changed : activeTiles) {
+        changed->active = false;
+    }
+    activeTiles.clear();
+    for (const Candidate &candidate : candidates) {
+        Tile &target = *candidate.tile;
+        if (target.changed || target.edited) {
+            activate(target);
+        }
+        target.edited = false;
+    }
+    // Empty tiles that settled are dropped; they come back if a neighbour grows into them.
+    for (const Candidate &candidate : candidates) {
+        const Tile &target = *candidate.tile;
+        if (!target.active && std::memcmp(target.rows[0], emptyRows, sizeof(emptyRows)) == 0 && std::memcmp(target.rows[1], emptyRows, sizeof(emptyRows)) == 0) {
+            tiles.erase(key(target.x, target.y));
+        }
+    }
+    ++generationCount;
+}
+
+void SparseLife::run(uint64_t generations) {
+    for (uint64_t generation = 0; generation != generations; ++generation) {
+        step();
+    }
+}
+
+}
@@ -0,0 +1,277 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace trace {
+
+namespace detail {
+
+std::atomic<bool> active { false };
+
+uint64_t now() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}
+
+namespace {
+
+enum class Kind : uint32_t {
+    zone,
+    count,
+    frame,
+};
+
+struct Event {
+    const char *name;
+    uint64_t start;
+    // The zone's end, or the counter's delta.
+    int64_t value;
+    Kind kind;
+};
+
+// One thread's events. Only the owning thread writes `events` and `head`; readers take `head` with acquire and read behind it.
+struct Ring {
+    explicit Ring(uint32_t thread) : thread(thread), events(new Event[eventsPerThread]) {
+    }
+
+    void push(const Event &event) {
+        const uint64_t index = head.load(std::memory_order_relaxed);
+        events[index % eventsPerThread] = event;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    const uint32_t thread;
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> head { 0 };
+    // `head` when `clear` was last called; events before it are ignored.
+    std::atomic<uint64_t> cleared { 0 };
+};
+
+// Every thread's ring, kept for the life of the process so events outlive the threads that recorded them.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::atomic<uint64_t> origin { 0 };
+};
+
+// Never destroyed, so threads still recording during static destruction don't write into freed rings.
+Registry &registry() {
+    static Registry *shared = new Registry();
+    return *shared;
+}
+
+thread_local Ring *threadRing = nullptr;
+
+Ring &ring() {
+    if (!threadRing) {
+        Registry &shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.rings.push_back(std::make_unique<Ring>(uint32_t(shared.rings.size())));
+        threadRing = shared.rings.back().get();
+    }
+    return *threadRing;
+}
+
+}
+
+namespace detail {
+
+void recordZone(const char *name, uint64_t start, uint64_t end) {
+    ring().push({ name, start, int64_t(end), Kind::zone });
+}
+
+void recordCount(const char *name, int64_t delta) {
+    ring().push({ name, now(), delta, Kind::count });
+}
+
+}
+
+void setEnabled(bool enabled) {
+    if (enabled) {
+        uint64_t unset = 0;
+        registry().origin.compare_exchange_strong(unset, detail::now());
+    }
+    detail::active.store(enabled, std::memory_order_relaxed);
+}
+
+void clear() {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (const auto &ring : shared.rings) {
+        ring->cleared.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+void frame() {
+    if (enabled()) {
+        ring().push({ "frame", detail::now(), 0, Kind::frame });
+    }
+}
+
+Capture capture() {
+    Registry &shared = registry();
+    const uint64_t origin = shared.origin.load();
+    const auto since = [origin](uint64_t time) {
+        return time > origin ? time - origin : 0;
+    };
+    Capture result;
+    // Counter and frame events from every thread, to be merged in time order.
+    std::vector<std::pair<const Event *, uint32_t>> marks;
+    std::vector<std::vector<Event>> copies;
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        copies.resize(shared.rings.size());
+        for (const auto &ring : shared.rings) {
+            const uint64_t cleared = ring->cleared.load(std::memory_order_relaxed);
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = std::max(cleared, head > eventsPerThread ? head - eventsPerThread : 0);
+            std::vector<Event> &copy = copies[ring->thread];
+            for (uint64_t index = first; index < head; ++index) {
+                copy.push_back(ring->events[index % eventsPerThread]);
+            }
+            // Anything the owner overwrote while we copied is unreliable; drop it.
+            const uint64_t after = ring->head.load(std::memory_order_acquire);
+            const uint64_t overwritten = after > eventsPerThread ? after - eventsPerThread : 0;
+            if (overwritten > first) {
+                copy.erase(copy.begin(), copy.begin() + std::min<ptrdiff_t>(ptrdiff_t(overwritten - first), ptrdiff_t(copy.size())));
+                first = overwritten;
+            }
+            result.dropped += first - cleared;
+        }
+    }
+    for (uint32_t thread = 0; thread < copies.size(); ++thread) {
+        for (const Event &event : copies[thread]) {
+            if (event.kind == Kind::zone) {
+                result.zones.push_back({ event.name, thread, since(event.start), uint64_t(event.value) - event.start });
+            }
+            else {
+                marks.push_back({ &event, thread });
+            }
+        }
+    }
+    std::stable_sort(result.zones.begin(), result.zones.end(), [](const ZoneRecord &a, const ZoneRecord &b) {
+        return a.start < b.start;
+    });
+    std::stable_sort(marks.begin(), marks.end(), [](const auto &a, const auto &b) {
+        return a.first->start < b.first->start;
+    });
+
+    // Counters are matched by name rather than by pointer, since the same literal may have a different address in every translation unit.
+    std::map<std::string_view, std::pair<const char *, int64_t>> totals;
+    bool unfinished = false;
+    uint64_t latest = 0;
+    for (const auto &[event, thread] : marks) {
+        latest = event->start;
+        if (event->kind == Kind::count) {
+            auto &total = totals.try_emplace(event->name, event->name, 0).first->second;
+            total.second += event->value;
+            unfinished = true;
+            continue;
+        }
+        for (auto &[key, total] : totals) {
+            result.counters.push_back({ total.first, result.frames.size(), since(event->start), total.second });
+            total.second = 0;
+        }
+        result.frames.push_back(since(event->start));
+        unfinished = false;
+    }
+    if (unfinished) {
+        for (const auto &[key, total] : totals) {
+            result.counters.push_back({ total.first, result.frames.size(), since(latest), total.second });
+        }
+    }
+    return result;
+}
+
+// MARK: - Chrome trace
+
+namespace {
+
+void appendString(std::string &json, const char *string) {
+    json += '"';
+    for (const char *character = string; *character; ++character) {
+        if (*character == '"' || *character == '\\') {
+            json += '\\';
+        }
+        json += uint8_t(*character) < 0x20 ? ' ' : *character;
+    }
+    json += '"';
+}
+
+// Chrome trace timestamps are in microseconds.
+void appendTime(std::string &json, uint64_t nanoseconds) {
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "%llu.%03llu", (unsigned long long)(nanoseconds / 1000), (unsigned long long)(nanoseconds % 1000));
+    json += buffer;
+}
+
+}
+
+std::string chromeTrace() {
+    const Capture trace = capture();
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const auto begin = [&](const char *name, const char *phase, uint32_t thread) {
+        json += first ? "\n" : ",\n";
+        first = false;
+        json += "{\"name\":";
+        appendString(json, name);
+        json += ",\"ph\":\"";
+        json += phase;
+        json += "\",\"pid\":1,\"tid\":" + std::to_string(thread);
+    };
+    uint32_t threads = 0;
+    for (const ZoneRecord &zone : trace.zones) {
+        threads = std::max(threads, zone.thread + 1);
+    }
+    for (uint32_t thread = 0; thread < threads; ++thread) {
+        begin("thread_name", "M", thread);
+        json += ",\"args\":{\"name\":\"thread " + std::to_string(thread) + "\"}}";
+    }
+    for (const ZoneRecord &zone : trace.zones) {
+        begin(zone.name, "X", zone.thread);
+        json += ",\"ts\":";
+        appendTime(json, zone.start);
+        json += ",\"dur\":";
+        appendTime(json, zone.duration);
+        json += '}';
+    }
+    for (uint64_t time : trace.frames) {
+        begin("frame", "i", 0);
+        json += ",\"s\":\"g\",\"ts\":";
+        appendTime(json, time);
+        json += '}';
+    }
+    for (const CounterRecord &counter : trace.counters) {
+        begin(counter.name, "C", 0);
+        json += ",\"ts\":";
+        appendTime(json, counter.time);
+        json += ",\"args\":{\"value\":" + std::to_string(counter.total) + "}}";
+    }
+    json += "\n],\"otherData\":{\"droppedEvents\":" + std::to_string(trace.dropped) + "}}\n";
+    return json;
+}
+
+bool writeChromeTrace(const std::string &path, std::string &error) {
+    const std::string json = chromeTrace();
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        error = "cannot write " + path;
+        return false;
+    }
+    const bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+    if (fclose(file) != 0 || !written) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+}
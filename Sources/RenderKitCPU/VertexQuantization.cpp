@@ -0,0 +1,155 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Half.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace quantization {
+
+namespace {
+
+// What vertex fetch makes of the stored formats.
+float unorm16(uint16_t value) {
+    return float(value) / 65535.0f;
+}
+
+float snorm16(int16_t value) {
+    return std::max(float(value) / 32767.0f, -1.0f);
+}
+
+uint16_t toUnorm16(float value, float origin, float scale) {
+    if (!(scale > 0)) {
+        return 0;
+    }
+    // fmax first so that NaN becomes 0.
+    const float t = std::fmin(std::fmax((value - origin) / scale, 0.0f), 1.0f);
+    return uint16_t(t * 65535.0f + 0.5f);
+}
+
+// The octahedral map: the normal projected onto the octahedron |x| + |y| + |z| = 1, with the lower half folded out over the corners.
+void project(const float normal[3], float encoded[2]) {
+    const float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    if (!(sum > 0)) {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+    const float x = normal[0] / sum, y = normal[1] / sum;
+    if (normal[2] >= 0) {
+        encoded[0] = x;
+        encoded[1] = y;
+    }
+    else {
+        encoded[0] = (1 - std::fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+        encoded[1] = (1 - std::fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+    }
+}
+
+}
+
+Bounds bounds(const SimpleVertex *vertices, size_t count) {
+    Bounds result = {};
+    if (count == 0) {
+        return result;
+    }
+    float minimum[3], maximum[3];
+    for (int axis = 0; axis != 3; ++axis) {
+        minimum[axis] = maximum[axis] = vertices[0].position[axis];
+    }
+    for (size_t index = 1; index != count; ++index) {
+        for (int axis = 0; axis != 3; ++axis) {
+            minimum[axis] = std::min(minimum[axis], vertices[index].position[axis]);
+            maximum[axis] = std::max(maximum[axis], vertices[index].position[axis]);
+        }
+    }
+    for (int axis = 0; axis != 3; ++axis) {
+        result.origin[axis] = minimum[axis];
+        result.scale[axis] = maximum[axis] - minimum[axis];
+    }
+    return result;
+}
+
+void encodeNormal(const float normal[3], int16_t encoded[2]) {
+    float projected[2];
+    project(normal, projected);
+    const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (!(length > 0) || !std::isfinite(length)) {
+        encoded[0] = int16_t(std::lround(projected[0] * 32767.0f));
+        encoded[1] = int16_t(std::lround(projected[1] * 32767.0f));
+        return;
+    }
+    const float unit[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+    const float base[2] = { std::floor(projected[0] * 32767.0f), std::floor(projected[1] * 32767.0f) };
+    float bestDot = -2;
+    for (int candidate = 0; candidate != 4; ++candidate) {
+        const int16_t trial[2] = {
+            int16_t(std::clamp(base[0] + float(candidate & 1), -32767.0f, 32767.0f)),
+            int16_t(std::clamp(base[1] + float(candidate >> 1), -32767.0f, 32767.0f)),
+        };
+        float decoded[3];
+        decodeNormal(trial, decoded);
+        const float dot = decoded[0] * unit[0] + decoded[1] * unit[1] + decoded[2] * unit[2];
+        if (dot > bestDot) {
+            bestDot = dot;
+            encoded[0] = trial[0];
+            encoded[1] = trial[1];
+        }
+    }
+}
+
+void decodeNormal(const int16_t encoded[2], float normal[3]) {
+    float x = snorm16(encoded[0]), y = snorm16(encoded[1]);
+    const float z = 1 - std::fabs(x) - std::fabs(y);
+    const float t = std::fmin(std::fmax(-z, 0.0f), 1.0f);
+    x += x >= 0 ? -t : t;
+    y += y >= 0 ? -t : t;
+    const float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+QuantizedVertex quantize(const SimpleVertex &vertex, const Bounds &bounds) {
+    QuantizedVertex result = {};
+    for (int axis = 0; axis != 3; ++axis) {
+        result.position[axis] = toUnorm16(vertex.position[axis], bounds.origin[axis], bounds.scale[axis]);
+    }
+    encodeNormal(vertex.normal, result.normal);
+    result.textureCoordinate[0] = half::fromFloat(vertex.textureCoordinate[0]);
+    result.textureCoordinate[1] = half::fromFloat(vertex.textureCoordinate[1]);
+    return result;
+}
+
+SimpleVertex dequantize(const QuantizedVertex &vertex, const Bounds &bounds) {
+    SimpleVertex result;
+    for (int axis = 0; axis != 3; ++axis) {
+        result.position[axis] = bounds.origin[axis] + bounds.scale[axis] * unorm16(vertex.position[axis]);
+    }
+    decodeNormal(vertex.normal, result.normal);
+    result.textureCoordinate[0] = half::toFloat(vertex.textureCoordinate[0]);
+    result.textureCoordinate[1] = half::toFloat(vertex.textureCoordinate[1]);
+    return result;
+}
+
+void quantize(const SimpleVertex *input, QuantizedVertex *output, size_t count, const Bounds &bounds) {
+    const trace::Zone zone("quantization.quantize");
+    parallel::parallelFor(count, 16384, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            output[index] = quantize(input[index], bounds);
+        }
+    });
+}
+
+void dequantize(const QuantizedVertex *input, SimpleVertex *output, size_t count, const Bounds &bounds) {
+    const trace::Zone zone("quantization.dequantize");
+    parallel::parallelFor(count, 16384, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            output[index] = dequantize(input[index], bounds);
+        }
+    });
+}
+
+}
@@ -0,0 +1,283 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace textures {
+
+namespace {
+
+constexpr uint32_t none = 0xFFFFFFFF;
+constexpr uint32_t maximumSlots = 0xFFFF;
+
+}
+
+// MARK: - Setup
+
+bool VirtualTexture::open(const std::vector<KTXFile> &tiles, uint32_t gridWidth, uint32_t gridHeight, uint32_t newPageSize, uint32_t pageBudget) {
+    message.clear();
+    if (tiles.empty() || size_t(gridWidth) * gridHeight != tiles.size()) {
+        message = "the grid does not match the number of tiles";
+        return false;
+    }
+    const KTXFile &first = tiles.front();
+    for (const KTXFile &tile : tiles) {
+        if (tile.version() == 0 || tile.format() != first.format() || tile.width() != first.width() || tile.height() != first.height() || tile.levelCount() != first.levelCount()) {
+            message = "tiles differ in format, size or levels";
+            return false;
+        }
+    }
+    block = first.blockFormat();
+    if (block.depth != 1 || newPageSize == 0 || newPageSize % block.width != 0 || newPageSize % block.height != 0) {
+        message = "the page size is not a whole number of blocks";
+        return false;
+    }
+    sources = tiles;
+    grid[0] = gridWidth;
+    grid[1] = gridHeight;
+    tileSize[0] = first.width();
+    tileSize[1] = first.height();
+    pageSize = newPageSize;
+
+    // Levels coarser than the first to fit in one page add nothing that page lacks.
+    levels = 0;
+    tilePages = 0;
+    bool single = false;
+    while (levels < first.levelCount() && !single) {
+        levelOffset[levels] = tilePages;
+        tilePages += pagesWide(levels) * pagesHigh(levels);
+        single = pagesWide(levels) * pagesHigh(levels) == 1;
+        ++levels;
+    }
+    if (!single) {
+        message = "the coarsest level does not fit in one page";
+        return false;
+    }
+    if (pageBudget < tiles.size() || pageBudget > maximumSlots) {
+        message = "the page budget must hold one page per tile and fewer than 65536 pages";
+        return false;
+    }
+    if (double(tilePages) * double(tiles.size()) >= double(none)) {
+        message = "too many pages";
+        return false;
+    }
+
+    slotColumns = uint32_t(std::ceil(std::sqrt(double(pageBudget))));
+    slotRows = (pageBudget + slotColumns - 1) / slotColumns;
+    frame = 0;
+    const size_t pageCount = size_t(tilePages) * tiles.size();
+    pageSlot.assign(pageCount, none);
+    pageFrame.assign(pageCount, 0);
+    pendingIndex.assign(pageCount, none);
+    slotPage.assign(pageBudget, none);
+    table.assign(pageCount, none);
+    pending.clear();
+    staging.clear();
+    return true;
+}
+
+uint32_t VirtualTexture::pagesWide(uint32_t level) const {
+    return (std::max(tileSize[0] >> level, 1u) + pageSize - 1) / pageSize;
+}
+
+uint32_t VirtualTexture::pagesHigh(uint32_t level) const {
+    return (std::max(tileSize[1] >> level, 1u) + pageSize - 1) / pageSize;
+}
+
+uint32_t VirtualTexture::pageIndex(uint32_t tile, uint32_t level, uint32_t pageX, uint32_t pageY) const {
+    return tile * tilePages + levelOffset[level] + pageY * pagesWide(level) + pageX;
+}
+
+// MARK: - Requests
+
+void VirtualTexture::beginFrame() {
+    ++frame;
+    for (const Request &request : pending) {
+        pendingIndex[request.page] = none;
+    }
+    pending.clear();
+    for (uint32_t tile = 0; tile != sources.size(); ++tile) {
+        requestPage(tile, levels - 1, 0, 0, -1);
+    }
+}
+
+uint32_t VirtualTexture::levelFor(float texelsPerPixel) const {
+    if (levels == 0 || !(texelsPerPixel > 1)) {
+        return 0;
+    }
+    return std::min(uint32_t(std::log2(texelsPerPixel)), levels - 1);
+}
+
+void VirtualTexture::request(float uMin, float vMin, float uMax, float vMax, uint32_t level) {
+    if (levels == 0) {
+        return;
+    }
+    if (uMin > uMax) {
+        request(uMin, vMin, 1, vMax, level);
+        request(0, vMin, uMax, vMax, level);
+        return;
+    }
+    uMin = std::clamp(uMin, 0.0f, 1.0f);
+    uMax = std::clamp(uMax, 0.0f, 1.0f);
+    vMin = std::clamp(vMin, 0.0f, 1.0f);
+    vMax = std::clamp(vMax, 0.0f, 1.0f);
+    if (!(uMin <= uMax && vMin <= vMax)) {
+        return;
+    }
+    level = std::min(level, levels - 1);
+    const float centreU = (uMin + uMax) / 2, centreV = (vMin + vMax) / 2;
+    const uint32_t firstTileX = std::min(uint32_t(uMin * float(grid[0])), grid[0] - 1), lastTileX = std::min(uint32_t(uMax * float(grid[0])), grid[0] - 1);
+    const uint32_t firstTileY = std::min(uint32_t(vMin * float(grid[1])), grid[1] - 1), lastTileY = std::min(uint32_t(vMax * float(grid[1])), grid[1] - 1);
+    for (uint32_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+        for (uint32_t tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            const float left = std::clamp(uMin * float(grid[0]) - float(tileX), 0.0f, 1.0f), right = std::clamp(uMax * float(grid[0]) - float(tileX), 0.0f, 1.0f);
+            const float top = std::clamp(vMin * float(grid[1]) - float(tileY), 0.0f, 1.0f), bottom = std::clamp(vMax * float(grid[1]) - float(tileY), 0.0f, 1.0f);
+            for (uint32_t pageLevel = level; pageLevel != levels; ++pageLevel) {
+                const float texelsWide = float(std::max(tileSize[0] >> pageLevel, 1u)), texelsHigh = float(std::max(tileSize[1] >> pageLevel, 1u));
+                const uint32_t lastX = pagesWide(pageLevel) - 1, lastY = pagesHigh(pageLevel) - 1;
+                const uint32_t x0 = std::min(uint32_t(left * texelsWide / float(pageSize)), lastX), x1 = std::min(uint32_t(right * texelsWide / float(pageSize)), lastX);
+                const uint32_t y0 = std::min(uint32_t(top * texelsHigh / float(pageSize)), lastY), y1 = std::min(uint32_t(bottom * texelsHigh / float(pageSize)), lastY);
+                for (uint32_t pageY = y0; pageY <= y1; ++pageY) {
+                    for (uint32_t pageX = x0; pageX <= x1; ++pageX) {
+                        const float u = (float(tileX) + (float(pageX) + 0.5f) * float(pageSize) / texelsWide) / float(grid[0]);
+                        const float v = (float(tileY) + (float(pageY) + 0.5f) * float(pageSize) / texelsHigh) / float(grid[1]);
+                        requestPage(tileY * grid[0] + tileX, pageLevel, pageX, pageY, std::hypot(u - centreU, v - centreV));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VirtualTexture::requestPage(uint32_t tile, uint32_t level, uint32_t pageX, uint32_t pageY, float distance) {
+    const uint32_t page = pageIndex(tile, level, pageX, pageY);
+    pageFrame[page] = frame;
+    if (pageSlot[page] != none) {
+        return;
+    }
+    if (pendingIndex[page] != none) {
+        Request &request = pending[pendingIndex[page]];
+        request.distance = std::min(request.distance, distance);
+        return;
+    }
+    pendingIndex[page] = uint32_t(pending.size());
+    pending.push_back({ .page = page, .level = level, .distance = distance });
+}
+
+// MARK: - Loading
+
+std::vector<PageUpload> VirtualTexture::update(size_t maximumPages) {
+    std::vector<PageUpload> uploads;
+    if (levels == 0 || pending.empty() || maximumPages == 0) {
+        return uploads;
+    }
+    std::sort(pending.begin(), pending.end(), [](const Request &a, const Request &b) {
+        return a.level != b.level ? a.level > b.level : a.distance < b.distance;
+    });
+
+    // Free slots first, then the least recently requested pages; pages requested this frame and the coarsest pages stay.
+    std::vector<uint32_t> candidates;
+    for (uint32_t slot = 0; slot != slotPage.size(); ++slot) {
+        const uint32_t page = slotPage[slot];
+        if (page == none || (pageFrame[page] < frame && page % tilePages != levelOffset[levels - 1])) {
+            candidates.push_back(slot);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+        const uint64_t frameA = slotPage[a] == none ? 0 : pageFrame[slotPage[a]] + 1;
+        const uint64_t frameB = slotPage[b] == none ? 0 : pageFrame[slotPage[b]] + 1;
+        return frameA < frameB;
+    });
+
+    const size_t count = std::min({ maximumPages, pending.size(), candidates.size() });
+    staging.resize(count * slotBytes());
+    std::vector<bool> dirty(sources.size(), false);
+    const uint32_t borderBlocksX = borderWidth() / block.width, borderBlocksY = borderHeight() / block.height;
+    for (size_t index = 0; index != count; ++index) {
+        const Request &request = pending[index];
+        const uint32_t slot = candidates[index];
+        if (slotPage[slot] != none) {
+            pageSlot[slotPage[slot]] = none;
+            dirty[slotPage[slot] / tilePages] = true;
+        }
+        const uint32_t tile = request.page / tilePages, level = request.level;
+        const uint32_t local = request.page % tilePages - levelOffset[level];
+        const uint32_t pageX = local % pagesWide(level), pageY = local / pagesWide(level);
+        const size_t offset = index * slotBytes();
+        sources[tile].copyBlocks(level, 0, 0, int32_t(pageX * pageSize / block.width) - int32_t(borderBlocksX), int32_t(pageY * pageSize / block.height) - int32_t(borderBlocksY), slotWidth() / block.width, slotHeight() / block.height, staging.data() + offset, slotBytesPerRow());
+        slotPage[slot] = request.page;
+        pageSlot[request.page] = slot;
+        pendingIndex[request.page] = none;
+        dirty[tile] = true;
+        uploads.push_back({ .slot = slot, .x = slot % slotColumns * slotWidth(), .y = slot / slotColumns * slotHeight(), .tile = tile, .level = level, .pageX = pageX, .pageY = pageY, .offset = offset });
+    }
+    pending.erase(pending.begin(), pending.begin() + ptrdiff_t(count));
+    for (uint32_t index = 0; index != pending.size(); ++index) {
+        pendingIndex[pending[index].page] = index;
+    }
+    for (uint32_t tile = 0; tile != sources.size(); ++tile) {
+        if (dirty[tile]) {
+            rebuildTable(tile);
+        }
+    }
+    return uploads;
+}
+
+// Coarse to fine, so each missing page can take its parent's entry.
+void VirtualTexture::rebuildTable(uint32_t tile) {
+    for (uint32_t level = levels; level-- != 0;) {
+        const uint32_t wide = pagesWide(level), high = pagesHigh(level);
+        for (uint32_t pageY = 0; pageY != high; ++pageY) {
+            for (uint32_t pageX = 0; pageX != wide; ++pageX) {
+                const uint32_t page = pageIndex(tile, level, pageX, pageY);
+                if (pageSlot[page] != none) {
+                    table[page] = pageSlot[page] | level << 16;
+                }
+                else if (level + 1 == levels) {
+                    table[page] = none;
+                }
+                else {
+                    table[page] = table[pageIndex(tile, level + 1, std::min(pageX >> 1, pagesWide(level + 1) - 1), std::min(pageY >> 1, pagesHigh(level + 1) - 1))];
+                }
+            }
+        }
+    }
+}
+
+// MARK: - Lookup
+
+bool VirtualTexture::translate(float u, float v, uint32_t level, float &atlasU, float &atlasV) const {
+    if (levels == 0 || !(u >= 0 && u <= 1 && v >= 0 && v <= 1)) {
+        return false;
+    }
+    const float gridU = u * float(grid[0]), gridV = v * float(grid[1]);
+    const uint32_t tileX = std::min(uint32_t(gridU), grid[0] - 1), tileY = std::min(uint32_t(gridV), grid[1] - 1);
+    const float localU = gridU - float(tileX), localV = gridV - float(tileY);
+    level = std::min(level, levels - 1);
+    uint32_t pageX = std::min(uint32_t(localU * float(std::max(tileSize[0] >> level, 1u)) / float(pageSize)), pagesWide(level) - 1);
+    uint32_t pageY = std::min(uint32_t(localV * float(std::max(tileSize[1] >> level, 1u)) / float(pageSize)), pagesHigh(level) - 1);
+    const uint32_t entry = table[pageIndex(tileY * grid[0] + tileX, level, pageX, pageY)];
+    if (entry == none) {
+        return false;
+    }
+    // Walk up to the resident level the way the table was built.
+    const uint32_t slot = entry & 0xFFFF, residentLevel = entry >> 16;
+    for (uint32_t parent = level + 1; parent <= residentLevel; ++parent) {
+        pageX = std::min(pageX >> 1, pagesWide(parent) - 1);
+        pageY = std::min(pageY >> 1, pagesHigh(parent) - 1);
+    }
+    const float texelsWide = float(std::max(tileSize[0] >> residentLevel, 1u)), texelsHigh = float(std::max(tileSize[1] >> residentLevel, 1u));
+    const float x = std::clamp(localU * texelsWide, 0.5f, texelsWide - 0.5f) - float(pageX * pageSize);
+    const float y = std::clamp(localV * texelsHigh, 0.5f, texelsHigh - 0.5f) - float(pageY * pageSize);
+    atlasU = (float(slot % slotColumns * slotWidth() + borderWidth()) + x) / float(atlasWidth());
+    atlasV = (float(slot / slotColumns * slotHeight() + borderHeight()) + y) / float(atlasHeight());
+    return true;
+}
+
+size_t VirtualTexture::residentPages() const {
+    return size_t(std::count_if(slotPage.begin(), slotPage.end(), [](uint32_t page) {
+        return page != none;
+    }));
+}
+
+}
@@ -0,0 +1,474 @@
+#include "VolumeRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include "BrickedVolume.h"
+#include "Parallel.h"
+#include "PreIntegration.h"
+
+namespace volume {
+
+namespace {
+
+constexpr uint32_t tileSize = 16;
+// Entries in the step length opacity correction table.
+constexpr size_t correctionSize = 4096;
+
+struct Vector {
+    float x, y, z;
+
+    float operator[](int axis) const {
+        return axis == 0 ? x : axis == 1 ? y : z;
+    }
+};
+
+Vector operator+(Vector a, Vector b) {
+    return { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+Vector operator-(Vector a, Vector b) {
+    return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+Vector operator*(Vector a, float scale) {
+    return { a.x * scale, a.y * scale, a.z * scale };
+}
+
+Vector cross(Vector a, Vector b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+Vector normalize(Vector a) {
+    const float length = std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+    return length > 0 ? a * (1 / length) : a;
+}
+
+// The first trilinear cell of a sample coordinate (voxel centres at integers, clamped to the edge) and the weight of the next voxel.
+struct Cell {
+    uint32_t index;
+    float fraction;
+};
+
+Cell cellOf(float coordinate, uint32_t size) {
+    if (size < 2) {
+        return { 0, 0 };
+    }
+    const float clamped = std::clamp(coordinate, 0.0f, float(size - 1));
+    const uint32_t index = std::min(uint32_t(clamped), size - 2);
+    return { index, clamped - float(index) };
+}
+
+// Trilinear filtering over a dense volume.
+struct DenseSampler {
+    const Volume &volume;
+    size_t rowStride;
+    size_t sliceStride;
+
+    explicit DenseSampler(const Volume &volume) : volume(volume), rowStride(volume.width), sliceStride(size_t(volume.width) * volume.height) {}
+
+    float sample(Cell x, Cell y, Cell z) const {
+        const size_t stepX = volume.width > 1 ? 1 : 0, stepY = volume.height > 1 ? rowStride : 0, stepZ = volume.depth > 1 ? sliceStride : 0;
+        const uint16_t *corner = volume.values + z.index * sliceStride + y.index * rowStride + x.index;
+        auto lerp = [](float a, float b, float t) {
+            return a + (b - a) * t;
+        };
+        auto row = [&](const uint16_t *values) {
+            return lerp(float(values[0]), float(values[stepX]), x.fraction);
+        };
+        const float front = lerp(row(corner), row(corner + stepY), y.fraction);
+        const float back = lerp(row(corner + stepZ), row(corner + stepZ + stepY), y.fraction);
+        return lerp(front, back, z.fraction);
+    }
+};
+
+// Trilinear filtering through a brick cache. Every cell lies inside one brick; the brick last read is kept, so the cache is only consulted when a ray crosses into another.
+struct BrickedSampler {
+    const BrickCache &cache;
+    uint32_t brickSize;
+    const uint32_t *brickDimensions;
+    size_t stride;
+    size_t current = SIZE_MAX;
+    const uint16_t *values = nullptr;
+
+    explicit BrickedSampler(const BrickCache &cache) : cache(cache), brickSize(cache.volume().brickSize()), brickDimensions(cache.volume().brickDimensions()), stride(brickSize + 1) {}
+
+    float sample(Cell x, Cell y, Cell z) {
+        const uint32_t brickX = x.index / brickSize, brickY = y.index / brickSize, brickZ = z.index / brickSize;
+        const size_t brick = (size_t(brickZ) * brickDimensions[1] + brickY) * brickDimensions[0] + brickX;
+        if (brick != current) {
+            current = brick;
+            values = cache.brick(brick);
+        }
+        // Bricks repeat the edge voxels, so the next voxel along each axis is always there.
+        const uint16_t *corner = values + (size_t(z.index - brickZ * brickSize) * stride + (y.index - brickY * brickSize)) * stride + (x.index - brickX * brickSize);
+        const size_t stepY = stride, stepZ = stride * stride;
+        auto lerp = [](float a, float b, float t) {
+            return a + (b - a) * t;
+        };
+        auto row = [&](const uint16_t *values) {
+            return lerp(float(values[0]), float(values[1]), x.fraction);
+        };
+        const float front = lerp(row(corner), row(corner + stepY), y.fraction);
+        const float back = lerp(row(corner + stepZ), row(corner + stepZ + stepY), y.fraction);
+        return lerp(front, back, z.fraction);
+    }
+};
+
+// Per ray constants: the ray in sample coordinates, s(t) = origin + t * direction, and the t range inside the volume.
+struct Ray {
+    float origin[3];
+    float direction[3];
+    float near;
+    float far;
+};
+
+// Everything `march` needs that does not change across a render.
+struct Marcher {
+    const TransferFunction &transferFunction;
+    const uint32_t *size;
+    uint32_t brickSize;
+    const uint32_t *brickDimensions;
+    // One byte per brick, nonzero where the transfer function makes every value the brick holds transparent. Empty to march every sample.
+    const std::vector<uint8_t> &emptyBricks;
+    float inverseMaxValue;
+    // The shader's per slice opacity factor, alpha / instanceCount.
+    float sliceAlpha;
+    std::vector<float> correction;
+    // Classifies segments between samples instead of single samples when set; `step` is then its segment length.
+    const PreIntegratedTable *table;
+    float step;
+    float opacityThreshold;
+
+    // 1 - (1 - alpha)^exponent: the opacity of one step of length `step` through material that is `alpha` opaque per reference slice.
+    float correctedAlpha(float alpha) const {
+        const float position = std::min(alpha, 1.0f) * float(correctionSize - 1);
+        const size_t index = std::min(size_t(position), correctionSize - 2);
+        return correction[index] + (correction[index + 1] - correction[index]) * (position - float(index));
+    }
+
+    size_t brickOf(const Cell *cells) const {
+        return (size_t(cells[2].index / brickSize) * brickDimensions[1] + cells[1].index / brickSize) * brickDimensions[0] + cells[0].index / brickSize;
+    }
+
+    // The ray parameter at which the ray leaves the brick holding `cells`. The outermost bricks extend to infinity, since coordinates beyond the volume clamp into them.
+    float brickExit(const Ray &ray, const Cell *cells) const {
+        float exit = std::numeric_limits<float>::infinity();
+        for (int axis = 0; axis != 3; ++axis) {
+            const uint32_t brick = cells[axis].index / brickSize;
+            float bound;
+            if (ray.direction[axis] > 0 && brick + 1 < brickDimensions[axis]) {
+                bound = float((brick + 1) * brickSize);
+            }
+            else if (ray.direction[axis] < 0 && brick > 0) {
+                bound = float(brick * brickSize);
+            }
+            else {
+                continue;
+            }
+            exit = std::min(exit, (bound - ray.origin[axis]) / ray.direction[axis]);
+        }
+        return exit;
+    }
+
+    // Front to back compositing of premultiplied colour.
+    template <typename Sampler>
+    void march(Sampler &sampler, const Ray &ray, float *rgba, RenderStatistics &statistics) const {
+        float color[4] = { 0, 0, 0, 0 };
+        // The normalized value at the previous sample, negative when it was not taken.
+        float front = -1;
+        // The tolerance keeps rounding from adding a sample past the far side.
+        const uint64_t stepCount = uint64_t(std::max(0.0f, std::ceil((ray.far - ray.near) / step - 1e-3f)));
+        for (uint64_t index = 0; index < stepCount; ++index) {
+            const float t = ray.near + (float(index) + 0.5f) * step;
+            Cell cells[3];
+            for (int axis = 0; axis != 3; ++axis) {
+                cells[axis] = cellOf(ray.origin[axis] + t * ray.direction[axis], size[axis]);
+            }
+            // The index of the first sample past the brick holding `cells`, moving on by at least one.
+            auto exitIndex = [&] {
+                const float next = std::ceil((brickExit(ray, cells) - ray.near) / step - 0.5f);
+                return next >= float(stepCount) ? stepCount : std::max(index + 1, uint64_t(std::max(next, 0.0f)));
+            };
+            const bool empty = !emptyBricks.empty() && emptyBricks[brickOf(cells)];
+            // A segment from a sample outside an empty brick can still cross opaque values, so pre-integration takes the first sample inside.
+            const bool entering = empty && table && front >= 0;
+            if (empty && !entering) {
+                const uint64_t resume = exitIndex();
+                statistics.skippedSamples += resume - index;
+                index = resume - 1;
+                front = -1;
+                continue;
+            }
+            ++statistics.samples;
+            const float value = sampler.sample(cells[0], cells[1], cells[2]) * inverseMaxValue;
+            float sample[4];
+            if (table) {
+                if (front < 0) {
+                    // The previous sample was skipped (or this is the first): take it now for the segment's front.
+                    Cell previous[3];
+                    for (int axis = 0; axis != 3; ++axis) {
+                        previous[axis] = cellOf(ray.origin[axis] + (t - step) * ray.direction[axis], size[axis]);
+                    }
+                    front = sampler.sample(previous[0], previous[1], previous[2]) * inverseMaxValue;
+                }
+                table->sample(front, value, sample);
+                front = value;
+            }
+            else {
+                transferFunction.sample(value, sample);
+                sample[3] = correctedAlpha(sample[3] * sliceAlpha);
+                sample[0] *= sample[3];
+                sample[1] *= sample[3];
+                sample[2] *= sample[3];
+            }
+            if (sample[3] > 0) {
+                const float remaining = 1 - color[3];
+                for (int channel = 0; channel != 4; ++channel) {
+                    color[channel] += remaining * sample[channel];
+                }
+                if (color[3] >= opacityThreshold) {
+                    ++statistics.terminatedRays;
+                    break;
+                }
+            }
+            if (entering) {
+                const uint64_t resume = exitIndex();
+                statistics.skippedSamples += resume - index - 1;
+                front = resume > index + 1 ? -1 : front;
+                index = resume - 1;
+            }
+        }
+        std::copy_n(color, 4, rgba);
+    }
+};
+
+}
+
+// MARK: TransferFunction
+
+TransferFunction::TransferFunction(const uint8_t *rgba8, size_t count) : colors(std::max(count, size_t(1)) * 4, 0.0f) {
+    std::transform(rgba8, rgba8 + count * 4, colors.begin(), [](uint8_t value) { return float(value) / 255; });
+    rebuildPrefix();
+}
+
+TransferFunction::TransferFunction(const float *rgba, size_t count) : colors(std::max(count, size_t(1)) * 4, 0.0f) {
+    std::transform(rgba, rgba + count * 4, colors.begin(), [](float value) { return std::clamp(value, 0.0f, 1.0f); });
+    rebuildPrefix();
+}
+
+void TransferFunction::update(size_t first, size_t count, const uint8_t *rgba8) {
+    count = std::min(count, size() - std::min(first, size()));
+    std::transform(rgba8, rgba8 + count * 4, colors.begin() + first * 4, [](uint8_t value) { return float(value) / 255; });
+    rebuildPrefix();
+}
+
+void TransferFunction::rebuildPrefix() {
+    alphaPrefix.assign(size() + 1, 0);
+    for (size_t index = 0; index != size(); ++index) {
+        alphaPrefix[index + 1] = alphaPrefix[index] + colors[index * 4 + 3];
+    }
+}
+
+void TransferFunction::sample(float coordinate, float *rgba) const {
+    const Cell cell = cellOf(coordinate * float(size()) - 0.5f, uint32_t(size()));
+    const float *low = colors.data() + size_t(cell.index) * 4;
+    const float *high = size() > 1 ? low + 4 : low;
+    for (int channel = 0; channel != 4; ++channel) {
+        rgba[channel] = low[channel] + (high[channel] - low[channel]) * cell.fraction;
+    }
+}
+
+bool TransferFunction::isTransparent(float low, float high) const {
+    // Linear filtering reads the texels either side of each coordinate, so the range covers every texel that touches [low, high].
+    const Cell first = cellOf(low * float(size()) - 0.5f, uint32_t(size()));
+    const Cell last = cellOf(high * float(size()) - 0.5f, uint32_t(size()));
+    const size_t end = std::min(size_t(last.index) + 2, size());
+    return alphaPrefix[end] - alphaPrefix[first.index] <= 0;
+}
+
+// MARK: Renderer
+
+Renderer::Renderer(const Volume &volume, uint32_t brickSize) : source(volume), bricks(std::max(brickSize, 1u)) {
+    const uint32_t size[3] = { volume.width, volume.height, volume.depth };
+    // Bricks tile the trilinear cells, so each covers voxels [brick * brickSize, (brick + 1) * brickSize] inclusive.
+    for (int axis = 0; axis != 3; ++axis) {
+        dimensions[axis] = (std::max(size[axis], 2u) - 1 + bricks - 1) / bricks;
+    }
+    const size_t brickCount = size_t(dimensions[0]) * dimensions[1] * dimensions[2];
+    ranges.resize(brickCount * 2);
+    parallel::parallelFor(size_t(dimensions[2]), 1, [&](size_t begin, size_t end) {
+        for (size_t brickZ = begin; brickZ != end; ++brickZ) {
+            for (uint32_t brickY = 0; brickY != dimensions[1]; ++brickY) {
+                for (uint32_t brickX = 0; brickX != dimensions[0]; ++brickX) {
+                    uint16_t minimum = std::numeric_limits<uint16_t>::max(), maximum = 0;
+                    const uint32_t endX = std::min((brickX + 1) * bricks, size[0] - 1), endY = std::min((brickY + 1) * bricks, size[1] - 1), endZ = std::min(uint32_t(brickZ + 1) * bricks, size[2] - 1);
+                    for (uint32_t z = uint32_t(brickZ) * bricks; z <= endZ; ++z) {
+                        for (uint32_t y = brickY * bricks; y <= endY; ++y) {
+                            const uint16_t *row = volume.values + (size_t(z) * size[1] + y) * size[0];
+                            const auto [low, high] = std::minmax_element(row + brickX * bricks, row + endX + 1);
+                            minimum = std::min(minimum, *low);
+                            maximum = std::max(maximum, *high);
+                        }
+                    }
+                    const size_t brick = (brickZ * dimensions[1] + brickY) * dimensions[0] + brickX;
+                    ranges[brick * 2] = minimum;
+                    ranges[brick * 2 + 1] = maximum;
+                }
+            }
+        }
+    });
+}
+
+Renderer::Renderer(const BrickCache &cache) : cache(std::make_shared<const BrickCache>(cache)), bricks(cache.volume().brickSize()) {
+    const BrickedVolume &bricked = cache.volume();
+    source = { .values = nullptr, .width = bricked.size()[0], .height = bricked.size()[1], .depth = bricked.size()[2], .spacing = { bricked.spacing()[0], bricked.spacing()[1], bricked.spacing()[2] } };
+    std::copy_n(bricked.brickDimensions(), 3, dimensions);
+    ranges.resize(bricked.brickCount() * 2);
+    for (size_t brick = 0; brick != bricked.brickCount(); ++brick) {
+        ranges[brick * 2] = bricked.brickRecord(brick).minimum;
+        ranges[brick * 2 + 1] = bricked.brickRecord(brick).maximum;
+    }
+}
+
+RenderStatistics Renderer::render(const TransferFunction &transferFunction, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options) const {
+    return renderRays(transferFunction, nullptr, uniforms, camera, width, height, rgba, options);
+}
+
+RenderStatistics Renderer::render(const TransferFunction &transferFunction, const PreIntegratedTable &table, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options) const {
+    return renderRays(transferFunction, &table, uniforms, camera, width, height, rgba, options);
+}
+
+RenderStatistics Renderer::renderRays(const TransferFunction &transferFunction, const PreIntegratedTable *table, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options) const {
+    const uint32_t size[3] = { source.width, source.height, source.depth };
+    float physical[3], largest = 0;
+    int longestAxis = 0;
+    for (int axis = 0; axis != 3; ++axis) {
+        physical[axis] = float(size[axis]) * source.spacing[axis];
+        if (physical[axis] > largest) {
+            largest = physical[axis];
+            longestAxis = axis;
+        }
+    }
+    float extent[3], scale[3];
+    for (int axis = 0; axis != 3; ++axis) {
+        extent[axis] = physical[axis] / largest;
+        scale[axis] = float(size[axis]) / extent[axis];
+    }
+
+    const float maxValue = std::max(float(uniforms.maxValue), 1.0f);
+    const float referenceSlices = std::max(float(uniforms.instanceCount), 1.0f);
+    std::vector<uint8_t> emptyBricks;
+    if (options.skipEmptySpace) {
+        emptyBricks.resize(ranges.size() / 2);
+        for (size_t brick = 0; brick != emptyBricks.size(); ++brick) {
+            emptyBricks[brick] = uniforms.alpha <= 0 || transferFunction.isTransparent(float(ranges[brick * 2]) / maxValue, float(ranges[brick * 2 + 1]) / maxValue);
+        }
+    }
+    Marcher marcher = {
+        .transferFunction = transferFunction,
+        .size = size,
+        .brickSize = bricks,
+        .brickDimensions = dimensions,
+        .emptyBricks = emptyBricks,
+        .inverseMaxValue = 1 / maxValue,
+        .sliceAlpha = std::max(uniforms.alpha, 0.0f) / referenceSlices,
+        .correction = std::vector<float>(correctionSize),
+        .table = table,
+        .step = table ? std::max(table->segmentLength(), 1e-6f) : std::max(options.stepSize, 1e-3f) / float(size[longestAxis]),
+        .opacityThreshold = options.opacityThreshold,
+    };
+    // The slice renderer blends `instanceCount` slices across the unit cube, one every 1 / instanceCount.
+    const double exponent = double(marcher.step) * referenceSlices;
+    for (size_t index = 0; index != correctionSize; ++index) {
+        const double alpha = double(index) / double(correctionSize - 1);
+        marcher.correction[index] = float(1 - std::pow(1 - alpha, exponent));
+    }
+
+    const Vector position = { camera.position[0], camera.position[1], camera.position[2] };
+    const Vector forward = normalize(Vector { camera.target[0], camera.target[1], camera.target[2] } - position);
+    const Vector right = normalize(cross(forward, { camera.up[0], camera.up[1], camera.up[2] }));
+    const Vector up = cross(right, forward);
+    const float aspect = float(width) / float(std::max(height, 1u));
+    const bool orthographic = camera.fieldOfView <= 0;
+    const float halfHeight = orthographic ? camera.orthographicHeight / 2 : std::tan(camera.fieldOfView / 2);
+
+    if (cache) {
+        const float direction[3] = { forward.x, forward.y, forward.z };
+        cache->prefetch(camera.position, direction, [&](size_t brick) { return emptyBricks.empty() || !emptyBricks[brick]; });
+    }
+
+    const uint32_t tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+    std::vector<RenderStatistics> tileStatistics(size_t(tilesX) * tilesY);
+    parallel::parallelFor(tileStatistics.size(), 1, [&](size_t begin, size_t end) {
+        DenseSampler denseSampler(source);
+        std::optional<BrickedSampler> brickedSampler;
+        if (cache) {
+            brickedSampler.emplace(*cache);
+        }
+        for (size_t tile = begin; tile != end; ++tile) {
+            RenderStatistics &statistics = tileStatistics[tile];
+            const uint32_t firstX = uint32_t(tile % tilesX) * tileSize, firstY = uint32_t(tile / tilesX) * tileSize;
+            for (uint32_t y = firstY; y != std::min(firstY + tileSize, height); ++y) {
+                for (uint32_t x = firstX; x != std::min(firstX + tileSize, width); ++x) {
+                    float *pixel = rgba + (size_t(y) * width + x) * 4;
+                    const float screenX = (2 * (float(x) + 0.5f) / float(width) - 1) * aspect * halfHeight;
+                    const float screenY = (1 - 2 * (float(y) + 0.5f) / float(height)) * halfHeight;
+                    const Vector offset = right * screenX + up * screenY;
+                    const Vector origin = orthographic ? position + offset : position;
+                    const Vector direction = orthographic ? forward : normalize(forward + offset);
+
+                    ++statistics.rays;
+                    Ray ray = { .origin = {}, .direction = {}, .near = 0, .far = std::numeric_limits<float>::infinity() };
+                    for (int axis = 0; axis != 3; ++axis) {
+                        const float inverse = 1 / direction[axis];
+                        float entry = (0 - origin[axis]) * inverse, exit = (extent[axis] - origin[axis]) * inverse;
+                        if (direction[axis] == 0) {
+                            entry = origin[axis] >= 0 && origin[axis] <= extent[axis] ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+                            exit = -entry;
+                        }
+                        ray.near = std::max(ray.near, std::min(entry, exit));
+                        ray.far = std::min(ray.far, std::max(entry, exit));
+                        // Sample coordinates, voxel centres at integers.
+                        ray.origin[axis] = origin[axis] * scale[axis] - 0.5f;
+                        ray.direction[axis] = direction[axis] * scale[axis];
+                    }
+                    if (!(ray.near < ray.far)) {
+                        std::fill_n(pixel, 4, 0.0f);
+                        continue;
+                    }
+                    if (brickedSampler) {
+                        marcher.march(*brickedSampler, ray, pixel, statistics);
+                    }
+                    else {
+                        marcher.march(denseSampler, ray, pixel, statistics);
+                    }
+                }
+            }
+        }
+    });
+
+    RenderStatistics total;
+    for (const RenderStatistics &statistics : tileStatistics) {
+        total.rays += statistics.rays;
+        total.samples += statistics.samples;
+        total.skippedSamples += statistics.skippedSamples;
+        total.terminatedRays += statistics.terminatedRays;
+    }
+    return total;
+}
+
+void toRGBA8(const float *rgba, size_t pixelCount, const float *background, uint8_t *output) {
+    for (size_t pixel = 0; pixel != pixelCount; ++pixel) {
+        const float *color = rgba + pixel * 4;
+        for (int channel = 0; channel != 3; ++channel) {
+            const float value = color[channel] + (1 - color[3]) * background[channel];
+            output[pixel * 4 + channel] = uint8_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 255));
+        }
+        output[pixel * 4 + 3] = 255;
+    }
+}
+
+}
@@ -0,0 +1,424 @@
+#include "Voronoi.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+#include "Parallel.h"
+#include "Random.h"
+#include "Sorting.h"
+#include "Trace.h"
+
+namespace voronoi {
+
+namespace {
+
+constexpr uint32_t tileSize = 64;
+
+// `floor` without the libm call on targets that lack a rounding instruction; anything at or beyond 2^23 is already integral.
+float floorOf(float x) {
+    if (!(std::fabs(x) < 8388608.0f)) {
+        return x;
+    }
+    const float truncated = float(int32_t(x));
+    return truncated > x ? truncated - 1 : truncated;
+}
+
+// MARK: Random.h
+
+float rand2dTo1d(float x, float y) {
+    return hashRandom::rand2dTo1d(hashRandom::float2 { x, y });
+}
+
+typedef std::array<float, 3> Colour;
+
+Colour rand1dTo3d(float value) {
+    const hashRandom::float3 colour = hashRandom::rand1dTo3d(value);
+    return { colour.x, colour.y, colour.z };
+}
+
+// MARK: Cells
+
+struct Feature {
+    float x;
+    float y;
+};
+
+// cell + rand2dTo2d(cell)
+Feature featurePoint(float cellX, float cellY) {
+    const hashRandom::float2 offset = hashRandom::rand2dTo2d(hashRandom::float2 { cellX, cellY });
+    return { cellX + offset.x, cellY + offset.y };
+}
+
+// The closest of the 3 × 3 cells around the sample's base cell, as an offset from it, and the distances `implVoronoiNoise` returns.
+struct Nearest {
+    float distance;
+    float edgeDistance;
+    int cellX;
+    int cellY;
+};
+
+// Both passes of `implVoronoiNoise`, in the kernel's loop order and arithmetic. `featureAt(x, y)` returns the feature point of the base cell + (x, y); the second pass is skipped when `Edges` is false, which leaves `edgeDistance` at its initial 10.
+template <bool Edges, typename FeatureAt> [[gnu::always_inline]] inline Nearest nearest(float vx, float vy, const FeatureAt &featureAt) {
+    Nearest result = { .distance = 10, .edgeDistance = 10, .cellX = 0, .cellY = 0 };
+    float toClosestX = 0, toClosestY = 0, closestSquared = 100;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            const Feature feature = featureAt(x, y);
+            const float toCellX = feature.x - vx, toCellY = feature.y - vy;
+            // sqrt is monotonic, so only cells that pass the squared test can pass the kernel's test, and most don't.
+            const float squared = toCellX * toCellX + toCellY * toCellY;
+            if (!(squared < closestSquared)) {
+                continue;
+            }
+            const float distance = std::sqrt(squared);
+            if (distance < result.distance) {
+                closestSquared = squared;
+                result.distance = distance;
+                result.cellX = x;
+                result.cellY = y;
+                toClosestX = toCellX;
+                toClosestY = toCellY;
+            }
+        }
+    }
+    if constexpr (Edges) {
+        for (int x = -1; x <= 1; ++x) {
+            for (int y = -1; y <= 1; ++y) {
+                if (x == result.cellX && y == result.cellY) {
+                    continue;
+                }
+                const Feature feature = featureAt(x, y);
+                const float toCellX = feature.x - vx, toCellY = feature.y - vy;
+                const float toCenterX = (toClosestX + toCellX) * 0.5f, toCenterY = (toClosestY + toCellY) * 0.5f;
+                const float differenceX = toCellX - toClosestX, differenceY = toCellY - toClosestY;
+                // normalize(v) is v * rsqrt(dot(v, v)) in Metal.
+                const float inverseLength = 1 / std::sqrt(differenceX * differenceX + differenceY * differenceY);
+                const float edgeDistance = toCenterX * (differenceX * inverseLength) + toCenterY * (differenceY * inverseLength);
+                result.edgeDistance = std::min(result.edgeDistance, edgeDistance);
+            }
+        }
+    }
+    return result;
+}
+
+bool needsEdges(Mode mode) {
+    return mode == Mode::edgeDistance || mode == Mode::edgeMask;
+}
+
+// The colour `voronoiNoiseCompute` writes; `idColour()` is only called for `Mode::id`.
+template <typename IDColour> [[gnu::always_inline]] inline void writeColour(Mode mode, float distance, float edgeDistance, const IDColour &idColour, float *pixel) {
+    Colour colour;
+    switch (mode) {
+    case Mode::distance:
+        colour = { distance, distance, distance };
+        break;
+    case Mode::id:
+        colour = idColour();
+        break;
+    case Mode::edgeDistance:
+        colour = { edgeDistance, edgeDistance, edgeDistance };
+        break;
+    case Mode::edgeMask: {
+        const float value = 0.05f < edgeDistance ? 0.0f : 1.0f; // step(noise.z, 0.05)
+        colour = { value, value, value };
+        break;
+    }
+    default:
+        colour = { 1, 0, 1 };
+        break;
+    }
+    pixel[0] = colour[0];
+    pixel[1] = colour[1];
+    pixel[2] = colour[2];
+    pixel[3] = 1;
+}
+
+// MARK: Lattice tiles
+
+struct TileCell {
+    Feature feature;
+    Colour colour; // Only filled in for `Mode::id`.
+};
+
+// Evaluates every pixel independently, hashing cells as it goes; for tiles that see more cells than they have pixels.
+template <bool Edges> void generateDirect(const Parameters &parameters, float *output, size_t rowStride, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1) {
+    for (uint32_t y = y0; y != y1; ++y) {
+        const float vy = (float(y) + parameters.offset[1]) / parameters.size[1];
+        const float baseY = floorOf(vy);
+        for (uint32_t x = x0; x != x1; ++x) {
+            const float vx = (float(x) + parameters.offset[0]) / parameters.size[0];
+            const float baseX = floorOf(vx);
+            const Nearest result = nearest<Edges>(vx, vy, [&](int cellX, int cellY) {
+                return featurePoint(baseX + float(cellX), baseY + float(cellY));
+            });
+            writeColour(parameters.mode, result.distance, result.edgeDistance, [&] {
+                return rand1dTo3d(rand2dTo1d(baseX + float(result.cellX), baseY + float(result.cellY)));
+            }, output + (y * rowStride + x) * 4);
+        }
+    }
+}
+
+template <bool Edges> void generateTile(const Parameters &parameters, float *output, size_t rowStride, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1, std::vector<TileCell> &cells) {
+    // Sample coordinates are monotonic in the pixel coordinates, so the corner pixels bound every base cell in the tile.
+    auto cellRange = [&](unsigned axis, uint32_t first, uint32_t last) {
+        const float a = floorOf((float(first) + parameters.offset[axis]) / parameters.size[axis]);
+        const float b = floorOf((float(last) + parameters.offset[axis]) / parameters.size[axis]);
+        return std::array<float, 2> { std::min(a, b) - 1, std::max(a, b) + 1 };
+    };
+    const auto rangeX = cellRange(0, x0, x1 - 1), rangeY = cellRange(1, y0, y1 - 1);
+    const double cellCountX = double(rangeX[1]) - rangeX[0] + 1, cellCountY = double(rangeY[1]) - rangeY[0] + 1;
+    if (!(cellCountX * cellCountY <= double(x1 - x0) * (y1 - y0))) {
+        generateDirect<Edges>(parameters, output, rowStride, x0, x1, y0, y1);
+        return;
+    }
+
+    const size_t stride = size_t(cellCountX);
+    cells.resize(stride * size_t(cellCountY));
+    for (size_t row = 0; row != size_t(cellCountY); ++row) {
+        for (size_t column = 0; column != stride; ++column) {
+            const float cellX = rangeX[0] + float(column), cellY = rangeY[0] + float(row);
+            TileCell &cell = cells[row * stride + column];
+            cell.feature = featurePoint(cellX, cellY);
+            if (parameters.mode == Mode::id) {
+                cell.colour = rand1dTo3d(rand2dTo1d(cellX, cellY));
+            }
+        }
+    }
+
+    for (uint32_t y = y0; y != y1; ++y) {
+        const float vy = (float(y) + parameters.offset[1]) / parameters.size[1];
+        const size_t baseRow = size_t(floorOf(vy) - rangeY[0]);
+        for (uint32_t x = x0; x != x1; ++x) {
+            const float vx = (float(x) + parameters.offset[0]) / parameters.size[0];
+            const TileCell *base = cells.data() + baseRow * stride + size_t(floorOf(vx) - rangeX[0]);
+            const Nearest result = nearest<Edges>(vx, vy, [&](int cellX, int cellY) {
+                return base[cellY * ptrdiff_t(stride) + cellX].feature;
+            });
+            writeColour(parameters.mode, result.distance, result.edgeDistance, [&] {
+                return base[result.cellY * ptrdiff_t(stride) + result.cellX].colour;
+            }, output + (y * rowStride + x) * 4);
+        }
+    }
+}
+
+// MARK: Seeds
+
+// Seed regions sharing an edge in the flooded map, in both directions, as a compressed adjacency list.
+struct Adjacency {
+    std::vector<uint32_t> first; // seedCount + 1 offsets into `neighbours`
+    std::vector<uint32_t> neighbours;
+};
+
+Adjacency findAdjacency(const uint32_t *nearest, size_t seedCount, uint32_t width, uint32_t height) {
+    std::vector<std::vector<uint64_t>> chunks((height + tileSize - 1) / tileSize);
+    parallel::parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk != end; ++chunk) {
+            std::vector<uint64_t> &pairs = chunks[chunk];
+            auto connect = [&](uint32_t a, uint32_t b) {
+                if (a != b && a != noSeed && b != noSeed) {
+                    pairs.push_back(uint64_t(a) << 32 | b);
+                    pairs.push_back(uint64_t(b) << 32 | a);
+                }
+            };
+            const uint32_t lastRow = std::min<uint32_t>(height, uint32_t(chunk + 1) * tileSize);
+            for (uint32_t y = uint32_t(chunk) * tileSize; y != lastRow; ++y) {
+                const uint32_t *row = nearest + size_t(y) * width;
+                for (uint32_t x = 0; x != width; ++x) {
+                    if (x + 1 != width) {
+                        connect(row[x], row[x + 1]);
+                    }
+                    if (y + 1 != height) {
+                        connect(row[x], row[x + width]);
+                    }
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        }
+    });
+
+    std::vector<uint64_t> pairs;
+    for (const auto &chunk : chunks) {
+        pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+    }
+    sorting::sort(pairs.data(), nullptr, pairs.size());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    Adjacency adjacency;
+    adjacency.first.assign(seedCount + 1, 0);
+    adjacency.neighbours.resize(pairs.size());
+    for (size_t index = 0; index != pairs.size(); ++index) {
+        ++adjacency.first[(pairs[index] >> 32) + 1];
+        adjacency.neighbours[index] = uint32_t(pairs[index]);
+    }
+    for (size_t seed = 0; seed != seedCount; ++seed) {
+        adjacency.first[seed + 1] += adjacency.first[seed];
+    }
+    return adjacency;
+}
+
+}
+
+Sample sample(float x, float y) {
+    const float baseX = floorOf(x), baseY = floorOf(y);
+    const Nearest result = nearest<true>(x, y, [&](int cellX, int cellY) {
+        return featurePoint(baseX + float(cellX), baseY + float(cellY));
+    });
+    return {
+        .distance = result.distance,
+        .id = rand2dTo1d(baseX + float(result.cellX), baseY + float(result.cellY)),
+        .edgeDistance = result.edgeDistance,
+    };
+}
+
+void generate(const Parameters &parameters, float *output, uint32_t width, uint32_t height, size_t rowStride) {
+    const trace::Zone zone("voronoi.generate");
+    trace::count("voronoi.texels", int64_t(width) * height);
+    rowStride = rowStride ? rowStride : width;
+    const uint32_t tilesAcross = (width + tileSize - 1) / tileSize, tilesDown = (height + tileSize - 1) / tileSize;
+    parallel::parallelFor(size_t(tilesAcross) * tilesDown, 1, [&](size_t begin, size_t end) {
+        std::vector<TileCell> cells;
+        for (size_t tile = begin; tile != end; ++tile) {
+            const uint32_t x0 = uint32_t(tile % tilesAcross) * tileSize, y0 = uint32_t(tile / tilesAcross) * tileSize;
+            const uint32_t x1 = std::min(width, x0 + tileSize), y1 = std::min(height, y0 + tileSize);
+            if (needsEdges(parameters.mode)) {
+                generateTile<true>(parameters, output, rowStride, x0, x1, y0, y1, cells);
+            }
+            else {
+                generateTile<false>(parameters, output, rowStride, x0, x1, y0, y1, cells);
+            }
+        }
+    });
+}
+
+void jumpFlood(const Seed *seeds, size_t seedCount, uint32_t width, uint32_t height, uint32_t *nearest) {
+    const trace::Zone zone("voronoi.jumpFlood");
+    const size_t pixelCount = size_t(width) * height;
+    if (pixelCount == 0) {
+        return;
+    }
+    // While flooding, empty pixels point at an extra seed at infinity, so every candidate can be compared without branching.
+    const uint32_t empty = uint32_t(seedCount);
+    std::vector<Seed> points(seeds, seeds + seedCount);
+    points.push_back({ INFINITY, INFINITY });
+    std::vector<uint32_t> buffers[2] = { std::vector<uint32_t>(pixelCount, empty), std::vector<uint32_t>(pixelCount) };
+    auto squaredDistance = [&](uint32_t index, float x, float y) {
+        const float dx = points[index].x - x, dy = points[index].y - y;
+        return dx * dx + dy * dy;
+    };
+    for (uint32_t index = 0; index != empty; ++index) {
+        // Seeds outside the image start from the closest edge pixel; their distances still use the real position.
+        const float x = std::clamp(std::floor(seeds[index].x + 0.5f), 0.0f, float(width - 1));
+        const float y = std::clamp(std::floor(seeds[index].y + 0.5f), 0.0f, float(height - 1));
+        if (std::isnan(x) || std::isnan(y)) {
+            continue;
+        }
+        uint32_t &pixel = buffers[0][size_t(y) * width + size_t(x)];
+        const float distance = squaredDistance(index, x, y), current = squaredDistance(pixel, x, y);
+        if (distance < current || (distance == current && index < pixel)) {
+            pixel = index;
+        }
+    }
+
+    unsigned sourceIndex = 0;
+    auto pass = [&](uint32_t step) {
+        const uint32_t *source = buffers[sourceIndex].data();
+        uint32_t *destination = buffers[sourceIndex ^ 1].data();
+        parallel::parallelFor(height, 16, [&](size_t begin, size_t end) {
+            for (uint32_t y = uint32_t(begin); y != uint32_t(end); ++y) {
+                const uint32_t *rows[3];
+                unsigned rowCount = 0;
+                for (int64_t ny : { int64_t(y) - step, int64_t(y), int64_t(y) + step }) {
+                    if (ny >= 0 && ny < height) {
+                        rows[rowCount++] = source + size_t(ny) * width;
+                    }
+                }
+                const float pixelY = float(y);
+                uint32_t *output = destination + size_t(y) * width;
+                for (uint32_t x = 0; x != width; ++x) {
+                    const float pixelX = float(x);
+                    uint32_t best = source[size_t(y) * width + x];
+                    float bestDistance = squaredDistance(best, pixelX, pixelY);
+                    // Ties go to the lower index so the result doesn't depend on scan order.
+                    auto consider = [&](uint32_t candidate) {
+                        const float distance = squaredDistance(candidate, pixelX, pixelY);
+                        const bool better = distance < bestDistance || (distance == bestDistance && candidate < best);
+                        best = better ? candidate : best;
+                        bestDistance = better ? distance : bestDistance;
+                    };
+                    for (unsigned row = 0; row != rowCount; ++row) {
+                        if (x >= step) {
+                            consider(rows[row][x - step]);
+                        }
+                        consider(rows[row][x]);
+                        if (width - x > step) {
+                            consider(rows[row][x + step]);
+                        }
+                    }
+                    output[x] = best;
+                }
+            }
+        });
+        sourceIndex ^= 1;
+    };
+    for (uint32_t step = std::bit_ceil(std::max({ width, height, 2u })) / 2; step != 0; step /= 2) {
+        pass(step);
+    }
+    pass(1);
+    const std::vector<uint32_t> &result = buffers[sourceIndex];
+    std::transform(result.begin(), result.end(), nearest, [&](uint32_t index) {
+        return index == empty ? noSeed : index;
+    });
+}
+
+void generate(const Seed *seeds, size_t seedCount, float scale, Mode mode, float *output, uint32_t width, uint32_t height, size_t rowStride) {
+    rowStride = rowStride ? rowStride : width;
+    std::vector<uint32_t> nearest(size_t(width) * height);
+    jumpFlood(seeds, seedCount, width, height, nearest.data());
+
+    Adjacency adjacency;
+    if (needsEdges(mode)) {
+        adjacency = findAdjacency(nearest.data(), seedCount, width, height);
+    }
+    std::vector<Colour> colours;
+    if (mode == Mode::id) {
+        colours.resize(seedCount);
+        for (size_t index = 0; index != seedCount; ++index) {
+            colours[index] = rand1dTo3d(rand2dTo1d(seeds[index].x, seeds[index].y));
+        }
+    }
+
+    parallel::parallelFor(height, 16, [&](size_t begin, size_t end) {
+        for (uint32_t y = uint32_t(begin); y != uint32_t(end); ++y) {
+            for (uint32_t x = 0; x != width; ++x) {
+                const uint32_t closest = nearest[size_t(y) * width + x];
+                float distance = 10, edgeDistance = 10;
+                if (closest != noSeed) {
+                    const Seed &seed = seeds[closest];
+                    const float toClosestX = seed.x - float(x), toClosestY = seed.y - float(y);
+                    distance = std::sqrt(toClosestX * toClosestX + toClosestY * toClosestY) / scale;
+                    float minEdgeDistance = 10 * scale;
+                    if (needsEdges(mode)) {
+                        for (uint32_t index = adjacency.first[closest]; index != adjacency.first[closest + 1]; ++index) {
+                            const Seed &neighbour = seeds[adjacency.neighbours[index]];
+                            const float toCellX = neighbour.x - float(x), toCellY = neighbour.y - float(y);
+                            const float toCenterX = (toClosestX + toCellX) * 0.5f, toCenterY = (toClosestY + toCellY) * 0.5f;
+                            const float differenceX = toCellX - toClosestX, differenceY = toCellY - toClosestY;
+                            const float inverseLength = 1 / std::sqrt(differenceX * differenceX + differenceY * differenceY);
+                            minEdgeDistance = std::min(minEdgeDistance, toCenterX * (differenceX * inverseLength) + toCenterY * (differenceY * inverseLength));
+                        }
+                    }
+                    edgeDistance = minEdgeDistance / scale;
+                }
+                writeColour(mode, distance, edgeDistance, [&] {
+                    return closest != noSeed ? colours[closest] : Colour { 0, 0, 0 };
+                }, output + (y * rowStride + x) * 4);
+            }
+        }
+    });
+}
+
+}
@@ -0,0 +1,366 @@
+#include "VoxFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <set>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace voxels {
+
+struct VoxFile::Mapping {
+    void *address = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (address) {
+            munmap(address, size);
+        }
+    }
+};
+
+namespace {
+
+// Bounds checked little endian reads. Any read past the end sets `failed` and returns zeros.
+struct Reader {
+    const uint8_t *bytes;
+    size_t size;
+    size_t offset = 0;
+    bool failed = false;
+
+    bool has(size_t count) const {
+        return !failed && count <= size - offset;
+    }
+
+    uint32_t u32() {
+        if (!has(4)) {
+            failed = true;
+            return 0;
+        }
+        const uint8_t *p = bytes + offset;
+        offset += 4;
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    int32_t i32() {
+        return int32_t(u32());
+    }
+
+    std::string_view string() {
+        const uint32_t length = u32();
+        if (!has(length)) {
+            failed = true;
+            return {};
+        }
+        const std::string_view result(reinterpret_cast<const char *>(bytes + offset), length);
+        offset += length;
+        return result;
+    }
+
+    std::map<std::string_view, std::string_view> dictionary() {
+        std::map<std::string_view, std::string_view> result;
+        const uint32_t count = u32();
+        for (uint32_t index = 0; index != count && !failed; ++index) {
+            const std::string_view key = string();
+            result[key] = string();
+        }
+        return result;
+    }
+};
+
+bool isChunk(const uint8_t *id, const char *name) {
+    return std::memcmp(id, name, 4) == 0;
+}
+
+// Keeps world positions well inside the ±2^25 voxels `ChunkStore` keys can address.
+constexpr long maximumTranslation = 1 << 24;
+// Bounds on the scene graph walk. A node reached along several paths is walked once per path, so without a budget a small file of shared groups could expand exponentially.
+constexpr size_t maximumNodeDepth = 64;
+constexpr size_t maximumNodeVisits = 1 << 20;
+
+struct Transform {
+    int8_t rotation[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    int32_t translation[3] = { 0, 0, 0 };
+};
+
+// `_r`: bits 0-1 and 2-3 are the columns of the non-zero entries in rows 0 and 1 (row 2 takes the remaining column), bits 4-6 the signs of rows 0-2.
+Transform parseTransform(const std::map<std::string_view, std::string_view> &frame) {
+    Transform transform;
+    if (const auto found = frame.find("_r"); found != frame.end()) {
+        const unsigned bits = unsigned(std::strtoul(std::string(found->second).c_str(), nullptr, 10));
+        const unsigned first = bits & 3, second = (bits >> 2) & 3;
+        if (first < 3 && second < 3 && first != second) {
+            const unsigned columns[3] = { first, second, 3 - first - second };
+            std::fill_n(transform.rotation, 9, 0);
+            for (int row = 0; row != 3; ++row) {
+                transform.rotation[row * 3 + columns[row]] = (bits >> (4 + row)) & 1 ? -1 : 1;
+            }
+        }
+    }
+    if (const auto found = frame.find("_t"); found != frame.end()) {
+        const std::string text(found->second);
+        const char *cursor = text.c_str();
+        for (int axis = 0; axis != 3; ++axis) {
+            char *end;
+            transform.translation[axis] = int32_t(std::clamp(std::strtol(cursor, &end, 10), -maximumTranslation, maximumTranslation));
+            cursor = end;
+        }
+    }
+    return transform;
+}
+
+Transform combine(const Transform &parent, const Transform &child) {
+    Transform result;
+    for (int row = 0; row != 3; ++row) {
+        for (int column = 0; column != 3; ++column) {
+            int value = 0;
+            for (int k = 0; k != 3; ++k) {
+                value += parent.rotation[row * 3 + k] * child.rotation[k * 3 + column];
+            }
+            result.rotation[row * 3 + column] = int8_t(value);
+        }
+        int32_t value = parent.translation[row];
+        for (int k = 0; k != 3; ++k) {
+            value += parent.rotation[row * 3 + k] * child.translation[k];
+        }
+        result.translation[row] = std::clamp(value, int32_t(-maximumTranslation), int32_t(maximumTranslation));
+    }
+    return result;
+}
+
+struct Node {
+    enum Kind { transform, group, shape } kind;
+    Transform local;
+    std::vector<int32_t> children;
+    std::vector<int32_t> models;
+};
+
+}
+
+bool VoxFile::open(const std::string &path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        message = "cannot open " + path;
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+        ::close(descriptor);
+        message = "cannot read " + path;
+        return false;
+    }
+    auto newMapping = std::make_shared<Mapping>();
+    newMapping->size = size_t(status.st_size);
+    void *address = mmap(nullptr, newMapping->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (address == MAP_FAILED) {
+        message = "cannot map " + path;
+        return false;
+    }
+    newMapping->address = address;
+    // Models are read on demand and usually one at a time.
+    madvise(address, newMapping->size, MADV_RANDOM);
+    mapping = std::move(newMapping);
+    return parse(static_cast<const uint8_t *>(mapping->address), mapping->size);
+}
+
+bool VoxFile::parse(const uint8_t *data, size_t size) {
+    bytes = data;
+    modelList.clear();
+    instanceList.clear();
+    message.clear();
+    for (int index = 0; index != 256; ++index) {
+        colors[index] = { uint8_t(index), uint8_t(index), uint8_t(index), 255 };
+    }
+
+    Reader reader = { .bytes = data, .size = size };
+    if (!reader.has(8) || std::memcmp(data, "VOX ", 4) != 0) {
+        message = "not a .vox file";
+        return false;
+    }
+    reader.offset = 4;
+    const uint32_t version = reader.u32();
+    if (version != 150 && version != 200) {
+        message = "unsupported .vox version " + std::to_string(version);
+        return false;
+    }
+
+    // MAIN holds every other chunk as its children; read them as one flat list.
+    if (!reader.has(12) || !isChunk(data + reader.offset, "MAIN")) {
+        message = "missing MAIN chunk";
+        return false;
+    }
+    reader.offset += 12;
+    std::map<int32_t, Node> nodes;
+    const uint32_t *pendingSize = nullptr;
+    uint32_t sizeValues[3];
+    while (reader.has(12)) {
+        const uint8_t *id = data + reader.offset;
+        reader.offset += 4;
+        const uint32_t contentSize = reader.u32();
+        const uint32_t childrenSize = reader.u32();
+        if (!reader.has(contentSize)) {
+            break;
+        }
+        Reader content = { .bytes = data + reader.offset, .size = contentSize };
+        const size_t contentOffset = reader.offset;
+        if (isChunk(id, "SIZE")) {
+            for (uint32_t &value : sizeValues) {
+                value = content.u32();
+            }
+            if (content.failed || std::any_of(sizeValues, sizeValues + 3, [](uint32_t value) { return value == 0 || value > 256; })) {
+                message = "model size outside 1...256";
+                return false;
+            }
+            pendingSize = sizeValues;
+        }
+        else if (isChunk(id, "XYZI")) {
+            const uint32_t voxelCount = content.u32();
+            if (!pendingSize || !content.has(size_t(voxelCount) * 4)) {
+                message = "XYZI chunk without SIZE or with truncated voxels";
+                return false;
+            }
+            modelList.push_back({ .size = { pendingSize[0], pendingSize[1], pendingSize[2] }, .voxelCount = voxelCount, .voxelOffset = contentOffset + 4 });
+            pendingSize = nullptr;
+        }
+        else if (isChunk(id, "RGBA")) {
+            for (int index = 0; index != 255 && content.has(4); ++index) {
+                const uint8_t *color = content.bytes + content.offset;
+                colors[index + 1] = { color[0], color[1], color[2], color[3] };
+                content.offset += 4;
+            }
+        }
+        else if (isChunk(id, "nTRN")) {
+            const int32_t nodeId = content.i32();
+            content.dictionary();
+            Node node;
+            node.kind = Node::transform;
+            node.children.push_back(content.i32());
+            content.i32(); // reserved
+            content.i32(); // layer
+            const uint32_t frameCount = content.u32();
+            // Only the first animation frame places the model.
+            if (frameCount > 0) {
+                node.local = parseTransform(content.dictionary());
+            }
+            if (!content.failed) {
+                nodes[nodeId] = node;
+            }
+        }
+        else if (isChunk(id, "nGRP")) {
+            const int32_t nodeId = content.i32();
+            content.dictionary();
+            Node node;
+            node.kind = Node::group;
+            const uint32_t childCount = content.u32();
+            for (uint32_t child = 0; child != childCount && !content.failed; ++child) {
+                node.children.push_back(content.i32());
+            }
+            if (!content.failed) {
+                nodes[nodeId] = node;
+            }
+        }
+        else if (isChunk(id, "nSHP")) {
+            const int32_t nodeId = content.i32();
+            content.dictionary();
+            Node node;
+            node.kind = Node::shape;
+            const uint32_t modelCount = content.u32();
+            for (uint32_t model = 0; model != modelCount && !content.failed; ++model) {
+                node.models.push_back(content.i32());
+                content.dictionary();
+            }
+            if (!content.failed) {
+                nodes[nodeId] = node;
+            }
+        }
+        // No chunk inside MAIN defines children, so any are skipped along with the content.
+        reader.offset += contentSize;
+        if (!reader.has(childrenSize)) {
+            break;
+        }
+        reader.offset += childrenSize;
+    }
+
+    auto addInstance = [&](uint32_t model, const Transform &transform) {
+        VoxInstance instance = {};
+        instance.model = model;
+        std::copy_n(transform.rotation, 9, instance.rotation);
+        std::copy_n(transform.translation, 3, instance.translation);
+        const VoxModel &source = modelList[model];
+        int32_t corners[2][3];
+        instance.worldPosition(source, 0, 0, 0, corners[0]);
+        instance.worldPosition(source, std::max(source.size[0], 1u) - 1, std::max(source.size[1], 1u) - 1, std::max(source.size[2], 1u) - 1, corners[1]);
+        for (int axis = 0; axis != 3; ++axis) {
+            instance.minimum[axis] = std::min(corners[0][axis], corners[1][axis]);
+            instance.maximum[axis] = std::max(corners[0][axis], corners[1][axis]) + 1;
+        }
+        instanceList.push_back(instance);
+    };
+
+    if (nodes.empty()) {
+        for (uint32_t model = 0; model != modelList.size(); ++model) {
+            Transform transform;
+            for (int axis = 0; axis != 3; ++axis) {
+                transform.translation[axis] = int32_t(modelList[model].size[axis] / 2);
+            }
+            addInstance(model, transform);
+        }
+        return true;
+    }
+
+    // Walk the graph from the root transform, refusing cycles and graphs that expand past the visit budget.
+    std::set<int32_t> path;
+    size_t visits = 0;
+    auto visit = [&](auto &&self, int32_t nodeId, const Transform &parent) -> bool {
+        const auto found = nodes.find(nodeId);
+        if (found == nodes.end()) {
+            return true;
+        }
+        if (path.contains(nodeId)) {
+            message = "scene graph node " + std::to_string(nodeId) + " contains itself";
+            return false;
+        }
+        if (path.size() == maximumNodeDepth || ++visits > maximumNodeVisits) {
+            message = "scene graph too deep or too large";
+            return false;
+        }
+        const Node &node = found->second;
+        const Transform transform = node.kind == Node::transform ? combine(parent, node.local) : parent;
+        path.insert(nodeId);
+        for (const int32_t child : node.children) {
+            if (!self(self, child, transform)) {
+                return false;
+            }
+        }
+        path.erase(nodeId);
+        for (const int32_t model : node.models) {
+            if (model >= 0 && size_t(model) < modelList.size()) {
+                addInstance(uint32_t(model), transform);
+            }
+        }
+        return true;
+    };
+    if (!visit(visit, 0, Transform())) {
+        instanceList.clear();
+        return false;
+    }
+    return true;
+}
+
+std::vector<MagicaVoxel> VoxFile::magicaVoxels(size_t model) const {
+    const uint8_t *source = voxelData(model);
+    std::vector<MagicaVoxel> result(modelList[model].voxelCount);
+    for (size_t index = 0; index != result.size(); ++index) {
+        const uint8_t *voxel = source + index * 4;
+        result[index] = { .position = { uint8_t(modelList[model].coordinate(voxel, 0)), uint8_t(modelList[model].coordinate(voxel, 1)), uint8_t(modelList[model].coordinate(voxel, 2)) }, .unused = 0, .color = voxel[3] };
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,183 @@
+#include "VoxelMeshing.h"
+
+#include <algorithm>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace voxels {
+
+namespace {
+
+// A rectangle of faces in the plane `axis = plane`, covering [u, u + width) × [v, v + height) of the other two axes, (axis + 1) % 3 and (axis + 2) % 3.
+struct Quad {
+    uint32_t plane;
+    uint32_t u, v;
+    uint32_t width, height;
+    uint8_t color;
+};
+
+// The six face directions: axis and whether the normal points along +axis.
+struct Direction {
+    int axis;
+    bool positive;
+};
+
+constexpr Direction directions[6] = {
+    { 0, true }, { 0, false }, { 1, true }, { 1, false }, { 2, true }, { 2, false },
+};
+
+// Slices meshed per parallel task.
+constexpr size_t sliceGrain = 4;
+
+// The visible faces of slice `slice` facing `direction`, merged into quads. `mask` is scratch of uSize × vSize bytes.
+void meshSlice(const VoxelGrid &grid, Direction direction, uint32_t slice, bool greedy, std::vector<uint8_t> &mask, std::vector<Quad> &quads) {
+    const uint32_t size[3] = { grid.width, grid.height, grid.depth };
+    const int uAxis = (direction.axis + 1) % 3, vAxis = (direction.axis + 2) % 3;
+    const uint32_t uSize = size[uAxis], vSize = size[vAxis];
+    const bool hasNeighbour = direction.positive ? slice + 1 < size[direction.axis] : slice > 0;
+    const uint32_t neighbourSlice = direction.positive ? slice + 1 : slice - 1;
+    mask.resize(size_t(uSize) * vSize);
+    uint32_t position[3];
+    for (uint32_t v = 0; v != vSize; ++v) {
+        for (uint32_t u = 0; u != uSize; ++u) {
+            position[direction.axis] = slice;
+            position[uAxis] = u;
+            position[vAxis] = v;
+            uint8_t color = grid.color(position[0], position[1], position[2]);
+            if (color != 0 && hasNeighbour) {
+                position[direction.axis] = neighbourSlice;
+                if (grid.color(position[0], position[1], position[2]) != 0) {
+                    color = 0;
+                }
+            }
+            mask[size_t(v) * uSize + u] = color;
+        }
+    }
+
+    const uint32_t plane = direction.positive ? slice + 1 : slice;
+    for (uint32_t v = 0; v != vSize; ++v) {
+        uint8_t *row = mask.data() + size_t(v) * uSize;
+        for (uint32_t u = 0; u != uSize;) {
+            const uint8_t color = row[u];
+            if (color == 0) {
+                ++u;
+                continue;
+            }
+            uint32_t width = 1, height = 1;
+            if (greedy) {
+                while (u + width != uSize && row[u + width] == color) {
+                    ++width;
+                }
+                // Grow downwards while the whole run below has the same colour.
+                for (; v + height != vSize; ++height) {
+                    const uint8_t *next = row + size_t(height) * uSize + u;
+                    if (!std::all_of(next, next + width, [&](uint8_t other) { return other == color; })) {
+                        break;
+                    }
+                }
+                for (uint32_t line = 0; line != height; ++line) {
+                    std::fill_n(mask.data() + size_t(v + line) * uSize + u, width, 0);
+                }
+            }
+            quads.push_back({ .plane = plane, .u = u, .v = v, .width = width, .height = height, .color = color });
+            u += width;
+        }
+    }
+}
+
+}
+
+VoxelMesh meshVoxels(const VoxelGrid &grid, VoxelSize voxelSize, bool greedy) {
+    const trace::Zone zone("voxels.meshVoxels");
+    VoxelMesh mesh;
+    const uint32_t size[3] = { grid.width, grid.height, grid.depth };
+    if (size[0] == 0 || size[1] == 0 || size[2] == 0) {
+        return mesh;
+    }
+
+    // One task list entry per (direction, slice), meshed in parallel and concatenated in order.
+    struct Task {
+        Direction direction;
+        uint32_t slice;
+    };
+    std::vector<Task> tasks;
+    for (const Direction direction : directions) {
+        for (uint32_t slice = 0; slice != size[direction.axis]; ++slice) {
+            tasks.push_back({ direction, slice });
+        }
+    }
+    std::vector<std::vector<Quad>> quads(tasks.size());
+    parallel::parallelFor(tasks.size(), sliceGrain, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> mask;
+        for (size_t index = begin; index != end; ++index) {
+            meshSlice(grid, tasks[index].direction, tasks[index].slice, greedy, mask, quads[index]);
+        }
+    });
+
+    std::vector<size_t> firstQuads(tasks.size() + 1, 0);
+    for (size_t index = 0; index != tasks.size(); ++index) {
+        firstQuads[index + 1] = firstQuads[index] + quads[index].size();
+    }
+    const size_t quadCount = firstQuads.back();
+    mesh.vertices.resize(quadCount * 4);
+    mesh.indices.resize(quadCount * 6);
+    const float scale[3] = { voxelSize.x, voxelSize.y, voxelSize.z };
+    parallel::parallelFor(tasks.size(), sliceGrain, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            const Direction direction = tasks[index].direction;
+            const int uAxis = (direction.axis + 1) % 3, vAxis = (direction.axis + 2) % 3;
+            uint16_t normal[3] = { 0, 0, 0 };
+            normal[direction.axis] = half::fromFloat(direction.positive ? 1 : -1);
+            // u × v is +axis, so (0, 1, 2) is counter-clockwise seen from +axis.
+            constexpr uint32_t positiveOrder[6] = { 0, 1, 2, 0, 2, 3 };
+            constexpr uint32_t negativeOrder[6] = { 0, 2, 1, 0, 3, 2 };
+            const uint32_t *order = direction.positive ? positiveOrder : negativeOrder;
+            size_t quadIndex = firstQuads[index];
+            for (const Quad &quad : quads[index]) {
+                const uint32_t corners[4][2] = { { 0, 0 }, { quad.width, 0 }, { quad.width, quad.height }, { 0, quad.height } };
+                PackedVoxelVertex *vertices = mesh.vertices.data() + quadIndex * 4;
+                for (int corner = 0; corner != 4; ++corner) {
+                    float position[3];
+                    position[direction.axis] = float(quad.plane);
+                    position[uAxis] = float(quad.u + corners[corner][0]);
+                    position[vAxis] = float(quad.v + corners[corner][1]);
+                    PackedVoxelVertex &vertex = vertices[corner];
+                    for (int axis = 0; axis != 3; ++axis) {
+                        vertex.position[axis] = half::fromFloat(position[axis] * scale[axis]);
+                        vertex.normal[axis] = normal[axis];
+                    }
+                    vertex.textureCoordinate[0] = half::fromFloat(float(corners[corner][0]));
+                    vertex.textureCoordinate[1] = half::fromFloat(float(corners[corner][1]));
+                    vertex.colorIndex = quad.color;
+                    vertex.unused = 0;
+                }
+                uint32_t *indices = mesh.indices.data() + quadIndex * 6;
+                for (int corner = 0; corner != 6; ++corner) {
+                    indices[corner] = uint32_t(quadIndex * 4 + order[corner]);
+                }
+                ++quadIndex;
+            }
+        }
+    });
+    trace::count("voxels.quadsEmitted", int64_t(mesh.indices.size() / 6));
+    return mesh;
+}
+
+VoxelMesh meshVoxels(const MagicaVoxel *voxels, size_t count, VoxelSize voxelSize, bool greedy) {
+    uint32_t size[3] = { 0, 0, 0 };
+    for (size_t index = 0; index != count; ++index) {
+        for (int axis = 0; axis != 3; ++axis) {
+            size[axis] = std::max(size[axis], uint32_t(voxels[index].position[axis]) + 1);
+        }
+    }
+    std::vector<uint8_t> colors(size_t(size[0]) * size[1] * size[2], 0);
+    for (size_t index = 0; index != count; ++index) {
+        const uint8_t *position = voxels[index].position;
+        colors[(size_t(position[2]) * size[1] + position[1]) * size[0] + position[0]] = voxels[index].color;
+    }
+    const VoxelGrid grid = { .colors = colors.data(), .width = size[0], .height = size[1], .depth = size[2] };
+    return meshVoxels(grid, voxelSize, greedy);
+}
+
+}
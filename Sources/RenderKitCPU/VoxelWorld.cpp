@@ -0,0 +1,208 @@
+#include "VoxelWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+
+namespace voxels {
+
+namespace {
+
+constexpr int32_t chunkMask = ChunkStore::chunkSize - 1;
+
+size_t offsetInChunk(int32_t x, int32_t y, int32_t z) {
+    return (size_t(z & chunkMask) * ChunkStore::chunkSize + size_t(y & chunkMask)) * ChunkStore::chunkSize + size_t(x & chunkMask);
+}
+
+// Distance from a point to the nearest voxel of a chunk.
+float distanceToChunk(const float point[3], const int32_t chunk[3]) {
+    float squared = 0;
+    for (int axis = 0; axis != 3; ++axis) {
+        const float low = float(chunk[axis] * ChunkStore::chunkSize), high = low + ChunkStore::chunkSize;
+        const float gap = std::max({ low - point[axis], point[axis] - high, 0.0f });
+        squared += gap * gap;
+    }
+    return std::sqrt(squared);
+}
+
+// Sign extends one 21 bit coordinate of a `ChunkStore::key`.
+int32_t keyCoordinate(uint64_t chunkKey, int shift) {
+    return int32_t(uint32_t(chunkKey >> shift) << 11) >> 11;
+}
+
+// A voxel read from a model, already placed in its chunk.
+struct PlacedVoxel {
+    uint64_t chunkKey;
+    uint32_t offset;
+    uint8_t color;
+};
+
+}
+
+// MARK: ChunkStore
+
+uint8_t ChunkStore::get(int32_t x, int32_t y, int32_t z) const {
+    const uint8_t *values = chunk(x >> chunkShift, y >> chunkShift, z >> chunkShift);
+    return values ? values[offsetInChunk(x, y, z)] : 0;
+}
+
+void ChunkStore::set(int32_t x, int32_t y, int32_t z, uint8_t color) {
+    const uint64_t chunkKey = key(x >> chunkShift, y >> chunkShift, z >> chunkShift);
+    if (color == 0 && !chunks.contains(chunkKey)) {
+        return;
+    }
+    mutableChunk(chunkKey)[offsetInChunk(x, y, z)] = color;
+}
+
+const uint8_t *ChunkStore::chunk(int32_t chunkX, int32_t chunkY, int32_t chunkZ) const {
+    const auto found = chunks.find(key(chunkX, chunkY, chunkZ));
+    return found == chunks.end() ? nullptr : found->second.data();
+}
+
+uint8_t *ChunkStore::mutableChunk(uint64_t chunkKey) {
+    std::vector<uint8_t> &values = chunks[chunkKey];
+    if (values.empty()) {
+        values.assign(chunkVolume, 0);
+    }
+    return values.data();
+}
+
+void ChunkStore::extract(int32_t x, int32_t y, int32_t z, uint32_t width, uint32_t height, uint32_t depth, uint8_t *output) const {
+    parallel::parallelFor(depth, 1, [&](size_t begin, size_t end) {
+        for (size_t dz = begin; dz != end; ++dz) {
+            for (uint32_t dy = 0; dy != height; ++dy) {
+                uint8_t *row = output + (dz * height + dy) * width;
+                const int32_t voxelY = y + int32_t(dy), voxelZ = z + int32_t(dz);
+                // A chunk lookup per run of up to chunkSize voxels rather than per voxel.
+                for (uint32_t dx = 0; dx != width;) {
+                    const int32_t voxelX = x + int32_t(dx);
+                    const uint32_t run = std::min(width - dx, uint32_t(ChunkStore::chunkSize - (voxelX & chunkMask)));
+                    const uint8_t *values = chunk(voxelX >> chunkShift, voxelY >> chunkShift, voxelZ >> chunkShift);
+                    if (values) {
+                        std::copy_n(values + offsetInChunk(voxelX, voxelY, voxelZ), run, row + dx);
+                    }
+                    else {
+                        std::fill_n(row + dx, run, 0);
+                    }
+                    dx += run;
+                }
+            }
+        }
+    });
+}
+
+// MARK: VoxelWorld
+
+void VoxelWorld::add(const VoxFile &file, int32_t x, int32_t y, int32_t z) {
+    const uint32_t fileIndex = uint32_t(files.size());
+    files.push_back(file);
+    const int32_t offset[3] = { x, y, z };
+    for (VoxInstance instance : file.instances()) {
+        for (int axis = 0; axis != 3; ++axis) {
+            instance.translation[axis] += offset[axis];
+            instance.minimum[axis] += offset[axis];
+            instance.maximum[axis] += offset[axis];
+        }
+        instances.push_back({ fileIndex, instance });
+        // Loaded chunks the instance overlaps are dropped, so the next `update` rebuilds them with its voxels on top.
+        for (auto iterator = resident.begin(); iterator != resident.end();) {
+            const uint64_t chunkKey = *iterator;
+            bool overlaps = true;
+            for (int axis = 0; axis != 3; ++axis) {
+                const int32_t chunk = keyCoordinate(chunkKey, 21 * axis);
+                overlaps = overlaps && chunk >= instance.minimum[axis] >> ChunkStore::chunkShift && chunk <= (instance.maximum[axis] - 1) >> ChunkStore::chunkShift;
+            }
+            if (overlaps) {
+                chunks.erase(chunkKey);
+                iterator = resident.erase(iterator);
+            }
+            else {
+                ++iterator;
+            }
+        }
+    }
+}
+
+size_t VoxelWorld::update(float x, float y, float z, float radius) {
+    const float point[3] = { x, y, z };
+
+    // The chunks each instance has to contribute to: those it overlaps, in range and not yet loaded.
+    std::vector<std::vector<uint64_t>> needed(instances.size());
+    std::unordered_set<uint64_t> loading;
+    for (size_t index = 0; index != instances.size(); ++index) {
+        const VoxInstance &instance = instances[index].instance;
+        int32_t first[3], last[3];
+        bool overlaps = true;
+        for (int axis = 0; axis != 3; ++axis) {
+            first[axis] = std::max(instance.minimum[axis], int32_t(std::floor(point[axis] - radius))) >> ChunkStore::chunkShift;
+            last[axis] = std::min(instance.maximum[axis] - 1, int32_t(std::ceil(point[axis] + radius))) >> ChunkStore::chunkShift;
+            overlaps = overlaps && first[axis] <= last[axis];
+        }
+        if (!overlaps) {
+            continue;
+        }
+        int32_t chunk[3];
+        for (chunk[2] = first[2]; chunk[2] <= last[2]; ++chunk[2]) {
+            for (chunk[1] = first[1]; chunk[1] <= last[1]; ++chunk[1]) {
+                for (chunk[0] = first[0]; chunk[0] <= last[0]; ++chunk[0]) {
+                    const uint64_t chunkKey = ChunkStore::key(chunk[0], chunk[1], chunk[2]);
+                    if (distanceToChunk(point, chunk) <= radius && !resident.contains(chunkKey)) {
+                        needed[index].push_back(chunkKey);
+                        loading.insert(chunkKey);
+                    }
+                }
+            }
+        }
+    }
+
+    // Read each instance's voxels once, keeping those that land in its needed chunks.
+    std::vector<std::vector<PlacedVoxel>> placed(instances.size());
+    parallel::parallelFor(instances.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t index = begin; index != end; ++index) {
+            std::vector<uint64_t> &keys = needed[index];
+            if (keys.empty()) {
+                continue;
+            }
+            std::sort(keys.begin(), keys.end());
+            const VoxFile &file = files[instances[index].file];
+            const VoxInstance &instance = instances[index].instance;
+            const VoxModel &model = file.models()[instance.model];
+            const uint8_t *voxels = file.voxelData(instance.model);
+            for (uint32_t voxel = 0; voxel != model.voxelCount; ++voxel) {
+                const uint8_t *source = voxels + size_t(voxel) * 4;
+                if (source[3] == 0) {
+                    continue;
+                }
+                int32_t position[3];
+                instance.worldPosition(model, model.coordinate(source, 0), model.coordinate(source, 1), model.coordinate(source, 2), position);
+                const uint64_t chunkKey = ChunkStore::key(position[0] >> ChunkStore::chunkShift, position[1] >> ChunkStore::chunkShift, position[2] >> ChunkStore::chunkShift);
+                if (std::binary_search(keys.begin(), keys.end(), chunkKey)) {
+                    placed[index].push_back({ chunkKey, uint32_t(offsetInChunk(position[0], position[1], position[2])), source[3] });
+                }
+            }
+        }
+    });
+    for (const auto &voxels : placed) {
+        for (const PlacedVoxel &voxel : voxels) {
+            chunks.mutableChunk(voxel.chunkKey)[voxel.offset] = voxel.color;
+        }
+    }
+    resident.insert(loading.begin(), loading.end());
+
+    // Evict what has fallen out of range.
+    for (auto iterator = resident.begin(); iterator != resident.end();) {
+        const uint64_t chunkKey = *iterator;
+        const int32_t chunk[3] = { keyCoordinate(chunkKey, 0), keyCoordinate(chunkKey, 21), keyCoordinate(chunkKey, 42) };
+        if (distanceToChunk(point, chunk) > radius + evictionMargin) {
+            chunks.erase(chunkKey);
+            iterator = resident.erase(iterator);
+        }
+        else {
+            ++iterator;
+        }
+    }
+    return loading.size();
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "VolumeRenderer.h"
+
+// Out of core 16 bit volumes. A bricked volume file stores the voxels as separately paged bricks along with the statistics the volume path otherwise needs a full pass for: the value range (`VolumeFragmentUniforms.maxValue`), a histogram of every voxel, and each brick's range and histogram. Files are memory mapped, and a `BrickCache` keeps the bricks that have been read within a memory budget, evicting the least recently used.
+
+namespace volume {
+
+// The statistics stored for each brick.
+struct BrickRecord {
+    // The minimum and maximum of every value a sample inside the brick can read.
+    uint16_t minimum;
+    uint16_t maximum;
+    // Counts of the brick's own voxels (not those repeated from its neighbours) over equal parts of [minimum, maximum].
+    uint16_t histogram[16];
+};
+
+static_assert(sizeof(BrickRecord) == 36);
+
+// Bricks cover `brickSize`³ trilinear cells, like `Renderer`'s brick grid, so brick b along an axis holds voxels [b * brickSize, (b + 1) * brickSize] inclusive, with the last voxel repeated past the edge. Every sample reads a single brick.
+class BrickedVolume {
+public:
+    // Keeps a brick's own voxels countable in `BrickRecord::histogram`.
+    static constexpr uint32_t maximumBrickSize = 32;
+
+    // Maps and parses `path`. Returns false, with a message in `error()`, if the file cannot be read or is not a bricked volume.
+    bool open(const std::string &path);
+
+    // Parses a file already in memory. The bytes must outlive this object and every copy of it.
+    bool parse(const uint8_t *bytes, size_t size);
+
+    const std::string &error() const {
+        return message;
+    }
+
+    // Width, height and depth in voxels.
+    const uint32_t *size() const {
+        return dimensions;
+    }
+
+    const float *spacing() const {
+        return voxelSpacing;
+    }
+
+    uint32_t brickSize() const {
+        return bricks;
+    }
+
+    const uint32_t *brickDimensions() const {
+        return brickGrid;
+    }
+
+    size_t brickCount() const {
+        return size_t(brickGrid[0]) * brickGrid[1] * brickGrid[2];
+    }
+
+    // Bytes between bricks in the file, a whole number of pages (16 KB, which covers 4 KB and 16 KB page systems alike).
+    size_t brickStride() const {
+        return stride;
+    }
+
+    uint16_t minValue() const {
+        return minimum;
+    }
+
+    // What `VolumeFragmentUniforms.maxValue` would be computed from.
+    uint16_t maxValue() const {
+        return maximum;
+    }
+
+    // 65536 counts, one per value, over every voxel.
+    const uint64_t *histogram() const {
+        return counts;
+    }
+
+    const BrickRecord &brickRecord(size_t brick) const {
+        return records[brick];
+    }
+
+    // (brickSize + 1)³ values, x fastest, straight from the mapping. Reading them is what pages the brick in; go through a `BrickCache` to keep that within a budget.
+    const uint16_t *brickData(size_t brick) const {
+        return reinterpret_cast<const uint16_t *>(data + brick * stride);
+    }
+
+private:
+    struct Mapping;
+
+    friend class BrickCache;
+
+    std::shared_ptr<Mapping> mapping;
+    std::string message;
+    uint32_t dimensions[3] = {};
+    float voxelSpacing[3] = {};
+    uint32_t bricks = 0;
+    uint32_t brickGrid[3] = {};
+    size_t stride = 0;
+    uint16_t minimum = 0;
+    uint16_t maximum = 0;
+    const uint64_t *counts = nullptr;
+    const BrickRecord *records = nullptr;
+    const uint8_t *data = nullptr;
+};
+
+// Writes a bricked volume of `width` × `height` × `depth` voxels, asking for them a z slice (x fastest) at a time, in order, so volumes larger than memory can be converted; about brickSize + 1 slices are held at once. Returns false, with a message in `error`, if the file cannot be written.
+bool writeBrickedVolume(const std::string &path, uint32_t width, uint32_t height, uint32_t depth, const float *spacing, uint32_t brickSize, const std::function<void(uint32_t z, uint16_t *slice)> &readSlice, std::string &error);
+
+// Writes a dense volume, e.g. a raw file mapped into memory, as a bricked volume.
+bool writeBrickedVolume(const std::string &path, const Volume &volume, uint32_t brickSize, std::string &error);
+
+// Keeps the bricks of a mapped `BrickedVolume` that have been read within `memoryBudget` bytes, releasing the pages of the least recently used bricks back to the system. Pointers returned by `brick` stay valid after eviction: reading them again just pages the brick back in. Thread safe; copies share one cache.
+class BrickCache {
+public:
+    BrickCache(const BrickedVolume &volume, size_t memoryBudget);
+
+    const BrickedVolume &volume() const;
+
+    // The brick's data, marking it most recently used.
+    const uint16_t *brick(size_t index) const;
+
+    // Asks the system to read ahead the bricks in front of `position` along `direction`, nearest first, until half the budget is in flight; positions are in `Camera`'s volume box coordinates. Bricks for which `wanted` returns false, e.g. those the transfer function makes transparent, are passed over. Returns the number of bricks requested.
+    size_t prefetch(const float *position, const float *direction, const std::function<bool(size_t brick)> &wanted = nullptr) const;
+
+    // Copies every `step`th voxel of the box starting at (x, y, z) into a dense width × height × depth grid, brick by brick through the cache. With `step` > 1 this builds a reduced copy of a volume too large to upload, for the slice renderer's `texture3d<ushort>`.
+    void extract(uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth, uint32_t step, uint16_t *output) const;
+
+    size_t memoryBudget() const;
+    size_t residentBytes() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t evictions() const;
+
+private:
+    struct State;
+
+    std::shared_ptr<State> state;
+};
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Clustered light culling for the Blinn-Phong shaders (RenderKitShaders/Classic/BlinnPhongShaders.metal). The view frustum is cut into a grid of screen tiles by exponentially spaced depth slices ("froxels"); each cluster lists the lights whose sphere of influence reaches it, so `BlinnPhongClusteredFragmentShader` shades a fragment with the handful of lights near it rather than every light in the scene.
+
+namespace lighting {
+
+// Same layout as `BlinnPhongLight` in BlinnPhongShaders.h, whose simd_float3s take 16 bytes. Positions are in view space, where the shaders light.
+struct alignas(16) Light {
+    float position[3];
+    float positionPadding;
+    float color[3];
+    float colorPadding;
+    float power;
+};
+
+static_assert(sizeof(Light) == 48);
+
+// Same layout as `BlinnPhongClusterGrid` in BlinnPhongShaders.h.
+struct ClusterGrid {
+    uint32_t tilesWide;
+    uint32_t tilesHigh;
+    uint32_t slices;
+    float viewportWidth;
+    float viewportHeight;
+    // View space depths (distances along -z) the slices span, normally the projection's near and far planes.
+    float nearZ;
+    float farZ;
+};
+
+// Same layout as `BlinnPhongClusterRange`: a cluster's lights are `lightIndices[offset ..< offset + count]`.
+struct ClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// A symmetric perspective projection looking down -z, as `CameraUniforms.projectionMatrix` is built.
+struct Projection {
+    // Vertical field of view in radians.
+    float fieldOfView;
+    // Width over height.
+    float aspectRatio;
+};
+
+// Surface colours, as sampled from `BlinnPhongMaterialArgumentBuffer`'s textures.
+struct Material {
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float shininess;
+};
+
+// The distance beyond which a light's `lightColor * lightPower / distance²` falls below `threshold` in every channel. Lights fall off with the square of distance and never reach zero; clusters ignore them past this radius.
+float influenceRadius(const Light &light, float threshold);
+
+class LightClusters {
+public:
+    // A grid of `tilesWide` × `tilesHigh` screen tiles by `slices` depth slices.
+    LightClusters(uint32_t tilesWide, uint32_t tilesHigh, uint32_t slices);
+
+    // Bins `lights` into the clusters of a `viewportWidth` × `viewportHeight` view through `projection` between depths `nearZ` and `farZ`, one depth slice per thread. Lights are ignored beyond the distance where they fall below `threshold`, by default half a step of an 8 bit channel.
+    void build(const Light *lights, size_t count, const Projection &projection, float viewportWidth, float viewportHeight, float nearZ, float farZ, float threshold = 1.0f / 512);
+
+    // The shader's uniforms for the last build.
+    const ClusterGrid &grid() const {
+        return clusterGrid;
+    }
+
+    // One range per cluster, x fastest, then y (from the top of the screen), then depth slice.
+    const std::vector<ClusterRange> &ranges() const {
+        return clusterRanges;
+    }
+
+    // The lights of every cluster, in ascending order within each.
+    const std::vector<uint32_t> &lightIndices() const {
+        return indices;
+    }
+
+    // The cluster of a fragment at pixel (x, y), with y down as in `[[position]]`, and view space depth `depth`; depths outside nearZ...farZ use the first or last slice.
+    uint32_t clusterIndex(float x, float y, float depth) const;
+
+private:
+    ClusterGrid clusterGrid;
+    std::vector<ClusterRange> clusterRanges;
+    std::vector<uint32_t> indices;
+};
+
+// `CalculateBlinnPhong` on the CPU: the colour of a surface at view space `position` with interpolated `normal`, lit by `lights[lightIndices[i]]` for i < `count` (or by `lights[0 ..< count]` when `lightIndices` is null). `phongMode` 0 is Blinn-Phong, otherwise Phong, as the shader's function constant.
+void calculateBlinnPhong(const float *position, const float *normal, const Light *lights, const uint32_t *lightIndices, size_t count, const float *ambientLightColor, const Material &material, int phongMode, float *rgb);
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+// Compute dispatch on the host, shaped like a Metal compute command encoder's: a grid of threads is cut into threadgroups and the threadgroups are spread over the worker pool. RenderKitShadersHost uses it to run RenderKitShaders' kernels, compiled as C++, on the CPU.
+
+namespace compute {
+
+// A grid or threadgroup size in threads, as MTLSize.
+struct Size {
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t depth = 1;
+};
+
+struct Position {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t z = 0;
+};
+
+// What a kernel can ask about the thread it runs as, named after the attributes that ask for it.
+struct Thread {
+    // [[thread_position_in_grid]]
+    Position positionInGrid;
+    // [[thread_position_in_threadgroup]]
+    Position positionInThreadgroup;
+    // [[threadgroup_position_in_grid]]
+    Position threadgroupPositionInGrid;
+    // [[thread_index_in_threadgroup]]
+    uint32_t indexInThreadgroup;
+    // [[threads_per_grid]] (also [[grid_size]])
+    Size threadsPerGrid;
+    // [[threads_per_threadgroup]]; smaller than the dispatch's threadgroup size in groups cut short by the edge of the grid.
+    Size threadsPerThreadgroup;
+};
+
+// Calls `kernel(thread)` for every thread of `grid`, as `dispatchThreads(_:threadsPerThreadgroup:)` would: the grid is cut into `threadgroup` sized groups, the groups on its far edges cut short, and workers claim groups as they finish the last, so uneven kernels still balance. The threads of a group run one after another on one worker, so a kernel that waits on the rest of its group in `threadgroup_barrier` cannot run this way.
+template <typename Kernel>
+void dispatchThreads(Size grid, Size threadgroup, const Kernel &kernel) {
+    threadgroup = { std::max(threadgroup.width, 1u), std::max(threadgroup.height, 1u), std::max(threadgroup.depth, 1u) };
+    if (grid.width == 0 || grid.height == 0 || grid.depth == 0) {
+        return;
+    }
+    trace::count("compute.threads", int64_t(grid.width) * grid.height * grid.depth);
+    const uint32_t groupsWide = (grid.width - 1) / threadgroup.width + 1;
+    const uint32_t groupsHigh = (grid.height - 1) / threadgroup.height + 1;
+    const uint32_t groupsDeep = (grid.depth - 1) / threadgroup.depth + 1;
+    // Claim groups a thousand or so threads at a time, so that small groups don't cost a claim each.
+    const size_t threadsPerGroup = size_t(threadgroup.width) * threadgroup.height * threadgroup.depth;
+    const size_t grain = std::max<size_t>(1, 1024 / threadsPerGroup);
+    parallel::parallelFor(size_t(groupsWide) * groupsHigh * groupsDeep, grain, [&](size_t begin, size_t end) {
+        Thread thread;
+        thread.threadsPerGrid = grid;
+        for (size_t group = begin; group != end; ++group) {
+            const Position groupPosition = { uint32_t(group % groupsWide), uint32_t(group / groupsWide % groupsHigh), uint32_t(group / groupsWide / groupsHigh) };
+            const Position origin = { groupPosition.x * threadgroup.width, groupPosition.y * threadgroup.height, groupPosition.z * threadgroup.depth };
+            thread.threadgroupPositionInGrid = groupPosition;
+            const Size size = { std::min(threadgroup.width, grid.width - origin.x), std::min(threadgroup.height, grid.height - origin.y), std::min(threadgroup.depth, grid.depth - origin.z) };
+            thread.threadsPerThreadgroup = size;
+            uint32_t index = 0;
+            for (uint32_t z = 0; z != size.depth; ++z) {
+                for (uint32_t y = 0; y != size.height; ++y) {
+                    for (uint32_t x = 0; x != size.width; ++x) {
+                        thread.positionInThreadgroup = { x, y, z };
+                        thread.positionInGrid = { origin.x + x, origin.y + y, origin.z + z };
+                        thread.indexInThreadgroup = index++;
+                        kernel(thread);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// As `dispatchThreadgroups(_:threadsPerThreadgroup:)`: `threadgroups` whole groups of `threadgroup` threads. Thread positions are 32 bit, so each axis must come to at most UINT32_MAX threads; larger grids assert, and without assertions dispatch only the whole groups that fit.
+template <typename Kernel>
+void dispatchThreadgroups(Size threadgroups, Size threadgroup, const Kernel &kernel) {
+    threadgroup = { std::max(threadgroup.width, 1u), std::max(threadgroup.height, 1u), std::max(threadgroup.depth, 1u) };
+    auto threads = [](uint32_t groups, uint32_t threadsPerGroup) {
+        const uint64_t count = uint64_t(groups) * threadsPerGroup;
+        assert(count <= std::numeric_limits<uint32_t>::max() && "threadgroup grid too large");
+        return count <= std::numeric_limits<uint32_t>::max() ? uint32_t(count) : std::numeric_limits<uint32_t>::max() / threadsPerGroup * threadsPerGroup;
+    };
+    dispatchThreads({ threads(threadgroups.width, threadgroup.width), threads(threadgroups.height, threadgroup.height), threads(threadgroups.depth, threadgroup.depth) }, threadgroup, kernel);
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Particles.h"
+
+// Smoothed particle hydrodynamics (Müller et al. 2003) for `particles::Particle`s: poly6 density, a linear equation of state for pressure, spiky pressure forces and the Laplacian viscosity term, integrated with the same Verlet step as `particleUpdate`.
+// Neighbours are found through a uniform grid of `smoothingRadius` sized cells over the bounds, hashed into a table with at least one bucket per particle (and more than two slices of the grid, so that a cell's neighbours never collide). The table is rebuilt every step by a counting sort, which also reorders the particles so that each cell's particles are contiguous and each row of neighbouring cells is one range; every phase is O(n) and runs over the buckets in parallel.
+
+namespace fluid {
+
+struct Parameters {
+    // The kernel support `h`, in metres; also the grid cell size.
+    float smoothingRadius = 0.0457f;
+    float particleMass = 0.02f;
+    float restDensity = 998.29f;
+    // Gas constant `k` in `pressure = k * (density - restDensity)`.
+    float stiffness = 3;
+    // Dynamic viscosity `mu`.
+    float viscosity = 3.5f;
+    // Particles are kept inside this box. Those that cross a wall are put back on it, and the velocity along the wall's normal is reversed and scaled by `restitution`.
+    float boundsMin[3] = { 0, 0, 0 };
+    float boundsMax[3] = { 1, 1, 1 };
+    float restitution = 0.5f;
+};
+
+// Wall clock seconds spent in each phase of one step.
+struct Timings {
+    // Hashing, the counting sort, and reordering the particle arrays.
+    double grid = 0;
+    // Density and pressure.
+    double density = 0;
+    // Pressure and viscosity forces, in one neighbour pass.
+    double forces = 0;
+    double integrate = 0;
+
+    double total() const {
+        return grid + density + forces + integrate;
+    }
+};
+
+class Solver {
+public:
+    explicit Solver(const Parameters &parameters = Parameters());
+
+    const Parameters &parameters() const {
+        return settings;
+    }
+
+    size_t count() const {
+        return ids.size();
+    }
+
+    // Replaces the fluid with `count` particles. Velocities come from `position - oldPosition` as in `particleUpdate`; `lifetime` is ignored and fluid particles never die.
+    void setParticles(const particles::Particle *input, size_t count);
+
+    // Writes the particles in the order they were given to `setParticles`, with `acceleration` holding the last step's SPH acceleration.
+    void exportParticles(particles::Particle *output) const;
+
+    // Densities from the last step, in the order given to `setParticles`.
+    void exportDensities(float *output) const;
+
+    // One step of `environment.timestep` seconds under `environment.gravity`. `drag` and `mass` are not used: the fluid's own viscosity and `Parameters::particleMass` take their place.
+    Timings step(const particles::Environment &environment);
+
+    // Number of grid buckets, a power of two.
+    size_t bucketCount() const {
+        return bucketStarts.empty() ? 0 : bucketStarts.size() - 1;
+    }
+
+private:
+    Parameters settings;
+    // Particle arrays in grid order, permuted by every step's counting sort.
+    std::vector<float> positions[3];
+    std::vector<float> oldPositions[3];
+    std::vector<float> accelerations[3];
+    std::vector<float> ages;
+    std::vector<float> densities;
+    std::vector<float> pressures;
+    // The `setParticles` index of each particle.
+    std::vector<uint32_t> ids;
+    // Particles [bucketStarts[b], bucketStarts[b + 1]) hash to bucket `b`.
+    std::vector<uint32_t> bucketStarts;
+    // Sort scratch: each particle's bucket, the permutation, and the arrays being permuted into.
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> order;
+    std::vector<float> scratch;
+    std::vector<uint32_t> scratchIds;
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Host side Life that produces the same generations as `gpuLifeKernelWrap`/`gpuLifeKernalNoWrap` (RenderKitShaders/Classic/GPULifeKernel.metal) and `gameOfLifeGENERIC` (ComputeTool/GameOfLife.metal).
+
+namespace gameOfLife {
+
+// A Life-like (outer totalistic) rule. Bit n of `birth` is set if a dead cell with n live neighbours comes alive, bit n of `survival` if a live cell with n live neighbours stays alive. Defaults to B3/S23, the rule hardwired into `rules(count, alive)`.
+struct Rule {
+    uint16_t birth = 1 << 3;
+    uint16_t survival = 1 << 2 | 1 << 3;
+
+    // Accepts "B3/S23" style strings (case insensitive, either order, slash optional) and the older "23/3" survival/birth notation. A rule with no digits must name both sets, as in "B/S". Returns nothing for anything else.
+    static std::optional<Rule> parse(std::string_view string);
+
+    // Canonical "B…/S…" form.
+    std::string toString() const;
+
+    bool isConway() const {
+        return *this == Rule();
+    }
+
+    bool next(unsigned count, bool alive) const {
+        return ((alive ? survival : birth) >> count) & 1;
+    }
+
+    bool operator==(const Rule &other) const {
+        return birth == other.birth && survival == other.survival;
+    }
+};
+
+// A board packed 64 cells per word, bit `x % 64` of word `x / 64` in each row. Bits past `width` in the last word of a row are always zero.
+class Board {
+public:
+    Board(uint32_t width = 0, uint32_t height = 0);
+
+    // One byte per cell (like the `r8Uint` textures the kernels use); non-zero means alive. `bytesPerRow` defaults to `width`.
+    static Board fromCells(const uint8_t *cells, uint32_t width, uint32_t height, size_t bytesPerRow = 0);
+    // Writes 1 for alive and 0 for dead cells, matching what the kernels write.
+    void toCells(uint8_t *cells, size_t bytesPerRow = 0) const;
+
+    uint32_t width() const {
+        return columns;
+    }
+
+    uint32_t height() const {
+        return rows;
+    }
+
+    uint32_t wordsPerRow() const {
+        return stride;
+    }
+
+    bool get(uint32_t x, uint32_t y) const {
+        return (row(y)[x / 64] >> (x % 64)) & 1;
+    }
+
+    void set(uint32_t x, uint32_t y, bool alive) {
+        const uint64_t bit = uint64_t(1) << (x % 64);
+        row(y)[x / 64] = alive ? row(y)[x / 64] | bit : row(y)[x / 64] & ~bit;
+    }
+
+    const uint64_t *row(uint32_t y) const {
+        return words.data() + size_t(y) * stride;
+    }
+
+    uint64_t *row(uint32_t y) {
+        return words.data() + size_t(y) * stride;
+    }
+
+    size_t population() const;
+
+    bool operator==(const Board &other) const {
+        return columns == other.columns && rows == other.rows && words == other.words;
+    }
+
+private:
+    uint32_t columns;
+    uint32_t rows;
+    uint32_t stride;
+    std::vector<uint64_t> words;
+};
+
+// Computes the next generation of `input` into `output`, resizing it if needed. With `wrap` the board is a torus (like `gpuLifeKernelWrap`), otherwise cells beyond the edges are dead (like `gpuLifeKernalNoWrap`).
+// Neighbours are counted 64 (or 256 with AVX2) cells at a time with bit-sliced adders, and rows are split into bands across the worker pool. B3/S23 takes a hardwired path; other rules test each neighbour count the rule uses.
+void step(const Board &input, Board &output, bool wrap, const Rule &rule = Rule());
+
+// Advances `board` by `generations` generations.
+void run(Board &board, unsigned generations, bool wrap, const Rule &rule = Rule());
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Host side graphtoy (https://graphtoy.com): the helper functions RenderKitShaders/include/GraphToy.h ports, evaluated over float arrays eight lanes at a time, and a compiler from graphtoy expression strings such as `smoothstep(0,1,x)*noise(x*4)` to a register bytecode that runs over large batches.
+// Everything is single precision, and the integer hash behind `cellnoise`, `voronoi` and `noise` wraps modulo 2^32 as the shaders' does. graphtoy.com itself computes in doubles and rounds the hash's 32 × 32 bit products to 53 bits, so it can disagree with both where those products are large. Inputs to the hashed functions must stay within ±2^31.
+
+namespace graphtoy {
+
+// Every operation a compiled expression can perform: the arithmetic operators, JavaScript's Math functions graphtoy exposes, and graphtoy's own helpers.
+enum class Function : uint8_t {
+    // Operators
+    negate,
+    add,
+    subtract,
+    multiply,
+    divide,
+    // JavaScript's `%`: the remainder truncated towards zero, like fmod.
+    remainder,
+
+    // One argument
+    abs,
+    sign,
+    floor,
+    ceil,
+    // JavaScript's Math.round: halves round up.
+    round,
+    trunc,
+    sqrt,
+    cbrt,
+    exp,
+    log,
+    log2,
+    log10,
+    sin,
+    cos,
+    tan,
+    asin,
+    acos,
+    atan,
+    sinh,
+    cosh,
+    tanh,
+    asinh,
+    acosh,
+    atanh,
+    saturate,
+    // 1 for x >= 0 (including -0), else -1.
+    ssign,
+    radians,
+    degrees,
+    inversesqrt,
+    rcbrt,
+    rcp,
+    frac,
+    exp2,
+    exp10,
+    cellnoise,
+    voronoi,
+    noise,
+
+    // Two arguments
+    pow,
+    atan2,
+    min,
+    max,
+    // step(a, x): 0 for x < a, else 1.
+    step,
+    // x - y * floor(x / y): the sign follows y.
+    mod,
+    over,
+    // sqr(a, x): a square wave, 1 where sin(x) > a, else -1.
+    sqr,
+    // tri(a, x): a triangle wave of period 2π peaking at phase a.
+    tri,
+
+    // Three arguments
+    clamp,
+    smoothstep,
+    mix,
+    fma,
+
+    // Five arguments: remap(a, b, x, c, d) maps x from [a, b] to [c, d], clamping outside.
+    remap,
+};
+
+// How many arguments `function` takes.
+unsigned arity(Function function);
+
+// The function graphtoy calls `name` (including the aliases `fract`, `rsqrt` and `lerp`), if any. Operators have no names.
+std::optional<Function> functionNamed(std::string_view name);
+
+// `function` of one set of arguments, `arity(function)` of them.
+float evaluate(Function function, const float *arguments);
+
+// `output[i] = function(arguments[0][i], …)` for i < `count`, eight lanes at a time across the worker pool. `output` may alias any of the arguments.
+void evaluate(Function function, const float *const *arguments, float *output, size_t count);
+
+// Scalar forms of the helpers whose batches are most used on their own.
+float cellnoise(float x);
+float voronoi(float x);
+float noise(float x);
+
+// A graphtoy expression of `x` and `t` compiled to bytecode. The syntax is graphtoy's: numbers, `x`, `t`, the constants `PI` and `E`, calls of any `Function` by name, unary `-` and `+`, and the binary `+ - * / %` with the usual precedence. Subexpressions of constants are folded at compile time.
+class Expression {
+public:
+    // One bytecode step: `registers[output] = function(registers[inputs[0]], …)`.
+    struct Instruction {
+        Function function;
+        uint16_t output;
+        uint16_t inputs[5];
+    };
+
+    // Register 0 holds x and register 1 holds t; constants follow, then temporaries.
+    static constexpr uint16_t xRegister = 0;
+    static constexpr uint16_t tRegister = 1;
+
+    // Compiles `source`. Returns false, with a message in `error()`, if it is not a valid expression; the previous program is kept.
+    bool compile(std::string_view source);
+
+    const std::string &error() const {
+        return message;
+    }
+
+    // The expression at one point.
+    float evaluate(float x, float t = 0) const;
+
+    // The expression at every `x[i]` for i < `count`, with `t` the same throughout, in blocks across the worker pool. `output` may alias `x`.
+    void evaluate(const float *x, float *output, size_t count, float t = 0) const;
+
+    const std::vector<Instruction> &instructions() const {
+        return program;
+    }
+
+    const std::vector<float> &constants() const {
+        return constantValues;
+    }
+
+    // Registers the program uses, including x, t and the constants.
+    uint16_t registerCount() const {
+        return registers;
+    }
+
+    // The register that holds the result once every instruction has run.
+    uint16_t resultRegister() const {
+        return result;
+    }
+
+private:
+    std::vector<Instruction> program;
+    std::vector<float> constantValues;
+    uint16_t registers = 2;
+    uint16_t result = xRegister;
+    std::string message;
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+// Conversions between float and the bits of an IEEE binary16 `half`, for filling Metal vertex buffers and textures from the host.
+
+namespace half {
+
+// Rounds to nearest, ties to even. Values too large for a half become infinity and NaNs stay NaNs.
+inline uint16_t fromFloat(float value) {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7fffffff;
+    if (magnitude >= 0x7f800000) {
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    }
+    // 65520 and up round to infinity.
+    if (magnitude >= 0x477ff000) {
+        return sign | 0x7c00;
+    }
+    // Below 2^-14 the result is subnormal; at or below 2^-25 it rounds to zero.
+    if (magnitude < 0x38800000) {
+        if (magnitude <= 0x33000000) {
+            return sign;
+        }
+        const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        const uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t result = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        result += remainder > halfway || (remainder == halfway && (result & 1));
+        return sign | uint16_t(result);
+    }
+    // Rebias the exponent from 127 to 15 and drop 13 mantissa bits; a carry out of the mantissa correctly bumps the exponent.
+    uint32_t result = (magnitude - 0x38000000) >> 13;
+    const uint32_t remainder = magnitude & 0x1fff;
+    result += remainder > 0x1000 || (remainder == 0x1000 && (result & 1));
+    return sign | uint16_t(result);
+}
+
+// Exact.
+inline float toFloat(uint16_t bits) {
+    const uint32_t sign = uint32_t(bits & 0x8000) << 16;
+    const uint32_t exponent = (bits >> 10) & 0x1f, mantissa = bits & 0x3ff;
+    if (exponent == 0x1f) {
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    }
+    if (exponent == 0) {
+        // Subnormal or zero: mantissa * 2^-24.
+        const float magnitude = float(mantissa) * 0x1p-24f;
+        return sign ? -magnitude : magnitude;
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// KTX 1 and KTX 2 texture containers, memory mapped. Opening a file reads only the header and level index; a level, an image or a region of blocks is paged in when it is copied out, so a gigapixel panorama costs address space until parts of it are displayed.
+
+namespace textures {
+
+// The size of one block of the pixel format: 1 × 1 × 1 texels for uncompressed formats, e.g. 8 × 8 × 1 for ASTC 8x8.
+struct BlockFormat {
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t bytes;
+};
+
+class KTXFile {
+public:
+    // Maps and parses `path`. Returns false, with a message in `error()`, if the file cannot be read, is not KTX, is big endian, is supercompressed or uses a format whose block size is unknown.
+    bool open(const std::string &path);
+
+    // Parses a file already in memory. The bytes must outlive this object and every copy of it.
+    bool parse(const uint8_t *bytes, size_t size);
+
+    const std::string &error() const {
+        return message;
+    }
+
+    // 1 or 2.
+    uint32_t version() const {
+        return fileVersion;
+    }
+
+    // `vkFormat` for KTX 2 files, `glInternalFormat` for KTX 1.
+    uint32_t format() const {
+        return pixelFormat;
+    }
+
+    const BlockFormat &blockFormat() const {
+        return block;
+    }
+
+    uint32_t width() const {
+        return size[0];
+    }
+
+    uint32_t height() const {
+        return size[1];
+    }
+
+    // 1 for 2D textures.
+    uint32_t depth() const {
+        return size[2];
+    }
+
+    uint32_t levelCount() const {
+        return levels;
+    }
+
+    // 1 unless the texture is an array.
+    uint32_t layerCount() const {
+        return layers;
+    }
+
+    // 6 for cube maps, otherwise 1.
+    uint32_t faceCount() const {
+        return faces;
+    }
+
+    uint32_t levelWidth(uint32_t level) const {
+        return std::max(size[0] >> level, 1u);
+    }
+
+    uint32_t levelHeight(uint32_t level) const {
+        return std::max(size[1] >> level, 1u);
+    }
+
+    // Blocks across and down one image of a level.
+    uint32_t blocksWide(uint32_t level) const {
+        return (levelWidth(level) + block.width - 1) / block.width;
+    }
+
+    uint32_t blocksHigh(uint32_t level) const {
+        return (levelHeight(level) + block.height - 1) / block.height;
+    }
+
+    // Bytes from one row of blocks to the next, including KTX 1's four byte row alignment for uncompressed formats.
+    size_t bytesPerRow(uint32_t level) const;
+
+    // Bytes of one 2D image (one depth slice of one face of one layer) of a level.
+    size_t imageBytes(uint32_t level) const {
+        return bytesPerRow(level) * blocksHigh(level);
+    }
+
+    // The first depth slice of an image, or nullptr if the indices are out of range.
+    const uint8_t *image(uint32_t level, uint32_t layer = 0, uint32_t face = 0) const;
+
+    // Copies blocks [blockX, blockX + blocksAcross) × [blockY, blockY + blocksDown) of an image into `output`, rows `outputBytesPerRow` apart. Blocks outside the image repeat the nearest edge block. Returns false if the image does not exist.
+    bool copyBlocks(uint32_t level, uint32_t layer, uint32_t face, int32_t blockX, int32_t blockY, uint32_t blocksAcross, uint32_t blocksDown, uint8_t *output, size_t outputBytesPerRow) const;
+
+private:
+    struct Mapping;
+
+    bool parseVersion1(const uint8_t *bytes, size_t size);
+    bool parseVersion2(const uint8_t *bytes, size_t size);
+
+    std::shared_ptr<Mapping> mapping;
+    std::string message;
+    uint32_t fileVersion = 0;
+    uint32_t pixelFormat = 0;
+    BlockFormat block = {};
+    bool padRows = false;
+    uint32_t size[3] = {};
+    uint32_t levels = 0;
+    uint32_t layers = 0;
+    uint32_t faces = 0;
+    // Where each level's data starts, and for KTX 1 cube maps the (padded) bytes from one face to the next; zero means faces are packed like layers.
+    const uint8_t *levelData[32] = {};
+    size_t faceStride[32] = {};
+};
+
+}
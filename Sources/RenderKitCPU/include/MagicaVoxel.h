@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace voxels {
+
+// Same layout as `MagicaVoxel` in Classic/include/Voxels.h, where the `uchar3` position takes four bytes. Kept apart from VoxelMeshing.h so that code compiled against the Metal shim, whose `half` clashes with Half.h, can use it too.
+struct alignas(4) MagicaVoxel {
+    uint8_t position[3];
+    uint8_t unused;
+    uint8_t color;
+};
+
+static_assert(sizeof(MagicaVoxel) == 8);
+
+}
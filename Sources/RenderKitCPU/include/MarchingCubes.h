@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Host side isosurface extraction. Uses the same tables and cube/edge numbering as `Polygonise()` in RenderKitShaders/MarchingCubes.metal.
+
+namespace marchingCubes {
+
+struct PackedFloat3 {
+    float x;
+    float y;
+    float z;
+};
+
+// A dense scalar field sampled on a width × height × depth lattice. Values are stored x fastest, then y, then z.
+struct ScalarGrid {
+    const float *values;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    PackedFloat3 origin = { 0, 0, 0 }; // position of sample (0, 0, 0)
+    PackedFloat3 spacing = { 1, 1, 1 }; // distance between neighbouring samples
+
+    float value(uint32_t x, uint32_t y, uint32_t z) const {
+        return values[(size_t(z) * height + y) * width + x];
+    }
+};
+
+// Same layout as the first 24 bytes of `SimpleVertex`.
+struct Vertex {
+    PackedFloat3 position;
+    PackedFloat3 normal; // normalised negative field gradient, consistent with the triangle winding
+};
+
+struct IndexedMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices; // triangle list
+};
+
+struct Triangle {
+    PackedFloat3 p[3];
+};
+
+// Extracts the isosurface of `grid` at `isolevel` as a welded mesh. The grid is split into z slabs that are processed in parallel; each edge crossing is interpolated once and shared by every cell (and triangle) that touches it.
+IndexedMesh extractIsosurface(const ScalarGrid &grid, float isolevel);
+
+// Keeps an isosurface in sync with a field that is edited in place. The field is divided into bricks of `brickSize`³ cells with a min/max pyramid over them, so bricks that cannot contain `isolevel` are skipped without classifying their cells. After an edit only the bricks touching the edited samples are re-extracted; `mesh()` splices the per-brick results back into one welded mesh.
+class BrickedIsosurface {
+public:
+    BrickedIsosurface(const ScalarGrid &grid, float isolevel, uint32_t brickSize = 16);
+
+    float isolevel() const {
+        return currentIsolevel;
+    }
+
+    // Re-extracts every brick whose value range straddles the new isolevel (and clears those that no longer do).
+    void setIsolevel(float isolevel);
+
+    // Call after writing new values into the field for the samples in the inclusive box [min, max].
+    void invalidate(uint32_t minX, uint32_t minY, uint32_t minZ, uint32_t maxX, uint32_t maxY, uint32_t maxZ);
+
+    const IndexedMesh &mesh();
+
+    size_t brickCount() const {
+        return bricks.size();
+    }
+
+    // Number of bricks whose value range straddles the isolevel.
+    size_t activeBrickCount() const;
+
+private:
+    struct Brick {
+        float minValue;
+        float maxValue;
+        bool active = false;
+        std::vector<Vertex> vertices;
+        std::vector<uint64_t> edgeKeys; // lattice edge of each vertex, ascending
+        std::vector<uint32_t> indices; // local vertex ids, or tagged indices into `foreignKeys`
+        std::vector<uint64_t> foreignKeys; // edges owned by neighbouring bricks
+    };
+
+    struct Range {
+        float minValue;
+        float maxValue;
+    };
+
+    size_t brickIndex(uint32_t bx, uint32_t by, uint32_t bz) const {
+        return (size_t(bz) * brickDimensions[1] + by) * brickDimensions[0] + bx;
+    }
+
+    void updateRange(size_t index);
+    void rebuildHierarchy();
+    void collectStraddlingBricks(size_t level, uint32_t x, uint32_t y, uint32_t z, std::vector<size_t> &result) const;
+    void extractBricks(const std::vector<size_t> &indices);
+    void extractBrick(size_t index);
+
+    ScalarGrid grid;
+    float currentIsolevel;
+    uint32_t brickSize;
+    uint32_t brickDimensions[3];
+    std::vector<Brick> bricks;
+    std::vector<std::vector<Range>> hierarchy; // level 0 mirrors the bricks, each level above halves every dimension
+    std::vector<uint32_t> hierarchyDimensions; // x, y, z per level
+    IndexedMesh assembledMesh;
+    bool needsAssembly = true;
+};
+
+// Single threaded reference that runs `Polygonise()` cell by cell and returns an unwelded triangle soup.
+std::vector<Triangle> extractTriangleSoup(const ScalarGrid &grid, float isolevel);
+
+}
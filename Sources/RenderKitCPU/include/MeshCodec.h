@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Lossless compression of index and vertex buffers for storing meshes on disk. Both codecs are byte oriented and decode at around 1 GB/s per core, and streams are cut into chunks that decode independently across the worker pool.
+// Indices are coded one at a time against the next vertex not yet used: that vertex is a single zero byte, and an earlier one is its distance back, as a LEB128 varint. After `MeshOptimizer` (cache order, then fetch order) triangles cost about 3.5 bytes, against 6 or 12 uncompressed.
+// Vertices are split into byte columns, each byte delta coded against the same byte of the previous vertex, and the deltas bit packed 16 at a time at 0, 2, 4 or 8 bits each. Smooth meshes in fetch order, quantized (VertexQuantization.h) or not, shrink to around 40%.
+// Streams are little endian, start with a 16 byte header and are limited to 4 GB.
+
+namespace meshCodec {
+
+enum class Stream : uint8_t {
+    indices,
+    vertices,
+};
+
+struct Header {
+    Stream stream;
+    // Indices or vertices.
+    uint32_t count;
+    // Bytes per vertex; 4 for index streams.
+    uint32_t stride;
+};
+
+// The header of an encoded stream, or nothing if `data` does not start with one.
+std::optional<Header> readHeader(const uint8_t *data, size_t size);
+
+std::vector<uint8_t> encodeIndices(const uint32_t *indices, size_t count);
+std::vector<uint8_t> encodeIndices(const uint16_t *indices, size_t count);
+
+// Decodes `count` indices. Returns false if `data` is not an index stream of `count` indices, is corrupt, or (for 16 bit output) holds an index over 65535; `indices` may then be partly written.
+bool decodeIndices(const uint8_t *data, size_t size, uint32_t *indices, size_t count);
+bool decodeIndices(const uint8_t *data, size_t size, uint16_t *indices, size_t count);
+
+std::vector<uint8_t> encodeVertices(const void *vertices, size_t count, size_t stride);
+
+// Decodes `count` vertices of `stride` bytes. Returns false if `data` is not a vertex stream of that shape or is corrupt; `vertices` may then be partly written.
+bool decodeVertices(const uint8_t *data, size_t size, void *vertices, size_t count, size_t stride);
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace parallel {
+
+// Number of threads (including the calling thread) that `parallelFor` spreads work across. Defaults to the hardware concurrency.
+unsigned threadCount();
+
+// Resizes the shared worker pool. Passing 0 restores the hardware concurrency. Must not be called from inside `parallelFor`.
+void setThreadCount(unsigned count);
+
+// Splits [0, count) into chunks of at most `grain` items and calls `body(begin, end)` for each chunk on the worker pool. The calling thread participates and the call blocks until every chunk has run. Nested calls run serially on the calling thread.
+void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body);
+
+}
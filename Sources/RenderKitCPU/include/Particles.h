@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Host side particles with the same physics as `particleUpdate` (RenderKitShaders/Classic/ParticleShaders.metal): Verlet steps under gravity and quadratic drag, with particles dying when they run out of lifetime or fall below y = 0.
+// State is kept as structure of arrays and stepped eight particles at a time across the worker pool. Dead particles go on a free list, which emitters refill in batches.
+
+namespace particles {
+
+// Byte for byte the `Particle` struct in Classic/include/ParticleShaders.h: three 16 byte simd_float3s (the fourth float of each is padding), then age and lifetime, 64 bytes in all.
+struct alignas(16) Particle {
+    float position[4];
+    float oldPosition[4];
+    float acceleration[4];
+    float age;
+    float lifetime;
+    float padding[2];
+};
+
+static_assert(sizeof(Particle) == 64);
+
+// `ParticlesEnvironment` plus the constants `particleUpdate` passes to `apply_forces`.
+struct Environment {
+    float gravity[3] = { 0, -9.81f, 0 };
+    float timestep = 1.0f / 60;
+    float drag = 0.1f;
+    float mass = 1;
+};
+
+// Where new particles start. The kernel's respawn is the default: at the origin, at rest, with an initial acceleration of (random + accelerationOffset) * accelerationScale.
+struct Emitter {
+    float origin[3] = { 0, 0, 0 };
+    float accelerationOffset[3] = { -0.5f, 0, -0.5f };
+    float accelerationScale[3] = { 200, 2000, 200 };
+    float lifetime = 5;
+    // Mixed with the particle index and the step count, so every spawn draws different values.
+    uint32_t seed = 0;
+};
+
+class System {
+public:
+    // Every particle starts dead, with all `capacity` slots on the free list.
+    explicit System(size_t capacity = 0);
+
+    size_t capacity() const {
+        return count;
+    }
+
+    size_t liveCount() const {
+        return count - freeList.size();
+    }
+
+    size_t freeCount() const {
+        return freeList.size();
+    }
+
+    uint64_t stepCount() const {
+        return steps;
+    }
+
+    bool isAlive(size_t index) const {
+        return alive[index] != 0;
+    }
+
+    // Brings up to `count` dead particles back to life, taking slots from the end of the free list, and returns how many it emitted.
+    size_t emit(size_t count, const Emitter &emitter);
+
+    // One Verlet step of every live particle. Particles that end the step dead are moved to the free list.
+    void step(const Environment &environment);
+
+    // Respawns everything that died in earlier steps, then steps: what one `particleUpdate` dispatch does.
+    void step(const Environment &environment, const Emitter &respawn);
+
+    // The state of particle `index` in the kernel's layout. Dead particles keep their last state, which the kernel also treats as dead.
+    Particle particle(size_t index) const;
+
+    // Writes all `capacity()` particles in the kernel's layout, in parallel.
+    void exportParticles(Particle *output) const;
+
+    // Replaces the state with `capacity()` particles in the kernel's layout (e.g. read back from a GPU buffer) and rebuilds the free list from the kernel's death test.
+    void importParticles(const Particle *input);
+
+private:
+    size_t count;
+    // Rounded up to a multiple of eight; the extra slots are permanently dead and never on the free list.
+    size_t paddedCount;
+    std::vector<float> positions[3];
+    std::vector<float> oldPositions[3];
+    std::vector<float> accelerations[3];
+    std::vector<float> ages;
+    std::vector<float> lifetimes;
+    // -1 for live particles and 0 for dead ones, so eight of them load as a lane mask.
+    std::vector<int32_t> alive;
+    std::vector<uint32_t> freeList;
+    uint64_t steps = 0;
+};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VolumeRenderer.h"
+
+// Pre-integrated transfer functions. Rather than classifying single samples, the renderer looks up the colour and opacity of a whole segment between two samples, integrated over every value the segment passes through on the way. Thin features of the transfer function are then no longer missed between samples, so far fewer slices or samples per ray give the same image.
+
+namespace volume {
+
+// A size × size table of premultiplied RGBA, indexed by the normalized values at the front (x) and back (y) of a segment `segmentLength` long, in `Camera`'s volume box units. Opacity follows the slice renderer: material is `transferFunction.a * alpha / instanceCount` opaque per reference slice 1 / instanceCount thick. Along the segment values are taken to vary linearly and are integrated front to back at every texel they cross.
+class PreIntegratedTable {
+public:
+    PreIntegratedTable(const TransferFunction &transferFunction, const FragmentUniforms &uniforms, float segmentLength);
+
+    // Recomputes the entries that read texels [first, first + count) after `transferFunction`, the one the table was built from, has been edited there, e.g. with `TransferFunction::update`. Only segments whose value range reaches the edited texels change.
+    void update(const TransferFunction &transferFunction, size_t first, size_t count);
+
+    uint32_t size() const {
+        return dimension;
+    }
+
+    float segmentLength() const {
+        return length;
+    }
+
+    // size × size RGBA floats, rows by back value.
+    const float *data() const {
+        return entries.data();
+    }
+
+    // Bilinear lookup, clamped to the edge, as a texture sampler would.
+    void sample(float front, float back, float *rgba) const;
+
+    // The table as rgba16Float texels, for a `texture2d<float>` for `volumePreIntegratedFragmentShader`.
+    void exportHalf(uint16_t *output) const;
+
+private:
+    void integrate(const TransferFunction &transferFunction, uint32_t firstRow, uint32_t lastRow, uint32_t firstColumn, uint32_t lastColumn);
+
+    uint32_t dimension;
+    float length;
+    float sliceAlpha;
+    float referenceSlices;
+    std::vector<float> entries;
+};
+
+}
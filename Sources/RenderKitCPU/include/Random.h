@@ -0,0 +1,5 @@
+#pragma once
+
+// The shaders' integer hash random functions (RenderKitShaders/include/HashRandom.h), which compile as host C++ too. Host code gets the same values as the GPU, bit for bit.
+
+#include "../../RenderKitShaders/include/HashRandom.h"
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A software rasterizer for rendering without a GPU: thumbnails and golden images on machines without Metal. It draws the same vertex and uniform data as `flatShaderVertexShader`/`flatShaderFragmentShader` (RenderKitShaders/FlatShader.metal) and `unlitVertexShader`/`unlitFragmentShader` (UnlitShader.metal). Triangles are clipped, binned into screen tiles, and the tiles rasterized in parallel with fixed point edge functions evaluated a row of pixels at a time, against a depth buffer.
+
+namespace raster {
+
+// Same layout as `SimpleVertex` in CommonTypes.h: packed positions and normals, then a simd_float2.
+struct Vertex {
+    float position[3];
+    float normal[3];
+    float textureCoordinate[2];
+};
+
+static_assert(sizeof(Vertex) == 32);
+
+// Same layout as `ModelTransforms`: column major simd_float4x4 and simd_float3x3, whose columns take 16 bytes.
+struct alignas(16) ModelTransforms {
+    float modelViewMatrix[4][4];
+    float modelNormalMatrix[3][4];
+};
+
+static_assert(sizeof(ModelTransforms) == 112);
+
+// Same layout as `CameraUniforms`.
+struct alignas(16) CameraUniforms {
+    float projectionMatrix[4][4];
+};
+
+// Same layout as `LightUniforms`; each simd_float3 takes 16 bytes.
+struct alignas(16) LightUniforms {
+    float lightPosition[3];
+    float lightPositionPadding;
+    float lightColor[3];
+    float lightColorPadding;
+    float lightPower;
+    float lightPowerPadding[3];
+    float ambientLightColor[3];
+    float ambientLightColorPadding;
+};
+
+static_assert(sizeof(LightUniforms) == 64);
+
+// Same layout as `FlatMaterial` in FlatShader.h. The shader ignores the texture indices, and so does the rasterizer.
+struct alignas(16) FlatMaterial {
+    float diffuseColor[4];
+    int16_t diffuseTextureIndex;
+    alignas(16) float ambientColor[4];
+    int16_t ambientTextureIndex;
+};
+
+static_assert(sizeof(FlatMaterial) == 64);
+
+// Same layout as `UnlitMaterial` in UnlitShader.h.
+struct alignas(16) UnlitMaterial {
+    float color[4];
+    int16_t textureIndex;
+};
+
+static_assert(sizeof(UnlitMaterial) == 32);
+
+// An rgba8Unorm texture, sampled as `basicSampler`: linear, clamped to the edge, top row first.
+struct Texture {
+    const uint8_t *rgba8;
+    uint32_t width;
+    uint32_t height;
+};
+
+// A triangle list. With `indices` null, every three vertices make a triangle.
+struct Mesh {
+    const Vertex *vertices;
+    size_t vertexCount;
+    const uint32_t *indices = nullptr;
+    size_t indexCount = 0;
+};
+
+struct DrawStatistics {
+    // Triangles after clipping to the view volume that contain at least one pixel centre's bounds, so were binned.
+    uint64_t triangles = 0;
+    // Fragments that passed the depth test.
+    uint64_t fragments = 0;
+};
+
+class Rasterizer {
+public:
+    // A `width` × `height` colour and depth target, binned in `tileSize` pixel squares.
+    Rasterizer(uint32_t width, uint32_t height, uint32_t tileSize = 64);
+
+    uint32_t width() const {
+        return targetWidth;
+    }
+
+    uint32_t height() const {
+        return targetHeight;
+    }
+
+    // Clears as a render pass's `loadAction = .clear` would.
+    void clear(const float *rgba, float depth = 1);
+
+    // Draws `instanceCount` instances of `mesh`, instance i with `transforms[i]` and `materials[i]`, as the flat shader does: a diffuse term from the triangle's first vertex's normal and one point light, plus ambient.
+    DrawStatistics drawFlat(const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const LightUniforms &light, const FlatMaterial *materials);
+
+    // Draws as the unlit shader does: each instance's material colour, or `textures[textureIndex]` sampled at the perspective correct texture coordinate.
+    DrawStatistics drawUnlit(const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const UnlitMaterial *materials, const Texture *textures = nullptr, size_t textureCount = 0);
+
+    // width × height linear RGBA floats, row by row from the top.
+    const float *color() const {
+        return colorBuffer.data();
+    }
+
+    // width × height depths in 0...1, as a depth32Float attachment.
+    const float *depth() const {
+        return depthBuffer.data();
+    }
+
+    // The colour target as rgba8Unorm, clamped.
+    void toRGBA8(uint8_t *output) const;
+
+private:
+    enum class Shading {
+        flat,
+        unlit,
+    };
+
+    DrawStatistics draw(Shading shading, const Mesh &mesh, uint32_t instanceCount, const CameraUniforms &camera, const ModelTransforms *transforms, const LightUniforms *light, const FlatMaterial *flatMaterials, const UnlitMaterial *unlitMaterials, const Texture *textures, size_t textureCount);
+
+    uint32_t targetWidth;
+    uint32_t targetHeight;
+    uint32_t tile;
+    uint32_t tilesWide;
+    uint32_t tilesHigh;
+    std::vector<float> colorBuffer;
+    std::vector<float> depthBuffer;
+};
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// This is the umbrella header for the host (CPU) module. It is C++ only; import it from Swift with C++ interoperability enabled.
+
+#include "Parallel.h"
+#include "Random.h"
+#include "MarchingCubes.h"
+#include "GameOfLife.h"
+#include "SparseLife.h"
+#include "Sorting.h"
+#include "SimplexNoise.h"
+#include "Voronoi.h"
+#include "Particles.h"
+#include "Fluid.h"
+#include "Half.h"
+#include "MagicaVoxel.h"
+#include "VoxelMeshing.h"
+#include "VoxFile.h"
+#include "VoxelWorld.h"
+#include "VolumeRenderer.h"
+#include "BrickedVolume.h"
+#include "PreIntegration.h"
+#include "KTXFile.h"
+#include "VirtualTexture.h"
+#include "ClusteredLighting.h"
+#include "Rasterizer.h"
+#include "ComputeDispatch.h"
+#include "Trace.h"
+#include "GraphToy.h"
+#include "ColorConversion.h"
+#include "VertexQuantization.h"
+#include "MeshCodec.h"
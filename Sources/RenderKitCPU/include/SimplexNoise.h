@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host side simplex noise. The 2D function is `snoise(vec2)` from RenderKitShaders/Noise.metal; the 3D and 4D ones are its webgl-noise siblings (also in Noise.metal). Every function follows the shader's operation order in single precision and stays within 1e-5 of the GPU results (the differences come from FMA contraction and Metal's fast-math `floor`/`fract`), except at rare points within an ulp of a simplex boundary, where the two sides can pick different lattice corners.
+// Coordinates must stay within ±2^31, where single precision has long stopped resolving the noise anyway.
+
+namespace noise {
+
+// Scalar evaluation, one point at a time.
+float simplex(float x, float y);
+float simplex(float x, float y, float z);
+float simplex(float x, float y, float z, float w);
+
+// Batch evaluation over coordinate arrays (one array per axis). Points are evaluated eight at a time (AVX2 when the CPU has it) and chunks are spread across the worker pool. `output` may alias any of the inputs.
+void simplex2D(const float *x, const float *y, float *output, size_t count);
+void simplex3D(const float *x, const float *y, const float *z, float *output, size_t count);
+void simplex4D(const float *x, const float *y, const float *z, const float *w, float *output, size_t count);
+
+enum class FractalMode {
+    // Sum of octaves, normalised back to [-1, 1].
+    fbm,
+    // Sum of (1 - |noise|)² per octave, normalised to [0, 1]; sharp crests where the noise crosses zero.
+    ridged,
+};
+
+// Multi-octave noise. Octave n samples ((p + offset) * frequency * lacunarity^n) with weight gain^n; each octave is also shifted by a fixed amount so the octaves don't all pass through zero at the same lattice points.
+struct Fractal {
+    FractalMode mode = FractalMode::fbm;
+    unsigned octaves = 6;
+    float frequency = 1;
+    float lacunarity = 2;
+    float gain = 0.5;
+    float offset[4] = { 0, 0, 0, 0 };
+};
+
+void fractal2D(const Fractal &fractal, const float *x, const float *y, float *output, size_t count);
+void fractal3D(const Fractal &fractal, const float *x, const float *y, const float *z, float *output, size_t count);
+void fractal4D(const Fractal &fractal, const float *x, const float *y, const float *z, const float *w, float *output, size_t count);
+
+// Fills a `width` × `height` heightfield with 2D fractal noise sampled at (originX + column * spacing, originY + row * spacing), generating the coordinates on the fly. Rows are spread across the worker pool. `rowStride` is in floats and defaults to `width`.
+void heightfield(const Fractal &fractal, float *output, uint32_t width, uint32_t height, float originX, float originY, float spacing, size_t rowStride = 0);
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Host side key/payload sorting. `bitonicPass` is one dispatch of `bitonicSort` (Demos/Packages/Compute/Sources/ComputeTool/BitonicSort.metal) and `bitonicSort` runs the demo's full (groupWidth, groupHeight, stepIndex) schedule; `radixSort` replaces those O(log² n) passes with a parallel least-significant-digit radix sort.
+// Every function takes an optional payload array (typically an index into particle or draw arrays) that is permuted along with the keys; pass nullptr to sort bare keys. Float keys are sorted through an order-preserving bit flip, so -0 sorts before +0, and NaNs with the sign bit set sort before -inf and the others after +inf.
+
+namespace sorting {
+
+// Inputs up to this size go through the bitonic network; the radix passes only pay off beyond it.
+constexpr size_t bitonicThreshold = 4096;
+
+// The second copy of keys and payloads the radix passes ping-pong through. Reuse one across frames to avoid reallocating (and faulting in) hundreds of megabytes per sort. Contents are unspecified between calls.
+struct Scratch {
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> payloads;
+};
+
+// Sorts ascending by key with the radix backend, falling back to `bitonicSort` for `count <= bitonicThreshold`. Payloads of equal keys keep their relative order only on the radix path.
+void sort(uint32_t *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+void sort(uint64_t *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+void sort(float *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+
+// Stable LSD radix sort with 8 bit digits. Each pass splits the array into one block per worker, histograms the blocks, and scatters every block to its precomputed offsets. Digits that are the same for every key are detected up front and their passes skipped, so e.g. 64 bit keys that only use their low 40 bits take 5 passes instead of 8.
+void radixSort(uint32_t *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+void radixSort(uint64_t *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+void radixSort(float *keys, uint32_t *payloads, size_t count, Scratch *scratch = nullptr);
+
+// The complete bitonic network, in the same pass order `BitonicSortDemo` dispatches. Not stable.
+void bitonicSort(uint32_t *keys, uint32_t *payloads, size_t count);
+void bitonicSort(uint64_t *keys, uint32_t *payloads, size_t count);
+void bitonicSort(float *keys, uint32_t *payloads, size_t count);
+
+// One `bitonicSort` dispatch: every compare-and-swap of the (groupWidth, groupHeight, stepIndex) step, with `numEntries` not necessarily a power of two.
+void bitonicPass(uint32_t *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex);
+void bitonicPass(uint64_t *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex);
+void bitonicPass(float *keys, uint32_t *payloads, size_t numEntries, uint32_t groupWidth, uint32_t groupHeight, uint32_t stepIndex);
+
+}
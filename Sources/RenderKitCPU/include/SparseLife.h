@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "GameOfLife.h"
+
+// Unbounded Life universes for long runs where most of the plane is empty or has settled. Both engines ignore B0 in the rule (a birth on zero neighbours would fill the empty plane every other generation).
+
+namespace gameOfLife {
+
+struct Cell {
+    int64_t x;
+    int64_t y;
+};
+
+// A universe stored as 64 × 64 tiles of bit rows; tiles are only allocated where there are (or may soon be) live cells. Each tile keeps its last two generations, and is recomputed only when it or one of its eight neighbours differs from two generations earlier, so empty space, still lifes and period 2 oscillators (most of a settled soup) cost nothing. Active tiles are stepped in parallel with the same bit-sliced kernels as `step`.
+class SparseLife {
+public:
+    explicit SparseLife(const Rule &rule = Rule());
+
+    const Rule &rule() const {
+        return currentRule;
+    }
+
+    bool get(int64_t x, int64_t y) const;
+    void set(int64_t x, int64_t y, bool alive);
+
+    // Copies the live cells of `board` with its top left corner at (x, y).
+    void insert(const Board &board, int64_t x, int64_t y);
+    // Copies the `width` × `height` region with its top left corner at (x, y) into a board.
+    Board extract(int64_t x, int64_t y, uint32_t width, uint32_t height) const;
+    // Live cells in no particular order.
+    std::vector<Cell> cells() const;
+
+    void step();
+    void run(uint64_t generations);
+
+    uint64_t generation() const {
+        return generationCount;
+    }
+
+    size_t population() const;
+
+    size_t tileCount() const {
+        return tiles.size();
+    }
+
+    // Tiles whose neighbourhoods will be recomputed by the next `step()`.
+    size_t activeTileCount() const {
+        return activeTiles.size();
+    }
+
+private:
+    static constexpr int tileShift = 6;
+    static constexpr int64_t tileSize = 1 << tileShift;
+
+    struct Tile {
+        int32_t x;
+        int32_t y;
+        uint64_t rows[2][tileSize] = {}; // even and odd generations
+        uint64_t next[tileSize];
+        bool active = false; // differs from two generations ago (or was edited), and in `activeTiles`
+        bool changed = false;
+        bool edited = false;
+        uint64_t visited = 0; // generation it was last collected for stepping
+    };
+
+    static uint64_t key(int64_t tileX, int64_t tileY) {
+        return uint64_t(uint32_t(tileX)) << 32 | uint32_t(tileY);
+    }
+
+    Tile *findTile(int64_t tileX, int64_t tileY) const;
+    Tile &tile(int64_t tileX, int64_t tileY);
+    void activate(Tile &tile);
+
+    Rule currentRule;
+    std::unordered_map<uint64_t, Tile> tiles; // nodes are stable, so tiles can be referred to by pointer
+    std::vector<Tile *> activeTiles;
+    uint64_t generationCount = 0;
+};
+
+// Gosper's HashLife: the universe is a quadtree of canonical (hash-consed) nodes, and the centre of every node is memoized after 2^(level - 2) generations, so repeated structure in space and time is only ever computed once. `step(k)` advances 2^k generations in one call; `run` decomposes an arbitrary count into such jumps. The base case evaluates 4 × 4 cell blocks through a table compiled from the rule.
+// Single threaded. Memory grows with the number of distinct nodes seen; `collectGarbage()` drops everything that is not reachable from the current universe, and runs automatically once `nodeBudget` nodes exist.
+class HashLife {
+public:
+    explicit HashLife(const Rule &rule = Rule(), size_t nodeBudget = size_t(1) << 24);
+
+    const Rule &rule() const {
+        return currentRule;
+    }
+
+    bool get(int64_t x, int64_t y) const;
+    void set(int64_t x, int64_t y, bool alive);
+
+    // Copies the live cells of `board` with its top left corner at (x, y).
+    void insert(const Board &board, int64_t x, int64_t y);
+    // Copies the `width` × `height` region with its top left corner at (x, y) into a board.
+    Board extract(int64_t x, int64_t y, uint32_t width, uint32_t height) const;
+    // Live cells in no particular order.
+    std::vector<Cell> cells() const;
+
+    // Advances 2^log2Generations generations.
+    void step(unsigned log2Generations);
+    void run(uint64_t generations);
+
+    uint64_t generation() const {
+        return generationCount;
+    }
+
+    uint64_t population() const;
+
+    size_t nodeCount() const {
+        return nodes.size();
+    }
+
+    void collectGarbage();
+
+private:
+    typedef uint32_t NodeID;
+
+    // Level 0 nodes are single cells (0 is dead, 1 alive); a level n node covers 2^n × 2^n cells.
+    struct Node {
+        NodeID nw, ne, sw, se;
+        uint32_t level;
+        uint64_t population;
+        NodeID result = none; // centre after 2^(level - 2) generations
+    };
+
+    struct Children {
+        NodeID nw, ne, sw, se;
+
+        bool operator==(const Children &other) const {
+            return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+        }
+    };
+
+    struct ChildrenHash {
+        size_t operator()(const Children &children) const;
+    };
+
+    static constexpr NodeID none = ~NodeID(0);
+
+    NodeID join(NodeID nw, NodeID ne, NodeID sw, NodeID se);
+    NodeID empty(uint32_t level);
+    NodeID centre(NodeID node);
+    NodeID advance(NodeID node, uint32_t log2Generations);
+    NodeID setCell(NodeID node, int64_t x, int64_t y, bool alive);
+    NodeID build(const Board &board, uint32_t level, int64_t x, int64_t y);
+    NodeID unite(NodeID a, NodeID b);
+    NodeID copy(const std::vector<Node> &source, NodeID node, std::unordered_map<NodeID, NodeID> &copied);
+    void expand();
+    bool isPadded() const;
+    void collectCells(NodeID node, int64_t x, int64_t y, std::vector<Cell> &result) const;
+
+    // Half the width of the universe; the root covers [-radius, radius) on both axes.
+    int64_t radius() const {
+        return int64_t(1) << (nodes[root].level - 1);
+    }
+
+    Rule currentRule;
+    size_t nodeBudget;
+    std::vector<Node> nodes;
+    std::unordered_map<Children, NodeID, ChildrenHash> canonical;
+    std::unordered_map<uint64_t, NodeID> partialSteps; // (node, log2Generations) for jumps shorter than a node's natural step
+    std::vector<NodeID> emptyNodes; // by level
+    uint8_t centreTable[1 << 16]; // 4 × 4 block (bit 4y + x) to its centre 2 × 2 block one generation later (bit 2y + x)
+    NodeID root;
+    uint64_t generationCount = 0;
+};
+
+}
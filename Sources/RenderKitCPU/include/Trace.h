@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight instrumentation for the CPU kernels: scoped timing zones, counters totalled per frame, and export as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread records into its own fixed size ring buffer with no locks or shared writes; when a ring fills, its oldest events are overwritten. With tracing disabled (the default) a zone or counter costs one relaxed atomic load.
+// Names are not copied, so they must outlive the trace: pass string literals.
+
+namespace trace {
+
+namespace detail {
+
+extern std::atomic<bool> active;
+
+uint64_t now();
+
+void recordZone(const char *name, uint64_t start, uint64_t end);
+
+void recordCount(const char *name, int64_t delta);
+
+}
+
+// Events each thread keeps before overwriting its oldest.
+constexpr size_t eventsPerThread = 1 << 16;
+
+inline bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+// Starts or stops recording. Stopping keeps what was recorded for `chromeTrace`.
+void setEnabled(bool enabled);
+
+// Forgets everything recorded so far.
+void clear();
+
+// Times its own lifetime, as a zone named `name` on the calling thread. A zone that starts while tracing is disabled records nothing, even if tracing is enabled before it ends.
+class Zone {
+public:
+    explicit Zone(const char *name) : name(name), start(enabled() ? detail::now() : 0) {
+    }
+
+    ~Zone() {
+        if (start != 0) {
+            detail::recordZone(name, start, detail::now());
+        }
+    }
+
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+private:
+    const char *name;
+    uint64_t start;
+};
+
+// Adds `delta` to counter `name`'s total for the current frame.
+inline void count(const char *name, int64_t delta) {
+    if (enabled()) {
+        detail::recordCount(name, delta);
+    }
+}
+
+// Ends the current frame: counters recorded since the last `frame` are reported as that frame's totals.
+void frame();
+
+// A recorded zone, in nanoseconds since tracing first started.
+struct ZoneRecord {
+    const char *name;
+    uint32_t thread;
+    uint64_t start;
+    uint64_t duration;
+};
+
+// One counter's total over one frame. Frames are numbered from 0 since the last `clear`; counters recorded after the last `frame` call make up a final, unfinished frame.
+struct CounterRecord {
+    const char *name;
+    uint64_t frame;
+    // When the frame ended (or the latest event, for the unfinished frame).
+    uint64_t time;
+    int64_t total;
+};
+
+struct Capture {
+    std::vector<ZoneRecord> zones;
+    std::vector<CounterRecord> counters;
+    // When each `frame` call was made.
+    std::vector<uint64_t> frames;
+    // Events lost to full rings since the last `clear`.
+    uint64_t dropped = 0;
+};
+
+// Gathers what every thread has recorded, zones by start time. Call while no thread is recording (with tracing disabled, or between frames while the kernels are idle): a ring being written as it is read may yield a partly written event.
+Capture capture();
+
+// `capture()` as Chrome trace event JSON: zones as complete ("X") events on one track per thread, counter totals as counter ("C") events at the end of every frame, and frames as instant events.
+std::string chromeTrace();
+
+// Writes `chromeTrace()` to `path`. Returns false, with a message in `error`, if the file cannot be written.
+bool writeChromeTrace(const std::string &path, std::string &error);
+
+}
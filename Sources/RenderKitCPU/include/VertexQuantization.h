@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Quantized vertices for large static meshes: `SimpleVertex`'s 32 bytes in 16, laid out as `QuantizedVertex` in RenderKitShaders/include/QuantizedVertex.h and `VertexDescriptor.packed(semantics:quantized: true)`. Positions are 16 bit unorms within the mesh's bounds, normals are octahedrally encoded in two 16 bit snorms, and texture coordinates are halves. Positions land within about 1/131070 of the bounds' size of the original, and normals within 0.01°.
+
+namespace quantization {
+
+// Same layout as `SimpleVertex` in RenderKitShaders/include/CommonTypes.h.
+struct SimpleVertex {
+    float position[3];
+    float normal[3];
+    float textureCoordinate[2];
+};
+
+static_assert(sizeof(SimpleVertex) == 32);
+
+// Same layout as `QuantizedVertex`, with the halves as their IEEE binary16 bits. position[3] pads the position to the four bytes Metal aligns attributes to and is always zero.
+struct QuantizedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t textureCoordinate[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16);
+
+// Same layout as `QuantizationBounds`, whose float3s take 16 bytes: a quantized position p stands for origin + scale * p / 65535.
+struct Bounds {
+    alignas(16) float origin[3];
+    alignas(16) float scale[3];
+};
+
+static_assert(sizeof(Bounds) == 32);
+
+// The smallest bounds holding every position. Empty meshes get zero bounds.
+Bounds bounds(const SimpleVertex *vertices, size_t count);
+
+// Octahedral encoding. The normal need not be unit length; zero (or NaN) encodes as +z. Of the four nearest encodings the one that decodes closest to the normal is chosen.
+void encodeNormal(const float normal[3], int16_t encoded[2]);
+
+// The unit vector `encoded` stands for, computed as `octahedral_decode` computes it after vertex fetch.
+void decodeNormal(const int16_t encoded[2], float normal[3]);
+
+// Positions outside `bounds` are clamped to it.
+QuantizedVertex quantize(const SimpleVertex &vertex, const Bounds &bounds);
+SimpleVertex dequantize(const QuantizedVertex &vertex, const Bounds &bounds);
+
+// Batches across the worker pool.
+void quantize(const SimpleVertex *input, QuantizedVertex *output, size_t count, const Bounds &bounds);
+void dequantize(const QuantizedVertex *input, SimpleVertex *output, size_t count, const Bounds &bounds);
+
+}
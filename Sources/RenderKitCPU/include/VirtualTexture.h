@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "KTXFile.h"
+
+// A virtual texture over the tiles of a panorama. Each tile's mip levels are cut into square pages; only the pages the view asks for are copied, still block compressed, into slots of one atlas texture, and a page table maps every page to the finest resident page covering it. Memory then follows the screen rather than the panorama, which can be far larger than a GPU could hold. `panoramicVirtualTextureFragmentShader` samples the result.
+
+namespace textures {
+
+// One page to copy into the atlas: `VirtualTexture::slotBytes()` bytes at `offset` in the staging data, rows `slotBytesPerRow()` apart, for the slot whose top left texel, border included, is (x, y).
+struct PageUpload {
+    uint32_t slot;
+    uint32_t x;
+    uint32_t y;
+    uint32_t tile;
+    uint32_t level;
+    uint32_t pageX;
+    uint32_t pageY;
+    size_t offset;
+};
+
+class VirtualTexture {
+public:
+    // Tiles are `gridWidth` × `gridHeight`, row by row, and must share their format, size and levels; `pageSize` texels must be a whole number of blocks. The atlas holds `pageBudget` pages. Returns false, with a message in `error()`, if they do not fit together or the budget cannot hold the coarsest page of every tile.
+    bool open(const std::vector<KTXFile> &tiles, uint32_t gridWidth, uint32_t gridHeight, uint32_t pageSize, uint32_t pageBudget);
+
+    const std::string &error() const {
+        return message;
+    }
+
+    // Starts collecting the requests of a frame. The one page of each tile's coarsest level is always requested, so every page has something to fall back to.
+    void beginFrame();
+
+    // The level to request for a view showing `texelsPerPixel` texels of level 0 per pixel.
+    uint32_t levelFor(float texelsPerPixel) const;
+
+    // Requests the pages of `level` under the panorama rectangle [uMin, uMax] × [vMin, vMax], in 0...1 texture coordinates, and those of every coarser level above them. A `uMin` greater than `uMax` wraps around the seam.
+    void request(float uMin, float vMin, float uMax, float vMax, uint32_t level);
+
+    // Loads up to `maximumPages` requested pages, coarse levels first and then those nearest the centre of the requests, reusing the slots of the least recently requested pages, and updates the page table. Pages requested this frame are never evicted, so a frame asking for more than the budget gets coarser pages instead.
+    std::vector<PageUpload> update(size_t maximumPages);
+
+    // The blocks of the pages returned by the last `update`.
+    const uint8_t *stagingData() const {
+        return staging.data();
+    }
+
+    // Slot geometry in texels: a page plus a border of whole blocks, at least two texels, on every side, copied from the neighbouring pages of the same tile. Filtering then never reads another slot, even where a level's odd size shifts a page against its parent by a texel.
+    uint32_t borderWidth() const {
+        return block.width * ((block.width + 1) / block.width);
+    }
+
+    uint32_t borderHeight() const {
+        return block.height * ((block.height + 1) / block.height);
+    }
+
+    uint32_t slotWidth() const {
+        return pageSize + 2 * borderWidth();
+    }
+
+    uint32_t slotHeight() const {
+        return pageSize + 2 * borderHeight();
+    }
+
+    uint32_t pageWidth() const {
+        return pageSize;
+    }
+
+    size_t slotBytesPerRow() const {
+        return size_t(slotWidth() / block.width) * block.bytes;
+    }
+
+    size_t slotBytes() const {
+        return slotBytesPerRow() * (slotHeight() / block.height);
+    }
+
+    uint32_t slotsPerRow() const {
+        return slotColumns;
+    }
+
+    // The atlas texture's size in texels, in the tiles' pixel format.
+    uint32_t atlasWidth() const {
+        return slotColumns * slotWidth();
+    }
+
+    uint32_t atlasHeight() const {
+        return slotRows * slotHeight();
+    }
+
+    // Levels that have pages, the last being the coarsest one that fits in a single page.
+    uint32_t levelCount() const {
+        return levels;
+    }
+
+    uint32_t pagesPerTile() const {
+        return tilePages;
+    }
+
+    // One entry per page, tile by tile, level by level, row by row: the slot in the low 16 bits and its level in the high 16 bits, or 0xFFFFFFFF while nothing covering the page is resident.
+    const std::vector<uint32_t> &pageTable() const {
+        return table;
+    }
+
+    // Mirrors the shader's lookup: the atlas texture coordinate showing panorama coordinate (u, v) at `level`, or false if nothing covering it is resident.
+    bool translate(float u, float v, uint32_t level, float &atlasU, float &atlasV) const;
+
+    size_t residentPages() const;
+
+    size_t pendingPages() const {
+        return pending.size();
+    }
+
+private:
+    struct Request {
+        uint32_t page;
+        uint32_t level;
+        float distance;
+    };
+
+    uint32_t pagesWide(uint32_t level) const;
+    uint32_t pagesHigh(uint32_t level) const;
+    uint32_t pageIndex(uint32_t tile, uint32_t level, uint32_t pageX, uint32_t pageY) const;
+    void requestPage(uint32_t tile, uint32_t level, uint32_t pageX, uint32_t pageY, float distance);
+    void rebuildTable(uint32_t tile);
+
+    std::string message;
+    std::vector<KTXFile> sources;
+    uint32_t grid[2] = {};
+    uint32_t tileSize[2] = {};
+    uint32_t pageSize = 0;
+    BlockFormat block = {};
+    uint32_t levels = 0;
+    uint32_t levelOffset[32] = {};
+    uint32_t tilePages = 0;
+    uint32_t slotColumns = 0;
+    uint32_t slotRows = 0;
+    uint64_t frame = 0;
+
+    // Per page: its slot or 0xFFFFFFFF, and the frame it was last requested in.
+    std::vector<uint32_t> pageSlot;
+    std::vector<uint64_t> pageFrame;
+    // Per slot: its page or 0xFFFFFFFF.
+    std::vector<uint32_t> slotPage;
+    std::vector<Request> pending;
+    std::vector<uint32_t> pendingIndex;
+    std::vector<uint32_t> table;
+    std::vector<uint8_t> staging;
+};
+
+}
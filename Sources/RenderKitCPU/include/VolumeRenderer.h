@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Host side volume rendering of the 16 bit scalar volumes that `volumeVertexShader`/`volumeFragmentShader` (RenderKitShaders/VolumeShaders.metal) draw as stacks of blended slices. Rays are marched front to back through tiles of the image in parallel; bricks whose values the transfer function maps to zero opacity are leapt over, and rays stop once they are (nearly) opaque.
+
+namespace volume {
+
+// Same layout as `VolumeFragmentUniforms` in VolumeShaders.h. The slice shader gives every slice `transferFunction.a * alpha / instanceCount` opacity; the ray marcher uses `instanceCount` as the reference slice count and corrects each sample's opacity for its step length, so images match the slice renderer's at any sampling rate.
+#pragma pack(push, 1)
+struct FragmentUniforms {
+    uint16_t instanceCount;
+    uint16_t maxValue;
+    float alpha;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FragmentUniforms) == 8);
+
+// A dense r16Uint volume, x fastest, then y, then z. `spacing` is the size of a voxel along each axis (the CT head's voxels are 1:1:2).
+struct Volume {
+    const uint16_t *values;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    float spacing[3] = { 1, 1, 1 };
+
+    uint16_t value(uint32_t x, uint32_t y, uint32_t z) const {
+        return values[(size_t(z) * height + y) * width + x];
+    }
+};
+
+// The 1D `transferFunctionTexture`, sampled as the shader's `basicSampler` does: normalized coordinates, linear filtering, clamp to edge.
+class TransferFunction {
+public:
+    // `count` colours of rgba8Unorm texels, as uploaded to the texture.
+    TransferFunction(const uint8_t *rgba8, size_t count);
+    // `count` RGBA colours in 0...1.
+    TransferFunction(const float *rgba, size_t count);
+
+    size_t size() const {
+        return colors.size() / 4;
+    }
+
+    // Straight (not premultiplied) RGBA at `coordinate`, the normalized volume value.
+    void sample(float coordinate, float *rgba) const;
+
+    // Whether every value in [low, high] samples to zero alpha.
+    bool isTransparent(float low, float high) const;
+
+    // Replaces texels [first, first + count) with rgba8Unorm colours, as `MTLTexture.replace` would.
+    void update(size_t first, size_t count, const uint8_t *rgba8);
+
+    const float *data() const {
+        return colors.data();
+    }
+
+private:
+    void rebuildPrefix();
+
+    std::vector<float> colors;
+    // alphaPrefix[i] is the sum of the first i texels' alpha.
+    std::vector<double> alphaPrefix;
+};
+
+// The view, in the volume's box: the volume fills [0, extent] on each axis, where `extent` is its physical size (voxel count × spacing) divided by the largest physical dimension, so the longest axis runs from 0 to 1.
+struct Camera {
+    float position[3] = { 0.5f, 0.5f, -1.2f };
+    float target[3] = { 0.5f, 0.5f, 0.5f };
+    float up[3] = { 0, 1, 0 };
+    // Vertical field of view in radians. Zero selects an orthographic view `orthographicHeight` tall.
+    float fieldOfView = 0.9f;
+    float orthographicHeight = 1.5f;
+};
+
+struct RenderOptions {
+    // Distance between samples, in voxels along the volume's longest axis.
+    float stepSize = 0.5f;
+    // Rays stop once their accumulated opacity reaches this.
+    float opacityThreshold = 0.99f;
+    bool skipEmptySpace = true;
+};
+
+struct RenderStatistics {
+    uint64_t rays = 0;
+    uint64_t samples = 0;
+    // Samples not taken because they fell in bricks the transfer function makes transparent.
+    uint64_t skippedSamples = 0;
+    // Rays that stopped at the opacity threshold before leaving the volume.
+    uint64_t terminatedRays = 0;
+};
+
+class BrickCache;
+class PreIntegratedTable;
+
+class Renderer {
+public:
+    // Builds the min/max brick grid the renderer skips empty space with; bricks cover `brickSize`³ trilinear sample cells.
+    explicit Renderer(const Volume &volume, uint32_t brickSize = 8);
+
+    // Renders a bricked volume through a copy of `cache` (copies share one cache), using the file's bricks and their ranges as the brick grid. Each render prefetches the bricks ahead of the camera that the transfer function does not make transparent. `volume().values` is null.
+    explicit Renderer(const BrickCache &cache);
+
+    const Volume &volume() const {
+        return source;
+    }
+
+    // Renders a width × height image of premultiplied RGBA floats, row by row from the top. Pixels whose rays miss the volume are transparent black.
+    RenderStatistics render(const TransferFunction &transferFunction, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options = RenderOptions()) const;
+
+    // Renders with a table pre-integrated from `transferFunction` and `uniforms`: each step composites the table's entry for the segment since the previous sample, and steps are `table.segmentLength()` long rather than `options.stepSize`. A step of four to eight voxels gives about the image of single samples every voxel.
+    RenderStatistics render(const TransferFunction &transferFunction, const PreIntegratedTable &table, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options = RenderOptions()) const;
+
+    // The brick grid: `brickDimensions` bricks per axis, each with the minimum and maximum of every value a sample inside it can read.
+    uint32_t brickSize() const {
+        return bricks;
+    }
+
+    const uint32_t *brickDimensions() const {
+        return dimensions;
+    }
+
+    uint16_t brickMinimum(size_t brick) const {
+        return ranges[brick * 2];
+    }
+
+    uint16_t brickMaximum(size_t brick) const {
+        return ranges[brick * 2 + 1];
+    }
+
+private:
+    RenderStatistics renderRays(const TransferFunction &transferFunction, const PreIntegratedTable *table, const FragmentUniforms &uniforms, const Camera &camera, uint32_t width, uint32_t height, float *rgba, const RenderOptions &options) const;
+
+    Volume source;
+    std::shared_ptr<const BrickCache> cache;
+    uint32_t bricks;
+    uint32_t dimensions[3];
+    std::vector<uint16_t> ranges;
+};
+
+// Composites premultiplied RGBA floats over an opaque background colour and writes rgba8Unorm pixels, e.g. for saving batch renders.
+void toRGBA8(const float *rgba, size_t pixelCount, const float *background, uint8_t *output);
+
+}
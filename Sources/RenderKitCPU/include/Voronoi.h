@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host side cellular noise. `generate` writes what `voronoiNoiseCompute` (RenderKitShaders/voronoiNoise.metal) writes for each mode, using the same `implVoronoiNoise` arithmetic and the same integer hashes (Random.h), so feature points and ids match the GPU exactly; distances can differ in the last bits where Metal's fast-math `sqrt` and division do.
+// The jump flood functions build the same kind of field around an arbitrary set of seed points instead of one jittered point per lattice cell.
+
+namespace voronoi {
+
+// `VoronoiNoise.mode`.
+enum class Mode : int16_t {
+    // Distance to the nearest feature point, in cells.
+    distance = 0,
+    // `rand1dTo3d` of the nearest feature's id.
+    id = 1,
+    // Distance to the nearest cell edge.
+    edgeDistance = 2,
+    // 1 within 0.05 of a cell edge, 0 elsewhere.
+    edgeMask = 3,
+};
+
+// `VoronoiNoise` minus the texture: pixel (x, y) samples the noise at ((x, y) + offset) / size.
+struct Parameters {
+    float size[2] = { 1, 1 };
+    float offset[2] = { 0, 0 };
+    Mode mode = Mode::distance;
+};
+
+// The float3 `implVoronoiNoise` returns.
+struct Sample {
+    float distance;
+    float id;
+    float edgeDistance;
+};
+
+// `implVoronoiNoise` at one point, hashing all nine neighbouring cells twice like the kernel does.
+Sample sample(float x, float y);
+
+// Fills `width` × `height` RGBA float pixels (four floats each, `rowStride` pixels apart, defaulting to `width`) with `voronoiNoiseCompute`'s colours. The image is processed in 64 × 64 pixel tiles; each tile hashes every lattice cell it can see once and shares the feature points between all its pixels, and tiles are spread across the worker pool. Output is identical to calling `sample` per pixel.
+void generate(const Parameters &parameters, float *output, uint32_t width, uint32_t height, size_t rowStride = 0);
+
+// MARK: Seed sets
+
+struct Seed {
+    float x;
+    float y;
+};
+
+// Sentinel in the nearest seed map for pixels no seed reached (only when there are no usable seeds).
+constexpr uint32_t noSeed = UINT32_MAX;
+
+// Writes the index of the (approximately) nearest seed to each of the `width` × `height` pixels of `nearest`, by jump flooding with steps of width/2 down to 1 plus one more step of 1 (JFA+1). Seeds are in pixel coordinates and may lie outside the image; a seed that rounds (or clamps) to the same pixel as a closer seed is lost.
+void jumpFlood(const Seed *seeds, size_t seedCount, uint32_t width, uint32_t height, uint32_t *nearest);
+
+// `generate` for a seed set: jump floods, then writes the same colours per mode with distances divided by `scale` (pixels per unit, typically the mean seed spacing). Edge distances consider every seed whose region touches the pixel's own seed region in the flooded map. A seed's id is `rand2dTo1d` of its position.
+void generate(const Seed *seeds, size_t seedCount, float scale, Mode mode, float *output, uint32_t width, uint32_t height, size_t rowStride = 0);
+
+}
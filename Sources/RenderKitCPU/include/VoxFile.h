@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VoxelMeshing.h"
+
+// MagicaVoxel `.vox` files, memory mapped. Opening a file only walks the chunk headers, the palette and the scene graph; the voxels of each model stay in the mapping until something asks for them, so a world of hundreds of 256³ models costs address space rather than memory.
+
+namespace voxels {
+
+struct PaletteColor {
+    uint8_t r, g, b, a;
+};
+
+// A `SIZE`/`XYZI` pair. `voxelOffset` is where its `voxelCount` packed (x, y, z, colour index) voxels start in the file.
+struct VoxModel {
+    uint32_t size[3];
+    uint32_t voxelCount;
+    size_t voxelOffset;
+
+    // Axis `axis` of a voxel read from `voxelData`, clamped into the model's box. MagicaVoxel never writes voxels outside `size`, but opening a file does not check, since that would page in every model; readers clamp instead so such voxels stay inside the instance bounds.
+    uint32_t coordinate(const uint8_t *voxel, int axis) const {
+        return std::min<uint32_t>(voxel[axis], size[axis] - 1);
+    }
+};
+
+// One placement of a model in the world, from the scene graph's `nTRN`/`nGRP`/`nSHP` nodes. Voxel `v` of the model lands on `rotation * (v - size / 2) + translation`, with `size / 2` rounded down, which is how MagicaVoxel centres models on their transforms. Files without a scene graph place every model unrotated with its corner at the origin.
+struct VoxInstance {
+    uint32_t model;
+    // Row major; every row has a single +1 or -1.
+    int8_t rotation[9];
+    int32_t translation[3];
+    // World space bounds of the model's box, min inclusive and max exclusive.
+    int32_t minimum[3];
+    int32_t maximum[3];
+
+    void worldPosition(const VoxModel &model, uint32_t x, uint32_t y, uint32_t z, int32_t *output) const {
+        const int32_t local[3] = { int32_t(x) - int32_t(model.size[0] / 2), int32_t(y) - int32_t(model.size[1] / 2), int32_t(z) - int32_t(model.size[2] / 2) };
+        for (int row = 0; row != 3; ++row) {
+            output[row] = rotation[row * 3] * local[0] + rotation[row * 3 + 1] * local[1] + rotation[row * 3 + 2] * local[2] + translation[row];
+        }
+    }
+};
+
+class VoxFile {
+public:
+    // Maps and parses `path`. Returns false, with a message in `error()`, if the file cannot be read, is not a version 150 or 200 `.vox` file, or has a scene graph with a cycle, more than 64 levels or more than 2^20 node visits.
+    bool open(const std::string &path);
+
+    // Parses a file already in memory. The bytes must outlive this object and every copy of it.
+    bool parse(const uint8_t *bytes, size_t size);
+
+    const std::string &error() const {
+        return message;
+    }
+
+    const std::vector<VoxModel> &models() const {
+        return modelList;
+    }
+
+    const std::vector<VoxInstance> &instances() const {
+        return instanceList;
+    }
+
+    // Indexed by palette index: entry 0 is unused (empty), entry i is the `RGBA` chunk's i - 1th colour. Files without an `RGBA` chunk get a grey ramp rather than MagicaVoxel's built in default palette.
+    const PaletteColor *palette() const {
+        return colors;
+    }
+
+    // The raw `XYZI` data of a model: four bytes per voxel, x, y, z and palette index, with positions unchecked (see `VoxModel::coordinate`). Reading it is what pages the model in.
+    const uint8_t *voxelData(size_t model) const {
+        return bytes + modelList[model].voxelOffset;
+    }
+
+    // A model's voxels in the layout `voxelsToVertices` and `meshVoxels` take, with positions clamped into the model's box.
+    std::vector<MagicaVoxel> magicaVoxels(size_t model) const;
+
+private:
+    struct Mapping;
+
+    std::shared_ptr<Mapping> mapping;
+    const uint8_t *bytes = nullptr;
+    std::string message;
+    std::vector<VoxModel> modelList;
+    std::vector<VoxInstance> instanceList;
+    PaletteColor colors[256] = {};
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Half.h"
+#include "MagicaVoxel.h"
+
+// Host side meshing of MagicaVoxel models into the `PackedVoxelVertex`/index buffers that `VoxelVertexShader` (RenderKitShaders/Classic/Voxels.metal) draws. Unlike `voxelsToVertices`, which writes a full cube of 24 vertices and 36 indices for every voxel, faces between two solid voxels are dropped and the remaining coplanar faces of one colour are merged into as few quads as possible (greedy meshing).
+
+namespace voxels {
+
+// Same layout as `PackedVoxelVertex` in Classic/include/Voxels.h, with every half stored as its IEEE binary16 bits.
+struct PackedVoxelVertex {
+    uint16_t position[3];
+    uint16_t normal[3];
+    uint16_t textureCoordinate[2];
+    uint16_t colorIndex;
+    uint16_t unused;
+};
+
+static_assert(sizeof(PackedVoxelVertex) == 20);
+
+// A dense block of palette indices, x fastest, then y, then z. Index 0 is empty, as in `copyCubeVertices`.
+struct VoxelGrid {
+    const uint8_t *colors;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+
+    uint8_t color(uint32_t x, uint32_t y, uint32_t z) const {
+        return colors[(size_t(z) * height + y) * width + x];
+    }
+};
+
+// The `voxelSize` the kernel scales voxel positions by.
+struct VoxelSize {
+    float x = 1;
+    float y = 1;
+    float z = 1;
+};
+
+struct VoxelMesh {
+    std::vector<PackedVoxelVertex> vertices;
+    // Triangle list, two triangles per quad, counter-clockwise seen from the side the normal points to (as `copyCubeVertices` winds its cubes).
+    std::vector<uint32_t> indices;
+};
+
+// Meshes the visible faces of `grid`; faces on the grid's boundary are visible. With `greedy` each face with the same normal, plane and colour as its neighbours is merged into maximal rectangles, otherwise every visible voxel face is its own quad. Vertex positions are `voxel corner * voxelSize`, and texture coordinates run from (0, 0) to the quad's size in voxels so textures tile once per voxel. Slices are meshed in parallel and the output is deterministic.
+VoxelMesh meshVoxels(const VoxelGrid &grid, VoxelSize voxelSize = VoxelSize(), bool greedy = true);
+
+// Meshes the `MagicaVoxel` array a `voxelsToVertices` dispatch would take. Voxels are scattered into a grid just large enough to hold them; when two share a position the later one wins.
+VoxelMesh meshVoxels(const MagicaVoxel *voxels, size_t count, VoxelSize voxelSize = VoxelSize(), bool greedy = true);
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "VoxFile.h"
+
+// Worlds built from many MagicaVoxel models, without the 256³ cap of `MagicaVoxel`'s `uchar3` positions or a dense texture covering the whole scene. Palette indices live in a sparse map of 32³ chunks, and chunks are only decoded from the mapped `.vox` files when they come within range of a point of interest.
+
+namespace voxels {
+
+// A brick map: palette indices in 32³ chunks keyed by chunk coordinate, x fastest within a chunk. Chunks without voxels are not stored, and positions outside every stored chunk read as 0 (empty).
+class ChunkStore {
+public:
+    static constexpr int32_t chunkShift = 5;
+    static constexpr int32_t chunkSize = 1 << chunkShift;
+    static constexpr size_t chunkVolume = size_t(chunkSize) * chunkSize * chunkSize;
+
+    static uint64_t key(int32_t chunkX, int32_t chunkY, int32_t chunkZ) {
+        // 21 bits per axis, enough for ±2^25 voxels.
+        return uint64_t(uint32_t(chunkX) & 0x1fffff) | uint64_t(uint32_t(chunkY) & 0x1fffff) << 21 | uint64_t(uint32_t(chunkZ) & 0x1fffff) << 42;
+    }
+
+    uint8_t get(int32_t x, int32_t y, int32_t z) const;
+    void set(int32_t x, int32_t y, int32_t z, uint8_t color);
+
+    // The chunk's chunkVolume indices, or nullptr if it holds no voxels.
+    const uint8_t *chunk(int32_t chunkX, int32_t chunkY, int32_t chunkZ) const;
+
+    void erase(uint64_t chunkKey) {
+        chunks.erase(chunkKey);
+    }
+
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+
+    size_t memoryBytes() const {
+        return chunks.size() * chunkVolume;
+    }
+
+    // Copies the box starting at (x, y, z) into a dense width × height × depth grid, e.g. to pass to `meshVoxels` or upload as a 3D texture.
+    void extract(int32_t x, int32_t y, int32_t z, uint32_t width, uint32_t height, uint32_t depth, uint8_t *output) const;
+
+private:
+    friend class VoxelWorld;
+
+    uint8_t *mutableChunk(uint64_t chunkKey);
+
+    std::unordered_map<uint64_t, std::vector<uint8_t>> chunks;
+};
+
+class VoxelWorld {
+public:
+    // Adds every instance in `file`'s scene graph, moved by (x, y, z). Copies of the file share its mapping. Palette indices are stored as they are, so files added to one world should share a palette. Loaded chunks the new instances overlap are reloaded by the next `update`.
+    void add(const VoxFile &file, int32_t x = 0, int32_t y = 0, int32_t z = 0);
+
+    // Loads every chunk that overlaps an instance and comes within `radius` voxels of (x, y, z), and evicts loaded chunks that are more than `radius + evictionMargin` away. Each instance's voxels are read once per call, in parallel across instances; where instances overlap the one added last wins. Returns the number of chunks loaded.
+    size_t update(float x, float y, float z, float radius);
+
+    // Empty unless the chunk containing the voxel is loaded.
+    uint8_t get(int32_t x, int32_t y, int32_t z) const {
+        return chunks.get(x, y, z);
+    }
+
+    const ChunkStore &store() const {
+        return chunks;
+    }
+
+    size_t instanceCount() const {
+        return instances.size();
+    }
+
+    // Chunks that have been loaded and not evicted, including those that turned out to be empty.
+    size_t residentChunkCount() const {
+        return resident.size();
+    }
+
+    // Extra distance, in voxels, before a loaded chunk is evicted, so that small movements do not reload the same chunks.
+    float evictionMargin = ChunkStore::chunkSize;
+
+private:
+    struct PlacedInstance {
+        uint32_t file;
+        VoxInstance instance;
+    };
+
+    std::vector<VoxFile> files;
+    std::vector<PlacedInstance> instances;
+    std::unordered_set<uint64_t> resident;
+    ChunkStore chunks;
+};
+
+}
@@ -0,0 +1,363 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace benchmark {
+
+// MARK: - Running
+
+std::vector<Result> run(const std::vector<Benchmark> &benchmarks, const Options &options, const std::function<void(const Result &)> &progress) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<Result> results;
+    for (const Benchmark &benchmark : benchmarks) {
+        if (benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        for (uint64_t size : benchmark.sizes) {
+            for (unsigned threads : options.threadCounts) {
+                parallel::setThreadCount(threads);
+                Workload workload = benchmark.make(size);
+                // One untimed run to fault in memory and warm caches and the worker pool.
+                if (workload.reset) {
+                    workload.reset();
+                }
+                workload.run();
+                std::vector<double> times;
+                double total = 0;
+                while (times.size() < options.minimumIterations || total < options.minimumTime) {
+                    if (workload.reset) {
+                        workload.reset();
+                    }
+                    const auto start = Clock::now();
+                    workload.run();
+                    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                    // Each timed run is a frame of the trace, when one is being recorded.
+                    trace::frame();
+                    times.push_back(seconds);
+                    total += seconds;
+                }
+                std::sort(times.begin(), times.end());
+                Result result {
+                    .name = benchmark.name,
+                    .unit = benchmark.unit,
+                    .size = size,
+                    .threads = parallel::threadCount(),
+                    .items = workload.items,
+                    .iterations = times.size(),
+                    .medianSeconds = times[times.size() / 2],
+                    .minimumSeconds = times.front(),
+                };
+                result.itemsPerSecond = result.medianSeconds > 0 ? double(result.items) / result.medianSeconds : 0;
+                if (progress) {
+                    progress(result);
+                }
+                results.push_back(result);
+            }
+        }
+    }
+    parallel::setThreadCount(0);
+    return results;
+}
+
+// MARK: - JSON
+
+namespace {
+
+struct FileCloser {
+    void operator()(FILE *file) const {
+        fclose(file);
+    }
+};
+
+using File = std::unique_ptr<FILE, FileCloser>;
+
+// Just enough JSON for result files: objects, arrays, strings, numbers, booleans and null.
+struct Value {
+    enum class Kind {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object,
+    };
+
+    Kind kind = Kind::null;
+    double number = 0;
+    std::string string;
+    std::vector<Value> elements;
+    std::map<std::string, Value> members;
+
+    const Value *member(const std::string &key) const {
+        auto found = members.find(key);
+        return found == members.end() ? nullptr : &found->second;
+    }
+};
+
+class Parser {
+public:
+    explicit Parser(const std::string &text) : text(text) {
+    }
+
+    // Parses the whole text as one value. Returns false, with a message in `error`, on malformed input.
+    bool parse(Value &value, std::string &error) {
+        if (!parseValue(value, 0) || (skipSpace(), position != text.size())) {
+            error = "malformed JSON at offset " + std::to_string(position);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skipSpace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            ++position;
+        }
+    }
+
+    bool consume(char character) {
+        skipSpace();
+        if (position < text.size() && text[position] == character) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeWord(const char *word) {
+        const std::string_view view(word);
+        if (text.compare(position, view.size(), view) != 0) {
+            return false;
+        }
+        position += view.size();
+        return true;
+    }
+
+    bool parseString(std::string &string) {
+        if (!consume('"')) {
+            return false;
+        }
+        while (position < text.size() && text[position] != '"') {
+            char character = text[position++];
+            if (character == '\\') {
+                if (position == text.size()) {
+                    return false;
+                }
+                switch (text[position++]) {
+                case 'n':
+                    character = '\n';
+                    break;
+                case 't':
+                    character = '\t';
+                    break;
+                case 'r':
+                    character = '\r';
+                    break;
+                case '"':
+                case '\\':
+                case '/':
+                    character = text[position - 1];
+                    break;
+                default:
+                    // Result files never contain \b, \f or \u escapes.
+                    return false;
+                }
+            }
+            string.push_back(character);
+        }
+        return consume('"');
+    }
+
+    bool parseValue(Value &value, unsigned depth) {
+        if (depth > 64) {
+            return false;
+        }
+        skipSpace();
+        if (position == text.size()) {
+            return false;
+        }
+        const char character = text[position];
+        if (character == '{') {
+            ++position;
+            value.kind = Value::Kind::object;
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                std::string key;
+                Value member;
+                if (!parseString(key) || !consume(':') || !parseValue(member, depth + 1)) {
+                    return false;
+                }
+                value.members[key] = std::move(member);
+            } while (consume(','));
+            return consume('}');
+        }
+        if (character == '[') {
+            ++position;
+            value.kind = Value::Kind::array;
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                value.elements.emplace_back();
+                if (!parseValue(value.elements.back(), depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+        if (character == '"') {
+            value.kind = Value::Kind::string;
+            return parseString(value.string);
+        }
+        if (consumeWord("true")) {
+            value.kind = Value::Kind::boolean;
+            value.number = 1;
+            return true;
+        }
+        if (consumeWord("false")) {
+            value.kind = Value::Kind::boolean;
+            return true;
+        }
+        if (consumeWord("null")) {
+            return true;
+        }
+        const char *begin = text.c_str() + position;
+        char *end = nullptr;
+        value.kind = Value::Kind::number;
+        value.number = strtod(begin, &end);
+        if (end == begin) {
+            return false;
+        }
+        position += size_t(end - begin);
+        return true;
+    }
+
+    const std::string &text;
+    size_t position = 0;
+};
+
+void writeString(FILE *file, const std::string &string) {
+    fputc('"', file);
+    for (char character : string) {
+        if (character == '"' || character == '\\') {
+            fputc('\\', file);
+        }
+        fputc(character, file);
+    }
+    fputc('"', file);
+}
+
+}
+
+bool writeResults(const std::string &path, const std::vector<Result> &results, std::string &error) {
+    File file(fopen(path.c_str(), "w"));
+    if (!file) {
+        error = "cannot write " + path;
+        return false;
+    }
+    fprintf(file.get(), "{\n  \"version\": 1,\n  \"results\": [");
+    for (size_t index = 0; index < results.size(); ++index) {
+        const Result &result = results[index];
+        fprintf(file.get(), "%s\n    {\"name\": ", index == 0 ? "" : ",");
+        writeString(file.get(), result.name);
+        fprintf(file.get(), ", \"unit\": ");
+        writeString(file.get(), result.unit);
+        fprintf(file.get(), ", \"size\": %llu, \"threads\": %u, \"items\": %llu, \"iterations\": %llu, \"medianSeconds\": %.9g, \"minimumSeconds\": %.9g, \"itemsPerSecond\": %.9g}", (unsigned long long)result.size, result.threads, (unsigned long long)result.items, (unsigned long long)result.iterations, result.medianSeconds, result.minimumSeconds, result.itemsPerSecond);
+    }
+    fprintf(file.get(), "\n  ]\n}\n");
+    if (ferror(file.get())) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool readResults(const std::string &path, std::vector<Result> &results, std::string &error) {
+    File file(fopen(path.c_str(), "rb"));
+    if (!file) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    for (size_t count; (count = fread(buffer, 1, sizeof buffer, file.get())) > 0;) {
+        text.append(buffer, count);
+    }
+    Value root;
+    if (!Parser(text).parse(root, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    const Value *list = root.member("results");
+    if (!list || list->kind != Value::Kind::array) {
+        error = path + ": no results array";
+        return false;
+    }
+    results.clear();
+    for (const Value &element : list->elements) {
+        const Value *name = element.member("name");
+        const Value *unit = element.member("unit");
+        const Value *size = element.member("size");
+        const Value *threads = element.member("threads");
+        const Value *throughput = element.member("itemsPerSecond");
+        if (!name || name->kind != Value::Kind::string || !size || size->kind != Value::Kind::number || !threads || threads->kind != Value::Kind::number || !throughput || throughput->kind != Value::Kind::number) {
+            error = path + ": result without a name, size, thread count and throughput";
+            return false;
+        }
+        Result result {
+            .name = name->string,
+            .unit = unit && unit->kind == Value::Kind::string ? unit->string : "",
+            .size = uint64_t(size->number),
+            .threads = unsigned(threads->number),
+            .itemsPerSecond = throughput->number,
+        };
+        const auto number = [&](const char *key) {
+            const Value *value = element.member(key);
+            return value && value->kind == Value::Kind::number ? value->number : 0;
+        };
+        result.items = uint64_t(number("items"));
+        result.iterations = uint64_t(number("iterations"));
+        result.medianSeconds = number("medianSeconds");
+        result.minimumSeconds = number("minimumSeconds");
+        results.push_back(result);
+    }
+    return true;
+}
+
+// MARK: - Comparison
+
+std::vector<Comparison> compare(const std::vector<Result> &current, const std::vector<Result> &baseline, double threshold) {
+    std::map<std::tuple<std::string, uint64_t, unsigned>, const Result *> baselineResults;
+    for (const Result &result : baseline) {
+        baselineResults[{ result.name, result.size, result.threads }] = &result;
+    }
+    std::vector<Comparison> comparisons;
+    comparisons.reserve(current.size());
+    for (const Result &result : current) {
+        Comparison comparison;
+        comparison.current = result;
+        auto found = baselineResults.find({ result.name, result.size, result.threads });
+        if (found != baselineResults.end() && found->second->itemsPerSecond > 0) {
+            comparison.hasBaseline = true;
+            comparison.baseline = *found->second;
+            comparison.change = result.itemsPerSecond / comparison.baseline.itemsPerSecond - 1;
+            comparison.regressed = comparison.change < -threshold;
+        }
+        comparisons.push_back(comparison);
+    }
+    return comparisons;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A small benchmark harness for the RenderKitCPU kernels: each benchmark is run at several input sizes and worker pool sizes, timed until a minimum time has passed, and reported as throughput (items per second) in the benchmark's own unit. Results are written as JSON and can be compared against an earlier run's JSON to catch regressions. The suite itself is in RenderKitCPUBenchmarks; this target holds the harness so that tests can check the result files and comparisons.
+
+namespace benchmark {
+
+// One benchmark at one input size, ready to time. Building it (allocating and filling inputs) is not timed.
+struct Workload {
+    // Items `run` processes per call, in the benchmark's unit.
+    uint64_t items = 0;
+    // The timed work.
+    std::function<void()> run = nullptr;
+    // Called before every `run` and not timed, for work that consumes its input (e.g. sorting in place).
+    std::function<void()> reset = nullptr;
+};
+
+struct Benchmark {
+    // "module.function", as in "gameOfLife.step".
+    std::string name;
+    // What `Workload::items` counts: "cells", "texels", "particles", "keys", ….
+    std::string unit;
+    // The input sizes to run, in whatever measure `make` takes (an edge length or an element count).
+    std::vector<uint64_t> sizes;
+    std::function<Workload(uint64_t size)> make;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    uint64_t size = 0;
+    unsigned threads = 0;
+    uint64_t items = 0;
+    uint64_t iterations = 0;
+    double medianSeconds = 0;
+    double minimumSeconds = 0;
+    // `items` over `medianSeconds`.
+    double itemsPerSecond = 0;
+};
+
+struct Options {
+    // Benchmarks whose name contains this string; empty runs all of them.
+    std::string filter;
+    // Worker pool sizes to run every benchmark with.
+    std::vector<unsigned> threadCounts;
+    // Each benchmark keeps repeating until it has run for this long, and at least `minimumIterations` times, so that the median the comparison uses is steady even for sizes that take a large part of `minimumTime` per run.
+    double minimumTime = 0.25;
+    uint64_t minimumIterations = 10;
+};
+
+// Runs every one of `benchmarks` that passes `options.filter` at each of its sizes and each thread count, calling `progress` with each result as it is measured.
+std::vector<Result> run(const std::vector<Benchmark> &benchmarks, const Options &options, const std::function<void(const Result &)> &progress = nullptr);
+
+// Writes `results` to `path` as JSON. Returns false, with a message in `error`, if the file cannot be written.
+bool writeResults(const std::string &path, const std::vector<Result> &results, std::string &error);
+
+// Reads results written by `writeResults`. Returns false, with a message in `error`, if the file cannot be read or is not such a file.
+bool readResults(const std::string &path, std::vector<Result> &results, std::string &error);
+
+struct Comparison {
+    Result current;
+    // Whether the baseline has a result with the same name, size and thread count.
+    bool hasBaseline = false;
+    Result baseline;
+    // current / baseline throughput - 1: negative is slower.
+    double change = 0;
+    bool regressed = false;
+};
+
+// Pairs every current result with the baseline result of the same name, size and thread count. A result regressed if its throughput fell by more than `threshold` (0.1 is ten percent).
+std::vector<Comparison> compare(const std::vector<Result> &current, const std::vector<Result> &baseline, double threshold);
+
+}
@@ -0,0 +1,283 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "ColorConversion.h"
+#include "GameOfLife.h"
+#include "GraphToy.h"
+#include "MarchingCubes.h"
+#include "MeshCodec.h"
+#include "Particles.h"
+#include "RenderKitShadersHost.h"
+#include "SimplexNoise.h"
+#include "Sorting.h"
+#include "VertexQuantization.h"
+#include "Voronoi.h"
+#include "VoxelMeshing.h"
+
+namespace benchmark {
+
+namespace {
+
+// xorshift64*, so inputs are the same from run to run.
+struct Generator {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+};
+
+// A `size`³ field of fractal noise, so the surface is uneven and the work per slab varies as it does in real scenes.
+std::shared_ptr<std::vector<float>> noiseField(uint32_t size) {
+    auto values = std::make_shared<std::vector<float>>(size_t(size) * size * size);
+    noise::Fractal fractal { .octaves = 4, .frequency = 4.0f / float(size) };
+    for (uint32_t z = 0; z < size; ++z) {
+        // One heightfield per z slice, each shifted along the noise's other axes.
+        fractal.offset[0] = float(z) * 0.37f;
+        fractal.offset[1] = float(z) * 0.61f;
+        noise::heightfield(fractal, values->data() + size_t(z) * size * size, size, size, 0, 0, 1);
+    }
+    return values;
+}
+
+Workload marchingCubesWorkload(uint64_t size) {
+    auto values = noiseField(uint32_t(size));
+    const marchingCubes::ScalarGrid grid { .values = values->data(), .width = uint32_t(size), .height = uint32_t(size), .depth = uint32_t(size) };
+    return {
+        .items = (size - 1) * (size - 1) * (size - 1),
+        .run = [values, grid] { marchingCubes::extractIsosurface(grid, 0); },
+    };
+}
+
+Workload gameOfLifeWorkload(uint64_t size) {
+    auto boards = std::make_shared<std::pair<gameOfLife::Board, gameOfLife::Board>>(gameOfLife::Board(uint32_t(size), uint32_t(size)), gameOfLife::Board());
+    Generator generator;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            boards->first.set(x, y, generator.next() % 3 == 0);
+        }
+    }
+    return {
+        .items = size * size,
+        .run = [boards] {
+            gameOfLife::step(boards->first, boards->second, true);
+            std::swap(boards->first, boards->second);
+        },
+    };
+}
+
+// Keys are copied back from `source` before every run, untimed, so every run sorts the same unsorted input.
+struct SortInput {
+    std::vector<uint32_t> source;
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> payloads;
+    sorting::Scratch scratch;
+
+    explicit SortInput(size_t count) : source(count), keys(count), payloads(count) {
+        Generator generator;
+        for (uint32_t &key : source) {
+            key = uint32_t(generator.next());
+        }
+    }
+
+    void reset() {
+        keys = source;
+        for (size_t index = 0; index < payloads.size(); ++index) {
+            payloads[index] = uint32_t(index);
+        }
+    }
+};
+
+Workload bitonicSortWorkload(uint64_t count) {
+    auto input = std::make_shared<SortInput>(count);
+    return {
+        .items = count,
+        .run = [input] { sorting::bitonicSort(input->keys.data(), input->payloads.data(), input->keys.size()); },
+        .reset = [input] { input->reset(); },
+    };
+}
+
+Workload radixSortWorkload(uint64_t count) {
+    auto input = std::make_shared<SortInput>(count);
+    return {
+        .items = count,
+        .run = [input] { sorting::radixSort(input->keys.data(), input->payloads.data(), input->keys.size(), &input->scratch); },
+        .reset = [input] { input->reset(); },
+    };
+}
+
+// A `size` × `size` image of texel coordinates and the output to evaluate them into.
+struct TexelGrid {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> output;
+
+    explicit TexelGrid(uint32_t size) : x(size_t(size) * size), y(size_t(size) * size), output(size_t(size) * size) {
+        for (size_t index = 0; index < x.size(); ++index) {
+            x[index] = float(index % size) * 0.05f;
+            y[index] = float(index / size) * 0.05f;
+        }
+    }
+};
+
+Workload simplexNoiseWorkload(uint64_t size) {
+    auto texels = std::make_shared<TexelGrid>(uint32_t(size));
+    return {
+        .items = size * size,
+        .run = [texels] { noise::simplex2D(texels->x.data(), texels->y.data(), texels->output.data(), texels->x.size()); },
+    };
+}
+
+Workload voronoiNoiseWorkload(uint64_t size) {
+    auto output = std::make_shared<std::vector<float>>(size * size * 4);
+    const voronoi::Parameters parameters { .size = { 32, 32 }, .offset = { 0, 0 }, .mode = voronoi::Mode::distance };
+    return {
+        .items = size * size,
+        .run = [output, parameters, size] { voronoi::generate(parameters, output->data(), uint32_t(size), uint32_t(size)); },
+    };
+}
+
+// A `size` × `size` RGBA8 image decoded to linear floats and encoded back, as texture import does.
+Workload colorConversionWorkload(uint64_t size) {
+    auto image = std::make_shared<std::pair<std::vector<uint8_t>, std::vector<float>>>(std::vector<uint8_t>(size * size * 4), std::vector<float>(size * size * 4));
+    Generator generator;
+    for (uint8_t &value : image->first) {
+        value = uint8_t(generator.next());
+    }
+    return {
+        .items = size * size,
+        .run = [image] {
+            color::srgbToLinear(image->first.data(), image->second.data(), image->first.size(), color::Layout::interleavedRGBA);
+            color::linearToSRGB(image->second.data(), image->first.data(), image->second.size(), color::Layout::interleavedRGBA);
+        },
+    };
+}
+
+// A typical graphtoy graph, compiled once and evaluated at `count` points.
+Workload graphToyWorkload(uint64_t count) {
+    auto samples = std::make_shared<std::pair<std::vector<float>, std::vector<float>>>(std::vector<float>(count), std::vector<float>(count));
+    for (size_t index = 0; index < count; ++index) {
+        samples->first[index] = float(index) * 1e-3f;
+    }
+    auto expression = std::make_shared<graphtoy::Expression>();
+    expression->compile("smoothstep(0,1,x)*noise(x*4)");
+    return {
+        .items = count,
+        .run = [samples, expression] { expression->evaluate(samples->first.data(), samples->second.data(), samples->first.size()); },
+    };
+}
+
+Workload particlesWorkload(uint64_t count) {
+    auto system = std::make_shared<particles::System>(count);
+    const particles::Emitter emitter;
+    system->emit(count, emitter);
+    return {
+        .items = count,
+        .run = [system, emitter] { system->step(particles::Environment(), emitter); },
+    };
+}
+
+Workload voxelMeshingWorkload(uint64_t size) {
+    // Rolling terrain: solid below a noise heightfield, coloured by height.
+    auto colors = std::make_shared<std::vector<uint8_t>>(size * size * size);
+    std::vector<float> heights(size * size);
+    noise::heightfield(noise::Fractal { .octaves = 4, .frequency = 3.0f / float(size) }, heights.data(), uint32_t(size), uint32_t(size), 0, 0, 1);
+    for (uint64_t z = 0; z < size; ++z) {
+        for (uint64_t x = 0; x < size; ++x) {
+            const uint64_t height = uint64_t(std::clamp((heights[z * size + x] * 0.5f + 0.5f) * float(size), 0.0f, float(size)));
+            for (uint64_t y = 0; y < height; ++y) {
+                (*colors)[(z * size + y) * size + x] = uint8_t(1 + y * 8 / size);
+            }
+        }
+    }
+    const voxels::VoxelGrid grid { .colors = colors->data(), .width = uint32_t(size), .height = uint32_t(size), .depth = uint32_t(size) };
+    return {
+        .items = size * size * size,
+        .run = [colors, grid] { voxels::meshVoxels(grid); },
+    };
+}
+
+// A `size` × `size` terrain patch: a noise heightfield, quantized and in row order, as a mesh is after `MeshOptimizer`.
+std::pair<std::vector<quantization::QuantizedVertex>, std::vector<uint32_t>> terrainMesh(uint64_t size) {
+    std::vector<float> heights(size * size);
+    noise::heightfield(noise::Fractal { .octaves = 4, .frequency = 3.0f / float(size) }, heights.data(), uint32_t(size), uint32_t(size), 0, 0, 1);
+    std::vector<quantization::SimpleVertex> vertices(size * size);
+    for (uint64_t z = 0; z < size; ++z) {
+        for (uint64_t x = 0; x < size; ++x) {
+            const uint64_t index = z * size + x;
+            const float slopeX = heights[z * size + std::min(x + 1, size - 1)] - heights[z * size + (x > 0 ? x - 1 : 0)];
+            const float slopeZ = heights[std::min(z + 1, size - 1) * size + x] - heights[(z > 0 ? z - 1 : 0) * size + x];
+            vertices[index] = {
+                .position = { float(x), heights[index] * 8, float(z) },
+                .normal = { -slopeX * 4, 1, -slopeZ * 4 },
+                .textureCoordinate = { float(x) / float(size), float(z) / float(size) },
+            };
+        }
+    }
+    std::pair<std::vector<quantization::QuantizedVertex>, std::vector<uint32_t>> mesh;
+    mesh.first.resize(vertices.size());
+    quantization::quantize(vertices.data(), mesh.first.data(), vertices.size(), quantization::bounds(vertices.data(), vertices.size()));
+    for (uint64_t z = 0; z + 1 < size; ++z) {
+        for (uint64_t x = 0; x + 1 < size; ++x) {
+            const uint32_t corner = uint32_t(z * size + x);
+            mesh.second.insert(mesh.second.end(), { corner, corner + uint32_t(size), corner + 1, corner + 1, corner + uint32_t(size), corner + uint32_t(size) + 1 });
+        }
+    }
+    return mesh;
+}
+
+Workload decodeIndicesWorkload(uint64_t size) {
+    const auto mesh = terrainMesh(size);
+    auto buffers = std::make_shared<std::pair<std::vector<uint8_t>, std::vector<uint32_t>>>(meshCodec::encodeIndices(mesh.second.data(), mesh.second.size()), std::vector<uint32_t>(mesh.second.size()));
+    return {
+        .items = mesh.second.size() / 3,
+        .run = [buffers] { meshCodec::decodeIndices(buffers->first.data(), buffers->first.size(), buffers->second.data(), buffers->second.size()); },
+    };
+}
+
+Workload decodeVerticesWorkload(uint64_t size) {
+    const auto mesh = terrainMesh(size);
+    auto buffers = std::make_shared<std::pair<std::vector<uint8_t>, std::vector<quantization::QuantizedVertex>>>(meshCodec::encodeVertices(mesh.first.data(), mesh.first.size(), sizeof(quantization::QuantizedVertex)), std::vector<quantization::QuantizedVertex>(mesh.first.size()));
+    return {
+        .items = mesh.first.size(),
+        .run = [buffers] { meshCodec::decodeVertices(buffers->first.data(), buffers->first.size(), buffers->second.data(), buffers->second.size(), sizeof(quantization::QuantizedVertex)); },
+    };
+}
+
+// Noise.metal's `simplexNoise2D` kernel itself, compiled against the Metal shim and dispatched on the worker pool, to compare with the native port above.
+Workload shaderSimplexNoiseWorkload(uint64_t size) {
+    auto texels = std::make_shared<std::vector<float>>(size * size * 4);
+    return {
+        .items = size * size,
+        .run = [texels, size] { shaders::simplexNoise2D({ .texels = texels->data(), .width = uint32_t(size), .height = uint32_t(size) }); },
+    };
+}
+
+}
+
+const std::vector<Benchmark> &benchmarks() {
+    static const std::vector<Benchmark> all = {
+        { "marchingCubes.extractIsosurface", "cells", { 32, 64, 128 }, marchingCubesWorkload },
+        { "gameOfLife.step", "cells", { 256, 1024, 4096 }, gameOfLifeWorkload },
+        { "sorting.bitonicSort", "keys", { 1 << 12, 1 << 16, 1 << 20 }, bitonicSortWorkload },
+        { "sorting.radixSort", "keys", { 1 << 16, 1 << 20, 1 << 22 }, radixSortWorkload },
+        { "noise.simplex2D", "texels", { 256, 1024, 2048 }, simplexNoiseWorkload },
+        { "voronoi.generate", "texels", { 256, 1024, 2048 }, voronoiNoiseWorkload },
+        { "color.roundTripRGBA8", "pixels", { 256, 1024, 4096 }, colorConversionWorkload },
+        { "graphtoy.expression", "samples", { 1 << 14, 1 << 17, 1 << 20 }, graphToyWorkload },
+        { "particles.step", "particles", { 1 << 14, 1 << 17, 1 << 20 }, particlesWorkload },
+        { "voxels.meshVoxels", "voxels", { 32, 64, 128 }, voxelMeshingWorkload },
+        { "mesh.decodeIndices", "triangles", { 256, 1024, 2048 }, decodeIndicesWorkload },
+        { "mesh.decodeVertices", "vertices", { 256, 1024, 2048 }, decodeVerticesWorkload },
+        { "shaders.simplexNoise2D", "texels", { 256, 1024 }, shaderSimplexNoiseWorkload },
+    };
+    return all;
+}
+
+}
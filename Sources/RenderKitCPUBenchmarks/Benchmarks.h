@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace benchmark {
+
+// Every benchmark in the suite.
+const std::vector<Benchmark> &benchmarks();
+
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Trace.h"
+
+// Runs the RenderKitCPU benchmarks, optionally writes the results as JSON and compares them with a baseline from an earlier run. Exits with status 1 if any result regressed past the threshold, so CI can fail on it. `--trace` also records the kernels' zones and counters and writes them as a Chrome trace.
+//
+//     RenderKitCPUBenchmarks [--filter name] [--threads 1,4,8] [--min-time seconds] [--output results.json] [--baseline baseline.json] [--threshold 0.1] [--trace trace.json] [--list]
+
+namespace {
+
+void printUsage() {
+    fprintf(stderr, "usage: RenderKitCPUBenchmarks [--filter name] [--threads 1,4,8] [--min-time seconds] [--output results.json] [--baseline baseline.json] [--threshold 0.1] [--trace trace.json] [--list]\n");
+}
+
+// "1,4,8" to { 1, 4, 8 }. Returns an empty list for anything else.
+std::vector<unsigned> parseThreadCounts(const char *string) {
+    std::vector<unsigned> counts;
+    while (*string) {
+        char *end = nullptr;
+        const unsigned long count = strtoul(string, &end, 10);
+        if (end == string || count == 0 || (*end != ',' && *end != 0)) {
+            return {};
+        }
+        counts.push_back(unsigned(count));
+        string = *end == ',' ? end + 1 : end;
+    }
+    return counts;
+}
+
+// 1, 2, 4, … up to the hardware concurrency, and the hardware concurrency itself.
+std::vector<unsigned> defaultThreadCounts() {
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned count = 1; count < hardware; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(hardware);
+    return counts;
+}
+
+}
+
+int main(int argc, char **argv) {
+    benchmark::Options options;
+    std::string outputPath;
+    std::string baselinePath;
+    std::string tracePath;
+    double threshold = 0.1;
+    for (int index = 1; index < argc; ++index) {
+        const char *argument = argv[index];
+        const char *value = index + 1 < argc ? argv[index + 1] : nullptr;
+        if (strcmp(argument, "--list") == 0) {
+            for (const benchmark::Benchmark &benchmark : benchmark::benchmarks()) {
+                printf("%s (%s)\n", benchmark.name.c_str(), benchmark.unit.c_str());
+            }
+            return 0;
+        }
+        if (!value) {
+            printUsage();
+            return 2;
+        }
+        ++index;
+        if (strcmp(argument, "--filter") == 0) {
+            options.filter = value;
+        }
+        else if (strcmp(argument, "--threads") == 0) {
+            options.threadCounts = parseThreadCounts(value);
+            if (options.threadCounts.empty()) {
+                printUsage();
+                return 2;
+            }
+        }
+        else if (strcmp(argument, "--min-time") == 0) {
+            options.minimumTime = atof(value);
+        }
+        else if (strcmp(argument, "--output") == 0) {
+            outputPath = value;
+        }
+        else if (strcmp(argument, "--baseline") == 0) {
+            baselinePath = value;
+        }
+        else if (strcmp(argument, "--threshold") == 0) {
+            threshold = atof(value);
+        }
+        else if (strcmp(argument, "--trace") == 0) {
+            tracePath = value;
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (options.threadCounts.empty()) {
+        options.threadCounts = defaultThreadCounts();
+    }
+
+    // Read the baseline first, so a bad path fails before minutes of benchmarking.
+    std::vector<benchmark::Result> baseline;
+    std::string error;
+    if (!baselinePath.empty() && !benchmark::readResults(baselinePath, baseline, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    trace::setEnabled(!tracePath.empty());
+    printf("%-34s %10s %7s %14s %10s\n", "benchmark", "size", "threads", "items/s", "median ms");
+    const std::vector<benchmark::Result> results = benchmark::run(benchmark::benchmarks(), options, [](const benchmark::Result &result) {
+        printf("%-34s %10llu %7u %14.4g %10.3f  %s/s\n", result.name.c_str(), (unsigned long long)result.size, result.threads, result.itemsPerSecond, result.medianSeconds * 1000, result.unit.c_str());
+        fflush(stdout);
+    });
+
+    trace::setEnabled(false);
+
+    if (!outputPath.empty() && !benchmark::writeResults(outputPath, results, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    if (!tracePath.empty() && !trace::writeChromeTrace(tracePath, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+
+    if (baselinePath.empty()) {
+        return 0;
+    }
+    size_t regressions = 0;
+    printf("\nagainst %s (threshold %.0f%%)\n", baselinePath.c_str(), threshold * 100);
+    for (const benchmark::Comparison &comparison : benchmark::compare(results, baseline, threshold)) {
+        const benchmark::Result &result = comparison.current;
+        if (!comparison.hasBaseline) {
+            printf("%-34s %10llu %7u  new\n", result.name.c_str(), (unsigned long long)result.size, result.threads);
+            continue;
+        }
+        printf("%-34s %10llu %7u %+8.1f%%%s\n", result.name.c_str(), (unsigned long long)result.size, result.threads, comparison.change * 100, comparison.regressed ? "  REGRESSION" : "");
+        regressions += comparison.regressed;
+    }
+    if (regressions > 0) {
+        printf("%zu regression%s\n", regressions, regressions == 1 ? "" : "s");
+        return 1;
+    }
+    return 0;
+}
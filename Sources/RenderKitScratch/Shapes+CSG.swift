@@ -1,3 +1,5 @@
+import Metal
+import RenderKit
 import RenderKitShaders
 import SIMDSupport
 import SwiftUI
@@ -126,6 +128,33 @@ public extension CSG {
     }
 }
 
+public extension CSG where Vertex == SimpleVertex {
+    /// Fans each (convex) polygon into triangles over shared vertices, reordered by `MeshOptimizer`.
+    func toYAMesh(label: String? = nil, device: MTLDevice) throws -> YAMesh {
+        var vertices: [SimpleVertex] = []
+        var vertexIndices: [SimpleVertex: UInt16] = [:]
+        var indices: [UInt16] = []
+        for polygon in polygons where polygon.vertices.count >= 3 {
+            let polygonIndices = try polygon.vertices.map { vertex in
+                if let index = vertexIndices[vertex] {
+                    return index
+                }
+                guard vertices.count <= Int(UInt16.max) else {
+                    throw RenderKitError.generic("Too many vertices for 16 bit indices.")
+                }
+                let index = UInt16(vertices.count)
+                vertices.append(vertex)
+                vertexIndices[vertex] = index
+                return index
+            }
+            for corner in 1 ..< polygonIndices.count - 1 {
+                indices += [polygonIndices[0], polygonIndices[corner], polygonIndices[corner + 1]]
+            }
+        }
+        return try YAMesh.simpleMesh(label: label, indices: indices, vertices: vertices, optimize: true, device: device)
+    }
+}
+
 public extension CGRect {
     func toCSG() -> CSG<SimpleVertex> {
         let vertices = [minXMinY, maxXMinY, maxXMaxY, minXMaxY]
@@ -171,6 +171,6 @@ extension WingedEdgeCollection {
                 return SimpleVertex(position: vertex.position, normal: .zero, textureCoordinate: .zero)
             }
         }
-        return try YAMesh.simpleMesh(indices: indices, vertices: vertices, device: device)
+        return try YAMesh.simpleMesh(indices: indices, vertices: vertices, optimize: true, device: device)
     }
 }
@@ -50,8 +50,64 @@ float4 BlinnPhongFragmentShader(Fragment in [[stage_in]],
     return float4(GammaCorrect(color, lightingModel.screenGamma), 1.0);
 }
 
+[[fragment]]
+float4 BlinnPhongClusteredFragmentShader(Fragment in [[stage_in]],
+                                         constant BlinnPhongLightingModelArgumentBuffer &lightingModel [[buffer(BlinnPhongBindings_LightingModelArgumentBuffer)]],
+                                         constant BlinnPhongMaterialArgumentBuffer &material [[buffer(BlinnPhongBindings_MaterialArgumentBuffer)]],
+                                         constant BlinnPhongClusterGrid &clusterGrid [[buffer(BlinnPhongClusterBindings_ClusterGridBuffer)]],
+                                         const device BlinnPhongClusterRange *clusterRanges [[buffer(BlinnPhongClusterBindings_ClusterRangesBuffer)]],
+                                         const device uint *lightIndices [[buffer(BlinnPhongClusterBindings_LightIndicesBuffer)]]
+                                         )
+{
+    float3 ambientColor = material.ambientTexture.sample(material.ambientSampler, in.textureCoordinate).rgb;
+    float3 diffuseColor = material.diffuseTexture.sample(material.diffuseSampler, in.textureCoordinate).rgb;
+    float3 specularColor = material.specularTexture.sample(material.specularSampler, in.textureCoordinate).rgb;
+    float3 color = CalculateBlinnPhongClustered(in.position, in.modelPosition, in.interpolatedNormal, lightingModel, clusterGrid, clusterRanges, lightIndices, material.shininess, ambientColor, diffuseColor, specularColor);
+    return float4(GammaCorrect(color, lightingModel.screenGamma), 1.0);
+}
+
 // MARK: Helper Functions
 
+// One light's diffuse and specular terms. `normal` and `viewDir` are normalized once per fragment by the callers.
+static void AccumulateBlinnPhongLight(const device BlinnPhongLight &light,
+                                      float3 modelPosition,
+                                      float3 normal,
+                                      float3 viewDir,
+                                      float shininess,
+                                      thread float3 &accumulatedDiffuse,
+                                      thread float3 &accumulatedSpecular
+                                      )
+{
+    float3 lightDir = light.lightPosition - modelPosition;
+    float distance = length(lightDir);
+    distance = distance * distance;
+    lightDir = normalize(lightDir);
+
+    const float lambertian = max(dot(lightDir, normal), 0.0);
+    float specular = 0.0;
+
+    if (lambertian > 0.0)
+    {
+        // this is blinn phong
+        if (kPhongMode == 0)
+        {
+            const float3 halfDir = normalize(lightDir + viewDir);
+            const float specularAngle = max(dot(halfDir, normal), 0.0);
+            specular = pow(specularAngle, shininess);
+        }
+        else
+        {
+            // this is phong (for comparison)
+            const float3 reflectDir = reflect(-lightDir, normal);
+            const float specularAngle = max(dot(reflectDir, viewDir), 0.0);
+            // note that the exponent is different here
+            specular = pow(specularAngle, shininess / 4.0);
+        }
+    }
+    const float3 radiance = light.lightColor * light.lightPower / distance;
+    accumulatedDiffuse += lambertian * radiance;
+    accumulatedSpecular += specular * radiance;
+}
 
 float3 CalculateBlinnPhong(float3 modelPosition,
                            float3 interpolatedNormal,
@@ -62,44 +118,49 @@ float3 CalculateBlinnPhong(float3 modelPosition,
                            float3 specularColor
                            )
 {
-
-    float3 accumulatedDiffuseColor = { 0, 0, 0 };
-    float3 accumulatedSpecularColor = { 0, 0, 0 };
+    const float3 normal = normalize(interpolatedNormal);
+    const float3 viewDir = normalize(-modelPosition);
+    float3 accumulatedDiffuse = { 0, 0, 0 };
+    float3 accumulatedSpecular = { 0, 0, 0 };
 
     for (int index = 0; index != lightingModel.lightCount; ++index) {
-        const auto light = lightingModel.lights[index];
-        const float3 normal = normalize(interpolatedNormal);
-        float3 lightDir = lightingModel.lights[index].lightPosition - modelPosition;
-        float distance = length(lightDir);
-        distance = distance * distance;
-        lightDir = normalize(lightDir);
+        AccumulateBlinnPhongLight(lightingModel.lights[index], modelPosition, normal, viewDir, shininess, accumulatedDiffuse, accumulatedSpecular);
+    }
 
-        const float lambertian = max(dot(lightDir, normal), 0.0);
-        float specular = 0.0;
+    float3 finalColor = lightingModel.ambientLightColor * ambientColor + diffuseColor * accumulatedDiffuse + specularColor * accumulatedSpecular;
+    return finalColor;
+}
 
-        if (lambertian > 0.0)
-        {
-            const float3 viewDir = normalize(-modelPosition);
-            // this is blinn phong
-            if (kPhongMode == 0)
-            {
-                const float3 halfDir = normalize(lightDir + viewDir);
-                const float specularAngle = max(dot(halfDir, normal), 0.0);
-                specular = pow(specularAngle, shininess);
-            }
-            else
-            {
-                // this is phong (for comparison)
-                const float3 reflectDir = reflect(-lightDir, normal);
-                const float specularAngle = max(dot(reflectDir, viewDir), 0.0);
-                // note that the exponent is different here
-                specular = pow(specularAngle, shininess / 4.0);
-            }
-        }
-        accumulatedDiffuseColor += diffuseColor * lambertian * light.lightColor * light.lightPower / distance;
-        accumulatedSpecularColor += specularColor * specular * light.lightColor * light.lightPower / distance;
+// As CalculateBlinnPhong, but only with the lights binned into the fragment's cluster. Mirrors `lighting::LightClusters::clusterIndex`.
+float3 CalculateBlinnPhongClustered(float4 fragmentPosition,
+                                    float3 modelPosition,
+                                    float3 interpolatedNormal,
+                                    constant BlinnPhongLightingModelArgumentBuffer &lightingModel,
+                                    constant BlinnPhongClusterGrid &clusterGrid,
+                                    const device BlinnPhongClusterRange *clusterRanges,
+                                    const device uint *lightIndices,
+                                    float shininess,
+                                    float3 ambientColor,
+                                    float3 diffuseColor,
+                                    float3 specularColor
+                                    )
+{
+    const uint column = min(uint(max(fragmentPosition.x / clusterGrid.viewportWidth * float(clusterGrid.tilesWide), 0.0)), clusterGrid.tilesWide - 1);
+    const uint row = min(uint(max(fragmentPosition.y / clusterGrid.viewportHeight * float(clusterGrid.tilesHigh), 0.0)), clusterGrid.tilesHigh - 1);
+    const float depth = max(-modelPosition.z, clusterGrid.nearZ);
+    const float slicePosition = log(depth / clusterGrid.nearZ) / log(clusterGrid.farZ / clusterGrid.nearZ);
+    const uint slice = min(uint(max(slicePosition * float(clusterGrid.slices), 0.0)), clusterGrid.slices - 1);
+    const BlinnPhongClusterRange range = clusterRanges[(slice * clusterGrid.tilesHigh + row) * clusterGrid.tilesWide + column];
+
+    const float3 normal = normalize(interpolatedNormal);
+    const float3 viewDir = normalize(-modelPosition);
+    float3 accumulatedDiffuse = { 0, 0, 0 };
+    float3 accumulatedSpecular = { 0, 0, 0 };
+
+    for (uint index = range.offset; index != range.offset + range.count; ++index) {
+        AccumulateBlinnPhongLight(lightingModel.lights[lightIndices[index]], modelPosition, normal, viewDir, shininess, accumulatedDiffuse, accumulatedSpecular);
     }
 
-    float3 finalColor = lightingModel.ambientLightColor * ambientColor + accumulatedDiffuseColor + accumulatedSpecularColor;
+    float3 finalColor = lightingModel.ambientLightColor * ambientColor + diffuseColor * accumulatedDiffuse + specularColor * accumulatedSpecular;
     return finalColor;
 }
@@ -1,9 +1,10 @@
 #include <metal_stdlib>
 #include "include/Shaders.h"
 #include "include/ParticleShaders.h"
-#include "include/Random.h"
+#include "../include/HashRandom.h"
 
 using namespace metal;
+using namespace hashRandom;
 
 float3 apply_forces(float3 vel, float drag, float mass)
 {
@@ -66,3 +66,9 @@ typedef NS_ENUM(NSInteger, ParticleShadersBindings) {
     ParticleShadersBindings_EnvironmentBuffer = 26,
     ParticleShadersBindings_ParticlesBuffer = 27,
 };
+
+typedef NS_ENUM(NSInteger, BlinnPhongClusterBindings) {
+    BlinnPhongClusterBindings_ClusterGridBuffer = 28,
+    BlinnPhongClusterBindings_ClusterRangesBuffer = 29,
+    BlinnPhongClusterBindings_LightIndicesBuffer = 30,
+};
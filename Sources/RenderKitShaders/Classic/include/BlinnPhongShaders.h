@@ -15,6 +15,23 @@ struct BlinnPhongLight {
     float lightPower;
 };
 
+// The froxel grid `BlinnPhongClusteredFragmentShader` looks lights up in: screen tiles by exponentially spaced view space depth slices between nearZ and farZ. Built on the CPU by `lighting::LightClusters`.
+struct BlinnPhongClusterGrid {
+    unsigned int tilesWide;
+    unsigned int tilesHigh;
+    unsigned int slices;
+    float viewportWidth;
+    float viewportHeight;
+    float nearZ;
+    float farZ;
+};
+
+// A cluster's lights: `lightIndices[offset ..< offset + count]`.
+struct BlinnPhongClusterRange {
+    unsigned int offset;
+    unsigned int count;
+};
+
 #ifdef __METAL_VERSION__
 struct BlinnPhongMaterialArgumentBuffer {
     texture2d<float, access::sample> ambientTexture;
@@ -41,4 +58,17 @@ float3 CalculateBlinnPhong(float3 modelPosition,
                            float3 diffuseColor,
                            float3 specularColor
                            );
+
+float3 CalculateBlinnPhongClustered(float4 fragmentPosition,
+                                    float3 modelPosition,
+                                    float3 interpolatedNormal,
+                                    constant BlinnPhongLightingModelArgumentBuffer &lightingModel,
+                                    constant BlinnPhongClusterGrid &clusterGrid,
+                                    const device BlinnPhongClusterRange *clusterRanges,
+                                    const device uint *lightIndices,
+                                    float shininess,
+                                    float3 ambientColor,
+                                    float3 diffuseColor,
+                                    float3 specularColor
+                                    );
 #endif
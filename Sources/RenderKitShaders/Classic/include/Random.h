@@ -3,6 +3,9 @@
 #include "GLSLCompat.h"
 
 // https://www.ronja-tutorials.com/post/024-white-noise/
+// Classic's copy of include/Random.h's sin based white noise, kept for the commented out include in Voxels.metal; no Classic shader calls it today. Its functions are in `sinRandom` so that it and HashRandom.h can be included together.
+
+namespace sinRandom {
 
 //get a scalar random value from a 3d value
 inline float rand3dTo1d(float3 value, float3 dotDir = float3(12.9898, 78.233, 37.719)){
@@ -75,3 +78,5 @@ inline float3 rand1dTo3d(float value){
                   rand1dTo1d(value, 5.7241)
                   );
 }
+
+}
@@ -14,6 +14,20 @@ struct Fragment {
 
 // MARK: -
 
+inline Fragment flatShaderVertex(float3 position, float3 normal, float2 textureCoordinate, ushort instance_id, constant CameraUniforms &camera, constant ModelTransforms *modelTransforms)
+{
+    const ModelTransforms modelTransform = modelTransforms[instance_id];
+    const float4 modelVertex = modelTransform.modelViewMatrix * float4(position, 1.0);
+    return {
+        .position = camera.projectionMatrix * modelVertex,
+        .modelPosition = float3(modelVertex) / modelVertex.w,
+        .interpolatedNormalFlat = modelTransform.modelNormalMatrix * normal,
+        .interpolatedNormal = modelTransform.modelNormalMatrix * normal,
+        .textureCoordinate = textureCoordinate,
+        .instance_id = instance_id
+    };
+}
+
 [[vertex]]
 Fragment flatShaderVertexShader(
     Vertex in [[stage_in]],
@@ -22,16 +36,20 @@ Fragment flatShaderVertexShader(
     constant ModelTransforms *modelTransforms [[buffer(2)]]
     )
 {
-    const ModelTransforms modelTransform = modelTransforms[instance_id];
-    const float4 modelVertex = modelTransform.modelViewMatrix * float4(in.position, 1.0);
-    return {
-        .position = camera.projectionMatrix * modelVertex,
-        .modelPosition = float3(modelVertex) / modelVertex.w,
-        .interpolatedNormalFlat = modelTransform.modelNormalMatrix * in.normal,
-        .interpolatedNormal = modelTransform.modelNormalMatrix * in.normal,
-        .textureCoordinate = in.textureCoordinate,
-        .instance_id = instance_id
-    };
+    return flatShaderVertex(in.position, in.normal, in.textureCoordinate, instance_id, camera, modelTransforms);
+}
+
+// For meshes in the 16 byte `QuantizedVertex` layout (`VertexDescriptor.packed(semantics:quantized: true)`), with the mesh's quantization `bounds`; pairs with flatShaderFragmentShader.
+[[vertex]]
+Fragment flatShaderQuantizedVertexShader(
+    QuantizedVertex in [[stage_in]],
+    ushort instance_id[[instance_id]],
+    constant CameraUniforms &camera [[buffer(1)]],
+    constant ModelTransforms *modelTransforms [[buffer(2)]],
+    constant QuantizationBounds &bounds [[buffer(3)]]
+    )
+{
+    return flatShaderVertex(dequantize_position(in.position, bounds), octahedral_decode(in.normal), in.textureCoordinate, instance_id, camera, modelTransforms);
 }
 
 [[fragment]]
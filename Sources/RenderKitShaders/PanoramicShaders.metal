@@ -52,3 +52,54 @@ vector_float4 panoramicFragmentShader(
     color *= uniforms.colorFactor;
     return color;
 }
+
+// MARK: -
+
+// Pages across and down one tile at a level.
+static uint2 pageCount(constant PanoramaVirtualTextureUniforms &uniforms, uint level) {
+    return (max(uniforms.tileSize >> level, uint2(1)) + uniforms.pageSize - 1) / uniforms.pageSize;
+}
+
+// Samples a virtual texture: the page table, one entry per page of every tile and level, points at the slot in the atlas holding the finest resident page covering it. Mirrors `textures::VirtualTexture::translate`.
+[[fragment]]
+vector_float4 panoramicVirtualTextureFragmentShader(
+    Fragment in [[stage_in]],
+    constant PanoramaVirtualTextureUniforms &uniforms [[buffer(0)]],
+    const device uint *pageTable [[buffer(1)]],
+    texture2d<float, access::sample> atlas [[texture(0)]]
+    )
+{
+    const float2 gridCoordinate = in.textureCoordinate * float2(uniforms.gridSize);
+    const uint2 tile = min(uint2(max(gridCoordinate, float2(0))), uint2(uniforms.gridSize) - 1);
+    const float2 local = gridCoordinate - float2(tile);
+
+    // The level whose texels best match the screen's pixels; derivatives of the continuous coordinate, so tile edges do not jump.
+    const float2 texels = gridCoordinate * float2(uniforms.tileSize);
+    const float texelsPerPixel = max(length(dfdx(texels)), length(dfdy(texels)));
+    const uint pageLevel = min(uint(max(log2(texelsPerPixel), 0.0)), uniforms.levelCount - 1);
+
+    uint offset = 0;
+    for (uint finer = 0; finer < pageLevel; ++finer) {
+        const uint2 pages = pageCount(uniforms, finer);
+        offset += pages.x * pages.y;
+    }
+    const float2 levelSize = float2(max(uniforms.tileSize >> pageLevel, uint2(1)));
+    uint2 page = min(uint2(local * levelSize / float(uniforms.pageSize)), pageCount(uniforms, pageLevel) - 1);
+    const uint entry = pageTable[(tile.y * uniforms.gridSize.x + tile.x) * uniforms.pagesPerTile + offset + page.y * pageCount(uniforms, pageLevel).x + page.x];
+    if (entry == 0xFFFFFFFF) {
+        return float4(0);
+    }
+
+    // Walk up to the resident level the way the page table was built.
+    const uint slot = entry & 0xFFFF, residentLevel = entry >> 16;
+    for (uint parent = pageLevel + 1; parent <= residentLevel; ++parent) {
+        page = min(page >> 1, pageCount(uniforms, parent) - 1);
+    }
+    const float2 residentSize = float2(max(uniforms.tileSize >> residentLevel, uint2(1)));
+    const float2 inPage = clamp(local * residentSize, float2(0.5), residentSize - 0.5) - float2(page * uniforms.pageSize);
+    const uint2 slotSize = uniforms.pageSize + 2 * uniforms.border;
+    const float2 atlasTexel = float2(uint2(slot % uniforms.slotsPerRow, slot / uniforms.slotsPerRow) * slotSize + uniforms.border) + inPage;
+    float4 color = atlas.sample(RenderKitShaders::basicSampler, atlasTexel / uniforms.atlasSize, level(0));
+    color *= uniforms.colorFactor;
+    return color;
+}
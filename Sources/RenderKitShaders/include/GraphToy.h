@@ -104,14 +104,15 @@ template <typename T> T mod(T x, T y) {
 
 float cellnoise(float x)
 {
-    auto n = int(floor(x)) | 0;
-    n = (n << 13) ^ n;  n &= 0xffffffff;
+    // graphtoy's `& 0xffffffff` wrapping, done in uint: the products overflow, which int may not.
+    auto n = uint(int(floor(x)));
+    n = (n << 13) ^ n;
     auto m = n;
-    n = n * 15731;      n &= 0xffffffff;
-    n = n * m;          n &= 0xffffffff;
-    n = n + 789221;     n &= 0xffffffff;
-    n = n * m;          n &= 0xffffffff;
-    n = n + 1376312589; n &= 0xffffffff;
+    n = n * 15731;
+    n = n * m;
+    n = n + 789221;
+    n = n * m;
+    n = n + 1376312589;
     n = (n>>14) & 65535;
     return n/65535.0;
 }
@@ -0,0 +1,174 @@
+#pragma once
+
+// Integer hash replacements for the `frac(sin(x) * 143758.5453)` functions in Random.h. Same names and dimensions (`rand3dTo1d`, `rand2dTo2d`, `rand1dTo3d`, …) in the `hashRandom` namespace, so a shader switches by including this header and `using namespace hashRandom;` instead of Random.h.
+// Inputs are hashed by bit pattern (so 0 and -0 are different inputs), and every output has 24 random bits in [0, 1). There are no transcendentals and nothing depends on the magnitude of the input, so the results are the same on the GPU and in host C++ bit for bit.
+// Compiles as Metal and as host C++ (C++17 or later, with or without <simd/simd.h>); RenderKitCPU exposes it as `Random.h`.
+
+#ifdef __METAL_VERSION__
+#include <metal_stdlib>
+using namespace metal;
+#elif __has_include(<simd/simd.h>)
+#include <simd/simd.h>
+#include <stdint.h>
+#else
+#include <stdint.h>
+#endif
+
+namespace hashRandom {
+
+#ifdef __METAL_VERSION__
+inline uint32_t bitsOf(float value) {
+    return metal::as_type<uint32_t>(value);
+}
+
+inline uint32_t mulhi(uint32_t a, uint32_t b) {
+    return metal::mulhi(a, b);
+}
+#else
+#if __has_include(<simd/simd.h>)
+typedef simd_float2 float2;
+typedef simd_float3 float3;
+typedef simd_uint2 uint2;
+typedef simd_uint3 uint3;
+typedef simd_uint4 uint4;
+#else
+struct float2 {
+    float x, y;
+};
+
+struct float3 {
+    float x, y, z;
+};
+
+struct uint2 {
+    uint32_t x, y;
+};
+
+struct uint3 {
+    uint32_t x, y, z;
+};
+
+struct uint4 {
+    uint32_t x, y, z, w;
+};
+#endif
+
+inline uint32_t bitsOf(float value) {
+    return __builtin_bit_cast(uint32_t, value);
+}
+
+inline uint32_t mulhi(uint32_t a, uint32_t b) {
+    return uint32_t((uint64_t(a) * b) >> 32);
+}
+#endif
+
+// MARK: Generators
+
+// PCG-RXS-M-XS: one LCG step and its output permutation, as a stateless hash (Jarzynski & Olano, "Hash Functions for GPU Rendering", 2020).
+inline uint32_t pcg(uint32_t value) {
+    const uint32_t state = value * 747796405u + 2891336453u;
+    const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Three inputs to three independent outputs (same paper). Every output bit depends on every input bit.
+inline uint3 pcg3d(uint32_t x, uint32_t y, uint32_t z) {
+    x = x * 1664525u + 1013904223u;
+    y = y * 1664525u + 1013904223u;
+    z = z * 1664525u + 1013904223u;
+    x += y * z;
+    y += z * x;
+    z += x * y;
+    x ^= x >> 16u;
+    y ^= y >> 16u;
+    z ^= z >> 16u;
+    x += y * z;
+    y += z * x;
+    z += x * y;
+    return uint3 { x, y, z };
+}
+
+inline uint4 pcg4d(uint32_t x, uint32_t y, uint32_t z, uint32_t w) {
+    x = x * 1664525u + 1013904223u;
+    y = y * 1664525u + 1013904223u;
+    z = z * 1664525u + 1013904223u;
+    w = w * 1664525u + 1013904223u;
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    w += y * z;
+    x ^= x >> 16u;
+    y ^= y >> 16u;
+    z ^= z >> 16u;
+    w ^= w >> 16u;
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    w += y * z;
+    return uint4 { x, y, z, w };
+}
+
+// Philox-2x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", 2011). Counter based: (counter, key) → two words, with every counter giving an independent draw. Use it for streams, e.g. counter = (particle index, frame) and key = seed.
+inline uint2 philox2x32(uint32_t counter0, uint32_t counter1, uint32_t key) {
+    for (int index = 0; index != 10; ++index) {
+        const uint32_t high = mulhi(0xD256D193u, counter0);
+        const uint32_t low = 0xD256D193u * counter0;
+        counter0 = high ^ key ^ counter1;
+        counter1 = low;
+        key += 0x9E3779B9u;
+    }
+    return uint2 { counter0, counter1 };
+}
+
+// The top 24 bits as a float in [0, 1); exact in single precision.
+inline float unitFloat(uint32_t bits) {
+    return float(bits >> 8u) * (1.0f / 16777216.0f);
+}
+
+// MARK: Random.h replacements
+
+// `seed` picks an independent family of values for the same input, in place of Random.h's `dotDir` and `mutator` parameters.
+
+inline float rand3dTo1d(float3 value, uint32_t seed = 0) {
+    return unitFloat(pcg4d(bitsOf(value.x), bitsOf(value.y), bitsOf(value.z), seed).x);
+}
+
+inline float rand2dTo1d(float2 value, uint32_t seed = 0) {
+    return unitFloat(pcg3d(bitsOf(value.x), bitsOf(value.y), seed).x);
+}
+
+inline float rand1dTo1d(float value, uint32_t seed = 0) {
+    return unitFloat(pcg(bitsOf(value) ^ pcg(seed)));
+}
+
+inline float2 rand3dTo2d(float3 value, uint32_t seed = 0) {
+    const uint4 hash = pcg4d(bitsOf(value.x), bitsOf(value.y), bitsOf(value.z), seed);
+    return float2 { unitFloat(hash.x), unitFloat(hash.y) };
+}
+
+inline float2 rand2dTo2d(float2 value, uint32_t seed = 0) {
+    const uint3 hash = pcg3d(bitsOf(value.x), bitsOf(value.y), seed);
+    return float2 { unitFloat(hash.x), unitFloat(hash.y) };
+}
+
+inline float2 rand1dTo2d(float value, uint32_t seed = 0) {
+    const uint3 hash = pcg3d(bitsOf(value), seed, 0x9E3779B9u);
+    return float2 { unitFloat(hash.x), unitFloat(hash.y) };
+}
+
+inline float3 rand3dTo3d(float3 value, uint32_t seed = 0) {
+    const uint4 hash = pcg4d(bitsOf(value.x), bitsOf(value.y), bitsOf(value.z), seed);
+    return float3 { unitFloat(hash.x), unitFloat(hash.y), unitFloat(hash.z) };
+}
+
+inline float3 rand2dTo3d(float2 value, uint32_t seed = 0) {
+    const uint3 hash = pcg3d(bitsOf(value.x), bitsOf(value.y), seed);
+    return float3 { unitFloat(hash.x), unitFloat(hash.y), unitFloat(hash.z) };
+}
+
+inline float3 rand1dTo3d(float value, uint32_t seed = 0) {
+    const uint3 hash = pcg3d(bitsOf(value), seed, 0x9E3779B9u);
+    return float3 { unitFloat(hash.x), unitFloat(hash.y), unitFloat(hash.z) };
+}
+
+}
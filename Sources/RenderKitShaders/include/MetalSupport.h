@@ -37,7 +37,7 @@ inline float3 srgb_to_linear(float3 c) {
 }
 
 inline float4 srgb_to_linear(float4 c) {
-    return float4(srgb_to_linear(c.xyz), c.a);
+    return float4(srgb_to_linear(float3(c.xyz)), c.a);
 }
 
 template<typename T> T linear_to_srgb(T c) {
@@ -57,6 +57,6 @@ inline float3 linear_to_srgb(float3 c) {
 }
 
 inline float4 linear_to_srgb(float4 c) {
-    return float4(linear_to_srgb(c.xyz), c.a);
+    return float4(linear_to_srgb(float3(c.xyz)), c.a);
 }
 #endif
@@ -4,3 +4,16 @@ struct PanoramaFragmentUniforms {
     simd_ushort2 gridSize;
     float4 colorFactor;
 };
+
+// Geometry of a `textures::VirtualTexture` for `panoramicVirtualTextureFragmentShader`; sizes in texels.
+struct PanoramaVirtualTextureUniforms {
+    simd_ushort2 gridSize;
+    simd_uint2 tileSize;
+    simd_uint2 border;
+    unsigned int pageSize;
+    unsigned int levelCount;
+    unsigned int pagesPerTile;
+    unsigned int slotsPerRow;
+    simd_float2 atlasSize;
+    float4 colorFactor;
+};
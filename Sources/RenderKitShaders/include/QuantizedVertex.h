@@ -0,0 +1,40 @@
+#pragma once
+
+#import "MetalSupport.h"
+
+// A `SimpleVertex` in 16 bytes rather than 32, for large static meshes: the position as three 16 bit unorms within the mesh's bounds (and one of padding), the normal octahedrally encoded in two 16 bit snorms, and the texture coordinate as halves. Described by `VertexDescriptor.packed(semantics:quantized: true)`, drawn by `flatShaderQuantizedVertexShader` (FlatShader.metal); RenderKitCPU's VertexQuantization.h produces it.
+
+// Maps a quantized position p in [0, 1]³ back into the mesh as origin + scale * p. Rather than decode per vertex, a renderer can fold this into the model matrix.
+struct QuantizationBounds {
+    float3 origin;
+    float3 scale;
+};
+
+#ifdef __METAL_VERSION__
+// The attributes as vertex fetch converts them.
+struct QuantizedVertex {
+    float4 position [[attribute(0)]];
+    float2 normal [[attribute(1)]];
+    float2 textureCoordinate [[attribute(2)]];
+};
+
+inline float3 dequantize_position(float4 position, QuantizationBounds bounds) {
+    return bounds.origin + bounds.scale * float3(position.xyz);
+}
+
+// The unit vector an octahedral encoding in [-1, 1]² stands for: the upper half of the octahedron maps directly and the lower half is folded out over the corners.
+inline float3 octahedral_decode(float2 encoded) {
+    float3 normal = float3(encoded.x, encoded.y, 1.0 - abs(encoded.x) - abs(encoded.y));
+    const float t = saturate(-normal.z);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+#else
+struct QuantizedVertex {
+    simd_ushort4 position;
+    simd_short2 normal;
+    // IEEE binary16 bits.
+    simd_ushort2 textureCoordinate;
+};
+#endif
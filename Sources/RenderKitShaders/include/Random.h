@@ -5,6 +5,9 @@
 using namespace glslCompatible;
 
 // https://www.ronja-tutorials.com/post/024-white-noise/
+// The original sin based white noise. No shader in this package uses it any more: voronoiNoise.metal and the particle respawn moved to HashRandom.h, whose integer hashes match the host bit for bit. It stays in the public headers for app shaders that rely on these exact values, inside `sinRandom` so that it can be included alongside HashRandom.h.
+
+namespace sinRandom {
 
 //get a scalar random value from a 3d value
 inline float rand3dTo1d(float3 value, float3 dotDir = float3(12.9898, 78.233, 37.719)){
@@ -77,3 +80,5 @@ inline float3 rand1dTo3d(float value){
                   rand1dTo1d(value, 5.7241)
                   );
 }
+
+}
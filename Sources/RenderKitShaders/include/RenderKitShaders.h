@@ -7,3 +7,4 @@
 #import "VolumeShaders.h"
 #import "FlatShader.h"
 #import "UnlitShader.h"
+#import "QuantizedVertex.h"
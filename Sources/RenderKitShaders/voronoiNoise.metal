@@ -1,9 +1,10 @@
 #include <metal_stdlib>
 #include "include/GLSLCompat.h"
-#include "include/Random.h"
+#include "include/HashRandom.h"
 //#include "include/Shaders.h"
 
 using namespace metal;
+using namespace hashRandom;
 
 float2 voronoiNoise(float3 value) {
     float2 baseCell = floor(value.xy);
@@ -0,0 +1,20 @@
+#include "RenderKitShadersHost.h"
+
+#include <metal_stdlib>
+
+namespace checkerboardShader {
+#include "../RenderKitShaders/Classic/CheckerBoardCompute.metal"
+}
+
+namespace shaders {
+
+void checkerboard(const Texture &output, float width, float height, compute::Size threadsPerThreadgroup) {
+    const trace::Zone zone("shaders.checkerboard");
+    const metal::texture2d<float, metal::access::write> texture(output.texels, output.width, output.height, output.channels);
+    const metal::float2 size(width, height);
+    compute::dispatchThreads({ output.width, output.height, 1 }, threadsPerThreadgroup, [&](const compute::Thread &invocation) {
+        checkerboardShader::checkerboard(metal::uint2(invocation.positionInGrid.x, invocation.positionInGrid.y), metal::uint2(invocation.threadsPerGrid.width, invocation.threadsPerGrid.height), texture, size);
+    });
+}
+
+}
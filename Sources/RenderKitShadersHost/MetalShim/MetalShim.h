@@ -0,0 +1,1189 @@
+#pragma once
+
+// Enough of the Metal Shading Language's standard library, in C++20, for RenderKitShaders' compute kernels to compile for the host unchanged: vectors with swizzles, matrices, the common, geometric and integer functions, textures over host memory, and samplers. `<metal_stdlib>` and `<simd/simd.h>` in this directory lead here.
+// A translation unit includes every other header first, then `<metal_stdlib>`, which defines `__METAL_VERSION__` (so shared headers take their shader side) and the address space and function qualifiers (`kernel`, `device`, `constant`, …) as empty macros. It then includes the .metal file inside a namespace of its own, so that two shader files' helpers of the same name can't collide.
+// Arithmetic is done in the element type, except that halfs are widened to float for the library functions, and double literals stay double until they are stored. Results agree with the GPU's to within rounding, not bit for bit.
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+// Shader code is written to the Metal compiler's warnings, not the host's: attributes the host doesn't know, `#import`, kernel arguments only some kernels use, and partial aggregate initialisation.
+#pragma GCC diagnostic ignored "-Wattributes"
+#pragma GCC diagnostic ignored "-Wdeprecated"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+namespace metal {
+
+using ::int8_t;
+using ::int16_t;
+using ::int32_t;
+using ::int64_t;
+using ::uint8_t;
+using ::uint16_t;
+using ::uint32_t;
+using ::uint64_t;
+
+typedef unsigned char uchar;
+typedef unsigned short ushort;
+typedef unsigned int uint;
+typedef _Float16 half;
+
+// MARK: - Vectors
+
+template <typename T, int N>
+struct vec;
+
+template <typename T, int N>
+struct packed_vec;
+
+template <typename T, int N, int... I>
+struct swizzle;
+
+template <typename T>
+concept scalar_like = std::is_arithmetic_v<T> || std::is_same_v<T, half>;
+
+// Element type and count of everything that reads as a vector: vectors, packed vectors and swizzles.
+template <typename X>
+struct vector_traits {
+    static constexpr int size = 0;
+};
+
+template <typename T, int N>
+struct vector_traits<vec<T, N>> {
+    using element = T;
+    static constexpr int size = N;
+
+    static T at(const vec<T, N> &value, int index) {
+        return value.v[index];
+    }
+};
+
+template <typename T, int N>
+struct vector_traits<packed_vec<T, N>> {
+    using element = T;
+    static constexpr int size = N;
+
+    static T at(const packed_vec<T, N> &value, int index) {
+        return value.v[index];
+    }
+};
+
+template <typename T, int N, int... I>
+struct vector_traits<swizzle<T, N, I...>> {
+    using element = T;
+    static constexpr int size = sizeof...(I);
+
+    static T at(const swizzle<T, N, I...> &value, int index) {
+        constexpr int indices[] = { I... };
+        return value.v[indices[index]];
+    }
+};
+
+template <typename X>
+concept vector_like = vector_traits<std::remove_cvref_t<X>>::size > 0;
+
+template <typename X>
+using element_of = typename vector_traits<std::remove_cvref_t<X>>::element;
+
+template <typename X>
+constexpr int size_of = vector_traits<std::remove_cvref_t<X>>::size;
+
+template <typename X>
+using vector_of = vec<element_of<X>, size_of<X>>;
+
+namespace detail {
+
+// Scalars count as one component, vectors as their size.
+template <typename X>
+constexpr int components() {
+    if constexpr (vector_like<X>) {
+        return size_of<X>;
+    }
+    else {
+        return 1;
+    }
+}
+
+// Component `index` of `value` as a T; scalars broadcast.
+template <typename T, typename X>
+T component(const X &value, int index) {
+    if constexpr (vector_like<X>) {
+        return T(vector_traits<std::remove_cvref_t<X>>::at(value, index));
+    }
+    else {
+        return T(value);
+    }
+}
+
+template <typename T, typename X>
+void append(T *&output, const X &value) {
+    for (int index = 0; index != components<X>(); ++index) {
+        *output++ = component<T>(value, index);
+    }
+}
+
+// The library functions work on halfs as floats.
+template <typename T>
+auto widen(T value) {
+    if constexpr (std::is_same_v<T, half>) {
+        return float(value);
+    }
+    else {
+        return value;
+    }
+}
+
+template <int... I>
+constexpr bool distinct() {
+    constexpr int indices[] = { I... };
+    for (size_t a = 0; a != sizeof...(I); ++a) {
+        for (size_t b = a + 1; b != sizeof...(I); ++b) {
+            if (indices[a] == indices[b]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+// The constructors and operators every vector type shares. Metal converts scalars to vectors implicitly and vectors of another element type or size explicitly.
+#define METAL_SHIM_VECTOR_MEMBERS(Name, N)                                                                                     \
+    Name()                                                                                                                     \
+        : v {} {                                                                                                               \
+    }                                                                                                                          \
+    Name(const Name &) = default;                                                                                              \
+    Name &operator=(const Name &other) {                                                                                       \
+        std::copy(other.v, other.v + N, v);                                                                                    \
+        return *this;                                                                                                          \
+    }                                                                                                                          \
+    template <scalar_like S>                                                                                                   \
+    Name(S scalar) {                                                                                                           \
+        std::fill(v, v + N, T(scalar));                                                                                        \
+    }                                                                                                                          \
+    template <vector_like V>                                                                                                   \
+        requires(size_of<V> >= N)                                                                                              \
+    explicit(!std::is_same_v<element_of<V>, T> || size_of<V> != N) Name(const V &other) {                                      \
+        for (int index = 0; index != N; ++index) {                                                                             \
+            v[index] = detail::component<T>(other, index);                                                                     \
+        }                                                                                                                      \
+    }                                                                                                                          \
+    template <typename... Parts>                                                                                               \
+        requires(sizeof...(Parts) >= 2 && (detail::components<Parts>() + ...) == N)                                           \
+    Name(const Parts &...parts) {                                                                                              \
+        T *output = v;                                                                                                         \
+        (detail::append(output, parts), ...);                                                                                  \
+    }                                                                                                                          \
+    T &operator[](int index) {                                                                                                 \
+        return v[index];                                                                                                       \
+    }                                                                                                                          \
+    const T &operator[](int index) const {                                                                                     \
+        return v[index];                                                                                                       \
+    }                                                                                                                          \
+    METAL_SHIM_COMPOUND_ASSIGNMENT(Name, vec<T, N>(*this))
+
+#define METAL_SHIM_COMPOUND_ASSIGNMENT(Name, ...)                                                                              \
+    template <typename B>                                                                                                      \
+    Name &operator+=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) + other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator-=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) - other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator*=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) * other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator/=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) / other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator%=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) % other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator&=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) & other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator|=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) | other;                                                                                          \
+    }                                                                                                                          \
+    template <typename B>                                                                                                      \
+    Name &operator^=(const B &other) {                                                                                         \
+        return *this = (__VA_ARGS__) ^ other;                                                                                          \
+    }
+
+// A swizzle reads as a vector of the named components and, when it names none twice, can be assigned to.
+template <typename T, int N, int... I>
+struct swizzle {
+    T v[N];
+
+    swizzle() = default;
+    swizzle(const swizzle &) = default;
+
+    swizzle &operator=(const vec<T, sizeof...(I)> &value) {
+        static_assert(detail::distinct<I...>(), "a swizzle that repeats a component can't be assigned to");
+        const vec<T, sizeof...(I)> copy = value;
+        int index = 0;
+        ((v[I] = copy.v[index++]), ...);
+        return *this;
+    }
+
+    swizzle &operator=(const swizzle &other) {
+        return *this = vec<T, sizeof...(I)>(other);
+    }
+
+    template <typename B>
+        requires(vector_like<B> || scalar_like<B>)
+    swizzle &operator=(const B &value) {
+        return *this = vec<T, sizeof...(I)>(value);
+    }
+
+    METAL_SHIM_COMPOUND_ASSIGNMENT(swizzle, vec<T, sizeof...(I)>(*this))
+};
+
+// Swizzle members: every sequence of two to four of a vector's components, named with xyzw and with rgba. Each level of nesting needs its own iteration macro, as a macro can't expand inside itself.
+#define METAL_SHIM_NAME(S, i) METAL_SHIM_NAME_##S##_##i
+#define METAL_SHIM_NAME_xyzw_0 x
+#define METAL_SHIM_NAME_xyzw_1 y
+#define METAL_SHIM_NAME_xyzw_2 z
+#define METAL_SHIM_NAME_xyzw_3 w
+#define METAL_SHIM_NAME_rgba_0 r
+#define METAL_SHIM_NAME_rgba_1 g
+#define METAL_SHIM_NAME_rgba_2 b
+#define METAL_SHIM_NAME_rgba_3 a
+#define METAL_SHIM_CAT2(a, b) METAL_SHIM_CAT2_(a, b)
+#define METAL_SHIM_CAT2_(a, b) a##b
+#define METAL_SHIM_CAT3(a, b, c) METAL_SHIM_CAT3_(a, b, c)
+#define METAL_SHIM_CAT3_(a, b, c) a##b##c
+#define METAL_SHIM_CAT4(a, b, c, d) METAL_SHIM_CAT4_(a, b, c, d)
+#define METAL_SHIM_CAT4_(a, b, c, d) a##b##c##d
+
+#define METAL_SHIM_EACH_A2(M, ...) M(__VA_ARGS__, 0) M(__VA_ARGS__, 1)
+#define METAL_SHIM_EACH_A3(M, ...) METAL_SHIM_EACH_A2(M, __VA_ARGS__) M(__VA_ARGS__, 2)
+#define METAL_SHIM_EACH_A4(M, ...) METAL_SHIM_EACH_A3(M, __VA_ARGS__) M(__VA_ARGS__, 3)
+#define METAL_SHIM_EACH_B2(M, ...) M(__VA_ARGS__, 0) M(__VA_ARGS__, 1)
+#define METAL_SHIM_EACH_B3(M, ...) METAL_SHIM_EACH_B2(M, __VA_ARGS__) M(__VA_ARGS__, 2)
+#define METAL_SHIM_EACH_B4(M, ...) METAL_SHIM_EACH_B3(M, __VA_ARGS__) M(__VA_ARGS__, 3)
+#define METAL_SHIM_EACH_C2(M, ...) M(__VA_ARGS__, 0) M(__VA_ARGS__, 1)
+#define METAL_SHIM_EACH_C3(M, ...) METAL_SHIM_EACH_C2(M, __VA_ARGS__) M(__VA_ARGS__, 2)
+#define METAL_SHIM_EACH_C4(M, ...) METAL_SHIM_EACH_C3(M, __VA_ARGS__) M(__VA_ARGS__, 3)
+#define METAL_SHIM_EACH_D2(M, ...) M(__VA_ARGS__, 0) M(__VA_ARGS__, 1)
+#define METAL_SHIM_EACH_D3(M, ...) METAL_SHIM_EACH_D2(M, __VA_ARGS__) M(__VA_ARGS__, 2)
+#define METAL_SHIM_EACH_D4(M, ...) METAL_SHIM_EACH_D3(M, __VA_ARGS__) M(__VA_ARGS__, 3)
+
+#define METAL_SHIM_SWIZZLE2(N, S, i, j) swizzle<T, N, i, j> METAL_SHIM_CAT2(METAL_SHIM_NAME(S, i), METAL_SHIM_NAME(S, j));
+#define METAL_SHIM_SWIZZLE3(N, S, i, j, k) swizzle<T, N, i, j, k> METAL_SHIM_CAT3(METAL_SHIM_NAME(S, i), METAL_SHIM_NAME(S, j), METAL_SHIM_NAME(S, k));
+#define METAL_SHIM_SWIZZLE4(N, S, i, j, k, l) swizzle<T, N, i, j, k, l> METAL_SHIM_CAT4(METAL_SHIM_NAME(S, i), METAL_SHIM_NAME(S, j), METAL_SHIM_NAME(S, k), METAL_SHIM_NAME(S, l));
+#define METAL_SHIM_LEVEL2(N, S, i) METAL_SHIM_EACH_B##N(METAL_SHIM_SWIZZLE2, N, S, i)
+#define METAL_SHIM_LEVEL3(N, S, i) METAL_SHIM_EACH_B##N(METAL_SHIM_LEVEL3_B, N, S, i)
+#define METAL_SHIM_LEVEL3_B(N, S, i, j) METAL_SHIM_EACH_C##N(METAL_SHIM_SWIZZLE3, N, S, i, j)
+#define METAL_SHIM_LEVEL4(N, S, i) METAL_SHIM_EACH_B##N(METAL_SHIM_LEVEL4_B, N, S, i)
+#define METAL_SHIM_LEVEL4_B(N, S, i, j) METAL_SHIM_EACH_C##N(METAL_SHIM_LEVEL4_C, N, S, i, j)
+#define METAL_SHIM_LEVEL4_C(N, S, i, j, k) METAL_SHIM_EACH_D##N(METAL_SHIM_SWIZZLE4, N, S, i, j, k)
+#define METAL_SHIM_SWIZZLES(N, S)                                                                                              \
+    METAL_SHIM_EACH_A##N(METAL_SHIM_LEVEL2, N, S) METAL_SHIM_EACH_A##N(METAL_SHIM_LEVEL3, N, S) METAL_SHIM_EACH_A##N(METAL_SHIM_LEVEL4, N, S)
+
+// Three component vectors take the space of four, as in Metal.
+template <typename T>
+struct alignas(2 * sizeof(T)) vec<T, 2> {
+    union {
+        T v[2];
+        struct {
+            T x, y;
+        };
+        struct {
+            T r, g;
+        };
+        METAL_SHIM_SWIZZLES(2, xyzw)
+        METAL_SHIM_SWIZZLES(2, rgba)
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(vec, 2)
+};
+
+template <typename T>
+struct alignas(4 * sizeof(T)) vec<T, 3> {
+    union {
+        T v[3];
+        struct {
+            T x, y, z;
+        };
+        struct {
+            T r, g, b;
+        };
+        METAL_SHIM_SWIZZLES(3, xyzw)
+        METAL_SHIM_SWIZZLES(3, rgba)
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(vec, 3)
+};
+
+template <typename T>
+struct alignas(4 * sizeof(T)) vec<T, 4> {
+    union {
+        T v[4];
+        struct {
+            T x, y, z, w;
+        };
+        struct {
+            T r, g, b, a;
+        };
+        METAL_SHIM_SWIZZLES(4, xyzw)
+        METAL_SHIM_SWIZZLES(4, rgba)
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(vec, 4)
+};
+
+// Packed vectors are their elements' size and alignment, and have no swizzles.
+template <typename T>
+struct packed_vec<T, 2> {
+    union {
+        T v[2];
+        struct {
+            T x, y;
+        };
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(packed_vec, 2)
+};
+
+template <typename T>
+struct packed_vec<T, 3> {
+    union {
+        T v[3];
+        struct {
+            T x, y, z;
+        };
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(packed_vec, 3)
+};
+
+template <typename T>
+struct packed_vec<T, 4> {
+    union {
+        T v[4];
+        struct {
+            T x, y, z, w;
+        };
+    };
+
+    METAL_SHIM_VECTOR_MEMBERS(packed_vec, 4)
+};
+
+#define METAL_SHIM_VECTOR_TYPES(T, name)                                                                                       \
+    typedef vec<T, 2> name##2;                                                                                                 \
+    typedef vec<T, 3> name##3;                                                                                                 \
+    typedef vec<T, 4> name##4;                                                                                                 \
+    typedef packed_vec<T, 2> packed_##name##2;                                                                                 \
+    typedef packed_vec<T, 3> packed_##name##3;                                                                                 \
+    typedef packed_vec<T, 4> packed_##name##4;
+
+METAL_SHIM_VECTOR_TYPES(bool, bool)
+METAL_SHIM_VECTOR_TYPES(char, char)
+METAL_SHIM_VECTOR_TYPES(uchar, uchar)
+METAL_SHIM_VECTOR_TYPES(short, short)
+METAL_SHIM_VECTOR_TYPES(ushort, ushort)
+METAL_SHIM_VECTOR_TYPES(int, int)
+METAL_SHIM_VECTOR_TYPES(uint, uint)
+METAL_SHIM_VECTOR_TYPES(half, half)
+METAL_SHIM_VECTOR_TYPES(float, float)
+
+
+// MARK: - Operators
+
+namespace detail {
+
+template <typename A, typename B>
+concept operands = (vector_like<A> && (vector_like<B> || scalar_like<B>)) || (scalar_like<A> && vector_like<B>);
+
+template <typename... X>
+struct first_vector;
+
+template <typename X, typename... Rest>
+struct first_vector<X, Rest...> : first_vector<Rest...> {};
+
+template <vector_like X, typename... Rest>
+struct first_vector<X, Rest...> {
+    using type = vector_of<X>;
+};
+
+// `f` applied component by component, with scalars broadcast and every argument converted to the first vector argument's element type. Returns a vector of that size with elements of type `Result`, or of the element type when `Result` is void. Without a vector argument it's `f` of the scalars in their common type.
+template <typename Result = void, typename F, typename... X>
+auto elementwise(F f, const X &...arguments) {
+    if constexpr ((vector_like<X> || ...)) {
+        using Vector = typename first_vector<X...>::type;
+        using T = element_of<Vector>;
+        using Element = std::conditional_t<std::is_void_v<Result>, T, Result>;
+        vec<Element, size_of<Vector>> result;
+        for (int index = 0; index != size_of<Vector>; ++index) {
+            result.v[index] = Element(f(widen(component<T>(arguments, index))...));
+        }
+        return result;
+    }
+    else {
+        using T = std::common_type_t<decltype(widen(arguments))...>;
+        using Element = std::conditional_t<std::is_void_v<Result>, T, Result>;
+        return Element(f(T(widen(arguments))...));
+    }
+}
+
+}
+
+#define METAL_SHIM_BINARY_OPERATOR(op, Result)                                                                                 \
+    template <typename A, typename B>                                                                                          \
+        requires detail::operands<A, B>                                                                                        \
+    auto operator op(const A &a, const B &b) {                                                                                 \
+        return detail::elementwise<Result>([](auto x, auto y) { return x op y; }, a, b);                                       \
+    }
+
+METAL_SHIM_BINARY_OPERATOR(+, void)
+METAL_SHIM_BINARY_OPERATOR(-, void)
+METAL_SHIM_BINARY_OPERATOR(*, void)
+METAL_SHIM_BINARY_OPERATOR(/, void)
+METAL_SHIM_BINARY_OPERATOR(%, void)
+METAL_SHIM_BINARY_OPERATOR(&, void)
+METAL_SHIM_BINARY_OPERATOR(|, void)
+METAL_SHIM_BINARY_OPERATOR(^, void)
+METAL_SHIM_BINARY_OPERATOR(<<, void)
+METAL_SHIM_BINARY_OPERATOR(>>, void)
+METAL_SHIM_BINARY_OPERATOR(==, bool)
+METAL_SHIM_BINARY_OPERATOR(!=, bool)
+METAL_SHIM_BINARY_OPERATOR(<, bool)
+METAL_SHIM_BINARY_OPERATOR(<=, bool)
+METAL_SHIM_BINARY_OPERATOR(>, bool)
+METAL_SHIM_BINARY_OPERATOR(>=, bool)
+METAL_SHIM_BINARY_OPERATOR(&&, bool)
+METAL_SHIM_BINARY_OPERATOR(||, bool)
+
+template <vector_like A>
+auto operator+(const A &a) {
+    return vector_of<A>(a);
+}
+
+template <vector_like A>
+auto operator-(const A &a) {
+    return detail::elementwise([](auto x) { return -x; }, a);
+}
+
+template <vector_like A>
+auto operator~(const A &a) {
+    return detail::elementwise([](auto x) { return ~x; }, a);
+}
+
+template <vector_like A>
+auto operator!(const A &a) {
+    return detail::elementwise<bool>([](auto x) { return !x; }, a);
+}
+
+// MARK: - Functions
+
+#define METAL_SHIM_FUNCTION1(name, Result, ...)                                                                                \
+    template <typename X>                                                                                                      \
+        requires(scalar_like<X> || vector_like<X>)                                                                             \
+    auto name(const X &x) {                                                                                                    \
+        return detail::elementwise<Result>([](auto x) { return __VA_ARGS__; }, x);                                             \
+    }
+
+#define METAL_SHIM_FUNCTION2(name, ...)                                                                                        \
+    template <typename X, typename Y>                                                                                          \
+        requires((scalar_like<X> || vector_like<X>) && (scalar_like<Y> || vector_like<Y>))                                    \
+    auto name(const X &x, const Y &y) {                                                                                        \
+        return detail::elementwise([](auto x, auto y) { return __VA_ARGS__; }, x, y);                                          \
+    }
+
+#define METAL_SHIM_FUNCTION3(name, ...)                                                                                        \
+    template <typename X, typename Y, typename Z>                                                                              \
+        requires((scalar_like<X> || vector_like<X>) && (scalar_like<Y> || vector_like<Y>) && (scalar_like<Z> || vector_like<Z>)) \
+    auto name(const X &x, const Y &y, const Z &z) {                                                                            \
+        return detail::elementwise([](auto x, auto y, auto z) { return __VA_ARGS__; }, x, y, z);                               \
+    }
+
+namespace detail {
+
+// The largest value below 1, which `fract` stays under.
+template <typename T>
+T belowOne() {
+    return std::nextafter(T(1), T(0));
+}
+
+template <typename T>
+T absolute(T value) {
+    if constexpr (std::is_signed_v<T> || std::is_floating_point_v<T>) {
+        return value < 0 ? T(-value) : value;
+    }
+    else {
+        return value;
+    }
+}
+
+}
+
+METAL_SHIM_FUNCTION1(abs, void, detail::absolute(x))
+METAL_SHIM_FUNCTION1(ceil, void, std::ceil(x))
+METAL_SHIM_FUNCTION1(floor, void, std::floor(x))
+METAL_SHIM_FUNCTION1(fract, void, std::fmin(x - std::floor(x), detail::belowOne<decltype(x)>()))
+METAL_SHIM_FUNCTION1(round, void, std::round(x))
+METAL_SHIM_FUNCTION1(rint, void, std::rint(x))
+METAL_SHIM_FUNCTION1(trunc, void, std::trunc(x))
+METAL_SHIM_FUNCTION1(sqrt, void, std::sqrt(x))
+METAL_SHIM_FUNCTION1(rsqrt, void, 1 / std::sqrt(x))
+METAL_SHIM_FUNCTION1(exp, void, std::exp(x))
+METAL_SHIM_FUNCTION1(exp2, void, std::exp2(x))
+METAL_SHIM_FUNCTION1(log, void, std::log(x))
+METAL_SHIM_FUNCTION1(log2, void, std::log2(x))
+METAL_SHIM_FUNCTION1(log10, void, std::log10(x))
+METAL_SHIM_FUNCTION1(sin, void, std::sin(x))
+METAL_SHIM_FUNCTION1(cos, void, std::cos(x))
+METAL_SHIM_FUNCTION1(tan, void, std::tan(x))
+METAL_SHIM_FUNCTION1(asin, void, std::asin(x))
+METAL_SHIM_FUNCTION1(acos, void, std::acos(x))
+METAL_SHIM_FUNCTION1(atan, void, std::atan(x))
+METAL_SHIM_FUNCTION1(sinh, void, std::sinh(x))
+METAL_SHIM_FUNCTION1(cosh, void, std::cosh(x))
+METAL_SHIM_FUNCTION1(tanh, void, std::tanh(x))
+METAL_SHIM_FUNCTION1(sign, void, x > 0 ? 1 : (x < 0 ? -1 : 0))
+METAL_SHIM_FUNCTION1(saturate, void, std::fmin(std::fmax(x, decltype(x)(0)), decltype(x)(1)))
+METAL_SHIM_FUNCTION1(isnan, bool, std::isnan(x))
+METAL_SHIM_FUNCTION1(isinf, bool, std::isinf(x))
+METAL_SHIM_FUNCTION1(isfinite, bool, std::isfinite(x))
+METAL_SHIM_FUNCTION1(popcount, void, std::popcount(std::make_unsigned_t<decltype(x)>(x)))
+
+METAL_SHIM_FUNCTION2(fmod, std::fmod(x, y))
+METAL_SHIM_FUNCTION2(pow, std::pow(x, y))
+METAL_SHIM_FUNCTION2(powr, std::pow(x, y))
+METAL_SHIM_FUNCTION2(atan2, std::atan2(x, y))
+METAL_SHIM_FUNCTION2(copysign, std::copysign(x, y))
+METAL_SHIM_FUNCTION2(fmin, std::fmin(x, y))
+METAL_SHIM_FUNCTION2(fmax, std::fmax(x, y))
+METAL_SHIM_FUNCTION2(min, y < x ? y : x)
+METAL_SHIM_FUNCTION2(max, x < y ? y : x)
+METAL_SHIM_FUNCTION2(step, y < x ? 0 : 1)
+
+METAL_SHIM_FUNCTION3(clamp, std::min(std::max(x, y), z))
+METAL_SHIM_FUNCTION3(mix, x + (y - x) * z)
+METAL_SHIM_FUNCTION3(fma, std::fma(x, y, z))
+METAL_SHIM_FUNCTION3(smoothstep, [&] {
+    const auto t = std::min(std::max((z - x) / (y - x), decltype(z)(0)), decltype(z)(1));
+    return t * t * (3 - 2 * t);
+}())
+
+// `c ? b : a` per component.
+template <typename A, typename B, typename C>
+    requires((scalar_like<A> || vector_like<A>) && (scalar_like<B> || vector_like<B>) && (scalar_like<C> || vector_like<C>))
+auto select(const A &a, const B &b, const C &c) {
+    if constexpr (vector_like<C>) {
+        using Vector = std::conditional_t<vector_like<A>, A, B>;
+        vector_of<Vector> result;
+        for (int index = 0; index != size_of<C>; ++index) {
+            result.v[index] = detail::component<bool>(c, index) ? detail::component<element_of<Vector>>(b, index) : detail::component<element_of<Vector>>(a, index);
+        }
+        return result;
+    }
+    else {
+        return c ? std::common_type_t<A, B>(b) : std::common_type_t<A, B>(a);
+    }
+}
+
+template <vector_like X>
+bool all(const X &x) {
+    for (int index = 0; index != size_of<X>; ++index) {
+        if (!detail::component<bool>(x, index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <vector_like X>
+bool any(const X &x) {
+    for (int index = 0; index != size_of<X>; ++index) {
+        if (detail::component<bool>(x, index)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// MARK: Geometric
+
+template <vector_like A, vector_like B>
+    requires(size_of<A> == size_of<B>)
+element_of<A> dot(const A &a, const B &b) {
+    using T = element_of<A>;
+    decltype(detail::widen(T())) sum = 0;
+    for (int index = 0; index != size_of<A>; ++index) {
+        sum += detail::widen(detail::component<T>(a, index)) * detail::widen(detail::component<T>(b, index));
+    }
+    return T(sum);
+}
+
+template <vector_like X>
+element_of<X> length_squared(const X &x) {
+    return dot(x, x);
+}
+
+template <vector_like X>
+element_of<X> length(const X &x) {
+    return element_of<X>(std::sqrt(detail::widen(dot(x, x))));
+}
+
+template <vector_like A, vector_like B>
+element_of<A> distance(const A &a, const B &b) {
+    return length(a - b);
+}
+
+template <vector_like A, vector_like B>
+element_of<A> distance_squared(const A &a, const B &b) {
+    return length_squared(a - b);
+}
+
+template <vector_like X>
+vector_of<X> normalize(const X &x) {
+    return x * (1 / detail::widen(length(x)));
+}
+
+template <vector_like A, vector_like B>
+    requires(size_of<A> == 3 && size_of<B> == 3)
+vector_of<A> cross(const A &a, const B &b) {
+    const vector_of<A> u(a), v(b);
+    return vector_of<A>(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+}
+
+template <vector_like I, vector_like N>
+vector_of<I> reflect(const I &incident, const N &normal) {
+    return incident - 2 * dot(normal, incident) * normal;
+}
+
+// MARK: Integer and bits
+
+template <typename To, typename From>
+    requires(sizeof(To) == sizeof(From) && scalar_like<To> && scalar_like<From>)
+To as_type(From value) {
+    return std::bit_cast<To>(value);
+}
+
+inline uint mulhi(uint a, uint b) {
+    return uint((uint64_t(a) * b) >> 32);
+}
+
+inline int mulhi(int a, int b) {
+    return int((int64_t(a) * b) >> 32);
+}
+
+// MARK: - Matrices
+
+// Column major, `Columns` vectors of `Rows` elements.
+template <typename T, int Columns, int Rows>
+struct matrix {
+    vec<T, Rows> columns[Columns];
+
+    matrix() = default;
+
+    // `diagonal` down the diagonal and zero elsewhere.
+    template <scalar_like S>
+    explicit matrix(S diagonal) {
+        for (int column = 0; column != Columns; ++column) {
+            if (column < Rows) {
+                columns[column][column] = T(diagonal);
+            }
+        }
+    }
+
+    template <typename... Vectors>
+        requires(sizeof...(Vectors) == Columns && Columns > 1 && (vector_like<Vectors> && ...))
+    matrix(const Vectors &...values)
+        : columns { vec<T, Rows>(values)... } {
+    }
+
+    vec<T, Rows> &operator[](int column) {
+        return columns[column];
+    }
+
+    const vec<T, Rows> &operator[](int column) const {
+        return columns[column];
+    }
+};
+
+template <typename T, int C, int R, vector_like V>
+    requires(size_of<V> == C)
+vec<T, R> operator*(const matrix<T, C, R> &m, const V &v) {
+    vec<T, R> result;
+    for (int column = 0; column != C; ++column) {
+        result += m.columns[column] * detail::component<T>(v, column);
+    }
+    return result;
+}
+
+template <typename T, int C, int R, vector_like V>
+    requires(size_of<V> == R)
+vec<T, C> operator*(const V &v, const matrix<T, C, R> &m) {
+    vec<T, C> result;
+    for (int column = 0; column != C; ++column) {
+        result[column] = dot(v, m.columns[column]);
+    }
+    return result;
+}
+
+template <typename T, int K, int C, int R>
+matrix<T, C, R> operator*(const matrix<T, K, R> &a, const matrix<T, C, K> &b) {
+    matrix<T, C, R> result;
+    for (int column = 0; column != C; ++column) {
+        result.columns[column] = a * b.columns[column];
+    }
+    return result;
+}
+
+template <typename T, int C, int R, scalar_like S>
+matrix<T, C, R> operator*(const matrix<T, C, R> &m, S scalar) {
+    matrix<T, C, R> result;
+    for (int column = 0; column != C; ++column) {
+        result.columns[column] = m.columns[column] * scalar;
+    }
+    return result;
+}
+
+template <typename T, int C, int R, scalar_like S>
+matrix<T, C, R> operator*(S scalar, const matrix<T, C, R> &m) {
+    return m * scalar;
+}
+
+template <typename T, int C, int R>
+matrix<T, C, R> operator+(const matrix<T, C, R> &a, const matrix<T, C, R> &b) {
+    matrix<T, C, R> result;
+    for (int column = 0; column != C; ++column) {
+        result.columns[column] = a.columns[column] + b.columns[column];
+    }
+    return result;
+}
+
+template <typename T, int C, int R>
+matrix<T, C, R> operator-(const matrix<T, C, R> &a, const matrix<T, C, R> &b) {
+    matrix<T, C, R> result;
+    for (int column = 0; column != C; ++column) {
+        result.columns[column] = a.columns[column] - b.columns[column];
+    }
+    return result;
+}
+
+template <typename T, int C, int R>
+matrix<T, R, C> transpose(const matrix<T, C, R> &m) {
+    matrix<T, R, C> result;
+    for (int column = 0; column != C; ++column) {
+        for (int row = 0; row != R; ++row) {
+            result.columns[row][column] = m.columns[column][row];
+        }
+    }
+    return result;
+}
+
+#define METAL_SHIM_MATRIX_TYPES(T, name)                                                                                       \
+    typedef matrix<T, 2, 2> name##2x2;                                                                                         \
+    typedef matrix<T, 2, 3> name##2x3;                                                                                         \
+    typedef matrix<T, 2, 4> name##2x4;                                                                                         \
+    typedef matrix<T, 3, 2> name##3x2;                                                                                         \
+    typedef matrix<T, 3, 3> name##3x3;                                                                                         \
+    typedef matrix<T, 3, 4> name##3x4;                                                                                         \
+    typedef matrix<T, 4, 2> name##4x2;                                                                                         \
+    typedef matrix<T, 4, 3> name##4x3;                                                                                         \
+    typedef matrix<T, 4, 4> name##4x4;
+
+METAL_SHIM_MATRIX_TYPES(half, half)
+METAL_SHIM_MATRIX_TYPES(float, float)
+
+// MARK: - Samplers
+
+enum class coord {
+    normalized,
+    pixel,
+};
+
+enum class address {
+    repeat,
+    mirrored_repeat,
+    clamp_to_edge,
+    clamp_to_zero,
+    clamp_to_border,
+};
+
+enum class s_address {
+    repeat,
+    mirrored_repeat,
+    clamp_to_edge,
+    clamp_to_zero,
+    clamp_to_border,
+};
+
+enum class t_address {
+    repeat,
+    mirrored_repeat,
+    clamp_to_edge,
+    clamp_to_zero,
+    clamp_to_border,
+};
+
+enum class r_address {
+    repeat,
+    mirrored_repeat,
+    clamp_to_edge,
+    clamp_to_zero,
+    clamp_to_border,
+};
+
+enum class filter {
+    nearest,
+    linear,
+};
+
+enum class mag_filter {
+    nearest,
+    linear,
+};
+
+enum class min_filter {
+    nearest,
+    linear,
+};
+
+enum class mip_filter {
+    none,
+    nearest,
+    linear,
+};
+
+// Built from the same arguments as a Metal `constexpr sampler`. Textures have no mipmaps here, so the mip filter is accepted and ignored, and sampling uses the magnification filter.
+struct sampler {
+    coord coordinates = coord::normalized;
+    address addressing[3] = { address::clamp_to_edge, address::clamp_to_edge, address::clamp_to_edge };
+    filter magnification = filter::nearest;
+    filter minification = filter::nearest;
+
+    constexpr sampler() = default;
+
+    template <typename... Arguments>
+        requires(sizeof...(Arguments) > 0 && !(std::is_same_v<Arguments, sampler> || ...))
+    constexpr sampler(Arguments... arguments) {
+        (set(arguments), ...);
+    }
+
+private:
+    constexpr void set(coord value) {
+        coordinates = value;
+    }
+
+    constexpr void set(address value) {
+        addressing[0] = addressing[1] = addressing[2] = value;
+    }
+
+    constexpr void set(s_address value) {
+        addressing[0] = address(value);
+    }
+
+    constexpr void set(t_address value) {
+        addressing[1] = address(value);
+    }
+
+    constexpr void set(r_address value) {
+        addressing[2] = address(value);
+    }
+
+    constexpr void set(filter value) {
+        magnification = minification = value;
+    }
+
+    constexpr void set(mag_filter value) {
+        magnification = filter(value);
+    }
+
+    constexpr void set(min_filter value) {
+        minification = filter(value);
+    }
+
+    constexpr void set(mip_filter) {
+    }
+};
+
+// MARK: - Textures
+
+enum class access {
+    sample,
+    read,
+    write,
+    read_write,
+};
+
+namespace detail {
+
+// Texels in host memory: `channels` elements each, x fastest, then y, then z. Reading a texture with fewer than four channels fills in (0, 0, 0, 1) as Metal does for narrower pixel formats. Texels outside the texture read as zero and writes to them are dropped.
+template <typename T>
+struct texture_storage {
+    T *texels = nullptr;
+    uint width = 0;
+    uint height = 1;
+    uint depth = 1;
+    uint channels = 4;
+
+    vec<T, 4> load(uint x, uint y, uint z) const {
+        if (x >= width || y >= height || z >= depth) {
+            return vec<T, 4>(T(0));
+        }
+        vec<T, 4> result(T(0), T(0), T(0), T(1));
+        const T *texel = texels + ((size_t(z) * height + y) * width + x) * channels;
+        for (uint channel = 0; channel != std::min(channels, 4u); ++channel) {
+            result.v[channel] = texel[channel];
+        }
+        return result;
+    }
+
+    void store(const vec<T, 4> &value, uint x, uint y, uint z) const {
+        if (x >= width || y >= height || z >= depth) {
+            return;
+        }
+        T *texel = texels + ((size_t(z) * height + y) * width + x) * channels;
+        for (uint channel = 0; channel != std::min(channels, 4u); ++channel) {
+            texel[channel] = value.v[channel];
+        }
+    }
+
+    // Texel index along an axis after addressing, or -1 for a texel of the border.
+    static int address(int index, int extent, metal::address mode) {
+        switch (mode) {
+        case metal::address::repeat:
+            return (index % extent + extent) % extent;
+        case metal::address::mirrored_repeat: {
+            const int wrapped = (index % (2 * extent) + 2 * extent) % (2 * extent);
+            return wrapped < extent ? wrapped : 2 * extent - 1 - wrapped;
+        }
+        case metal::address::clamp_to_edge:
+            return std::clamp(index, 0, extent - 1);
+        case metal::address::clamp_to_zero:
+        case metal::address::clamp_to_border:
+            return index < 0 || index >= extent ? -1 : index;
+        }
+        return -1;
+    }
+
+    vec<T, 4> filter(const sampler &state, const float *coordinates, int dimensions) const {
+        const uint extents[3] = { width, height, depth };
+        int low[3] = { 0, 0, 0 }, high[3] = { 0, 0, 0 };
+        float weights[3] = { 0, 0, 0 };
+        for (int axis = 0; axis != dimensions; ++axis) {
+            const int extent = int(extents[axis]);
+            float position = coordinates[axis] * (state.coordinates == coord::normalized ? float(extent) : 1.0f);
+            // Also takes NaNs to the edge.
+            position = std::fmin(std::fmax(position, -1e9f), 1e9f);
+            if (state.magnification == metal::filter::linear) {
+                const float base = std::floor(position - 0.5f);
+                weights[axis] = position - 0.5f - base;
+                low[axis] = address(int(base), extent, state.addressing[axis]);
+                high[axis] = address(int(base) + 1, extent, state.addressing[axis]);
+            }
+            else {
+                low[axis] = high[axis] = address(int(std::floor(position)), extent, state.addressing[axis]);
+            }
+        }
+        float sum[4] = { 0, 0, 0, 0 };
+        for (int corner = 0; corner != 1 << dimensions; ++corner) {
+            float weight = 1;
+            uint position[3] = { 0, 0, 0 };
+            bool border = false;
+            for (int axis = 0; axis != dimensions; ++axis) {
+                const bool upper = (corner >> axis) & 1;
+                weight *= upper ? weights[axis] : 1 - weights[axis];
+                const int index = upper ? high[axis] : low[axis];
+                border = border || index < 0;
+                position[axis] = uint(index);
+            }
+            if (weight == 0 || border) {
+                continue;
+            }
+            const vec<T, 4> texel = load(position[0], position[1], position[2]);
+            for (int channel = 0; channel != 4; ++channel) {
+                sum[channel] += weight * float(texel.v[channel]);
+            }
+        }
+        return vec<T, 4>(T(sum[0]), T(sum[1]), T(sum[2]), T(sum[3]));
+    }
+};
+
+}
+
+// Textures are handles, as in Metal: copies share texels, and writing through a const texture is fine.
+template <typename T, access A = access::sample>
+struct texture1d : detail::texture_storage<T> {
+    texture1d() = default;
+
+    texture1d(T *texels, uint width, uint channels = 4)
+        : detail::texture_storage<T> { texels, width, 1, 1, channels } {
+    }
+
+    uint get_width(uint = 0) const {
+        return this->width;
+    }
+
+    template <typename C>
+        requires(A != access::write)
+    vec<T, 4> read(const C &coordinate, uint = 0) const {
+        return this->load(detail::component<uint>(coordinate, 0), 0, 0);
+    }
+
+    template <typename V, typename C>
+        requires(A == access::write || A == access::read_write)
+    void write(const V &value, const C &coordinate, uint = 0) const {
+        this->store(vec<T, 4>(value), detail::component<uint>(coordinate, 0), 0, 0);
+    }
+
+    vec<T, 4> sample(sampler state, float coordinate) const
+        requires(A == access::sample)
+    {
+        return this->filter(state, &coordinate, 1);
+    }
+};
+
+template <typename T, access A = access::sample>
+struct texture2d : detail::texture_storage<T> {
+    texture2d() = default;
+
+    texture2d(T *texels, uint width, uint height, uint channels = 4)
+        : detail::texture_storage<T> { texels, width, height, 1, channels } {
+    }
+
+    uint get_width(uint = 0) const {
+        return this->width;
+    }
+
+    uint get_height(uint = 0) const {
+        return this->height;
+    }
+
+    template <typename C>
+        requires(A != access::write)
+    vec<T, 4> read(const C &coordinate, uint = 0) const {
+        return this->load(detail::component<uint>(coordinate, 0), detail::component<uint>(coordinate, 1), 0);
+    }
+
+    template <typename V, typename C>
+        requires(A == access::write || A == access::read_write)
+    void write(const V &value, const C &coordinate, uint = 0) const {
+        this->store(vec<T, 4>(value), detail::component<uint>(coordinate, 0), detail::component<uint>(coordinate, 1), 0);
+    }
+
+    template <typename C>
+        requires(A == access::sample)
+    vec<T, 4> sample(sampler state, const C &coordinate) const {
+        const float coordinates[2] = { detail::component<float>(coordinate, 0), detail::component<float>(coordinate, 1) };
+        return this->filter(state, coordinates, 2);
+    }
+};
+
+template <typename T, access A = access::sample>
+struct texture3d : detail::texture_storage<T> {
+    texture3d() = default;
+
+    texture3d(T *texels, uint width, uint height, uint depth, uint channels = 4)
+        : detail::texture_storage<T> { texels, width, height, depth, channels } {
+    }
+
+    uint get_width(uint = 0) const {
+        return this->width;
+    }
+
+    uint get_height(uint = 0) const {
+        return this->height;
+    }
+
+    uint get_depth(uint = 0) const {
+        return this->depth;
+    }
+
+    template <typename C>
+        requires(A != access::write)
+    vec<T, 4> read(const C &coordinate, uint = 0) const {
+        return this->load(detail::component<uint>(coordinate, 0), detail::component<uint>(coordinate, 1), detail::component<uint>(coordinate, 2));
+    }
+
+    template <typename V, typename C>
+        requires(A == access::write || A == access::read_write)
+    void write(const V &value, const C &coordinate, uint = 0) const {
+        this->store(vec<T, 4>(value), detail::component<uint>(coordinate, 0), detail::component<uint>(coordinate, 1), detail::component<uint>(coordinate, 2));
+    }
+
+    template <typename C>
+        requires(A == access::sample)
+    vec<T, 4> sample(sampler state, const C &coordinate) const {
+        const float coordinates[3] = { detail::component<float>(coordinate, 0), detail::component<float>(coordinate, 1), detail::component<float>(coordinate, 2) };
+        return this->filter(state, coordinates, 3);
+    }
+};
+
+}
+
+// MARK: - Global names
+
+// Metal's scalar, vector and matrix types are global names as well as members of namespace metal.
+typedef unsigned char uchar;
+typedef unsigned short ushort;
+typedef unsigned int uint;
+typedef metal::half half;
+
+#define METAL_SHIM_GLOBAL_VECTOR_TYPES(name)                                                                                   \
+    typedef metal::name##2 name##2;                                                                                            \
+    typedef metal::name##3 name##3;                                                                                            \
+    typedef metal::name##4 name##4;                                                                                            \
+    typedef metal::packed_##name##2 packed_##name##2;                                                                          \
+    typedef metal::packed_##name##3 packed_##name##3;                                                                          \
+    typedef metal::packed_##name##4 packed_##name##4;
+
+METAL_SHIM_GLOBAL_VECTOR_TYPES(bool)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(char)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(uchar)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(short)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(ushort)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(int)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(uint)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(half)
+METAL_SHIM_GLOBAL_VECTOR_TYPES(float)
+
+#define METAL_SHIM_GLOBAL_MATRIX_TYPES(name)                                                                                   \
+    typedef metal::name##2x2 name##2x2;                                                                                        \
+    typedef metal::name##2x3 name##2x3;                                                                                        \
+    typedef metal::name##2x4 name##2x4;                                                                                        \
+    typedef metal::name##3x2 name##3x2;                                                                                        \
+    typedef metal::name##3x3 name##3x3;                                                                                        \
+    typedef metal::name##3x4 name##3x4;                                                                                        \
+    typedef metal::name##4x2 name##4x2;                                                                                        \
+    typedef metal::name##4x3 name##4x3;                                                                                        \
+    typedef metal::name##4x4 name##4x4;
+
+METAL_SHIM_GLOBAL_MATRIX_TYPES(half)
+METAL_SHIM_GLOBAL_MATRIX_TYPES(float)
+
+// MARK: - Qualifiers
+
+// The shader sources' own headers check this to pick their Metal side.
+#define __METAL_VERSION__ 300
+
+// Function qualifiers and address spaces mean nothing on the host, except that the constant address space is read only. Attributes such as [[thread_position_in_grid]] are left to the compiler to ignore.
+#define kernel
+#define vertex
+#define fragment
+#define device
+#define constant const
+#define thread
+#define threadgroup
+
+#include "simd/simd.h"
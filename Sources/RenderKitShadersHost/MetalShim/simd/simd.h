@@ -0,0 +1,35 @@
+#pragma once
+
+// Shader sources include <simd/simd.h> for the `simd_` types they share with the host. Compiled as Metal by RenderKitShadersHost, those are the shim's vectors and matrices; anything else gets the real header.
+
+#ifdef __METAL_VERSION__
+#include "../MetalShim.h"
+
+typedef metal::float2 simd_float2;
+typedef metal::float3 simd_float3;
+typedef metal::float4 simd_float4;
+typedef metal::half2 simd_half2;
+typedef metal::half3 simd_half3;
+typedef metal::half4 simd_half4;
+typedef metal::int2 simd_int2;
+typedef metal::int3 simd_int3;
+typedef metal::int4 simd_int4;
+typedef metal::uint2 simd_uint2;
+typedef metal::uint3 simd_uint3;
+typedef metal::uint4 simd_uint4;
+typedef metal::ushort2 simd_ushort2;
+typedef metal::ushort3 simd_ushort3;
+typedef metal::ushort4 simd_ushort4;
+typedef metal::uchar2 simd_uchar2;
+typedef metal::uchar3 simd_uchar3;
+typedef metal::uchar4 simd_uchar4;
+typedef metal::packed_float2 simd_packed_float2;
+typedef metal::packed_float4 simd_packed_float4;
+typedef metal::float2x2 simd_float2x2;
+typedef metal::float3x3 simd_float3x3;
+typedef metal::float4x4 simd_float4x4;
+typedef metal::float4x3 simd_float4x3;
+typedef metal::float3x4 simd_float3x4;
+#elif __has_include_next(<simd/simd.h>)
+#include_next <simd/simd.h>
+#endif
@@ -0,0 +1,19 @@
+#include "RenderKitShadersHost.h"
+
+#include <metal_stdlib>
+
+namespace metalSupport {
+#include "../RenderKitShaders/include/MetalSupport.h"
+}
+
+namespace shaders {
+
+float srgbToLinear(float value) {
+    return metalSupport::srgb_to_linear(value);
+}
+
+float linearToSRGB(float value) {
+    return metalSupport::linear_to_srgb(value);
+}
+
+}
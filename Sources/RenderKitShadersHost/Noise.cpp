@@ -0,0 +1,19 @@
+#include "RenderKitShadersHost.h"
+
+#include <metal_stdlib>
+
+namespace noiseShader {
+#include "../RenderKitShaders/Noise.metal"
+}
+
+namespace shaders {
+
+void simplexNoise2D(const Texture &output, compute::Size threadsPerThreadgroup) {
+    const trace::Zone zone("shaders.simplexNoise2D");
+    const metal::texture2d<float, metal::access::write> texture(output.texels, output.width, output.height, output.channels);
+    compute::dispatchThreads({ output.width, output.height, 1 }, threadsPerThreadgroup, [&](const compute::Thread &invocation) {
+        noiseShader::simplexNoise2D(metal::uint2(invocation.positionInGrid.x, invocation.positionInGrid.y), texture);
+    });
+}
+
+}
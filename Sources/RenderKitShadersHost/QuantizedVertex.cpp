@@ -0,0 +1,29 @@
+#include "RenderKitShadersHost.h"
+
+#include <metal_stdlib>
+
+namespace quantizedVertexShader {
+#include "../RenderKitShaders/include/QuantizedVertex.h"
+}
+
+namespace shaders {
+
+quantization::SimpleVertex dequantize(const quantization::QuantizedVertex &quantized, const quantization::Bounds &bounds) {
+    using namespace metal;
+    // Vertex fetch's conversions from ushort4Normalized, short2Normalized and half2.
+    const float4 position(quantized.position[0] / 65535.0f, quantized.position[1] / 65535.0f, quantized.position[2] / 65535.0f, quantized.position[3] / 65535.0f);
+    const float2 normal(max(quantized.normal[0] / 32767.0f, -1.0f), max(quantized.normal[1] / 32767.0f, -1.0f));
+    const quantizedVertexShader::QuantizationBounds shaderBounds {
+        .origin = float3(bounds.origin[0], bounds.origin[1], bounds.origin[2]),
+        .scale = float3(bounds.scale[0], bounds.scale[1], bounds.scale[2]),
+    };
+    const float3 decodedPosition = quantizedVertexShader::dequantize_position(position, shaderBounds);
+    const float3 decodedNormal = quantizedVertexShader::octahedral_decode(normal);
+    return {
+        .position = { decodedPosition.x, decodedPosition.y, decodedPosition.z },
+        .normal = { decodedNormal.x, decodedNormal.y, decodedNormal.z },
+        .textureCoordinate = { float(as_type<half>(quantized.textureCoordinate[0])), float(as_type<half>(quantized.textureCoordinate[1])) },
+    };
+}
+
+}
@@ -0,0 +1,23 @@
+#include "RenderKitShadersHost.h"
+
+#include <metal_stdlib>
+
+namespace voronoiShader {
+#include "../RenderKitShaders/voronoiNoise.metal"
+}
+
+namespace shaders {
+
+void voronoiNoise(const voronoi::Parameters &parameters, const Texture &output, compute::Size threadsPerThreadgroup) {
+    const trace::Zone zone("shaders.voronoiNoiseCompute");
+    voronoiShader::VoronoiNoise argument;
+    argument.size = metal::float2(parameters.size[0], parameters.size[1]);
+    argument.offset = metal::float2(parameters.offset[0], parameters.offset[1]);
+    argument.mode = short(parameters.mode);
+    argument.outputTexture = metal::texture2d<float, metal::access::write>(output.texels, output.width, output.height, output.channels);
+    compute::dispatchThreads({ output.width, output.height, 1 }, threadsPerThreadgroup, [&](const compute::Thread &invocation) {
+        voronoiShader::voronoiNoiseCompute(argument, metal::uint2(invocation.positionInGrid.x, invocation.positionInGrid.y));
+    });
+}
+
+}
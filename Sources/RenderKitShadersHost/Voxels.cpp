@@ -0,0 +1,36 @@
+#include "RenderKitShadersHost.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <metal_stdlib>
+
+// Voxels.metal's fragment shader calls Support.metal's `GammaCorrect`.
+namespace voxelsShader {
+#include "../RenderKitShaders/Classic/Support.metal"
+#include "../RenderKitShaders/Classic/Voxels.metal"
+}
+
+namespace shaders {
+
+// The voxels are passed to the shader as they are, so the host struct has to match the shader's byte for byte.
+static_assert(sizeof(voxels::MagicaVoxel) == sizeof(voxelsShader::MagicaVoxel));
+static_assert(alignof(voxels::MagicaVoxel) == alignof(voxelsShader::MagicaVoxel));
+static_assert(offsetof(voxels::MagicaVoxel, position) == offsetof(voxelsShader::MagicaVoxel, position));
+static_assert(offsetof(voxels::MagicaVoxel, color) == offsetof(voxelsShader::MagicaVoxel, color));
+
+void magicaVoxelsToColorTexture3D(const voxels::MagicaVoxel *voxels, size_t count, const Texture &palette, const Texture &output, compute::Size threadsPerThreadgroup) {
+    const trace::Zone zone("shaders.magicaVoxelsToColorTexture3D");
+    const auto *shaderVoxels = reinterpret_cast<const voxelsShader::MagicaVoxel *>(voxels);
+    const metal::texture1d<float, metal::access::read> colorPalette(palette.texels, palette.width, palette.channels);
+    const metal::texture3d<float, metal::access::write> texture(output.texels, output.width, output.height, output.depth, output.channels);
+    // A grid is at most 2^32 - 1 threads wide, so larger counts go in several dispatches, each starting further into the buffer as a GPU dispatch would with a buffer offset.
+    for (size_t first = 0; first < count; first += std::numeric_limits<uint32_t>::max()) {
+        const uint32_t threads = uint32_t(std::min<size_t>(count - first, std::numeric_limits<uint32_t>::max()));
+        compute::dispatchThreads({ threads, 1, 1 }, threadsPerThreadgroup, [&](const compute::Thread &invocation) {
+            voxelsShader::magicaVoxelsToColorTexture3D(invocation.positionInGrid.x, shaderVoxels + first, colorPalette, texture);
+        });
+    }
+}
+
+}
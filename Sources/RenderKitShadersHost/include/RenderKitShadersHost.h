@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ComputeDispatch.h"
+#include "MagicaVoxel.h"
+#include "VertexQuantization.h"
+#include "Voronoi.h"
+
+// RenderKitShaders' compute kernels, compiled from their .metal sources unchanged against the Metal shim in MetalShim/ and run on the CPU with `compute::dispatchThreads`. Each function dispatches one thread per texel (or voxel), as the app does on the GPU, in groups of `threadsPerThreadgroup` threads.
+
+namespace shaders {
+
+// A texture in host memory for the kernels to read or write: `width` × `height` × `depth` texels of `channels` floats each, x fastest, then y, then z. It stands in for a texture of any float pixel format.
+struct Texture {
+    float *texels;
+    uint32_t width;
+    uint32_t height = 1;
+    uint32_t depth = 1;
+    uint32_t channels = 4;
+};
+
+// `checkerboard` (Classic/CheckerBoardCompute.metal): repeats every `width` × `height` texels, each repeat four squares, magenta at its top left and bottom right and black at the others.
+void checkerboard(const Texture &output, float width, float height, compute::Size threadsPerThreadgroup = { 8, 8, 1 });
+
+// `simplexNoise2D` (Noise.metal): the 2D simplex noise at each texel's position, in red.
+void simplexNoise2D(const Texture &output, compute::Size threadsPerThreadgroup = { 8, 8, 1 });
+
+// `voronoiNoiseCompute` (voronoiNoise.metal), with the `VoronoiNoise` arguments other than the texture taken from `parameters`.
+void voronoiNoise(const voronoi::Parameters &parameters, const Texture &output, compute::Size threadsPerThreadgroup = { 8, 8, 1 });
+
+// `srgb_to_linear` and `linear_to_srgb` (include/MetalSupport.h) for one channel, as the shaders compute them.
+float srgbToLinear(float value);
+float linearToSRGB(float value);
+
+// `dequantize_position` and `octahedral_decode` (include/QuantizedVertex.h): the vertex a vertex shader reading `QuantizedVertex` sees, after vertex fetch's format conversions.
+quantization::SimpleVertex dequantize(const quantization::QuantizedVertex &quantized, const quantization::Bounds &bounds);
+
+// `magicaVoxelsToColorTexture3D` (Classic/Voxels.metal): writes each voxel's colour, `palette[color]`, to its position in `output`. `voxels::MagicaVoxel` is checked against the shader's `MagicaVoxel` where the kernel is compiled.
+void magicaVoxelsToColorTexture3D(const voxels::MagicaVoxel *voxels, size_t count, const Texture &palette, const Texture &output, compute::Size threadsPerThreadgroup = { 64, 1, 1 });
+
+}
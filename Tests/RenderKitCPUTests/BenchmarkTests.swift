@@ -0,0 +1,71 @@
+import Foundation
+import RenderKitCPUBenchmarking
+import XCTest
+
+final class BenchmarkTests: XCTestCase {
+    func result(_ name: String, size: UInt64, threads: UInt32, itemsPerSecond: Double) -> benchmark.Result {
+        var result = benchmark.Result()
+        result.name = std.string(name)
+        result.unit = std.string("cells")
+        result.size = size
+        result.threads = threads
+        result.items = size * size
+        result.iterations = 10
+        result.medianSeconds = Double(result.items) / itemsPerSecond
+        result.minimumSeconds = result.medianSeconds * 0.9
+        result.itemsPerSecond = itemsPerSecond
+        return result
+    }
+
+    func testResultsRoundTripThroughJSON() throws {
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("BenchmarkTests-\(UUID().uuidString).json")
+        defer { try? FileManager.default.removeItem(at: url) }
+        var results = std.vector<benchmark.Result>()
+        results.push_back(result("gameOfLife.step", size: 1024, threads: 1, itemsPerSecond: 2.5e9))
+        results.push_back(result("name \"with\" \\ escapes", size: 64, threads: 8, itemsPerSecond: 123.456))
+        var error = std.string()
+        XCTAssertTrue(benchmark.writeResults(std.string(url.path), results, &error))
+
+        var read = std.vector<benchmark.Result>()
+        XCTAssertTrue(benchmark.readResults(std.string(url.path), &read, &error))
+        XCTAssertEqual(read.size(), 2)
+        for (original, copy) in zip(results, read) {
+            XCTAssertEqual(String(copy.name), String(original.name))
+            XCTAssertEqual(String(copy.unit), String(original.unit))
+            XCTAssertEqual(copy.size, original.size)
+            XCTAssertEqual(copy.threads, original.threads)
+            XCTAssertEqual(copy.items, original.items)
+            XCTAssertEqual(copy.iterations, original.iterations)
+            XCTAssertEqual(copy.medianSeconds, original.medianSeconds, accuracy: original.medianSeconds * 1e-8)
+            XCTAssertEqual(copy.itemsPerSecond, original.itemsPerSecond, accuracy: original.itemsPerSecond * 1e-8)
+        }
+
+        try Data("{\"results\": [{\"name\": \"a\"}]}".utf8).write(to: url)
+        XCTAssertFalse(benchmark.readResults(std.string(url.path), &read, &error))
+        try Data("{\"results\": [".utf8).write(to: url)
+        XCTAssertFalse(benchmark.readResults(std.string(url.path), &read, &error))
+        XCTAssertTrue(String(error).contains("malformed JSON"))
+        XCTAssertFalse(benchmark.readResults(std.string(url.path + ".missing"), &read, &error))
+    }
+
+    func testComparisonFlagsRegressionsPastTheThreshold() throws {
+        var baseline = std.vector<benchmark.Result>()
+        baseline.push_back(result("sorting.radixSort", size: 65536, threads: 1, itemsPerSecond: 100))
+        baseline.push_back(result("sorting.radixSort", size: 65536, threads: 4, itemsPerSecond: 100))
+        baseline.push_back(result("noise.simplex2D", size: 256, threads: 1, itemsPerSecond: 100))
+        var current = std.vector<benchmark.Result>()
+        current.push_back(result("sorting.radixSort", size: 65536, threads: 1, itemsPerSecond: 85))
+        current.push_back(result("sorting.radixSort", size: 65536, threads: 4, itemsPerSecond: 95))
+        current.push_back(result("noise.simplex2D", size: 256, threads: 1, itemsPerSecond: 130))
+        current.push_back(result("noise.simplex2D", size: 1024, threads: 1, itemsPerSecond: 1))
+
+        let comparisons = Array(benchmark.compare(current, baseline, 0.1))
+        XCTAssertEqual(comparisons.map(\.hasBaseline), [true, true, true, false])
+        XCTAssertEqual(comparisons.map(\.regressed), [true, false, false, false])
+        XCTAssertEqual(comparisons[0].change, -0.15, accuracy: 1e-12)
+        XCTAssertEqual(comparisons[2].change, 0.3, accuracy: 1e-12)
+
+        // At a zero threshold any slowdown counts.
+        XCTAssertEqual(Array(benchmark.compare(current, baseline, 0)).map(\.regressed), [true, true, false, false])
+    }
+}
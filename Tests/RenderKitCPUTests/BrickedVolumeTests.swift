@@ -0,0 +1,71 @@
+import Foundation
+import RenderKitCPU
+import XCTest
+
+final class BrickedVolumeTests: XCTestCase {
+    func testRoundTripsAndRendersLikeTheDenseVolume() {
+        let width = 37, height = 29, depth = 21
+        var values = [UInt16](repeating: 0, count: width * height * depth)
+        for z in 0..<depth {
+            for y in 0..<height {
+                for x in 0..<width {
+                    values[(z * height + y) * width + x] = UInt16((x * 37 + y * 11 + z * 101) % 1500)
+                }
+            }
+        }
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("BrickedVolumeTests-\(UUID().uuidString).rkbv")
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        values.withUnsafeBufferPointer { values in
+            var source = volume.Volume()
+            source.values = values.baseAddress
+            source.width = UInt32(width)
+            source.height = UInt32(height)
+            source.depth = UInt32(depth)
+            source.spacing = (1, 1, 2)
+            var error = std.string()
+            XCTAssertTrue(volume.writeBrickedVolume(std.string(url.path), source, 8, &error))
+
+            var bricked = volume.BrickedVolume()
+            XCTAssertTrue(bricked.open(std.string(url.path)))
+            XCTAssertEqual(bricked.size()[2], UInt32(depth))
+            XCTAssertEqual(bricked.spacing()[2], 2)
+            XCTAssertEqual(bricked.brickCount(), 5 * 4 * 3)
+            XCTAssertEqual(bricked.minValue(), values.min())
+            XCTAssertEqual(bricked.maxValue(), values.max())
+            XCTAssertEqual(bricked.histogram()[0], UInt64(values.filter { $0 == 0 }.count))
+
+            // A budget of four bricks still reads everything back.
+            let cache = volume.BrickCache(bricked, 4 * bricked.brickStride())
+            var extracted = [UInt16](repeating: 0, count: values.count)
+            cache.extract(0, 0, 0, UInt32(width), UInt32(height), UInt32(depth), 1, &extracted)
+            XCTAssertEqual(extracted, Array(values))
+            XCTAssertLessThanOrEqual(cache.residentBytes(), cache.memoryBudget())
+            XCTAssertGreaterThan(cache.evictions(), 0)
+
+            var texels = [UInt8](repeating: 0, count: 256 * 4)
+            for index in 0..<256 {
+                texels.replaceSubrange(index * 4..<index * 4 + 4, with: [UInt8(index), 128, UInt8(255 - index), index < 100 ? 0 : 255])
+            }
+            let transferFunction = volume.TransferFunction(texels, 256)
+            var uniforms = volume.FragmentUniforms()
+            uniforms.instanceCount = 128
+            uniforms.maxValue = bricked.maxValue()
+            uniforms.alpha = 20
+            var camera = volume.Camera()
+            camera.position = (1.4, 0.8, -0.6)
+            let options = volume.RenderOptions()
+
+            var dense = [Float](repeating: 0, count: 32 * 32 * 4)
+            let denseStatistics = volume.Renderer(source, 8).render(transferFunction, uniforms, camera, 32, 32, &dense, options)
+            var fromBricks = [Float](repeating: 0, count: 32 * 32 * 4)
+            let brickStatistics = volume.Renderer(cache).render(transferFunction, uniforms, camera, 32, 32, &fromBricks, options)
+            XCTAssertEqual(dense, fromBricks)
+            XCTAssertEqual(denseStatistics.samples, brickStatistics.samples)
+        }
+
+        var garbage = volume.BrickedVolume()
+        var bytes = [UInt8](repeating: 0, count: 128)
+        XCTAssertFalse(garbage.parse(&bytes, bytes.count))
+    }
+}
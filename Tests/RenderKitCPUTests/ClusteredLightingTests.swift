@@ -0,0 +1,62 @@
+import Foundation
+import RenderKitCPU
+import XCTest
+
+final class ClusteredLightingTests: XCTestCase {
+    func testClustersHoldEveryLightThatReachesThem() {
+        var generator = SystemRandomNumberGenerator()
+        var lights: [lighting.Light] = []
+        for _ in 0..<2000 {
+            var light = lighting.Light()
+            light.position = (Float.random(in: -40...40, using: &generator), Float.random(in: -20...20, using: &generator), Float.random(in: -100...0, using: &generator))
+            light.color = (Float.random(in: 0...1, using: &generator), Float.random(in: 0...1, using: &generator), Float.random(in: 0...1, using: &generator))
+            light.power = Float.random(in: 0.01...0.05, using: &generator)
+            lights.append(light)
+        }
+        var projection = lighting.Projection()
+        projection.fieldOfView = 1
+        projection.aspectRatio = 16.0 / 9
+        let threshold: Float = 1.0 / 512
+        var clusters = lighting.LightClusters(16, 9, 24)
+        clusters.build(lights, lights.count, projection, 1600, 900, 0.1, 100, threshold)
+        XCTAssertEqual(clusters.ranges().size(), 16 * 9 * 24)
+        // Far fewer lights per cluster than in the scene.
+        XCTAssertLessThan(clusters.lightIndices().size(), clusters.ranges().size() * 100)
+
+        var material = lighting.Material()
+        material.ambient = (0.2, 0.2, 0.2)
+        material.diffuse = (0.8, 0.7, 0.6)
+        material.specular = (1, 1, 1)
+        material.shininess = 32
+        let ambientLight: [Float] = [0.1, 0.1, 0.1]
+        let tanY = tan(Float(0.5)), tanX = tanY * 16 / 9
+        let indices = Array(clusters.lightIndices())
+
+        for _ in 0..<500 {
+            let x = Float.random(in: 0..<1600, using: &generator), y = Float.random(in: 0..<900, using: &generator)
+            let depth = 0.1 * pow(1000, Float.random(in: 0..<1, using: &generator))
+            let position: [Float] = [(2 * x / 1600 - 1) * tanX * depth, (1 - 2 * y / 900) * tanY * depth, -depth]
+            let normal: [Float] = [Float.random(in: -0.5...0.5, using: &generator), Float.random(in: -0.5...0.5, using: &generator), 1]
+
+            let range = clusters.ranges()[Int(clusters.clusterIndex(x, y, depth))]
+            let listed = Set(indices[Int(range.offset)..<Int(range.offset + range.count)])
+            var reaching: [UInt32] = []
+            for (index, light) in lights.enumerated() {
+                let dx = light.position.0 - position[0], dy = light.position.1 - position[1], dz = light.position.2 - position[2]
+                if (dx * dx + dy * dy + dz * dz).squareRoot() < lighting.influenceRadius(light, threshold) * 0.999 {
+                    XCTAssertTrue(listed.contains(UInt32(index)))
+                    reaching.append(UInt32(index))
+                }
+            }
+
+            // Shading with the lights that reach the point matches shading with the cluster's list.
+            var exact = [Float](repeating: 0, count: 3), clustered = [Float](repeating: 0, count: 3)
+            lighting.calculateBlinnPhong(position, normal, lights, reaching, reaching.count, ambientLight, material, 0, &exact)
+            let list = Array(indices[Int(range.offset)..<Int(range.offset + range.count)])
+            lighting.calculateBlinnPhong(position, normal, lights, list, list.count, ambientLight, material, 0, &clustered)
+            for channel in 0..<3 {
+                XCTAssertEqual(exact[channel], clustered[channel], accuracy: threshold * Float(list.count) * 2 + 1e-4)
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+import RenderKitCPU
+import RenderKitShadersHost
+import XCTest
+
+final class ColorConversionTests: XCTestCase {
+    func testBytesDecodeByTableAndRoundTrip() throws {
+        // Two RGBA pixels of every code.
+        let codes = (0 ..< 512).map { UInt8($0 % 256) }
+        var linear = [Float](repeating: 0, count: codes.count)
+        color.srgbToLinear(codes, &linear, codes.count, .interleavedRGBA)
+        for index in 0 ..< codes.count {
+            let expected = index % 4 == 3 ? Float(codes[index]) / 255 : shaders.srgbToLinear(Float(codes[index]) / 255)
+            XCTAssertEqual(linear[index], expected, accuracy: 1e-7)
+        }
+        var encoded = [UInt8](repeating: 0, count: codes.count)
+        color.linearToSRGB(linear, &encoded, linear.count, .interleavedRGBA)
+        XCTAssertEqual(encoded, codes)
+
+        let words = (0 ..< 65536).map { UInt16($0) }
+        var wide = [Float](repeating: 0, count: words.count)
+        var back = [UInt16](repeating: 0, count: words.count)
+        color.srgbToLinear(words, &wide, words.count, .planarRGBA)
+        color.linearToSRGB(wide, &back, wide.count, .planarRGBA)
+        XCTAssertEqual(back, words)
+    }
+
+    func testFloatsStayCloseToTheShaderFunctions() throws {
+        let values = (-1000 ..< 13000).map { Float($0) * 1e-4 } + [.nan, .infinity, 1, 0.0031308, 0.04045]
+        var decoded = [Float](repeating: 0, count: values.count)
+        var encoded = [Float](repeating: 0, count: values.count)
+        var bytes = [UInt8](repeating: 0, count: values.count)
+        color.srgbToLinear(values, &decoded, values.count, .color)
+        color.linearToSRGB(values, &encoded, values.count, .color)
+        color.linearToSRGB(values, &bytes, values.count, .color)
+        for (index, value) in values.enumerated() {
+            let reference = shaders.srgbToLinear(value)
+            if !reference.isFinite {
+                XCTAssertTrue(decoded[index] == reference || (decoded[index].isNaN && reference.isNaN))
+            }
+            else {
+                XCTAssertEqual(decoded[index], reference, accuracy: max(abs(reference) * 5e-7, 1e-9))
+            }
+            let srgb = shaders.linearToSRGB(value)
+            XCTAssertEqual(encoded[index], srgb, accuracy: 5e-7)
+            XCTAssertEqual(Float(bytes[index]), min(max(srgb, 0), 1) * 255, accuracy: 0.51)
+        }
+    }
+}
@@ -0,0 +1,71 @@
+import RenderKitCPU
+import XCTest
+
+final class FluidTests: XCTestCase {
+    private func block(_ size: (Int, Int, Int), spacing: Float, origin: Float) -> [particles.Particle] {
+        var result: [particles.Particle] = []
+        for z in 0 ..< size.2 {
+            for y in 0 ..< size.1 {
+                for x in 0 ..< size.0 {
+                    var particle = particles.Particle()
+                    // A little jitter so that particles do not sit exactly on cell boundaries.
+                    let jitter = Float((x * 7 + y * 13 + z * 29) % 17) * spacing * 0.001
+                    particle.position = (origin + Float(x) * spacing + jitter, origin + Float(y) * spacing, origin + Float(z) * spacing - jitter, 0)
+                    particle.oldPosition = particle.position
+                    result.append(particle)
+                }
+            }
+        }
+        return result
+    }
+
+    func testDensitiesMatchBruteForce() throws {
+        var parameters = fluid.Parameters()
+        parameters.boundsMax = (0.5, 0.5, 0.5)
+        // Packed tighter than at rest, so that every particle has dozens of neighbours across several cells.
+        let input = block((12, 9, 7), spacing: parameters.smoothingRadius * 0.3, origin: 0.02)
+        var solver = fluid.Solver(parameters)
+        input.withUnsafeBufferPointer { solver.setParticles($0.baseAddress, $0.count) }
+        let timings = solver.step(particles.Environment())
+        XCTAssertGreaterThanOrEqual(timings.total(), timings.forces)
+
+        var densities = [Float](repeating: 0, count: input.count)
+        densities.withUnsafeMutableBufferPointer { solver.exportDensities($0.baseAddress) }
+        let h = Double(parameters.smoothingRadius)
+        let poly6 = 315 / (64 * Double.pi * pow(h, 9))
+        for i in input.indices {
+            var sum = 0.0
+            for j in input.indices {
+                let dx = Double(input[i].position.0 - input[j].position.0), dy = Double(input[i].position.1 - input[j].position.1), dz = Double(input[i].position.2 - input[j].position.2)
+                let difference = h * h - (dx * dx + dy * dy + dz * dz)
+                if difference > 0 {
+                    sum += difference * difference * difference
+                }
+            }
+            let expected = Double(parameters.particleMass) * poly6 * sum
+            XCTAssertEqual(Double(densities[i]), expected, accuracy: expected * 1e-5)
+        }
+    }
+
+    func testColumnSettlesNearRestDensity() throws {
+        var parameters = fluid.Parameters()
+        parameters.stiffness = 100
+        parameters.boundsMax = (0.3, 0.6, 0.15)
+        let spacing = cbrt(parameters.particleMass / parameters.restDensity)
+        let input = block((10, 15, 5), spacing: spacing, origin: 0.01)
+        var solver = fluid.Solver(parameters)
+        input.withUnsafeBufferPointer { solver.setParticles($0.baseAddress, $0.count) }
+        var environment = particles.Environment()
+        environment.timestep = 0.001
+        for _ in 0 ..< 2000 {
+            solver.step(environment)
+        }
+        var output = [particles.Particle](repeating: particles.Particle(), count: input.count)
+        output.withUnsafeMutableBufferPointer { solver.exportParticles($0.baseAddress) }
+        var densities = [Float](repeating: 0, count: input.count)
+        densities.withUnsafeMutableBufferPointer { solver.exportDensities($0.baseAddress) }
+        XCTAssertTrue(output.allSatisfy { $0.position.0 >= 0 && $0.position.0 <= 0.3 && $0.position.1 >= 0 && $0.position.2 <= 0.15 })
+        let averageDensity = densities.reduce(0, +) / Float(densities.count)
+        XCTAssertEqual(averageDensity, parameters.restDensity, accuracy: parameters.restDensity * 0.05)
+    }
+}
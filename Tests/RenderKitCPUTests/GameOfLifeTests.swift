@@ -0,0 +1,129 @@
+import RenderKitCPU
+import XCTest
+
+final class GameOfLifeTests: XCTestCase {
+    // Straight port of the per-texel kernels.
+    func referenceStep(_ cells: [UInt8], width: Int, height: Int, wrap: Bool, rule: gameOfLife.Rule = .init()) -> [UInt8] {
+        var result = cells
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                var count = 0
+                for (dx, dy) in [(-1, -1), (0, -1), (1, -1), (-1, 0), (1, 0), (-1, 1), (0, 1), (1, 1)] {
+                    var px = x + dx, py = y + dy
+                    if wrap {
+                        px = (px + width) % width
+                        py = (py + height) % height
+                    }
+                    else if px < 0 || px >= width || py < 0 || py >= height {
+                        continue
+                    }
+                    count += cells[py * width + px] != 0 ? 1 : 0
+                }
+                let alive = cells[y * width + x] != 0
+                result[y * width + x] = rule.next(UInt32(count), alive) ? 1 : 0
+            }
+        }
+        return result
+    }
+
+    func testMatchesKernels() throws {
+        var generator = SystemRandomNumberGenerator()
+        for (width, height) in [(1, 1), (3, 2), (63, 5), (64, 64), (65, 7), (300, 33)] {
+            for wrap in [false, true] {
+                var cells = (0 ..< width * height).map { _ in UInt8.random(in: 0 ... 2, using: &generator) == 0 ? 255 : 0 }
+                var board = cells.withUnsafeBufferPointer { gameOfLife.Board.fromCells($0.baseAddress, UInt32(width), UInt32(height), 0) }
+                for _ in 0 ..< 8 {
+                    cells = referenceStep(cells, width: width, height: height, wrap: wrap)
+                    var next = gameOfLife.Board(0, 0)
+                    gameOfLife.step(board, &next, wrap, gameOfLife.Rule())
+                    board = next
+                    var output = [UInt8](repeating: 0, count: width * height)
+                    output.withUnsafeMutableBufferPointer { board.toCells($0.baseAddress, 0) }
+                    XCTAssertEqual(output, cells, "\(width)x\(height) wrap: \(wrap)")
+                }
+            }
+        }
+    }
+
+    func testSparseEnginesMatchBoard() throws {
+        // An R-pentomino in the middle of a board big enough that nothing reaches the edges in 256 generations.
+        let size: UInt32 = 768, offset: Int64 = 384
+        var board = gameOfLife.Board(size, size)
+        var sparse = gameOfLife.SparseLife(gameOfLife.Rule())
+        var hashLife = gameOfLife.HashLife(gameOfLife.Rule(), 1 << 20)
+        for (x, y) in [(1, 0), (2, 0), (0, 1), (1, 1), (1, 2)] {
+            board.set(UInt32(Int64(x) + offset), UInt32(Int64(y) + offset), true)
+            sparse.set(Int64(x), Int64(y), true)
+            hashLife.set(Int64(x), Int64(y), true)
+        }
+        gameOfLife.run(&board, 256, false, gameOfLife.Rule())
+        sparse.run(256)
+        hashLife.step(8)
+        XCTAssertEqual(sparse.generation(), 256)
+        XCTAssertEqual(hashLife.generation(), 256)
+        XCTAssertTrue(sparse.extract(-offset, -offset, size, size) == board)
+        XCTAssertTrue(hashLife.extract(-offset, -offset, size, size) == board)
+        XCTAssertEqual(UInt64(sparse.population()), hashLife.population())
+    }
+
+    func parse(_ string: String) -> gameOfLife.Rule? {
+        string.withCString { gameOfLife.Rule.parse(std.string_view($0)).value }
+    }
+
+    func canonical(_ string: String) -> String? {
+        parse(string).map { String($0.toString()) }
+    }
+
+    func testParsesRules() throws {
+        XCTAssertEqual(canonical("B3/S23"), "B3/S23")
+        XCTAssertTrue(parse("B3/S23")?.isConway() == true)
+        XCTAssertTrue(parse("23/3")?.isConway() == true)
+        XCTAssertTrue(parse("s23 b3")?.isConway() == true)
+        XCTAssertEqual(canonical("B36/S23"), "B36/S23")
+        XCTAssertEqual(canonical("36/23"), "B23/S36")
+        XCTAssertEqual(canonical("B2/S"), "B2/S")
+        XCTAssertEqual(canonical("B/S"), "B/S")
+        for malformed in ["", "B", "S", "/", "B3/S23/", "B9/S23", "B3/X23", "3", "B3/23", "B3S23!"] {
+            XCTAssertNil(parse(malformed), malformed)
+        }
+    }
+
+    func testRulesAcrossEngines() throws {
+        var generator = SystemRandomNumberGenerator()
+        for string in ["B3/S23", "23/3", "B36/S23"] {
+            let rule = try XCTUnwrap(parse(string))
+            let (width, height) = (70, 40)
+            for wrap in [false, true] {
+                var cells = (0 ..< width * height).map { _ in UInt8.random(in: 0 ... 2, using: &generator) == 0 ? 1 : 0 }
+                var board = cells.withUnsafeBufferPointer { gameOfLife.Board.fromCells($0.baseAddress, UInt32(width), UInt32(height), 0) }
+                for _ in 0 ..< 8 {
+                    cells = referenceStep(cells, width: width, height: height, wrap: wrap, rule: rule)
+                    var next = gameOfLife.Board(0, 0)
+                    gameOfLife.step(board, &next, wrap, rule)
+                    board = next
+                }
+                var output = [UInt8](repeating: 0, count: width * height)
+                output.withUnsafeMutableBufferPointer { board.toCells($0.baseAddress, 0) }
+                XCTAssertEqual(output, cells, "\(string) wrap: \(wrap)")
+            }
+
+            // A 32 × 32 soup in the middle of a board that nothing reaches the edges of in 64 generations.
+            let size: UInt32 = 256, offset: Int64 = 112
+            var board = gameOfLife.Board(size, size)
+            var sparse = gameOfLife.SparseLife(rule)
+            var hashLife = gameOfLife.HashLife(rule, 1 << 20)
+            for y in 0 ..< Int64(32) {
+                for x in 0 ..< Int64(32) where Bool.random(using: &generator) {
+                    board.set(UInt32(x + offset), UInt32(y + offset), true)
+                    sparse.set(x, y, true)
+                    hashLife.set(x, y, true)
+                }
+            }
+            gameOfLife.run(&board, 64, false, rule)
+            sparse.run(64)
+            hashLife.step(6)
+            XCTAssertTrue(sparse.extract(-offset, -offset, size, size) == board, string)
+            XCTAssertTrue(hashLife.extract(-offset, -offset, size, size) == board, string)
+        }
+    }
+}
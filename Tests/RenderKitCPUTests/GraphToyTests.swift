@@ -0,0 +1,79 @@
+import RenderKitCPU
+import XCTest
+
+final class GraphToyTests: XCTestCase {
+    func testBatchesMatchScalars() throws {
+        let count = 1003
+        let inputs = (0 ..< 3).map { channel in (0 ..< count).map { Float(($0 * 7919 + channel * 104_729) % 4001) * 0.01 - 20 } }
+        for function in [graphtoy.Function.floor, .round, .sin, .noise, .voronoi, .cellnoise, .mod, .tri, .smoothstep] {
+            var output = [Float](repeating: 0, count: count)
+            inputs[0].withUnsafeBufferPointer { a in
+                inputs[1].withUnsafeBufferPointer { b in
+                    inputs[2].withUnsafeBufferPointer { c in
+                        var arguments: [UnsafePointer<Float>?] = [a.baseAddress, b.baseAddress, c.baseAddress]
+                        output.withUnsafeMutableBufferPointer { output in
+                            graphtoy.evaluate(function, &arguments, output.baseAddress, count)
+                        }
+                    }
+                }
+            }
+            for index in 0 ..< count {
+                var arguments = [inputs[0][index], inputs[1][index], inputs[2][index]]
+                XCTAssertEqual(output[index], graphtoy.evaluate(function, &arguments))
+            }
+        }
+    }
+
+    func testHashWrapsLikeTheShader() throws {
+        // graphtoy's cellnoise with its 32 bit products wrapped.
+        func reference(_ x: Float) -> Float {
+            var n = UInt32(bitPattern: Int32(x.rounded(.down)))
+            n = (n << 13) ^ n
+            let m = n
+            n = n &* 15731 &* m &+ 789_221
+            n = n &* m &+ 1_376_312_589
+            return Float((n >> 14) & 65535) / 65535
+        }
+        for x in stride(from: Float(-5000), to: 5000, by: 13.7) {
+            XCTAssertEqual(graphtoy.cellnoise(x), reference(x))
+        }
+    }
+
+    func testExpression() throws {
+        var expression = graphtoy.Expression()
+        XCTAssertTrue(expression.compile("smoothstep(0,1,x)*noise(x*4)"))
+        XCTAssertEqual(expression.constants().size(), 3)
+
+        let count = 5000
+        let x = (0 ..< count).map { Float($0) * 0.003 - 2 }
+        var output = [Float](repeating: 0, count: count)
+        x.withUnsafeBufferPointer { x in
+            output.withUnsafeMutableBufferPointer { output in
+                expression.evaluate(x.baseAddress, output.baseAddress, count, 0)
+            }
+        }
+        for index in 0 ..< count {
+            var arguments: [Float] = [0, 1, x[index]]
+            let expected = graphtoy.evaluate(.smoothstep, &arguments) * graphtoy.noise(x[index] * 4)
+            XCTAssertEqual(output[index], expected)
+            XCTAssertEqual(expression.evaluate(x[index], 0), expected)
+        }
+
+        // Constant subexpressions fold away entirely.
+        XCTAssertTrue(expression.compile("remap(0, 2*PI, PI, -1, 1) + t"))
+        XCTAssertEqual(expression.instructions().size(), 1)
+        XCTAssertEqual(expression.constants().size(), 1)
+        XCTAssertEqual(expression.evaluate(0, 0.5), 0.5, accuracy: 1e-6)
+
+        XCTAssertFalse(expression.compile("clamp(x, 0)"))
+        XCTAssertTrue(String(expression.error()).contains("clamp"))
+        XCTAssertFalse(expression.compile("foo(x)"))
+        XCTAssertFalse(expression.compile("x +"))
+        // More distinct constants than 16 bit registers can number.
+        let oversized = "x" + (0 ..< 70000).map { "+x*\($0).5" }.joined()
+        XCTAssertFalse(oversized.withCString { expression.compile(std.string_view($0)) })
+        XCTAssertEqual(String(expression.error()), "expression too large")
+        // A failed compile keeps the previous program.
+        XCTAssertEqual(expression.evaluate(0, 0.5), 0.5, accuracy: 1e-6)
+    }
+}
@@ -0,0 +1,95 @@
+import RenderKitCPU
+import XCTest
+
+final class MarchingCubesTests: XCTestCase {
+    func testSphereIsWeldedAndWatertight() throws {
+        let size = 32
+        var values = [Float](repeating: 0, count: size * size * size)
+        for z in 0 ..< size {
+            for y in 0 ..< size {
+                for x in 0 ..< size {
+                    let dx = Float(x) - 15.5, dy = Float(y) - 15.5, dz = Float(z) - 15.5
+                    values[(z * size + y) * size + x] = (dx * dx + dy * dy + dz * dz).squareRoot()
+                }
+            }
+        }
+        values.withUnsafeBufferPointer { buffer in
+            var grid = marchingCubes.ScalarGrid()
+            grid.values = buffer.baseAddress
+            grid.width = UInt32(size)
+            grid.height = UInt32(size)
+            grid.depth = UInt32(size)
+
+            let mesh = marchingCubes.extractIsosurface(grid, 10)
+            let soup = marchingCubes.extractTriangleSoup(grid, 10)
+            XCTAssertEqual(mesh.indices.size(), soup.size() * 3)
+            XCTAssertLessThan(mesh.vertices.size() * 4, soup.size() * 3)
+
+            // Every edge of a closed, welded surface is shared by exactly two triangles.
+            let indices = Array(mesh.indices)
+            var edgeCounts: [UInt64: Int] = [:]
+            for triangle in stride(from: 0, to: indices.count, by: 3) {
+                for corner in 0 ..< 3 {
+                    let a = UInt64(indices[triangle + corner]), b = UInt64(indices[triangle + (corner + 1) % 3])
+                    XCTAssertLessThan(Int(max(a, b)), mesh.vertices.size())
+                    edgeCounts[min(a, b) << 32 | max(a, b), default: 0] += 1
+                }
+            }
+            XCTAssertTrue(edgeCounts.values.allSatisfy { $0 == 2 })
+        }
+    }
+
+    // Each triangle as its corner positions, rotated to start at the smallest corner so winding is kept, and the triangles sorted.
+    func triangles(_ mesh: marchingCubes.IndexedMesh) -> [[Float]] {
+        let indices = Array(mesh.indices)
+        return stride(from: 0, to: indices.count, by: 3).map { triangle in
+            let corners = (0 ..< 3).map { corner -> [Float] in
+                let position = mesh.vertices[Int(indices[triangle + corner])].position
+                return [position.x, position.y, position.z]
+            }
+            let first = (0 ..< 3).min { corners[$0].lexicographicallyPrecedes(corners[$1]) }!
+            return (0 ..< 3).flatMap { corners[(first + $0) % 3] }
+        }
+        .sorted { $0.lexicographicallyPrecedes($1) }
+    }
+
+    func testBrickedIsosurfaceMatchesFullExtraction() throws {
+        let size = 48
+        var values = [Float](repeating: 0, count: size * size * size)
+        for z in 0 ..< size {
+            for y in 0 ..< size {
+                for x in 0 ..< size {
+                    let dx = Float(x) - 20.5, dy = Float(y) - 20.5, dz = Float(z) - 20.5
+                    values[(z * size + y) * size + x] = (dx * dx + dy * dy + dz * dz).squareRoot()
+                }
+            }
+        }
+        values.withUnsafeMutableBufferPointer { buffer in
+            var grid = marchingCubes.ScalarGrid()
+            grid.values = UnsafePointer(buffer.baseAddress)
+            grid.width = UInt32(size)
+            grid.height = UInt32(size)
+            grid.depth = UInt32(size)
+
+            var bricked = marchingCubes.BrickedIsosurface(grid, 8, 8)
+            // A small sphere: most bricks never straddle the isolevel.
+            XCTAssertLessThan(bricked.activeBrickCount() * 4, bricked.brickCount())
+            XCTAssertEqual(triangles(bricked.mesh()), triangles(marchingCubes.extractIsosurface(grid, 8)))
+
+            bricked.setIsolevel(12)
+            XCTAssertLessThan(bricked.activeBrickCount(), bricked.brickCount())
+            XCTAssertEqual(triangles(bricked.mesh()), triangles(marchingCubes.extractIsosurface(grid, 12)))
+
+            // A solid block against the far x face of the field, beside the sphere.
+            for z in 30 ... 40 {
+                for y in 30 ... 40 {
+                    for x in 36 ..< size {
+                        buffer[(z * size + y) * size + x] = 0
+                    }
+                }
+            }
+            bricked.invalidate(36, 30, 30, UInt32(size - 1), 40, 40)
+            XCTAssertEqual(triangles(bricked.mesh()), triangles(marchingCubes.extractIsosurface(grid, 12)))
+        }
+    }
+}
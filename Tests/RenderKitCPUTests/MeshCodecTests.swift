@@ -0,0 +1,103 @@
+import RenderKitCPU
+import XCTest
+
+final class MeshCodecTests: XCTestCase {
+    // A `width` × `height` grid of quads, in row order.
+    func grid(width: UInt32, height: UInt32) -> [UInt32] {
+        var indices: [UInt32] = []
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                let corner = y * (width + 1) + x
+                indices += [corner, corner + 1, corner + width + 1, corner + 1, corner + width + 2, corner + width + 1]
+            }
+        }
+        return indices
+    }
+
+    func testIndicesRoundTrip() throws {
+        var generator = SystemRandomNumberGenerator()
+        let random = (0 ..< 50000).map { _ in UInt32.random(in: 0 ... .max, using: &generator) }
+        for indices in [grid(width: 200, height: 150), random, [0, 1, 2, .max, 0, .max], []] {
+            let encoded = Array(meshCodec.encodeIndices(indices, indices.count))
+            let header = meshCodec.readHeader(encoded, encoded.count).value
+            XCTAssertEqual(header?.stream, .indices)
+            XCTAssertEqual(header?.count, UInt32(indices.count))
+            var decoded = [UInt32](repeating: 0, count: indices.count)
+            XCTAssertTrue(meshCodec.decodeIndices(encoded, encoded.count, &decoded, decoded.count))
+            XCTAssertEqual(decoded, indices)
+        }
+
+        // A grid costs well under the 12 bytes per triangle of 32 bit indices.
+        let indices = grid(width: 200, height: 150)
+        let encoded = meshCodec.encodeIndices(indices, indices.count)
+        XCTAssertLessThan(encoded.size() * 3, indices.count * 5)
+    }
+
+    func testSixteenBitIndices() throws {
+        let wide = grid(width: 100, height: 100)
+        let narrow = wide.map { UInt16($0) }
+        let encoded = Array(meshCodec.encodeIndices(narrow, narrow.count))
+        XCTAssertEqual(encoded, Array(meshCodec.encodeIndices(wide, wide.count)))
+        var decoded = [UInt16](repeating: 0, count: narrow.count)
+        XCTAssertTrue(meshCodec.decodeIndices(encoded, encoded.count, &decoded, decoded.count))
+        XCTAssertEqual(decoded, narrow)
+
+        let large: [UInt32] = [0, 1, 65536]
+        let overflowing = Array(meshCodec.encodeIndices(large, large.count))
+        var small = [UInt16](repeating: 0, count: large.count)
+        XCTAssertFalse(meshCodec.decodeIndices(overflowing, overflowing.count, &small, small.count))
+    }
+
+    func testVerticesRoundTrip() throws {
+        // A smooth 16 byte vertex per grid point, and random bytes of an odd stride.
+        var smooth: [UInt16] = []
+        for y in 0 ..< 300 {
+            for x in 0 ..< 300 {
+                smooth += [UInt16(x * 200), UInt16(y * 200), UInt16(30000 + (x * x + y) % 97), 0, 0x1234, UInt16(y), UInt16(x), 0x3C00]
+            }
+        }
+        var generator = SystemRandomNumberGenerator()
+        let random = (0 ..< 7 * 3000).map { _ in UInt8.random(in: 0 ... .max, using: &generator) }
+        let cases: [([UInt8], Int)] = [(smooth.withUnsafeBytes { Array($0) }, 16), (random, 7), ([], 12)]
+        for (bytes, stride) in cases {
+            let count = bytes.count / stride
+            let encoded = Array(meshCodec.encodeVertices(bytes, count, stride))
+            XCTAssertEqual(meshCodec.readHeader(encoded, encoded.count).value?.stride, UInt32(stride))
+            var decoded = [UInt8](repeating: 0, count: bytes.count)
+            XCTAssertTrue(meshCodec.decodeVertices(encoded, encoded.count, &decoded, count, stride))
+            XCTAssertEqual(decoded, bytes)
+            XCTAssertFalse(meshCodec.decodeVertices(encoded, encoded.count, &decoded, count, stride + 1))
+        }
+        let encoded = meshCodec.encodeVertices(smooth, smooth.count / 8, 16)
+        XCTAssertLessThan(encoded.size() * 2, smooth.count * 2)
+    }
+
+    func testRejectsCorruptStreams() throws {
+        let indices = grid(width: 64, height: 64)
+        let encoded = Array(meshCodec.encodeIndices(indices, indices.count))
+        var decoded = [UInt32](repeating: 0, count: indices.count)
+        for length in [0, 15, 16, encoded.count / 2, encoded.count - 1] {
+            XCTAssertFalse(meshCodec.decodeIndices(encoded, length, &decoded, decoded.count))
+        }
+        XCTAssertFalse(meshCodec.decodeIndices(encoded, encoded.count, &decoded, decoded.count - 1))
+        XCTAssertFalse(meshCodec.decodeVertices(encoded, encoded.count, &decoded, decoded.count, 4))
+
+        var misdirected = encoded
+        misdirected[0] = UInt8(ascii: "X")
+        XCTAssertFalse(meshCodec.decodeIndices(misdirected, misdirected.count, &decoded, decoded.count))
+        XCTAssertNil(meshCodec.readHeader(misdirected, misdirected.count).value)
+
+        // A flipped byte may still decode, to other indices, but must never take the decoder outside the buffers.
+        var generator = SystemRandomNumberGenerator()
+        var vertices = [UInt8](repeating: 0, count: 16 * 100)
+        let encodedVertices = Array(meshCodec.encodeVertices(vertices.map { _ in UInt8.random(in: 0 ... 3, using: &generator) }, 100, 16))
+        for _ in 0 ..< 1000 {
+            var corrupt = encoded
+            corrupt[Int.random(in: 4 ..< corrupt.count, using: &generator)] ^= UInt8.random(in: 1 ... .max, using: &generator)
+            _ = meshCodec.decodeIndices(corrupt, corrupt.count, &decoded, decoded.count)
+            var corruptVertices = encodedVertices
+            corruptVertices[Int.random(in: 4 ..< corruptVertices.count, using: &generator)] ^= UInt8.random(in: 1 ... .max, using: &generator)
+            _ = meshCodec.decodeVertices(corruptVertices, corruptVertices.count, &vertices, 100, 16)
+        }
+    }
+}
@@ -0,0 +1,79 @@
+import RenderKitCPU
+import XCTest
+
+final class ParticlesTests: XCTestCase {
+    // One `particleUpdate` Verlet step for a live particle, written out per particle.
+    private func referenceStep(_ particle: inout particles.Particle, _ environment: particles.Environment) {
+        let timestep = environment.timestep
+        var position = [particle.position.0, particle.position.1, particle.position.2]
+        let oldPosition = [particle.oldPosition.0, particle.oldPosition.1, particle.oldPosition.2]
+        var acceleration = [particle.acceleration.0, particle.acceleration.1, particle.acceleration.2]
+        let gravity = [environment.gravity.0, environment.gravity.1, environment.gravity.2]
+        for axis in 0 ..< 3 {
+            let previous = position[axis]
+            position[axis] = previous + ((previous - oldPosition[axis]) + acceleration[axis] * timestep * timestep)
+            let velocity = position[axis] - previous
+            acceleration[axis] = gravity[axis] - 0.5 * environment.drag * (velocity * abs(velocity)) / environment.mass
+        }
+        particle.oldPosition = (particle.position.0, particle.position.1, particle.position.2, particle.oldPosition.3)
+        particle.position = (position[0], position[1], position[2], particle.position.3)
+        particle.acceleration = (acceleration[0], acceleration[1], acceleration[2], particle.acceleration.3)
+        particle.age += timestep
+    }
+
+    func testStepMatchesScalarKernel() throws {
+        let capacity = 1003
+        var system = particles.System(capacity)
+        let environment = particles.Environment()
+        var emitter = particles.Emitter()
+        emitter.lifetime = 0.75
+        var before = [particles.Particle](repeating: particles.Particle(), count: capacity)
+        var after = before
+        for _ in 0 ..< 120 {
+            system.emit(system.freeCount() / 2, emitter)
+            before.withUnsafeMutableBufferPointer { system.exportParticles($0.baseAddress) }
+            let wasAlive = (0 ..< capacity).map { system.isAlive($0) }
+            system.step(environment)
+            after.withUnsafeMutableBufferPointer { system.exportParticles($0.baseAddress) }
+            for index in 0 ..< capacity {
+                var expected = before[index]
+                if wasAlive[index] {
+                    referenceStep(&expected, environment)
+                }
+                XCTAssertEqual(after[index].position.1, expected.position.1)
+                XCTAssertEqual(after[index].acceleration.0, expected.acceleration.0)
+                XCTAssertEqual(after[index].age, expected.age)
+            }
+        }
+    }
+
+    func testDeadParticlesAreRespawned() throws {
+        let capacity = 256
+        var system = particles.System(capacity)
+        XCTAssertEqual(system.freeCount(), capacity)
+        var emitter = particles.Emitter()
+        emitter.lifetime = 0.1
+        XCTAssertEqual(system.emit(1000, emitter), capacity)
+        XCTAssertEqual(system.liveCount(), capacity)
+
+        // Every particle outlives its 0.1 s lifetime within seven steps and returns to the free list.
+        let environment = particles.Environment()
+        for _ in 0 ..< 7 {
+            system.step(environment)
+        }
+        XCTAssertEqual(system.liveCount(), 0)
+        XCTAssertEqual(system.freeCount(), capacity)
+
+        system.step(environment, emitter)
+        XCTAssertEqual(system.liveCount(), capacity)
+        XCTAssertEqual(system.particle(0).age, environment.timestep)
+
+        // Round trip through the kernel's layout keeps the state and the free list.
+        var exported = [particles.Particle](repeating: particles.Particle(), count: capacity)
+        exported.withUnsafeMutableBufferPointer { system.exportParticles($0.baseAddress) }
+        var copy = particles.System(capacity)
+        exported.withUnsafeBufferPointer { copy.importParticles($0.baseAddress) }
+        XCTAssertEqual(copy.liveCount(), system.liveCount())
+        XCTAssertEqual(copy.particle(17).position.1, system.particle(17).position.1)
+    }
+}
@@ -0,0 +1,100 @@
+import RenderKitCPU
+import XCTest
+
+final class PreIntegrationTests: XCTestCase {
+    private func uniforms() -> volume.FragmentUniforms {
+        var uniforms = volume.FragmentUniforms()
+        uniforms.instanceCount = 64
+        uniforms.maxValue = 1000
+        uniforms.alpha = 8
+        return uniforms
+    }
+
+    // A ramp of colour with a single opaque spike at texel 100.
+    private func texels() -> [UInt8] {
+        var texels = [UInt8](repeating: 0, count: 256 * 4)
+        for index in 0..<256 {
+            texels.replaceSubrange(index * 4..<index * 4 + 4, with: [UInt8(index), 64, UInt8(255 - index), index == 100 ? 255 : 0])
+        }
+        return texels
+    }
+
+    func testSegmentsCatchFeaturesBetweenSamples() {
+        let transferFunction = volume.TransferFunction(texels(), 256)
+        let table = volume.PreIntegratedTable(transferFunction, uniforms(), 4.0 / 64)
+        XCTAssertEqual(table.size(), 256)
+
+        // Both ends miss the spike, but the segment crosses it.
+        var rgba = [Float](repeating: 0, count: 4)
+        let below: Float = 50.5 / 256, above: Float = 150.5 / 256
+        table.sample(below, above, &rgba)
+        XCTAssertGreaterThan(rgba[3], 0)
+        table.sample(above, below, &rgba)
+        XCTAssertGreaterThan(rgba[3], 0)
+        table.sample(below, below, &rgba)
+        XCTAssertEqual(rgba[3], 0)
+
+        // A segment at a constant value has the opacity of that many reference slices.
+        let spike: Float = 100.5 / 256
+        table.sample(spike, spike, &rgba)
+        XCTAssertEqual(rgba[3], 1 - pow(1 - Float(8) / 64, 4), accuracy: 1e-4)
+    }
+
+    func testIncrementalUpdateMatchesRebuild() {
+        var texels = texels()
+        var transferFunction = volume.TransferFunction(texels, 256)
+        var table = volume.PreIntegratedTable(transferFunction, uniforms(), 2.0 / 64)
+        for index in 180..<190 {
+            texels[index * 4 + 3] = 128
+        }
+        texels.withUnsafeBufferPointer { transferFunction.update(180, 10, $0.baseAddress! + 180 * 4) }
+        table.update(transferFunction, 180, 10)
+        let rebuilt = volume.PreIntegratedTable(transferFunction, uniforms(), 2.0 / 64)
+        for index in 0..<256 * 256 * 4 {
+            XCTAssertEqual(table.data()[index], rebuilt.data()[index])
+        }
+    }
+
+    func testRendersWithFewerSamples() {
+        // Values ramp along z, so every ray crosses the spike somewhere between samples.
+        var values = [UInt16](repeating: 0, count: 16 * 16 * 64)
+        for z in 0..<64 {
+            for index in 0..<256 {
+                values[z * 256 + index] = UInt16(z * 1000 / 63)
+            }
+        }
+        values.withUnsafeBufferPointer { values in
+            var source = volume.Volume()
+            source.values = values.baseAddress
+            source.width = 16
+            source.height = 16
+            source.depth = 64
+            let renderer = volume.Renderer(source, 8)
+            let transferFunction = volume.TransferFunction(texels(), 256)
+            var camera = volume.Camera()
+            camera.fieldOfView = 0
+            camera.position = (0.125, 0.125, -1)
+            camera.target = (0.125, 0.125, 0.5)
+            camera.orthographicHeight = 0.2
+
+            var options = volume.RenderOptions()
+            options.stepSize = 0.125
+            options.opacityThreshold = 2
+            var reference = [Float](repeating: 0, count: 4 * 4 * 4)
+            let referenceStatistics = renderer.render(transferFunction, uniforms(), camera, 4, 4, &reference, options)
+
+            let table = volume.PreIntegratedTable(transferFunction, uniforms(), 8.0 / 64)
+            var preIntegrated = [Float](repeating: 0, count: 4 * 4 * 4)
+            let statistics = renderer.render(transferFunction, table, uniforms(), camera, 4, 4, &preIntegrated, options)
+            XCTAssertLessThan(statistics.samples * 32, referenceStatistics.samples)
+            XCTAssertGreaterThan(reference[3], 0.01)
+            XCTAssertEqual(preIntegrated[3], reference[3], accuracy: 0.05 * reference[3])
+
+            // Single samples as far apart step over the spike.
+            options.stepSize = 8
+            var sparse = [Float](repeating: 0, count: 4 * 4 * 4)
+            _ = renderer.render(transferFunction, uniforms(), camera, 4, 4, &sparse, options)
+            XCTAssertLessThan(sparse[3], reference[3] / 2)
+        }
+    }
+}
@@ -0,0 +1,76 @@
+import RenderKitCPU
+import XCTest
+
+final class RandomTests: XCTestCase {
+    func testKnownAnswers() throws {
+        // Random123's known answer for Philox-2x32-10 with a zero counter and key.
+        let philox = hashRandom.philox2x32(0, 0, 0)
+        XCTAssertEqual(philox.x, 0xFF1D_AE59)
+        XCTAssertEqual(philox.y, 0x6CD1_0DF2)
+        XCTAssertEqual(hashRandom.pcg(0), 129_708_002)
+    }
+
+    func testIntegerGridIsUniformAndUncorrelated() throws {
+        // The common case: one value per pixel or lattice cell.
+        let size = 512
+        var values: [Float] = []
+        values.reserveCapacity(size * size)
+        for y in 0 ..< size {
+            for x in 0 ..< size {
+                values.append(hashRandom.rand2dTo1d(hashRandom.float2(x: Float(x), y: Float(y)), 0))
+            }
+        }
+        XCTAssertTrue(values.allSatisfy { $0 >= 0 && $0 < 1 })
+
+        // Chi-squared over 256 buckets; 330 is the 99.9th percentile for 255 degrees of freedom.
+        var buckets = [Double](repeating: 0, count: 256)
+        for value in values {
+            buckets[Int(value * 256)] += 1
+        }
+        let expected = Double(values.count) / 256
+        let chiSquared = buckets.reduce(0) { $0 + ($1 - expected) * ($1 - expected) / expected }
+        XCTAssertLessThan(chiSquared, 330)
+
+        // Neighbouring pixels.
+        var sumA = 0.0, sumB = 0.0, sumAB = 0.0, sumAA = 0.0, sumBB = 0.0, count = 0.0
+        for y in 0 ..< size {
+            for x in 0 ..< size - 1 {
+                let a = Double(values[y * size + x]), b = Double(values[y * size + x + 1])
+                sumA += a
+                sumB += b
+                sumAB += a * b
+                sumAA += a * a
+                sumBB += b * b
+                count += 1
+            }
+        }
+        let correlation = (sumAB - sumA * sumB / count) / ((sumAA - sumA * sumA / count) * (sumBB - sumB * sumB / count)).squareRoot()
+        XCTAssertLessThan(abs(correlation), 0.01)
+    }
+
+    func testInputBitsAvalanche() throws {
+        var flipped = 0, total = 0
+        for value in UInt32(0) ..< 1000 {
+            let original = hashRandom.pcg3d(value, value &* 7, value &* 13)
+            for bit in 0 ..< 32 {
+                let changed = hashRandom.pcg3d(value ^ (1 << bit), value &* 7, value &* 13)
+                flipped += (original.x ^ changed.x).nonzeroBitCount + (original.y ^ changed.y).nonzeroBitCount + (original.z ^ changed.z).nonzeroBitCount
+                total += 96
+            }
+        }
+        let fraction = Double(flipped) / Double(total)
+        XCTAssertGreaterThan(fraction, 0.4)
+        XCTAssertLessThan(fraction, 0.6)
+    }
+
+    func testThroughput() throws {
+        measure {
+            var sum: Float = 0
+            for index in 0 ..< 1 << 20 {
+                let value = hashRandom.rand2dTo2d(hashRandom.float2(x: Float(index & 1023), y: Float(index >> 10)), 0)
+                sum += value.x - value.y
+            }
+            XCTAssertFalse(sum.isNaN)
+        }
+    }
+}
@@ -0,0 +1,119 @@
+import Foundation
+import RenderKitCPU
+import XCTest
+
+final class RasterizerTests: XCTestCase {
+    private func identityMatrix() -> (
+        (Float, Float, Float, Float), (Float, Float, Float, Float), (Float, Float, Float, Float), (Float, Float, Float, Float)
+    ) {
+        ((1, 0, 0, 0), (0, 1, 0, 0), (0, 0, 1, 0), (0, 0, 0, 1))
+    }
+
+    private func modelTransforms() -> raster.ModelTransforms {
+        var transforms = raster.ModelTransforms()
+        transforms.modelViewMatrix = identityMatrix()
+        transforms.modelNormalMatrix = ((1, 0, 0, 0), (0, 1, 0, 0), (0, 0, 1, 0))
+        return transforms
+    }
+
+    // Two triangles covering [x0, x1] × [y0, y1] at depth z.
+    private func quad(_ x0: Float, _ y0: Float, _ x1: Float, _ y1: Float, _ z: Float) -> [raster.Vertex] {
+        let corners: [(Float, Float, Float, Float)] = [(x0, y0, 0, 1), (x1, y0, 1, 1), (x1, y1, 1, 0), (x0, y0, 0, 1), (x1, y1, 1, 0), (x0, y1, 0, 0)]
+        return corners.map { corner in
+            var vertex = raster.Vertex()
+            vertex.position = (corner.0, corner.1, z)
+            vertex.normal = (0, 0, 1)
+            vertex.textureCoordinate = (corner.2, corner.3)
+            return vertex
+        }
+    }
+
+    private func mesh(_ vertices: UnsafeBufferPointer<raster.Vertex>) -> raster.Mesh {
+        var mesh = raster.Mesh()
+        mesh.vertices = vertices.baseAddress
+        mesh.vertexCount = vertices.count
+        return mesh
+    }
+
+    private func pixel(_ rasterizer: raster.Rasterizer, _ x: Int, _ y: Int) -> [Float] {
+        let index = (y * Int(rasterizer.width()) + x) * 4
+        return (0..<4).map { rasterizer.color()[index + $0] }
+    }
+
+    func testCoversExactlyAndTestsDepth() {
+        var rasterizer = raster.Rasterizer(64, 48, 16)
+        let clearColor: [Float] = [0, 0, 0, 1]
+        rasterizer.clear(clearColor, 1)
+        var camera = raster.CameraUniforms()
+        camera.projectionMatrix = identityMatrix()
+        var transforms = [modelTransforms()]
+
+        // A near red quad over the left half, then a farther green one over the whole target.
+        var red = raster.UnlitMaterial()
+        red.color = (1, 0, 0, 1)
+        red.textureIndex = -1
+        var green = red
+        green.color = (0, 1, 0, 1)
+        let near = quad(-1, -1, 0, 1, 0.25), far = quad(-1, -1, 1, 1, 0.5)
+        near.withUnsafeBufferPointer { vertices in
+            let statistics = rasterizer.drawUnlit(mesh(vertices), 1, camera, &transforms, [red], nil, 0)
+            // Shared edges are drawn once.
+            XCTAssertEqual(statistics.fragments, 32 * 48)
+        }
+        far.withUnsafeBufferPointer { vertices in
+            let statistics = rasterizer.drawUnlit(mesh(vertices), 1, camera, &transforms, [green], nil, 0)
+            XCTAssertEqual(statistics.fragments, 32 * 48)
+        }
+        XCTAssertEqual(pixel(rasterizer, 5, 20), [1, 0, 0, 1])
+        XCTAssertEqual(pixel(rasterizer, 40, 20), [0, 1, 0, 1])
+        XCTAssertEqual(rasterizer.depth()[20 * 64 + 5], 0.25)
+    }
+
+    func testShadesAsTheFlatAndUnlitShaders() {
+        var rasterizer = raster.Rasterizer(32, 32, 64)
+        let clearColor: [Float] = [0, 0, 0, 0]
+        rasterizer.clear(clearColor, 1)
+        var camera = raster.CameraUniforms()
+        camera.projectionMatrix = identityMatrix()
+        var transforms = [modelTransforms()]
+
+        // A 2 × 2 texture: each pixel of the quad lies nearest one texel.
+        let texels: [UInt8] = [255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 255]
+        texels.withUnsafeBufferPointer { texels in
+            var texture = raster.Texture()
+            texture.rgba8 = texels.baseAddress
+            texture.width = 2
+            texture.height = 2
+            var material = raster.UnlitMaterial()
+            material.textureIndex = 0
+            let vertices = quad(-1, -1, 1, 1, 0.5)
+            vertices.withUnsafeBufferPointer { vertices in
+                _ = rasterizer.drawUnlit(mesh(vertices), 1, camera, &transforms, [material], [texture], 1)
+            }
+        }
+        XCTAssertEqual(pixel(rasterizer, 0, 0), [1, 0, 0, 1])
+        XCTAssertEqual(pixel(rasterizer, 31, 0), [0, 1, 0, 1])
+        XCTAssertEqual(pixel(rasterizer, 0, 31), [0, 0, 1, 1])
+
+        // Flat: the quad's normal faces the light at (0, 0, 2); the light direction is not normalized, as in the shader.
+        var light = raster.LightUniforms()
+        light.lightPosition = (0, 0, 2)
+        light.lightColor = (1, 1, 1)
+        light.lightPower = 1
+        light.ambientLightColor = (0.5, 0.5, 0.5)
+        var material = raster.FlatMaterial()
+        material.diffuseColor = (1, 0.5, 0.25, 1)
+        material.ambientColor = (0.2, 0.2, 0.2, 1)
+        rasterizer.clear(clearColor, 1)
+        let vertices = quad(-1, -1, 1, 1, 0)
+        vertices.withUnsafeBufferPointer { vertices in
+            _ = rasterizer.drawFlat(mesh(vertices), 1, camera, &transforms, light, [material])
+        }
+        // At the pixel centre (1/32, -1/32): dot(l, n) = 2 and |l|² = 4 + 2/32².
+        let distanceSquared: Float = 4 + 2.0 / (32 * 32)
+        let centre = pixel(rasterizer, 16, 16)
+        XCTAssertEqual(centre[0], 1 * 2 / distanceSquared + 0.1, accuracy: 1e-4)
+        XCTAssertEqual(centre[1], 0.5 * 2 / distanceSquared + 0.1, accuracy: 1e-4)
+        XCTAssertEqual(centre[3], 1)
+    }
+}
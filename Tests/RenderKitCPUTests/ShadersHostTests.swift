@@ -0,0 +1,115 @@
+import RenderKitCPU
+import RenderKitShadersHost
+import XCTest
+
+final class ShadersHostTests: XCTestCase {
+    func testCheckerboard() throws {
+        let width = 16, height = 16
+        var texels = [Float](repeating: 0, count: width * height * 4)
+        texels.withUnsafeMutableBufferPointer { texels in
+            var output = shaders.Texture()
+            output.texels = texels.baseAddress
+            output.width = UInt32(width)
+            output.height = UInt32(height)
+            output.depth = 1
+            output.channels = 4
+            shaders.checkerboard(output, 4, 4, threadgroup(8, 8))
+        }
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                let magenta: Float = (x / 2 + y / 2) % 2 == 0 ? 1 : 0
+                XCTAssertEqual(Array(texels[(y * width + x) * 4 ..< (y * width + x) * 4 + 4]), [magenta, 0, magenta, 1])
+            }
+        }
+    }
+
+    func testSimplexNoiseMatchesHost() throws {
+        let width = 131, height = 70
+        var texels = [Float](repeating: 0, count: width * height * 4)
+        texels.withUnsafeMutableBufferPointer { texels in
+            var output = shaders.Texture()
+            output.texels = texels.baseAddress
+            output.width = UInt32(width)
+            output.height = UInt32(height)
+            output.depth = 1
+            output.channels = 4
+            shaders.simplexNoise2D(output, threadgroup(8, 8))
+        }
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                XCTAssertEqual(texels[(y * width + x) * 4], noise.simplex(Float(x), Float(y)), accuracy: 1e-5)
+            }
+        }
+    }
+
+    func testVoronoiNoiseMatchesGenerate() throws {
+        let width = 131, height = 70
+        var parameters = voronoi.Parameters()
+        parameters.size = (17, 23)
+        parameters.offset = (3.5, -7)
+        for mode in [voronoi.Mode.distance, voronoi.Mode.edgeDistance, voronoi.Mode.edgeMask] {
+            parameters.mode = mode
+            var expected = [Float](repeating: 0, count: width * height * 4)
+            expected.withUnsafeMutableBufferPointer { voronoi.generate(parameters, $0.baseAddress, UInt32(width), UInt32(height), 0) }
+            var texels = [Float](repeating: 0, count: width * height * 4)
+            texels.withUnsafeMutableBufferPointer { texels in
+                var output = shaders.Texture()
+                output.texels = texels.baseAddress
+                output.width = UInt32(width)
+                output.height = UInt32(height)
+                output.depth = 1
+                output.channels = 4
+                shaders.voronoiNoise(parameters, output, threadgroup(16, 16))
+            }
+            for index in 0 ..< texels.count {
+                XCTAssertEqual(texels[index], expected[index], accuracy: 1e-4)
+            }
+        }
+    }
+
+    func testMagicaVoxelsToColorTexture3D() throws {
+        let (width, height, depth) = (4, 3, 2)
+        var palette = (0 ..< 256).flatMap { index -> [Float] in [Float(index) / 255, 1 - Float(index) / 255, 0.5, 1] }
+        // The byte after the position is filled so that reading it in place of the position or colour would show.
+        let placed: [(UInt8, UInt8, UInt8, UInt8)] = [(0, 0, 0, 1), (3, 2, 1, 255), (1, 1, 0, 7), (2, 0, 1, 128)]
+        let input = placed.map { x, y, z, color in
+            var voxel = voxels.MagicaVoxel()
+            voxel.position = (x, y, z)
+            voxel.unused = 0xFF
+            voxel.color = color
+            return voxel
+        }
+        var texels = [Float](repeating: 0, count: width * height * depth * 4)
+        palette.withUnsafeMutableBufferPointer { palette in
+            texels.withUnsafeMutableBufferPointer { texels in
+                var colors = shaders.Texture()
+                colors.texels = palette.baseAddress
+                colors.width = 256
+                colors.height = 1
+                colors.depth = 1
+                colors.channels = 4
+                var output = shaders.Texture()
+                output.texels = texels.baseAddress
+                output.width = UInt32(width)
+                output.height = UInt32(height)
+                output.depth = UInt32(depth)
+                output.channels = 4
+                input.withUnsafeBufferPointer { shaders.magicaVoxelsToColorTexture3D($0.baseAddress, $0.count, colors, output, threadgroup(3, 1)) }
+            }
+        }
+        var expected = [Float](repeating: 0, count: texels.count)
+        for (x, y, z, color) in placed {
+            let texel = ((Int(z) * height + Int(y)) * width + Int(x)) * 4
+            expected[texel ..< texel + 4] = palette[Int(color) * 4 ..< Int(color) * 4 + 4]
+        }
+        XCTAssertEqual(texels, expected)
+    }
+
+    private func threadgroup(_ width: UInt32, _ height: UInt32) -> compute.Size {
+        var size = compute.Size()
+        size.width = width
+        size.height = height
+        size.depth = 1
+        return size
+    }
+}
@@ -0,0 +1,43 @@
+import RenderKitCPU
+import XCTest
+
+final class SimplexNoiseTests: XCTestCase {
+    func testBatchesMatchScalar() throws {
+        // Not a multiple of eight, so the padded tail is covered too.
+        let count = 1003
+        let x = (0 ..< count).map { _ in Float.random(in: -300 ... 300) }
+        let y = (0 ..< count).map { _ in Float.random(in: -300 ... 300) }
+        let z = (0 ..< count).map { _ in Float.random(in: -300 ... 300) }
+        let w = (0 ..< count).map { _ in Float.random(in: -300 ... 300) }
+        var output2D = [Float](repeating: 0, count: count), output3D = output2D, output4D = output2D
+        output2D.withUnsafeMutableBufferPointer { noise.simplex2D(x, y, $0.baseAddress, count) }
+        output3D.withUnsafeMutableBufferPointer { noise.simplex3D(x, y, z, $0.baseAddress, count) }
+        output4D.withUnsafeMutableBufferPointer { noise.simplex4D(x, y, z, w, $0.baseAddress, count) }
+        for index in 0 ..< count {
+            XCTAssertEqual(output2D[index], noise.simplex(x[index], y[index]))
+            XCTAssertEqual(output3D[index], noise.simplex(x[index], y[index], z[index]))
+            XCTAssertEqual(output4D[index], noise.simplex(x[index], y[index], z[index], w[index]))
+            XCTAssertLessThanOrEqual(abs(output2D[index]), 1.1)
+            XCTAssertLessThanOrEqual(abs(output3D[index]), 1.1)
+            XCTAssertLessThanOrEqual(abs(output4D[index]), 1.1)
+        }
+    }
+
+    func testHeightfieldMatchesFractal() throws {
+        let width = 67, height = 5
+        var fractal = noise.Fractal()
+        for mode in [noise.FractalMode.fbm, noise.FractalMode.ridged] {
+            fractal.mode = mode
+            var heights = [Float](repeating: 0, count: width * height)
+            heights.withUnsafeMutableBufferPointer { noise.heightfield(fractal, $0.baseAddress, UInt32(width), UInt32(height), -3, 5, 0.01, 0) }
+            let x = (0 ..< width * height).map { -3 + Float($0 % width) * 0.01 }
+            let y = (0 ..< width * height).map { 5 + Float($0 / width) * 0.01 }
+            var expected = [Float](repeating: 0, count: width * height)
+            expected.withUnsafeMutableBufferPointer { noise.fractal2D(fractal, x, y, $0.baseAddress, width * height) }
+            XCTAssertEqual(heights, expected)
+            if mode == .ridged {
+                XCTAssertTrue(heights.allSatisfy { $0 >= 0 && $0 <= 1 })
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+import RenderKitCPU
+import XCTest
+
+final class SortingTests: XCTestCase {
+    func testRadixAndBitonicAgreeWithStandardSort() throws {
+        for count in [3, 1000, 4097, 100_000] {
+            let original = (0 ..< count).map { _ in UInt32.random(in: 0 ..< UInt32(max(count / 4, 1))) }
+            var radixKeys = original, bitonicKeys = original
+            var radixPayloads = (0 ..< UInt32(count)).map { $0 }, bitonicPayloads = radixPayloads
+            radixKeys.withUnsafeMutableBufferPointer { keys in
+                radixPayloads.withUnsafeMutableBufferPointer { payloads in
+                    sorting.radixSort(keys.baseAddress, payloads.baseAddress, count, nil)
+                }
+            }
+            bitonicKeys.withUnsafeMutableBufferPointer { keys in
+                bitonicPayloads.withUnsafeMutableBufferPointer { payloads in
+                    sorting.bitonicSort(keys.baseAddress, payloads.baseAddress, count)
+                }
+            }
+            XCTAssertEqual(radixKeys, original.sorted())
+            XCTAssertEqual(bitonicKeys, original.sorted())
+            XCTAssertEqual(radixPayloads.map { original[Int($0)] }, radixKeys)
+            XCTAssertEqual(bitonicPayloads.map { original[Int($0)] }, bitonicKeys)
+            // The radix passes are stable.
+            for index in 1 ..< count where radixKeys[index] == radixKeys[index - 1] {
+                XCTAssertLessThan(radixPayloads[index - 1], radixPayloads[index])
+            }
+        }
+    }
+
+    func testFloatKeysUseTotalOrder() throws {
+        var keys: [Float] = [3, -0.0, .infinity, -1.5, 0, -.infinity, 2, -1e-30, 1e-30]
+        var payloads = (0 ..< UInt32(keys.count)).map { $0 }
+        let expected = keys.sorted { $0 < $1 || ($0 == 0 && $1 == 0 && $0.sign == .minus && $1.sign == .plus) }
+        keys.withUnsafeMutableBufferPointer { keys in
+            payloads.withUnsafeMutableBufferPointer { payloads in
+                sorting.radixSort(keys.baseAddress, payloads.baseAddress, keys.count, nil)
+            }
+        }
+        XCTAssertEqual(keys.map(\.bitPattern), expected.map(\.bitPattern))
+    }
+}
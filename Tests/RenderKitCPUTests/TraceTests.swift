@@ -0,0 +1,55 @@
+import RenderKitCPU
+import XCTest
+
+final class TraceTests: XCTestCase {
+    func testZonesAndFrameCounters() throws {
+        let size = 24
+        var values = [Float](repeating: 0, count: size * size * size)
+        for z in 0 ..< size {
+            for y in 0 ..< size {
+                for x in 0 ..< size {
+                    let dx = Float(x) - 11.5, dy = Float(y) - 11.5, dz = Float(z) - 11.5
+                    values[(z * size + y) * size + x] = (dx * dx + dy * dy + dz * dz).squareRoot()
+                }
+            }
+        }
+        values.withUnsafeBufferPointer { buffer in
+            var grid = marchingCubes.ScalarGrid()
+            grid.values = buffer.baseAddress
+            grid.width = UInt32(size)
+            grid.height = UInt32(size)
+            grid.depth = UInt32(size)
+
+            trace.clear()
+            // Nothing is recorded while tracing is disabled.
+            _ = marchingCubes.extractIsosurface(grid, 8)
+            XCTAssertEqual(trace.capture().zones.size(), 0)
+
+            trace.setEnabled(true)
+            var triangles: [Int] = []
+            for isolevel in [Float(6), Float(8)] {
+                triangles.append(marchingCubes.extractIsosurface(grid, isolevel).indices.size() / 3)
+                trace.frame()
+            }
+            trace.setEnabled(false)
+
+            let capture = trace.capture()
+            XCTAssertEqual(capture.frames.size(), 2)
+            XCTAssertEqual(capture.dropped, 0)
+            var extractions = 0
+            for index in 0 ..< capture.zones.size() where String(cString: capture.zones[index].name) == "marchingCubes.extractIsosurface" {
+                extractions += 1
+            }
+            XCTAssertEqual(extractions, 2)
+            var emitted: [Int] = []
+            for index in 0 ..< capture.counters.size() where String(cString: capture.counters[index].name) == "marchingCubes.trianglesEmitted" {
+                emitted.append(Int(capture.counters[index].total))
+            }
+            XCTAssertEqual(emitted, triangles)
+
+            XCTAssertTrue(String(trace.chromeTrace()).contains("\"ph\":\"X\""))
+            trace.clear()
+            XCTAssertEqual(trace.capture().zones.size(), 0)
+        }
+    }
+}
@@ -0,0 +1,82 @@
+import RenderKitCPU
+import RenderKitShadersHost
+import XCTest
+
+final class VertexQuantizationTests: XCTestCase {
+    func testRoundTripStaysWithinTolerance() throws {
+        var generator = SystemRandomNumberGenerator()
+        let vertices: [quantization.SimpleVertex] = (0 ..< 4096).map { _ in
+            var vertex = quantization.SimpleVertex()
+            vertex.position = (Float.random(in: -50 ... 50, using: &generator), Float.random(in: 0 ... 3, using: &generator), Float.random(in: -2 ... 7, using: &generator))
+            vertex.normal = (Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator))
+            vertex.textureCoordinate = (Float.random(in: 0 ... 1, using: &generator), Float.random(in: 0 ... 1, using: &generator))
+            return vertex
+        }
+        let bounds = quantization.bounds(vertices, vertices.count)
+        XCTAssertEqual(MemoryLayout<quantization.QuantizedVertex>.stride, 16)
+        var quantized = [quantization.QuantizedVertex](repeating: .init(), count: vertices.count)
+        var decoded = [quantization.SimpleVertex](repeating: .init(), count: vertices.count)
+        quantization.quantize(vertices, &quantized, vertices.count, bounds)
+        quantization.dequantize(quantized, &decoded, quantized.count, bounds)
+        for (original, result) in zip(vertices, decoded) {
+            XCTAssertEqual(result.position.0, original.position.0, accuracy: 100 / 65535)
+            XCTAssertEqual(result.position.1, original.position.1, accuracy: 3 / 65535)
+            XCTAssertEqual(result.position.2, original.position.2, accuracy: 9 / 65535)
+            // In doubles, since the cosine of 0.01° rounds to 1 as a float.
+            let a = SIMD3<Double>(Double(original.normal.0), Double(original.normal.1), Double(original.normal.2))
+            let b = SIMD3<Double>(Double(result.normal.0), Double(result.normal.1), Double(result.normal.2))
+            let cross = SIMD3<Double>(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x)
+            let angle = atan2((cross * cross).sum().squareRoot(), (a * b).sum()) * 180 / .pi
+            XCTAssertLessThan(angle, 0.01)
+            XCTAssertEqual(result.textureCoordinate.0, original.textureCoordinate.0, accuracy: 1.0 / 2048)
+            XCTAssertEqual(result.textureCoordinate.1, original.textureCoordinate.1, accuracy: 1.0 / 2048)
+        }
+    }
+
+    func testDegenerateNormalsAndOutOfBoundsPositions() throws {
+        var encoded: (Int16, Int16) = (0, 0)
+        var normal: (Float, Float, Float) = (0, 0, 0)
+        var zero: (Float, Float, Float) = (0, 0, 0)
+        withUnsafePointer(to: &zero.0) { input in
+            withUnsafeMutablePointer(to: &encoded.0) { quantization.encodeNormal(input, $0) }
+        }
+        withUnsafePointer(to: &encoded.0) { input in
+            withUnsafeMutablePointer(to: &normal.0) { quantization.decodeNormal(input, $0) }
+        }
+        XCTAssertEqual(normal.2, 1)
+
+        var bounds = quantization.Bounds()
+        bounds.origin = (0, 0, 0)
+        bounds.scale = (1, 1, 0)
+        var vertex = quantization.SimpleVertex()
+        vertex.position = (-1, 2, 5)
+        let quantized = quantization.quantize(vertex, bounds)
+        XCTAssertEqual(quantized.position.0, 0)
+        XCTAssertEqual(quantized.position.1, 65535)
+        XCTAssertEqual(quantized.position.2, 0)
+        XCTAssertEqual(quantized.position.3, 0)
+    }
+
+    func testMatchesTheShaderDecode() throws {
+        var generator = SystemRandomNumberGenerator()
+        var bounds = quantization.Bounds()
+        bounds.origin = (-1, 2, -3)
+        bounds.scale = (4, 5, 6)
+        for _ in 0 ..< 4096 {
+            var quantized = quantization.QuantizedVertex()
+            quantized.position = (UInt16.random(in: 0 ... .max, using: &generator), UInt16.random(in: 0 ... .max, using: &generator), UInt16.random(in: 0 ... .max, using: &generator), 0)
+            quantized.normal = (Int16.random(in: .min ... .max, using: &generator), Int16.random(in: .min ... .max, using: &generator))
+            quantized.textureCoordinate = (half.fromFloat(Float.random(in: -4 ... 4, using: &generator)), half.fromFloat(Float.random(in: -4 ... 4, using: &generator)))
+            let expected = quantization.dequantize(quantized, bounds)
+            let result = shaders.dequantize(quantized, bounds)
+            XCTAssertEqual(result.position.0, expected.position.0, accuracy: 1e-6)
+            XCTAssertEqual(result.position.1, expected.position.1, accuracy: 1e-6)
+            XCTAssertEqual(result.position.2, expected.position.2, accuracy: 1e-6)
+            XCTAssertEqual(result.normal.0, expected.normal.0, accuracy: 1e-6)
+            XCTAssertEqual(result.normal.1, expected.normal.1, accuracy: 1e-6)
+            XCTAssertEqual(result.normal.2, expected.normal.2, accuracy: 1e-6)
+            XCTAssertEqual(result.textureCoordinate.0, expected.textureCoordinate.0)
+            XCTAssertEqual(result.textureCoordinate.1, expected.textureCoordinate.1)
+        }
+    }
+}
@@ -0,0 +1,186 @@
+import RenderKitCPU
+import XCTest
+
+final class VirtualTextureTests: XCTestCase {
+    private func append(_ value: UInt32, to bytes: inout [UInt8]) {
+        withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+    }
+
+    private func append(_ value: UInt64, to bytes: inout [UInt8]) {
+        withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+    }
+
+    // An RGBA8 KTX 1 file whose texels hold their own x, y, level and `tile`.
+    private func makeKTX1(width: Int, height: Int, levels: Int, tile: UInt8) -> [UInt8] {
+        var bytes: [UInt8] = [0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A]
+        for field: UInt32 in [0x0403_0201, 0x1401, 1, 0x1908, 0x8058, 0x1908, UInt32(width), UInt32(height), 0, 0, 1, UInt32(levels), 0] {
+            append(field, to: &bytes)
+        }
+        for level in 0..<levels {
+            let levelWidth = max(width >> level, 1), levelHeight = max(height >> level, 1)
+            append(UInt32(levelWidth * levelHeight * 4), to: &bytes)
+            for y in 0..<levelHeight {
+                for x in 0..<levelWidth {
+                    bytes.append(contentsOf: [UInt8(x), UInt8(y), UInt8(level), tile])
+                }
+            }
+        }
+        return bytes
+    }
+
+    // A KTX 2 file of 8x8 blocks of 16 bytes, like ASTC, each block filled with its index.
+    private func makeKTX2(width: Int, height: Int) -> [UInt8] {
+        let blocks = ((width + 7) / 8) * ((height + 7) / 8)
+        let descriptorOffset = 80 + 24, descriptorSize = 4 + 24 + 16
+        let dataOffset = descriptorOffset + descriptorSize
+        var bytes: [UInt8] = [0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A]
+        for field: UInt32 in [1_000_066_007, 1, UInt32(width), UInt32(height), 0, 0, 1, 1, 0, UInt32(descriptorOffset), UInt32(descriptorSize), 0, 0] {
+            append(field, to: &bytes)
+        }
+        append(UInt64(0), to: &bytes)
+        append(UInt64(0), to: &bytes)
+        append(UInt64(dataOffset), to: &bytes)
+        append(UInt64(blocks * 16), to: &bytes)
+        append(UInt64(blocks * 16), to: &bytes)
+        append(UInt32(descriptorSize), to: &bytes)
+        var descriptor = [UInt8](repeating: 0, count: 24 + 16)
+        descriptor[12] = 7
+        descriptor[13] = 7
+        descriptor[16] = 16
+        bytes.append(contentsOf: descriptor)
+        for block in 0..<blocks {
+            bytes.append(contentsOf: [UInt8](repeating: UInt8(block), count: 16))
+        }
+        return bytes
+    }
+
+    func testReadsBothVersions() {
+        let version1 = makeKTX1(width: 13, height: 7, levels: 4, tile: 9)
+        version1.withUnsafeBufferPointer { bytes in
+            var file = textures.KTXFile()
+            XCTAssertTrue(file.parse(bytes.baseAddress, bytes.count))
+            XCTAssertEqual(file.version(), 1)
+            XCTAssertEqual(file.levelCount(), 4)
+            XCTAssertEqual(file.blockFormat().bytes, 4)
+            XCTAssertEqual(file.levelWidth(2), 3)
+            XCTAssertEqual(file.image(1, 0, 0)![0], 0)
+            XCTAssertEqual(file.image(1, 0, 0)![2], 1)
+            XCTAssertNil(file.image(4, 0, 0))
+
+            // Blocks outside the image repeat the edge.
+            var output = [UInt8](repeating: 0, count: 3 * 2 * 4)
+            XCTAssertTrue(file.copyBlocks(0, 0, 0, 11, -1, 3, 2, &output, 3 * 4))
+            XCTAssertEqual(output[0], 11)
+            XCTAssertEqual(output[8], 12)
+            XCTAssertEqual(output[1], 0)
+            XCTAssertEqual(output[12 + 4], 12)
+            XCTAssertEqual(output[12 + 4 + 1], 0)
+
+            XCTAssertFalse(file.parse(bytes.baseAddress, bytes.count - 1))
+            XCTAssertFalse(file.error().empty())
+        }
+
+        let version2 = makeKTX2(width: 20, height: 20)
+        version2.withUnsafeBufferPointer { bytes in
+            var file = textures.KTXFile()
+            XCTAssertTrue(file.parse(bytes.baseAddress, bytes.count))
+            XCTAssertEqual(file.version(), 2)
+            XCTAssertEqual(file.format(), 1_000_066_007)
+            XCTAssertEqual(file.blockFormat().width, 8)
+            XCTAssertEqual(file.blocksWide(0), 3)
+            XCTAssertEqual(file.imageBytes(0), 9 * 16)
+            var output = [UInt8](repeating: 0, count: 2 * 16)
+            XCTAssertTrue(file.copyBlocks(0, 0, 0, 2, 2, 2, 1, &output, 2 * 16))
+            XCTAssertEqual(output[0], 8)
+            XCTAssertEqual(output[16], 8)
+        }
+    }
+
+    func testRejectsTruncatedUnalignedLevel() {
+        // Two levels of a 1 × 1 RGBA8 texture; the first claims 5 bytes and the file ends a byte later, so the second level's size would start past the end.
+        var bytes: [UInt8] = [0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A]
+        for field: UInt32 in [0x0403_0201, 0x1401, 1, 0x1908, 0x8058, 0x1908, 1, 1, 0, 0, 1, 2, 0] {
+            append(field, to: &bytes)
+        }
+        append(UInt32(5), to: &bytes)
+        bytes.append(contentsOf: [1, 2, 3, 4, 5, 6])
+        bytes.withUnsafeBufferPointer { bytes in
+            var file = textures.KTXFile()
+            XCTAssertFalse(file.parse(bytes.baseAddress, bytes.count))
+            XCTAssertEqual(String(file.error()), "truncated KTX level")
+        }
+    }
+
+    func testPagesFollowRequests() {
+        let width = 100, height = 60, levels = 7
+        var bytes: [UInt8] = []
+        var offsets: [Int] = []
+        for tile in 0..<2 {
+            offsets.append(bytes.count)
+            bytes.append(contentsOf: makeKTX1(width: width, height: height, levels: levels, tile: UInt8(tile)))
+        }
+        bytes.withUnsafeBufferPointer { bytes in
+            var tiles = std.vector<textures.KTXFile>()
+            for (index, offset) in offsets.enumerated() {
+                var file = textures.KTXFile()
+                XCTAssertTrue(file.parse(bytes.baseAddress! + offset, (index + 1 < offsets.count ? offsets[index + 1] : bytes.count) - offset))
+                tiles.push_back(file)
+            }
+            var texture = textures.VirtualTexture()
+            XCTAssertTrue(texture.open(tiles, 2, 1, 16, 12))
+            // 100 × 60 texels: 7 × 4, 4 × 2, 2 × 1 and 1 × 1 pages.
+            XCTAssertEqual(texture.levelCount(), 4)
+            XCTAssertEqual(texture.pagesPerTile(), 28 + 8 + 2 + 1)
+            XCTAssertEqual(texture.levelFor(5), 2)
+
+            var atlas = [UInt8](repeating: 0, count: Int(texture.atlasWidth() * texture.atlasHeight()) * 4)
+            let rowBytes = Int(texture.slotBytesPerRow())
+            func load(_ maximumPages: Int) -> Int {
+                let uploads = texture.update(maximumPages)
+                for index in 0..<uploads.size() {
+                    let upload = uploads[index]
+                    for row in 0..<Int(texture.slotHeight()) {
+                        let source = texture.stagingData()! + upload.offset + row * rowBytes
+                        let target = ((Int(upload.y) + row) * Int(texture.atlasWidth()) + Int(upload.x)) * 4
+                        for byte in 0..<rowBytes {
+                            atlas[target + byte] = source[byte]
+                        }
+                    }
+                }
+                return uploads.size()
+            }
+            func texel(_ u: Float, _ v: Float, _ level: UInt32) -> [UInt8]? {
+                var atlasU: Float = 0, atlasV: Float = 0
+                guard texture.translate(u, v, level, &atlasU, &atlasV) else {
+                    return nil
+                }
+                let x = Int(atlasU * Float(texture.atlasWidth())), y = Int(atlasV * Float(texture.atlasHeight()))
+                let index = (y * Int(texture.atlasWidth()) + x) * 4
+                return Array(atlas[index..<index + 4])
+            }
+
+            XCTAssertNil(texel(0.3, 0.3, 0))
+            // The first update brings in the coarsest page of every tile, which then stands in for everything.
+            texture.beginFrame()
+            XCTAssertEqual(load(16), 2)
+            XCTAssertEqual(texel(0.3, 0.3, 0)?[2], 3)
+            XCTAssertEqual(texel(0.8, 0.3, 0)?[3], 1)
+
+            // Fine pages arrive after their parents, and lookups then find level 0.
+            texture.beginFrame()
+            texture.request(0.2, 0.2, 0.22, 0.24, 0)
+            XCTAssertGreaterThan(texture.pendingPages(), 0)
+            XCTAssertEqual(load(16), 3)
+            XCTAssertEqual(texel(0.21, 0.22, 0), [UInt8(0.42 * 100), UInt8(0.22 * 60), 0, 0])
+            XCTAssertEqual(texture.residentPages(), 5)
+
+            // Requests beyond the budget keep what this frame asked for and fall back to coarser pages.
+            texture.beginFrame()
+            texture.request(0.5, 0, 1, 1, 0)
+            _ = load(64)
+            XCTAssertLessThanOrEqual(texture.residentPages(), 12)
+            XCTAssertNotNil(texel(0.9, 0.9, 0))
+            XCTAssertEqual(texel(0.9, 0.9, 0)?[3], 1)
+        }
+    }
+}
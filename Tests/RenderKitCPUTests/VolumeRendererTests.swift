@@ -0,0 +1,94 @@
+import RenderKitCPU
+import XCTest
+
+final class VolumeRendererTests: XCTestCase {
+    // Black below 0.25, opaque white above.
+    private func transferFunction() -> volume.TransferFunction {
+        var texels = [UInt8](repeating: 0, count: 256 * 4)
+        for index in 64..<256 {
+            texels.replaceSubrange(index * 4..<index * 4 + 4, with: [255, 255, 255, 255])
+        }
+        return volume.TransferFunction(texels, 256)
+    }
+
+    private func uniforms(alpha: Float) -> volume.FragmentUniforms {
+        var uniforms = volume.FragmentUniforms()
+        uniforms.instanceCount = 64
+        uniforms.maxValue = 1000
+        uniforms.alpha = alpha
+        return uniforms
+    }
+
+    // An orthographic view straight down z, just covering the volume.
+    private func camera() -> volume.Camera {
+        var camera = volume.Camera()
+        camera.fieldOfView = 0
+        camera.orthographicHeight = 1
+        return camera
+    }
+
+    func testMatchesSliceOpacity() {
+        // Uniform material at 0.5 of maxValue: the slice renderer blends 64 slices of alpha / 64 each.
+        let values = [UInt16](repeating: 500, count: 16 * 16 * 16)
+        values.withUnsafeBufferPointer { values in
+            var source = volume.Volume()
+            source.values = values.baseAddress
+            source.width = 16
+            source.height = 16
+            source.depth = 16
+            let renderer = volume.Renderer(source, 4)
+            let expected = 1 - pow(1 - Float(4) / 64, 64)
+            for stepSize: Float in [0.25, 1, 2] {
+                var options = volume.RenderOptions()
+                options.stepSize = stepSize
+                options.opacityThreshold = 2
+                var pixels = [Float](repeating: -1, count: 8 * 8 * 4)
+                let statistics = renderer.render(transferFunction(), uniforms(alpha: 4), camera(), 8, 8, &pixels, options)
+                XCTAssertEqual(statistics.rays, 64)
+                XCTAssertEqual(pixels[3], expected, accuracy: 1e-3)
+                XCTAssertEqual(pixels[0], pixels[3], accuracy: 1e-6)
+            }
+        }
+    }
+
+    func testSkipsEmptyBricksAndTerminatesRays() {
+        // A 32³ volume that is empty (0) except for a solid cube in its back half.
+        var values = [UInt16](repeating: 0, count: 32 * 32 * 32)
+        for z in 20..<28 {
+            for y in 8..<24 {
+                for x in 8..<24 {
+                    values[(z * 32 + y) * 32 + x] = 900
+                }
+            }
+        }
+        values.withUnsafeBufferPointer { values in
+            var source = volume.Volume()
+            source.values = values.baseAddress
+            source.width = 32
+            source.height = 32
+            source.depth = 32
+            let renderer = volume.Renderer(source, 8)
+            XCTAssertEqual(renderer.brickDimensions()[0], 4)
+            XCTAssertEqual(renderer.brickMaximum(0), 0)
+
+            var options = volume.RenderOptions()
+            var skipped = [Float](repeating: 0, count: 16 * 16 * 4)
+            let fast = renderer.render(transferFunction(), uniforms(alpha: 200), camera(), 16, 16, &skipped, options)
+            options.skipEmptySpace = false
+            options.opacityThreshold = 2
+            var full = [Float](repeating: 0, count: 16 * 16 * 4)
+            let slow = renderer.render(transferFunction(), uniforms(alpha: 200), camera(), 16, 16, &full, options)
+
+            XCTAssertGreaterThan(fast.skippedSamples, 0)
+            XCTAssertGreaterThan(fast.terminatedRays, 0)
+            XCTAssertLessThan(fast.samples, slow.samples / 4)
+            XCTAssertEqual(slow.skippedSamples, 0)
+            for index in 0..<full.count {
+                XCTAssertEqual(skipped[index], full[index], accuracy: 0.011)
+            }
+            // The centre sees the cube, the corner only empty space.
+            XCTAssertGreaterThan(skipped[(8 * 16 + 8) * 4 + 3], 0.98)
+            XCTAssertEqual(skipped[3], 0)
+        }
+    }
+}
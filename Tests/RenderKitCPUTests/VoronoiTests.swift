@@ -0,0 +1,48 @@
+import RenderKitCPU
+import XCTest
+
+final class VoronoiTests: XCTestCase {
+    func testTilesMatchPerPixelSamples() throws {
+        // Cells larger and smaller than a pixel, so both the cached and the direct paths run.
+        for (size, offset) in [((Float(37.5), Float(21)), (Float(-1000), Float(12.25))), ((Float(0.4), Float(0.9)), (Float(3), Float(-7)))] {
+            let width = 131, height = 70
+            var parameters = voronoi.Parameters()
+            parameters.size = size
+            parameters.offset = offset
+            for mode in [voronoi.Mode.distance, voronoi.Mode.edgeDistance, voronoi.Mode.edgeMask] {
+                parameters.mode = mode
+                var pixels = [Float](repeating: 0, count: width * height * 4)
+                pixels.withUnsafeMutableBufferPointer { voronoi.generate(parameters, $0.baseAddress, UInt32(width), UInt32(height), 0) }
+                for y in 0 ..< height {
+                    for x in 0 ..< width {
+                        let sample = voronoi.sample((Float(x) + offset.0) / size.0, (Float(y) + offset.1) / size.1)
+                        let expected: Float
+                        switch mode {
+                        case .distance:
+                            expected = sample.distance
+                        case .edgeDistance:
+                            expected = sample.edgeDistance
+                        default:
+                            expected = sample.edgeDistance > 0.05 ? 0 : 1
+                        }
+                        XCTAssertEqual(pixels[(y * width + x) * 4], expected)
+                    }
+                }
+            }
+        }
+    }
+
+    func testJumpFloodFindsNearestSeeds() throws {
+        let width = 97, height = 61
+        let seeds = (0 ..< 60).map { _ in voronoi.Seed(x: Float.random(in: -5 ... Float(width) + 5), y: Float.random(in: -5 ... Float(height) + 5)) }
+        var nearest = [UInt32](repeating: 0, count: width * height)
+        nearest.withUnsafeMutableBufferPointer { voronoi.jumpFlood(seeds, seeds.count, UInt32(width), UInt32(height), $0.baseAddress) }
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                let distances = seeds.map { ($0.x - Float(x)) * ($0.x - Float(x)) + ($0.y - Float(y)) * ($0.y - Float(y)) }
+                // Jump flooding is approximate; allow the odd pixel to land on a seed that is nearly as close.
+                XCTAssertLessThanOrEqual(distances[Int(nearest[y * width + x])].squareRoot(), distances.min()!.squareRoot() + 2)
+            }
+        }
+    }
+}
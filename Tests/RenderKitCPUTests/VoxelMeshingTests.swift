@@ -0,0 +1,74 @@
+import RenderKitCPU
+import XCTest
+
+final class VoxelMeshingTests: XCTestCase {
+    func testHalfConversions() throws {
+        for bits in UInt16(0) ... UInt16.max where bits & 0x7C00 != 0x7C00 {
+            XCTAssertEqual(half.fromFloat(half.toFloat(bits)), bits)
+        }
+        let expected: [(Float, UInt16)] = [(1, 0x3C00), (-2, 0xC000), (0.1, 0x2E66), (1.0 / 3, 0x3555), (65504, 0x7BFF), (65519, 0x7BFF), (65520, 0x7C00), (0x1p-24, 0x0001), (0x1p-25, 0x0000), (.infinity, 0x7C00)]
+        for (value, bits) in expected {
+            XCTAssertEqual(half.fromFloat(value), bits)
+        }
+    }
+
+    func testSolidBlockIsSixQuads() throws {
+        let colors = [UInt8](repeating: 7, count: 5 * 4 * 3)
+        func mesh(greedy: Bool) -> voxels.VoxelMesh {
+            colors.withUnsafeBufferPointer { buffer in
+                var grid = voxels.VoxelGrid()
+                grid.colors = buffer.baseAddress
+                grid.width = 5
+                grid.height = 4
+                grid.depth = 3
+                return voxels.meshVoxels(grid, voxels.VoxelSize(), greedy)
+            }
+        }
+        let mesh = mesh(greedy: true)
+        XCTAssertEqual(mesh.vertices.size(), 24)
+        XCTAssertEqual(mesh.indices.size(), 36)
+        XCTAssertTrue(mesh.vertices.allSatisfy { $0.colorIndex == 7 })
+
+        // Against `voxelsToVertices`' 24 vertices and 36 indices per voxel.
+        let culled = mesh(greedy: false)
+        XCTAssertEqual(culled.vertices.size(), 4 * 2 * (5 * 4 + 4 * 3 + 5 * 3))
+    }
+
+    func testGreedyQuadsCoverTheVisibleFaces() throws {
+        // A random model with few colours, meshed both ways; the total area per (normal, colour) must agree.
+        var generator = SystemRandomNumberGenerator()
+        var input: [voxels.MagicaVoxel] = []
+        for z in 0 ..< 12 {
+            for y in 0 ..< 9 {
+                for x in 0 ..< 14 where Int.random(in: 0 ..< 3, using: &generator) != 0 {
+                    var voxel = voxels.MagicaVoxel()
+                    voxel.position = (UInt8(x), UInt8(y), UInt8(z))
+                    voxel.color = UInt8.random(in: 1 ... 3, using: &generator)
+                    input.append(voxel)
+                }
+            }
+        }
+        var size = voxels.VoxelSize()
+        size.x = 0.5
+        size.y = 0.5
+        size.z = 0.5
+        let faces = input.withUnsafeBufferPointer { voxels.meshVoxels($0.baseAddress, $0.count, size, false) }
+        let greedy = input.withUnsafeBufferPointer { voxels.meshVoxels($0.baseAddress, $0.count, size, true) }
+        XCTAssertLessThan(greedy.vertices.size(), faces.vertices.size())
+
+        func areas(_ mesh: voxels.VoxelMesh) -> [String: Float] {
+            var result: [String: Float] = [:]
+            let vertices = Array(mesh.vertices)
+            for quad in 0 ..< vertices.count / 4 {
+                let corners = (0 ..< 4).map { vertices[quad * 4 + $0] }
+                let normal = [corners[0].normal.0, corners[0].normal.1, corners[0].normal.2].map { half.toFloat($0) }
+                let positions = corners.map { [half.toFloat($0.position.0), half.toFloat($0.position.1), half.toFloat($0.position.2)] }
+                let extents = (0 ..< 3).map { axis in positions.map { $0[axis] }.max()! - positions.map { $0[axis] }.min()! }
+                let area = extents.filter { $0 > 0 }.reduce(1, *)
+                result["\(normal) \(corners[0].colorIndex)", default: 0] += area
+            }
+            return result
+        }
+        XCTAssertEqual(areas(faces), areas(greedy))
+    }
+}
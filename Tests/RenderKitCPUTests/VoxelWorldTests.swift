@@ -0,0 +1,189 @@
+import Foundation
+import RenderKitCPU
+import XCTest
+
+final class VoxelWorldTests: XCTestCase {
+    private static func word(_ value: UInt32) -> [UInt8] {
+        withUnsafeBytes(of: value.littleEndian) { Array($0) }
+    }
+
+    private static func string(_ value: String) -> [UInt8] {
+        word(UInt32(value.utf8.count)) + Array(value.utf8)
+    }
+
+    private static func chunk(_ id: String, _ content: [UInt8]) -> [UInt8] {
+        Array(id.utf8) + word(UInt32(content.count)) + word(0) + content
+    }
+
+    // A version 150 file with one model of `size` holding `voxels` (x, y, z, colour index), placed by a single transform node when `translation` is given, or by the scene graph chunks in `nodes`.
+    private func voxFile(size: (UInt32, UInt32, UInt32), voxels: [(UInt8, UInt8, UInt8, UInt8)], translation: (Int, Int, Int)? = nil, nodes: [UInt8] = []) -> Data {
+        let word = Self.word, string = Self.string, chunk = Self.chunk
+        var children = chunk("SIZE", word(size.0) + word(size.1) + word(size.2))
+        children += chunk("XYZI", word(UInt32(voxels.count)) + voxels.flatMap { [$0.0, $0.1, $0.2, $0.3] })
+        if let translation {
+            let frame = word(1) + string("_t") + string("\(translation.0) \(translation.1) \(translation.2)")
+            children += chunk("nTRN", word(0) + word(0) + word(1) + word(UInt32.max) + word(0) + word(1) + frame)
+            children += chunk("nSHP", word(1) + word(0) + word(1) + word(0) + word(0))
+        }
+        children += nodes
+        return Data(Array("VOX ".utf8) + word(150) + Array("MAIN".utf8) + word(0) + word(UInt32(children.count)) + children)
+    }
+
+    func testParsesModelsAndSceneGraph() throws {
+        let data = voxFile(size: (4, 6, 8), voxels: [(0, 0, 0, 1), (3, 5, 7, 9)], translation: (100, -20, 5))
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("VoxelWorldTests-\(UUID().uuidString).vox")
+        try data.write(to: url)
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        var file = voxels.VoxFile()
+        XCTAssertTrue(file.open(std.string(url.path)))
+        XCTAssertEqual(file.models().size(), 1)
+        XCTAssertEqual(file.models()[0].voxelCount, 2)
+        let magicaVoxels = file.magicaVoxels(0)
+        XCTAssertEqual(magicaVoxels[1].position.0, 3)
+        XCTAssertEqual(magicaVoxels[1].color, 9)
+
+        // Voxel v lands on v - size / 2 + translation.
+        XCTAssertEqual(file.instances().size(), 1)
+        let instance = file.instances()[0]
+        XCTAssertEqual(instance.minimum.0, 98)
+        XCTAssertEqual(instance.minimum.1, -23)
+        XCTAssertEqual(instance.maximum.2, 9)
+
+        var world = voxels.VoxelWorld()
+        world.add(file, 0, 0, 0)
+        XCTAssertEqual(world.get(98, -23, 1), 0)
+        XCTAssertGreaterThan(world.update(100, -20, 5, 10), 0)
+        XCTAssertEqual(world.get(98, -23, 1), 1)
+        XCTAssertEqual(world.get(101, -18, 8), 9)
+
+        var garbage = data
+        garbage[4] = 1
+        var broken = voxels.VoxFile()
+        garbage.withUnsafeBytes { XCTAssertFalse(broken.parse($0.bindMemory(to: UInt8.self).baseAddress, $0.count)) }
+    }
+
+    func testLoadsChunksLazilyAroundAPoint() throws {
+        var solid: [(UInt8, UInt8, UInt8, UInt8)] = []
+        for z in 0 ..< 64 {
+            for y in 0 ..< 8 {
+                for x in 0 ..< 64 {
+                    solid.append((UInt8(x), UInt8(y), UInt8(z), 3))
+                }
+            }
+        }
+        let data = voxFile(size: (64, 8, 64), voxels: solid)
+        try data.withUnsafeBytes { bytes in
+            var file = voxels.VoxFile()
+            XCTAssertTrue(file.parse(bytes.bindMemory(to: UInt8.self).baseAddress, bytes.count))
+            // A row of ten copies along x, 640 voxels long.
+            var world = voxels.VoxelWorld()
+            for copy in 0 ..< 10 {
+                world.add(file, Int32(copy * 64), 0, 0)
+            }
+            XCTAssertEqual(world.instanceCount(), 10)
+
+            XCTAssertGreaterThan(world.update(16, 4, 16, 20), 0)
+            XCTAssertEqual(world.get(0, 0, 0), 3)
+            XCTAssertEqual(world.get(600, 0, 0), 0)
+            XCTAssertEqual(world.update(17, 4, 16, 20), 0)
+
+            // Far along the row the first chunks are evicted and the last ones loaded.
+            world.update(620, 4, 16, 20)
+            XCTAssertEqual(world.get(0, 0, 0), 0)
+            XCTAssertEqual(world.get(600, 0, 0), 3)
+            XCTAssertLessThan(world.store().memoryBytes(), 16 * 32 * 32 * 32)
+
+            var box = [UInt8](repeating: 0, count: 40 * 8 * 40)
+            box.withUnsafeMutableBufferPointer { world.store().extract(600, 0, 0, 40, 8, 40, $0.baseAddress) }
+            XCTAssertTrue(box.allSatisfy { $0 == 3 })
+        }
+    }
+
+    func testInstancesAddedLaterReloadLoadedChunks() throws {
+        var solid: [(UInt8, UInt8, UInt8, UInt8)] = []
+        for z in 0 ..< 32 {
+            for y in 0 ..< 8 {
+                for x in 0 ..< 32 {
+                    solid.append((UInt8(x), UInt8(y), UInt8(z), 3))
+                }
+            }
+        }
+        let ground = voxFile(size: (32, 8, 32), voxels: solid)
+        let marker = voxFile(size: (1, 1, 1), voxels: [(0, 0, 0, 5)])
+        try ground.withUnsafeBytes { groundBytes in
+            try marker.withUnsafeBytes { markerBytes in
+                var groundFile = voxels.VoxFile(), markerFile = voxels.VoxFile()
+                XCTAssertTrue(groundFile.parse(groundBytes.bindMemory(to: UInt8.self).baseAddress, groundBytes.count))
+                XCTAssertTrue(markerFile.parse(markerBytes.bindMemory(to: UInt8.self).baseAddress, markerBytes.count))
+                var world = voxels.VoxelWorld()
+                world.add(groundFile, 0, 0, 0)
+                XCTAssertEqual(world.update(16, 4, 16, 20), 1)
+                XCTAssertEqual(world.get(10, 2, 10), 3)
+
+                // The marker lands inside the loaded chunk, and being added last it wins.
+                world.add(markerFile, 10, 2, 10)
+                XCTAssertEqual(world.get(10, 2, 10), 0)
+                XCTAssertEqual(world.update(16, 4, 16, 20), 1)
+                XCTAssertEqual(world.get(10, 2, 10), 5)
+                XCTAssertEqual(world.get(11, 2, 10), 3)
+            }
+        }
+    }
+
+    func testRejectsCyclicAndExplodingSceneGraphs() {
+        let word = Self.word, chunk = Self.chunk
+        func parse(_ data: Data) -> voxels.VoxFile {
+            var file = voxels.VoxFile()
+            data.withUnsafeBytes { _ = file.parse($0.bindMemory(to: UInt8.self).baseAddress, $0.count) }
+            return file
+        }
+        func transform(_ id: UInt32, child: UInt32) -> [UInt8] {
+            chunk("nTRN", word(id) + word(0) + word(child) + word(UInt32.max) + word(0) + word(0))
+        }
+        func group(_ id: UInt32, children: [UInt32]) -> [UInt8] {
+            chunk("nGRP", word(id) + word(0) + word(UInt32(children.count)) + children.flatMap(word))
+        }
+        let shape = chunk("nSHP", word(99) + word(0) + word(1) + word(0) + word(0))
+
+        // Group 1 lists itself twice beside the shape.
+        let cyclic = parse(voxFile(size: (1, 1, 1), voxels: [(0, 0, 0, 1)], nodes: transform(0, child: 1) + group(1, children: [1, 1, 99]) + shape))
+        XCTAssertTrue(String(cyclic.error()).contains("contains itself"))
+        XCTAssertEqual(cyclic.instances().size(), 0)
+
+        // Forty groups that each list the next twice: no cycle, but 2^40 paths to the shape.
+        var doubling = transform(0, child: 1)
+        for level: UInt32 in 1 ... 40 {
+            doubling += group(level, children: level == 40 ? [99] : [level + 1, level + 1])
+        }
+        XCTAssertEqual(String(parse(voxFile(size: (1, 1, 1), voxels: [(0, 0, 0, 1)], nodes: doubling + shape)).error()), "scene graph too deep or too large")
+
+        // Shared groups within the budget still place one instance per path.
+        var shared = transform(0, child: 1)
+        for level: UInt32 in 1 ... 3 {
+            shared += group(level, children: level == 3 ? [99] : [level + 1, level + 1])
+        }
+        let file = parse(voxFile(size: (1, 1, 1), voxels: [(0, 0, 0, 1)], nodes: shared + shape))
+        XCTAssertTrue(file.error().empty())
+        XCTAssertEqual(file.instances().size(), 4)
+    }
+
+    func testClampsVoxelsOutsideTheModel() throws {
+        // MagicaVoxel never writes these, but the file format allows them.
+        let data = voxFile(size: (4, 4, 4), voxels: [(1, 1, 1, 2), (9, 1, 200, 7)])
+        try data.withUnsafeBytes { bytes in
+            var file = voxels.VoxFile()
+            XCTAssertTrue(file.parse(bytes.bindMemory(to: UInt8.self).baseAddress, bytes.count))
+            let magicaVoxels = file.magicaVoxels(0)
+            XCTAssertEqual(magicaVoxels[1].position.0, 3)
+            XCTAssertEqual(magicaVoxels[1].position.2, 3)
+
+            // The model sits with its corner at the origin, so (3, 1, 3) is the clamped voxel.
+            var world = voxels.VoxelWorld()
+            world.add(file, 0, 0, 0)
+            XCTAssertGreaterThan(world.update(0, 0, 0, 10), 0)
+            XCTAssertEqual(world.get(1, 1, 1), 2)
+            XCTAssertEqual(world.get(3, 1, 3), 7)
+        }
+    }
+}
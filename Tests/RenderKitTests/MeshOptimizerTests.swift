@@ -0,0 +1,103 @@
+@testable import RenderKit
+import simd
+import XCTest
+
+final class MeshOptimizerTests: XCTestCase {
+    // A UV sphere with its triangles shuffled, as generated meshes often arrive.
+    func sphere(slices: Int = 64, stacks: Int = 32) -> (indices: [UInt32], positions: [SIMD3<Float>]) {
+        var positions: [SIMD3<Float>] = []
+        for stack in 0 ... stacks {
+            let phi = Float.pi * Float(stack) / Float(stacks)
+            for slice in 0 ... slices {
+                let theta = 2 * Float.pi * Float(slice) / Float(slices)
+                positions.append([sin(phi) * cos(theta), cos(phi), sin(phi) * sin(theta)])
+            }
+        }
+        var triangles: [[UInt32]] = []
+        for stack in 0 ..< stacks {
+            for slice in 0 ..< slices {
+                let a = UInt32(stack * (slices + 1) + slice)
+                let b = a + UInt32(slices + 1)
+                triangles.append([a, b, a + 1])
+                triangles.append([a + 1, b, b + 1])
+            }
+        }
+        var state: UInt64 = 0x2545_F491_4F6C_DD1D
+        for index in triangles.indices.reversed() {
+            state = state &* 6_364_136_223_846_793_005 &+ 1_442_695_040_888_963_407
+            triangles.swapAt(index, Int((state >> 33) % UInt64(index + 1)))
+        }
+        return (Array(triangles.joined()), positions)
+    }
+
+    // Triangles rotated to start at their smallest index, so winding is kept but the starting corner isn't.
+    func triangleSet(_ indices: [UInt32]) -> [[UInt32]] {
+        stride(from: 0, to: indices.count, by: 3).map { start in
+            let triangle = Array(indices[start ..< start + 3])
+            let first = triangle.firstIndex(of: triangle.min()!)!
+            return (0 ..< 3).map { triangle[(first + $0) % 3] }
+        }
+        .sorted { $0.lexicographicallyPrecedes($1) }
+    }
+
+    func testVertexCache() throws {
+        let (indices, positions) = sphere()
+        let before = MeshOptimizer.analyzeVertexCache(indices: indices, vertexCount: positions.count)
+        XCTAssertEqual(before.triangleCount, 64 * 32 * 2)
+        XCTAssertEqual(before.vertexCount, positions.count)
+        XCTAssertGreaterThan(before.acmr, 2.5)
+
+        let optimized = MeshOptimizer.optimizeVertexCache(indices: indices, vertexCount: positions.count)
+        XCTAssertEqual(triangleSet(optimized), triangleSet(indices))
+        let after = MeshOptimizer.analyzeVertexCache(indices: optimized, vertexCount: positions.count)
+        XCTAssertLessThan(after.acmr, 0.7)
+        XCTAssertLessThan(after.atvr, 1.3)
+    }
+
+    func testOverdraw() throws {
+        let (indices, positions) = sphere()
+        let cacheOrdered = MeshOptimizer.optimizeVertexCache(indices: indices, vertexCount: positions.count)
+        let optimized = MeshOptimizer.optimizeOverdraw(indices: cacheOrdered, positions: positions)
+        XCTAssertEqual(triangleSet(optimized), triangleSet(indices))
+        XCTAssertNotEqual(optimized, cacheOrdered)
+        // Splitting clusters costs at most a little of the cache order's gain.
+        let cacheACMR = MeshOptimizer.analyzeVertexCache(indices: cacheOrdered, vertexCount: positions.count).acmr
+        let overdrawACMR = MeshOptimizer.analyzeVertexCache(indices: optimized, vertexCount: positions.count).acmr
+        XCTAssertLessThan(overdrawACMR, cacheACMR * 1.15)
+    }
+
+    func testVertexFetchRemap() throws {
+        let (remap, vertexCount) = MeshOptimizer.vertexFetchRemap(indices: [4, 2, 0, 2, 4, 5], vertexCount: 6)
+        XCTAssertEqual(vertexCount, 4)
+        XCTAssertEqual(remap, [2, nil, 1, nil, 0, 3])
+        XCTAssertEqual(MeshOptimizer.remapIndices([4, 2, 0, 2, 4, 5], with: remap), [0, 1, 2, 1, 0, 3])
+        XCTAssertEqual(MeshOptimizer.remapVertices(["a", "b", "c", "d", "e", "f"], with: remap, vertexCount: vertexCount), ["e", "c", "a", "f"])
+    }
+
+    func testOptimizeKeepsContent() throws {
+        let (indices, positions) = sphere(slices: 16, stacks: 8)
+        let vertices = positions.map { SimpleVertex(position: $0, normal: normalize($0), textureCoordinate: .zero) }
+        let result = MeshOptimizer.optimize(indices: indices, vertices: vertices, position: \.position)
+        XCTAssertLessThan(result.report.after.acmr, result.report.before.acmr)
+        XCTAssertLessThanOrEqual(result.report.after.atvr, result.report.before.atvr)
+
+        // Triangles by position, rotated to start at their lexicographically smallest corner.
+        func triangles(_ indices: [UInt32], _ vertices: [SimpleVertex]) -> Set<[SIMD3<Float>]> {
+            Set(stride(from: 0, to: indices.count, by: 3).map { start in
+                let corners = (0 ..< 3).map { vertices[Int(indices[start + $0])].position }
+                let rotations = (0 ..< 3).map { rotation in (0 ..< 3).map { corners[(rotation + $0) % 3] } }
+                return rotations.min { a, b in
+                    a.flatMap { [$0.x, $0.y, $0.z] }.lexicographicallyPrecedes(b.flatMap { [$0.x, $0.y, $0.z] })
+                }!
+            })
+        }
+        XCTAssertEqual(triangles(result.indices, result.vertices), triangles(indices, vertices))
+        // Fetch order: each vertex is first used after every vertex before it.
+        var next: UInt32 = 0
+        for index in result.indices where index >= next {
+            XCTAssertEqual(index, next)
+            next += 1
+        }
+        XCTAssertEqual(Int(next), result.vertices.count)
+    }
+}
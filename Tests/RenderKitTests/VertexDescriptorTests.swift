@@ -50,4 +50,12 @@ final class VertexDescriptorTests: XCTestCase {
              format = MTLAttributeFormatFloat2
 */
     }
+
+    func testQuantizedVertexDescriptor() throws {
+        let d = VertexDescriptor.packed(semantics: [.position, .normal, .textureCoordinate], quantized: true)
+        XCTAssertEqual(d.layouts[0].attributes[0], .init(semantic: .position, format: .ushort4Normalized, offset: 0))
+        XCTAssertEqual(d.layouts[0].attributes[1], .init(semantic: .normal, format: .short2Normalized, offset: 8))
+        XCTAssertEqual(d.layouts[0].attributes[2], .init(semantic: .textureCoordinate, format: .half2, offset: 12))
+        XCTAssertEqual(d.layouts[0].stride, 16)
+    }
 }